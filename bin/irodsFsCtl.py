@@ -12,6 +12,10 @@ import array
 IOCTL_APP_NUMBER = 0xEE
 IFUSEIOC_RESET_METADATA_CACHE = 0
 IFUSEIOC_SHOW_CONNECTIONS = 1
+IFUSEIOC_SHOW_READ_COPIES = 2
+IFUSEIOC_SHOW_ADMISSION = 3
+IFUSEIOC_SHOW_BUFFER_POOL = 4
+IFUSEIOC_SHOW_WRITES = 5
 
 
 _IOC_NRBITS = 8
@@ -61,37 +65,191 @@ def reset_cache(mount_path):
         print "Done!"
     os.close(fd)
     
+CONN_REPORT_FIELDS = [
+    ("inuseShortOpConn", "In-Use ShortOp Conn"),
+    ("inuseConn", "In-Use Conn"),
+    ("inuseOnetimeuseConn", "In-Use OneTimeUse Conn"),
+    ("freeShortopConn", "Free ShortOp Conn"),
+    ("freeConn", "Free Conn"),
+    ("maxShortopConn", "Max ShortOp Conn"),
+    ("shortopConnUsers", "ShortOp Conn Users"),
+    ("connWaiters", "Conn Waiters"),
+    ("connWaitCount", "Conn Waits"),
+    ("connWaitTimeoutCount", "Conn Wait Timeouts"),
+    ("connWaitAvgMSec", "Conn Wait Avg (ms)"),
+    ("connWaitMaxMSec", "Conn Wait Max (ms)"),
+    ("minConn", "Min Conn"),
+    ("maxConn", "Max Conn"),
+    ("targetConn", "Target Conn (pool size)"),
+    ("connGrowCount", "Pool Grows"),
+    ("connShrinkCount", "Pool Shrinks"),
+    ("connQueueDelayAvgUSec", "Conn Queueing Delay Avg (us)"),
+    ("connUtilization", "Conn Utilization (%)"),
+    ("directConn", "Direct Data-Path Conn"),
+    ("endpoints", "iRODS Endpoints"),
+    ("ejectedEndpoints", "Ejected Endpoints"),
+    ("keepAliveCount", "Keep-Alive Requests"),
+    ("keepAliveFailCount", "Keep-Alive Failures"),
+    ("keepAliveSkipCount", "Keep-Alive Skipped (busy)"),
+    ("keepAliveLockHoldUSec", "Keep-Alive Lock Hold (us)"),
+    ("keepAliveLockHoldMaxUSec", "Keep-Alive Lock Hold Max (us)"),
+    ("engineWorkers", "Engine Workers"),
+    ("engineQueued", "Engine Queued Requests"),
+    ("engineRunning", "Engine Running Requests"),
+    ("engineMaxQueued", "Engine Max Queued Requests"),
+    ("engineInlineCount", "Engine Requests Run by Waiters"),
+    ("backgroundConn", "Connections Taken by Background Requests"),
+    ("maxBackgroundConn", "Max Connections for Background Requests"),
+    ("breakerState", "Circuit Breaker State (0: closed, 1: open, 2: probing)"),
+    ("breakerOpenCount", "Circuit Breaker Opened"),
+    ("breakerFastFailCount", "Requests Failed Fast by Circuit Breaker"),
+]
+
 def show_connections(mount_path):
     print "show connections: %s" % (mount_path)
     
     fd = os.open(mount_path, os.O_DIRECTORY)
-    buf = array.array('i', [0,0,0,0,0])
-    status = fcntl.ioctl(fd, _IOR(IOCTL_APP_NUMBER, IFUSEIOC_SHOW_CONNECTIONS, 20), buf, 1)
+    buf = array.array('i', [0] * len(CONN_REPORT_FIELDS))
+    status = fcntl.ioctl(fd, _IOR(IOCTL_APP_NUMBER, IFUSEIOC_SHOW_CONNECTIONS, buf.itemsize * len(buf)), buf, 1)
     if status != 0:
         print >> sys.stderr, "failed to show connections"
     else:
-        inuseShortOpConn = buf[0]
-        inuseConn = buf[1]
-        inuseOnetimeuseConn = buf[2]
-        freeShortopConn = buf[3]
-        freeConn = buf[4]
-        
-        print "In-Use ShortOp Conn: %d" % inuseShortOpConn
-        print "In-Use Conn: %d" % inuseConn
-        print "In-Use OneTimeUse Conn: %d" % inuseOnetimeuseConn
-        print "Free ShortOp Conn: %d" % freeShortopConn
-        print "Free Conn: %d" % freeConn
+        for i in range(len(CONN_REPORT_FIELDS)):
+            print "%s: %d" % (CONN_REPORT_FIELDS[i][1], buf[i])
+        print "Done!"
+    os.close(fd)
+
+READ_REPORT_FIELDS = [
+    ("deliveredKB", "Delivered (KB)"),
+    ("directKB", "Received into FUSE Buffer (KB)"),
+    ("copiedKB", "Copied (KB)"),
+    ("copiesPerByteX100", "Copies per Delivered Byte (x100)"),
+    ("hedgedReads", "Hedged Block Reads"),
+    ("hedgeWins", "Hedged Block Reads Won"),
+    ("cacheHits", "Block Cache Hits"),
+    ("cacheMisses", "Block Cache Misses"),
+]
+
+def get_read_copies(mount_path):
+    fd = os.open(mount_path, os.O_DIRECTORY)
+    buf = array.array('i', [0] * len(READ_REPORT_FIELDS))
+    status = fcntl.ioctl(fd, _IOR(IOCTL_APP_NUMBER, IFUSEIOC_SHOW_READ_COPIES, buf.itemsize * len(buf)), buf, 1)
+    os.close(fd)
+    if status != 0:
+        return None
+    return buf
+
+def show_read_copies(mount_path):
+    print "show read copies: %s" % (mount_path)
+    
+    buf = get_read_copies(mount_path)
+    if buf is None:
+        print >> sys.stderr, "failed to show read copies"
+    else:
+        for i in range(len(READ_REPORT_FIELDS)):
+            print "%s: %d" % (READ_REPORT_FIELDS[i][1], buf[i])
+        print "Done!"
+
+ADMISSION_REPORT_FIELDS = [
+    ("rpcs", "Requests in Flight"),
+    ("maxRPCs", "Max Requests in Flight"),
+    ("connecting", "Connections Being Established"),
+    ("maxConnecting", "Max Connections Being Established"),
+    ("backgroundKB", "Background Data in Flight (KB)"),
+    ("maxBackgroundKB", "Max Background Data in Flight (KB)"),
+    ("foregroundWaits", "Foreground Waits"),
+    ("foregroundRejected", "Foreground Requests Rejected"),
+    ("foregroundWaitAvgMSec", "Foreground Wait Avg (ms)"),
+    ("foregroundWaitMaxMSec", "Foreground Wait Max (ms)"),
+    ("backgroundWaits", "Background Waits"),
+    ("backgroundRejected", "Background Requests Rejected"),
+    ("backgroundShed", "Background Requests Dropped"),
+]
+
+def show_admission(mount_path):
+    print "show admission: %s" % (mount_path)
+    
+    fd = os.open(mount_path, os.O_DIRECTORY)
+    buf = array.array('i', [0] * len(ADMISSION_REPORT_FIELDS))
+    status = fcntl.ioctl(fd, _IOR(IOCTL_APP_NUMBER, IFUSEIOC_SHOW_ADMISSION, buf.itemsize * len(buf)), buf, 1)
+    if status != 0:
+        print >> sys.stderr, "failed to show admission"
+    else:
+        for i in range(len(ADMISSION_REPORT_FIELDS)):
+            print "%s: %d" % (ADMISSION_REPORT_FIELDS[i][1], buf[i])
+        print "Done!"
+    os.close(fd)
+
+BUFFER_POOL_REPORT_FIELDS = [
+    ("bufferKB", "Buffer Size (KB)"),
+    ("allocatedKB", "Allocated (KB)"),
+    ("inUseKB", "In Use (KB)"),
+    ("maxKB", "Max Allocated (KB)"),
+    ("hugepage", "Huge Pages"),
+    ("threadCacheHits", "Buffers Reused by the Same Thread"),
+    ("poolHits", "Buffers Reused from the Pool"),
+    ("newBuffers", "Buffers Allocated"),
+    ("reclaimed", "Cached Blocks Reclaimed"),
+    ("waits", "Waits for a Buffer"),
+    ("failures", "Allocations Failed"),
+]
+
+def show_buffer_pool(mount_path):
+    print "show buffer pool: %s" % (mount_path)
+    
+    fd = os.open(mount_path, os.O_DIRECTORY)
+    buf = array.array('i', [0] * len(BUFFER_POOL_REPORT_FIELDS))
+    status = fcntl.ioctl(fd, _IOR(IOCTL_APP_NUMBER, IFUSEIOC_SHOW_BUFFER_POOL, buf.itemsize * len(buf)), buf, 1)
+    if status != 0:
+        print >> sys.stderr, "failed to show buffer pool"
+    else:
+        for i in range(len(BUFFER_POOL_REPORT_FIELDS)):
+            print "%s: %d" % (BUFFER_POOL_REPORT_FIELDS[i][1], buf[i])
+        print "Done!"
+    os.close(fd)
+
+WRITE_REPORT_FIELDS = [
+    ("queuedBlocks", "Blocks Handed to Write-behind"),
+    ("writtenBlocks", "Blocks Written Back"),
+    ("pendingKB", "Not Written Yet (KB)"),
+    ("writtenKB", "Written Back (KB)"),
+    ("streamKBPerSec", "Upload Speed per Stream (KB/s)"),
+    ("avgBlockMSec", "Avg Block Upload Time (ms)"),
+    ("errors", "Upload Errors"),
+    ("writerWaits", "Writer Waits for Uploads"),
+    ("writerWaitMSec", "Writer Wait Time (ms)"),
+]
+
+def show_writes(mount_path):
+    print "show writes: %s" % (mount_path)
+    
+    fd = os.open(mount_path, os.O_DIRECTORY)
+    buf = array.array('i', [0] * len(WRITE_REPORT_FIELDS))
+    status = fcntl.ioctl(fd, _IOR(IOCTL_APP_NUMBER, IFUSEIOC_SHOW_WRITES, buf.itemsize * len(buf)), buf, 1)
+    if status != 0:
+        print >> sys.stderr, "failed to show writes"
+    else:
+        for i in range(len(WRITE_REPORT_FIELDS)):
+            print "%s: %d" % (WRITE_REPORT_FIELDS[i][1], buf[i])
         print "Done!"
     os.close(fd)
 
 COMMANDS = {
     "reset_cache": reset_cache,
     "show_connections": show_connections,
+    "show_read_copies": show_read_copies,
+    "show_admission": show_admission,
+    "show_buffer_pool": show_buffer_pool,
+    "show_writes": show_writes,
 }
 
 COMMANDS_DESCS = {
     "reset_cache": "invalidate all caches",
-    "show_connections": "show all established connections"
+    "show_connections": "show all established connections",
+    "show_read_copies": "show bytes copied per byte delivered on the read path",
+    "show_admission": "show requests held or dropped by admission control",
+    "show_buffer_pool": "show block buffers allocated and reused",
+    "show_writes": "show blocks written back in the background and writer waits"
 }
 
 def ioctl(command, mount_path, oargs):
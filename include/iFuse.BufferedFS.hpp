@@ -5,10 +5,38 @@
 #ifndef IFUSE_BUFFEREDFS_HPP
 #define IFUSE_BUFFEREDFS_HPP
 
+#include <list>
+#include <map>
 #include <pthread.h>
 #include "iFuse.Lib.Fd.hpp"
+#include "iFuse.Lib.Engine.hpp"
 
 #define IFUSE_BUFFER_CACHE_BLOCK_SIZE         (1024*1024*1)
+// memory for blocks cached, shared by all descriptors
+#define IFUSE_BUFFER_CACHE_MB                 64
+// memory for dirty blocks of a file, written back when over
+#define IFUSE_BUFFER_DIRTY_MB                 16
+// memory for dirty blocks of all files, including blocks being written back
+#define IFUSE_BUFFER_MAX_DIRTY_MB             128
+
+// completed blocks of a sequential write are uploaded over extra descriptors in parallel
+#define IFUSE_MAX_NUM_WRITE_STRIPE            8
+// 0 means writing back through the file's own descriptor only
+#define IFUSE_WRITE_STRIPE_NUM                0
+
+// a block read slower than this percentile of recent block reads is sent again on another descriptor
+// 0 means no hedging
+#define IFUSE_HEDGE_READ_PERCENTILE           0
+#define IFUSE_HEDGE_LATENCY_SAMPLES           128
+#define IFUSE_HEDGE_MIN_SAMPLES               16
+#define IFUSE_HEDGE_MIN_DELAY_MSEC            10
+
+// size and modification time of a file when opened
+// cached blocks are valid only for descriptors opened with the same stamp
+typedef struct IFuseBufferCacheStamp {
+    off_t size;
+    time_t mtime;
+} iFuseBufferCacheStamp_t;
 
 typedef struct IFuseBufferCache {
     unsigned long fdId;
@@ -16,8 +44,64 @@ typedef struct IFuseBufferCache {
     off_t offset;
     size_t size;
     char *buffer;
+    iFuseBufferCacheStamp_t stamp;
+    // set on access, cleared by the eviction clock
+    int referenced;
+    // readers copying out of the buffer without the lock
+    int refCount;
+    // dropped from the cache, freed by the last reader
+    bool detached;
+    // dirty ranges of a block being written, by in-block offset
+    // ranges are disjoint and not adjacent, size is the end of the last
+    std::map<off_t, size_t> *extents;
 } iFuseBufferCache_t;
 
+// dirty blocks of a file descriptor written back by engine workers
+typedef struct IFuseStripedWrite {
+    unsigned long fdId;
+    char *iRodsPath;
+    int stripeNum;
+    iFuseFd_t *fds[IFUSE_MAX_NUM_WRITE_STRIPE];
+    bool stripeBusy[IFUSE_MAX_NUM_WRITE_STRIPE];
+    // no extra descriptors, fds[0] is the file's own and is not closed here
+    bool ownFd;
+    // blocks handed over and not picked up by a worker yet
+    std::list<iFuseBufferCache_t*> *blocks;
+    std::list<iFuseEngineRequest_t*> *requests;
+    // blocks handed over and not written yet
+    int queued;
+    // end of the blocks handed over, while any is not written yet
+    off_t queuedEndOffset;
+    int running;
+    off_t lastOffset;
+    int error;
+    // references of g_StripedWriteMap and of waiters of other descriptors, the last one frees it
+    int refCount;
+    pthread_mutex_t mutex;
+    pthread_cond_t cond;
+} iFuseStripedWrite_t;
+
+typedef struct IFuseHedgedRead {
+    char *iRodsPath;
+    off_t offset;
+    size_t size;
+    int refCount;
+    int pending;
+    bool done;
+    int status;
+    char *buffer;
+    bool hedgeWon;
+    pthread_mutex_t mutex;
+    pthread_cond_t cond;
+} iFuseHedgedRead_t;
+
+typedef struct IFuseHedgedReadTaskParam {
+    iFuseHedgedRead_t *hedgedRead;
+    iFuseFd_t *iFuseFd;
+    char *buffer;
+    bool hedge;
+} iFuseHedgedReadTaskParam_t;
+
 void iFuseBufferedFSInit();
 void iFuseBufferedFSDestroy();
 
@@ -30,8 +114,11 @@ int iFuseBufferedFsGetAttr(const char *iRodsPath, struct stat *stbuf);
 int iFuseBufferedFsOpen(const char *iRodsPath, iFuseFd_t **iFuseFd, int openFlag);
 int iFuseBufferedFsClose(iFuseFd_t *iFuseFd);
 int iFuseBufferedFsFlush(iFuseFd_t *iFuseFd);
-int iFuseBufferedFsReadBlock(iFuseFd_t *iFuseFd, char *buf, unsigned int blockID);
+int iFuseBufferedFsReadBlock(iFuseFd_t *iFuseFd, char *buf, unsigned int blockID, off_t inBlockOffset, size_t size);
 int iFuseBufferedFsRead(iFuseFd_t *iFuseFd, char *buf, off_t off, size_t size);
 int iFuseBufferedFsWrite(iFuseFd_t *iFuseFd, const char *buf, off_t off, size_t size);
+int iFuseBufferedFsUnlink(const char *iRodsPath);
+int iFuseBufferedFsRename(const char *iRodsFromPath, const char *iRodsToPath);
+int iFuseBufferedFsTruncate(const char *iRodsPath, off_t size);
 
 #endif	/* IFUSE_BUFFEREDFS_HPP */
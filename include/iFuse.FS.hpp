@@ -11,6 +11,8 @@
 #include "iFuse.Lib.hpp"
 #include "iFuse.Lib.Fd.hpp"
 #include "iFuse.Lib.Conn.hpp"
+#include "iFuse.Lib.Admission.hpp"
+#include "iFuse.Lib.BufferPool.hpp"
 
 #define DEF_FILE_MODE	0660
 #define DEF_DIR_MODE	0770
@@ -21,6 +23,33 @@
 
 #define IFUSEIOC_RESET_METADATA_CACHE _IO(IOCTL_APP_NUMBER, 0)
 #define IFUSEIOC_SHOW_CONNECTIONS _IOR(IOCTL_APP_NUMBER, 1, iFuseFsConnReport_t)
+#define IFUSEIOC_SHOW_READ_COPIES _IOR(IOCTL_APP_NUMBER, 2, iFuseFsReadReport_t)
+#define IFUSEIOC_SHOW_ADMISSION _IOR(IOCTL_APP_NUMBER, 3, iFuseFsAdmissionReport_t)
+#define IFUSEIOC_SHOW_BUFFER_POOL _IOR(IOCTL_APP_NUMBER, 4, iFuseBufferPoolReport_t)
+#define IFUSEIOC_SHOW_WRITES _IOR(IOCTL_APP_NUMBER, 5, iFuseFsWriteReport_t)
+
+typedef struct IFuseFsReadReport {
+    int deliveredKB;
+    int directKB;
+    int copiedKB;
+    int copiesPerByteX100;
+    int hedgedReads;
+    int hedgeWins;
+    int cacheHits;
+    int cacheMisses;
+} iFuseFsReadReport_t;
+
+typedef struct IFuseFsWriteReport {
+    int queuedBlocks;
+    int writtenBlocks;
+    int pendingKB;
+    int writtenKB;
+    int streamKBPerSec;
+    int avgBlockMSec;
+    int errors;
+    int writerWaits;
+    int writerWaitMSec;
+} iFuseFsWriteReport_t;
 
 typedef int (*iFuseDirFiller) (void *buf, const char *name, const struct stat *stbuf, off_t off);
 
@@ -44,5 +73,17 @@ int iFuseFsTruncate(const char *iRodsPath, off_t size);
 int iFuseFsChmod(const char *iRodsPath, mode_t mode);
 int iFuseFsIoctl(const char *iRodsPath, int cmd, void *arg, struct fuse_file_info *fi, unsigned int flags, void *data);
 int iFuseFsCacheDir(const char *iRodsPath);
+void iFuseFsCountReadDelivery(size_t size);
+void iFuseFsCountReadDirect(size_t size);
+void iFuseFsCountReadCopy(size_t size);
+void iFuseFsCountReadHedge();
+void iFuseFsCountReadHedgeWin();
+void iFuseFsCountReadCacheHit();
+void iFuseFsCountReadCacheMiss();
+void iFuseFsReadReport(iFuseFsReadReport_t *report);
+void iFuseFsCountWriteBehindQueue(size_t size);
+void iFuseFsCountWriteBehindDone(size_t size, unsigned long long elapsedUSec, int status);
+void iFuseFsCountWriteBehindWait(unsigned long long elapsedUSec);
+void iFuseFsWriteReport(iFuseFsWriteReport_t *report);
 
 #endif	/* IFUSE_FS_HPP */
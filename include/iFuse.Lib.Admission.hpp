@@ -0,0 +1,57 @@
+/*** Copyright (c), The Regents of the University of California            ***
+ *** For more information please refer to files in the COPYRIGHT directory ***/
+/*** This code is written by Illyoung Choi (iychoi@email.arizona.edu)      ***
+ *** funded by iPlantCollaborative (www.iplantcollaborative.org).          ***/
+#ifndef IFUSE_LIB_ADMISSION_HPP
+#define IFUSE_LIB_ADMISSION_HPP
+
+#include <stddef.h>
+
+// limits, 0 means unlimited
+#define IFUSE_ADMISSION_MAX_RPC_NUM             64
+#define IFUSE_ADMISSION_MAX_CONNECTING_NUM      8
+#define IFUSE_ADMISSION_MAX_BACKGROUND_MB       64
+// requests waiting longer than this are rejected
+#define IFUSE_ADMISSION_WAIT_MSEC               1000
+
+typedef struct IFuseFsAdmissionReport {
+    int rpcs;
+    int maxRPCs;
+    int connecting;
+    int maxConnecting;
+    int backgroundKB;
+    int maxBackgroundKB;
+    int foregroundWaits;
+    int foregroundRejected;
+    int foregroundWaitAvgMSec;
+    int foregroundWaitMaxMSec;
+    int backgroundWaits;
+    int backgroundRejected;
+    int backgroundShed;
+} iFuseFsAdmissionReport_t;
+
+/*
+ * Admission control
+ * - RPCs in flight and connections being established are bounded.
+ *   Callers over the limits wait in a queue until others leave, and are
+ *   rejected with -EAGAIN after the admission wait.
+ *   Background callers (engine workers) let foreground callers go first.
+ *   An RPC is admitted before its connection is locked, never while a
+ *   connection lock is held, so holders of the limit do not wait on it.
+ * - Bytes of background requests (preload, striped writes, hedged reads) in
+ *   flight are bounded. New background requests are shed, not queued, when
+ *   the bytes are over the limit or foreground callers are waiting.
+ */
+
+void iFuseAdmissionInit();
+void iFuseAdmissionDestroy();
+void iFuseAdmissionReport(iFuseFsAdmissionReport_t *report);
+int iFuseAdmissionEnterRPC();
+void iFuseAdmissionEnterRPCNoWait();
+void iFuseAdmissionLeaveRPC();
+int iFuseAdmissionEnterConnect();
+void iFuseAdmissionLeaveConnect();
+bool iFuseAdmissionAdmitBackground(size_t size);
+void iFuseAdmissionReleaseBackground(size_t size);
+
+#endif	/* IFUSE_LIB_ADMISSION_HPP */
@@ -0,0 +1,70 @@
+/*** Copyright (c), The Regents of the University of California            ***
+ *** For more information please refer to files in the COPYRIGHT directory ***/
+/*** This code is written by Illyoung Choi (iychoi@email.arizona.edu)      ***
+ *** funded by iPlantCollaborative (www.iplantcollaborative.org).          ***/
+#ifndef IFUSE_LIB_BUFFERPOOL_HPP
+#define IFUSE_LIB_BUFFERPOOL_HPP
+
+#include <pthread.h>
+#include <stddef.h>
+
+// max size of buffers allocated, 0 means unlimited
+#define IFUSE_BUFFER_POOL_MAX_MB                256
+// free buffers kept by a thread for itself
+#define IFUSE_BUFFER_POOL_THREAD_CACHE_NUM      2
+// free buffers kept in the pool, more are returned to the system
+#define IFUSE_BUFFER_POOL_FREE_NUM              32
+// how long an allocation at the limit waits for a buffer to be released
+#define IFUSE_BUFFER_POOL_WAIT_MSEC             1000
+#define IFUSE_BUFFER_POOL_HUGEPAGE_SIZE         (2*1024*1024)
+
+// frees up to size bytes of buffers held elsewhere (e.g., cached blocks)
+// returns the number of buffers freed
+typedef int (*iFuseBufferPoolReclaimCB) (size_t size);
+
+typedef struct IFuseBufferPoolThreadCache {
+    int num;
+    char *buffers[IFUSE_BUFFER_POOL_THREAD_CACHE_NUM];
+    // the thread has exited, the pool frees the cache
+    bool exited;
+    // the pool is destroyed, the thread frees the cache when it exits
+    bool orphaned;
+    pthread_mutex_t mutex;
+} iFuseBufferPoolThreadCache_t;
+
+typedef struct IFuseBufferPoolReport {
+    int bufferKB;
+    int allocatedKB;
+    int inUseKB;
+    int maxKB;
+    int hugepage;
+    int threadCacheHits;
+    int poolHits;
+    int newBuffers;
+    int reclaimed;
+    int waits;
+    int failures;
+} iFuseBufferPoolReport_t;
+
+/*
+ * Pool of block-sized buffers
+ * - Released buffers are kept by the releasing thread first, then by the pool.
+ * - Allocated buffers are bounded. At the limit, buffers are reclaimed from
+ *   the reclaim handler (the block cache), then the caller waits for a
+ *   release up to IFUSE_BUFFER_POOL_WAIT_MSEC and gets NULL. Without wait,
+ *   the caller gets NULL at once, so it may hold locks the handler takes.
+ * - With hugepages, buffers are carved from chunks backed by transparent
+ *   huge pages, chunks are returned to the system only on destroy.
+ * - Buffers are not zero-filled.
+ */
+
+void iFuseBufferPoolInit(size_t bufferSize);
+void iFuseBufferPoolDestroy();
+void iFuseBufferPoolSetReclaimHandler(iFuseBufferPoolReclaimCB callback);
+void iFuseBufferPoolReport(iFuseBufferPoolReport_t *report);
+size_t iFuseBufferPoolGetBufferSize();
+int iFuseBufferPoolGetMaxBufferNum();
+char *iFuseBufferPoolAlloc(bool wait);
+void iFuseBufferPoolFree(char *buffer);
+
+#endif	/* IFUSE_LIB_BUFFERPOOL_HPP */
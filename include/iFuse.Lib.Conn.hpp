@@ -5,37 +5,129 @@
 #ifndef IFUSE_LIB_CONN_HPP
 #define IFUSE_LIB_CONN_HPP
 
+#include <list>
 #include <pthread.h>
 #include <time.h>
 #include "rodsClient.h"
 
 #define IFUSE_MAX_NUM_CONN	10
+#define IFUSE_MIN_NUM_CONN	2
+#define IFUSE_MAX_NUM_SHORTOP_CONN	3
 
 #define IFUSE_CONN_TYPE_FOR_FILE_IO      0
 #define IFUSE_CONN_TYPE_FOR_SHORTOP      1
 #define IFUSE_CONN_TYPE_FOR_ONETIMEUSE   2
 
+// classes of callers, lower is served first
+// short-op connections serve foreground metadata operations
+// file-io connections taken by engine workers serve background prefetch/write-back
+#define IFUSE_CONN_CLASS_METADATA       0
+#define IFUSE_CONN_CLASS_DATA           1
+#define IFUSE_CONN_CLASS_BACKGROUND     2
+
+// file-io connections background requests may take, 0 means half of max connections
+#define IFUSE_MAX_NUM_BACKGROUND_CONN   0
+
 #define IFUSE_FREE_CONN_CHECK_INTERVAL_SEC  10
 #define IFUSE_FREE_CONN_TIMEOUT_SEC         (60*5)
 #define IFUSE_FREE_CONN_KEEPALIVE_SEC       (60*3)
 
+// 0 means sharing a busy connection immediately without waiting
+#define IFUSE_CONN_WAIT_TIMEOUT_MSEC        0
+
+// average wait for a file-io connection to grow the pool, 0 means fixed pool size
+#define IFUSE_CONN_WAIT_TARGET_MSEC         0
+
+// number of file-io connections established in advance, 0 means no warm-up
+#define IFUSE_CONN_WARMUP_NUM               0
+
+// iRODS hosts serving the same zone, connections are spread over them
+#define IFUSE_MAX_NUM_ENDPOINT              16
+// an endpoint failing to connect this many times in a row is not used for a while
+#define IFUSE_ENDPOINT_MAX_FAIL             3
+#define IFUSE_ENDPOINT_EJECT_SEC            60
+
+// requests fail fast for a cool-down after this many network failures in a row, 0 means disabled
+#define IFUSE_CONN_BREAKER_FAIL_NUM         0
+#define IFUSE_CONN_BREAKER_COOLDOWN_SEC     10
+
+#define IFUSE_CONN_BREAKER_CLOSED       0
+#define IFUSE_CONN_BREAKER_OPEN         1
+#define IFUSE_CONN_BREAKER_HALF_OPEN    2
+
+#define IFUSE_CONN_STATE_CONNECTING     0
+#define IFUSE_CONN_STATE_READY          1
+#define IFUSE_CONN_STATE_FAILED         2
+
 typedef struct IFuseConn {
     unsigned long connId;
     int type;
     rcComm_t *conn;
+    char host[NAME_LEN];
+    int port;
+    bool direct;
+    int endpoint;
+    int connClass;
     time_t lastActTime;
     time_t lastUseTime;
     int inuseCnt;
+    // taken out of the table, freed when no one uses
+    bool discarded;
+    int state;
+    int connectStatus;
+    unsigned long long lockedTime;
+    // time the connection is locked, added atomically
+    unsigned long long busyUSec;
+    unsigned long long lastBusyUSec;
     pthread_rwlockattr_t lockAttr;
     pthread_rwlock_t lock;
+    pthread_mutex_t stateMutex;
+    pthread_cond_t stateCond;
 } iFuseConn_t;
 
+typedef struct IFuseConnKeepAlive {
+    std::list<iFuseConn_t*> *inuseConns;
+    std::list<iFuseConn_t*> *freeConns;
+} iFuseConnKeepAlive_t;
+
 typedef struct IFuseFsConnReport {
     int inuseShortOpConn;
     int inuseConn;
     int inuseOnetimeuseConn;
     int freeShortopConn;
     int freeConn;
+    int maxShortopConn;
+    int shortopConnUsers;
+    int connWaiters;
+    int connWaitCount;
+    int connWaitTimeoutCount;
+    int connWaitAvgMSec;
+    int connWaitMaxMSec;
+    int minConn;
+    int maxConn;
+    int targetConn;
+    int connGrowCount;
+    int connShrinkCount;
+    int connQueueDelayAvgUSec;
+    int connUtilization;
+    int directConn;
+    int endpoints;
+    int ejectedEndpoints;
+    int keepAliveCount;
+    int keepAliveFailCount;
+    int keepAliveSkipCount;
+    int keepAliveLockHoldUSec;
+    int keepAliveLockHoldMaxUSec;
+    int engineWorkers;
+    int engineQueued;
+    int engineRunning;
+    int engineMaxQueued;
+    int engineInlineCount;
+    int backgroundConn;
+    int maxBackgroundConn;
+    int breakerState;
+    int breakerOpenCount;
+    int breakerFastFailCount;
 } iFuseFsConnReport_t;
 
 /*
@@ -53,11 +145,17 @@ int iFuseConnTest();
 void iFuseConnInit();
 void iFuseConnDestroy();
 void iFuseConnReport(iFuseFsConnReport_t *report);
+void iFuseConnWarmUp();
 int iFuseConnGetAndUse(iFuseConn_t **iFuseConn, int connType);
+int iFuseConnGetAndUseForMetadata(iFuseConn_t **iFuseConn, int connType);
+int iFuseConnGetAndUseForHost(iFuseConn_t **iFuseConn, int connType, const char *host);
 int iFuseConnUnuse(iFuseConn_t *iFuseConn);
+void iFuseConnDiscard(iFuseConn_t *iFuseConn);
+int iFuseConnRetryTimedOut(iFuseConn_t *iFuseConn, iFuseConn_t **retryConn);
 void iFuseConnUpdateLastActTime(iFuseConn_t *iFuseConn, bool lock);
 int iFuseConnReconnect(iFuseConn_t *iFuseConn);
-void iFuseConnLock(iFuseConn_t *iFuseConn);
+int iFuseConnLock(iFuseConn_t *iFuseConn);
+void iFuseConnLockForRelease(iFuseConn_t *iFuseConn);
 void iFuseConnUnlock(iFuseConn_t *iFuseConn);
 
 #endif	/* IFUSE_LIB_CONN_HPP */
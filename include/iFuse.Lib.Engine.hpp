@@ -0,0 +1,77 @@
+/*** Copyright (c), The Regents of the University of California            ***
+ *** For more information please refer to files in the COPYRIGHT directory ***/
+/*** This code is written by Illyoung Choi (iychoi@email.arizona.edu)      ***
+ *** funded by iPlantCollaborative (www.iplantcollaborative.org).          ***/
+#ifndef IFUSE_LIB_ENGINE_HPP
+#define IFUSE_LIB_ENGINE_HPP
+
+#include <pthread.h>
+#include <stddef.h>
+
+// worker threads running FUSE requests and background requests (preload, write-back, keep-alive, ...)
+#define IFUSE_ENGINE_WORKER_NUM             16
+#define IFUSE_MAX_ENGINE_WORKER_NUM         256
+
+#define IFUSE_ENGINE_REQUEST_STATE_QUEUED       0
+#define IFUSE_ENGINE_REQUEST_STATE_RUNNING      1
+#define IFUSE_ENGINE_REQUEST_STATE_COMPLETED    2
+
+typedef int (*iFuseEngineTaskCB) (void *param);
+
+typedef struct IFuseEngineRequest {
+    iFuseEngineTaskCB task;
+    void *param;
+    bool foreground;
+    int state;
+    int status;
+    int refCount;
+    // bytes admitted as background work, released when completed
+    size_t admittedSize;
+    pthread_cond_t cond;
+} iFuseEngineRequest_t;
+
+typedef struct IFuseEngineReport {
+    int workers;
+    int queued;
+    int running;
+    int maxQueued;
+    int inlineCount;
+} iFuseEngineReport_t;
+
+/*
+ * Usage pattern
+ * - iFuseEngineInit
+ * - iFuseEngineStart (in FUSE_INIT, threads do not survive daemonizing)
+ * - iFuseEngineSubmit
+ * - iFuseEngineWait
+ * - iFuseEngineRelease
+ * - iFuseEngineStop
+ * - iFuseEngineDestroy
+ *
+ * Waiting for a request still in the queue runs it in the waiting thread,
+ * so a request may wait for others without holding up a worker forever.
+ *
+ * FUSE callbacks go through iFuseEngineRun, which queues a foreground
+ * request and waits. Foreground requests are taken first and background
+ * ones never occupy more than 3/4 of the workers.
+ *
+ * Requests submitted by iFuseEngineSubmitBackground go through admission
+ * control and are shed (-EBUSY) when the server falls behind.
+ */
+
+void iFuseEngineInit();
+void iFuseEngineDestroy();
+void iFuseEngineStart();
+void iFuseEngineStop();
+void iFuseEngineReport(iFuseEngineReport_t *report);
+int iFuseEngineSubmit(iFuseEngineTaskCB task, void *param, iFuseEngineRequest_t **request);
+int iFuseEngineRun(iFuseEngineTaskCB task, void *param);
+int iFuseEngineSubmitBackground(iFuseEngineTaskCB task, void *param, size_t size, iFuseEngineRequest_t **request);
+int iFuseEngineWait(iFuseEngineRequest_t *request);
+int iFuseEngineTimedWait(iFuseEngineRequest_t *request, int msec);
+bool iFuseEngineIsBackgroundThread();
+bool iFuseEngineIsDone(iFuseEngineRequest_t *request);
+bool iFuseEngineCancel(iFuseEngineRequest_t *request);
+void iFuseEngineRelease(iFuseEngineRequest_t *request);
+
+#endif	/* IFUSE_LIB_ENGINE_HPP */
@@ -9,6 +9,16 @@
 #include "iFuse.Lib.Conn.hpp"
 #include "rodsClient.h"
 
+// server-side descriptors of a read-only file, one per interleaved access stream
+#define IFUSE_MAX_NUM_FD_STREAM     8
+#define IFUSE_FD_STREAM_NUM         1
+
+typedef struct IFuseFdStream {
+    int fd;
+    off_t lastFilePointer;
+    unsigned long long lastUseUSec;
+} iFuseFdStream_t;
+
 typedef struct IFuseFd {
     unsigned long fdId;
     int fd;
@@ -16,6 +26,9 @@ typedef struct IFuseFd {
     char *iRodsPath;
     int openFlag;
     off_t lastFilePointer;
+    // streams[0] is the descriptor above, only read-only files have streams
+    int streamNum;
+    iFuseFdStream_t streams[IFUSE_MAX_NUM_FD_STREAM];
     pthread_rwlockattr_t lockAttr;
     pthread_rwlock_t lock;
 } iFuseFd_t;
@@ -35,8 +48,12 @@ void iFuseFdInit();
 void iFuseFdDestroy();
 int iFuseFdOpen(iFuseFd_t **iFuseFd, iFuseConn_t *iFuseConn, const char* iRodsPath, int openFlag);
 int iFuseFdReopen(iFuseFd_t *iFuseFd);
+int iFuseFdRetryTimedOut(iFuseFd_t *iFuseFd, off_t off);
+
+iFuseFdStream_t *iFuseFdGetReadStream(iFuseFd_t *iFuseFd, off_t off);
 int iFuseDirOpen(iFuseDir_t **iFuseDir, iFuseConn_t *iFuseConn, const char* iRodsPath);
 int iFuseDirOpenWithCache(iFuseDir_t **iFuseDir, const char* iRodsPath, const char* cachedEntries, unsigned int entryBufferLen);
+int iFuseDirRetryTimedOut(iFuseDir_t *iFuseDir);
 int iFuseFdClose(iFuseFd_t *iFuseFd);
 int iFuseDirClose(iFuseDir_t *iFuseDir);
 void iFuseFdLock(iFuseFd_t *iFuseFd);
@@ -0,0 +1,29 @@
+/*** Copyright (c), The Regents of the University of California            ***
+ *** For more information please refer to files in the COPYRIGHT directory ***/
+/*** This code is written by Illyoung Choi (iychoi@email.arizona.edu)      ***
+ *** funded by iPlantCollaborative (www.iplantcollaborative.org).          ***/
+#ifndef IFUSE_LIB_MOCKBACKEND_HPP
+#define IFUSE_LIB_MOCKBACKEND_HPP
+
+#include "rodsClient.h"
+#include "iFuse.Lib.RodsClientAPI.hpp"
+
+// same as NUM_L1_DESC of iRODS servers
+#define IFUSE_MOCK_MAX_L1DESC           1026
+// iRODS l1 descriptors 0 ~ 2 are never given to clients
+#define IFUSE_MOCK_MIN_L1DESC           3
+#define IFUSE_MOCK_MAX_COLLHANDLE       256
+
+/*
+ * Mock backend serving iRODS client API calls from a local directory
+ * an iRODS path /zone/home/user/file maps to <rootdir>/zone/home/user/file.
+ * each call is delayed by the given latency, and reads/writes are
+ * further delayed to model the given bandwidth.
+ * like iRODS agents, data object descriptors belong to the connection
+ * opened them, and are closed when the connection is disconnected.
+ */
+void iFuseMockBackendInit(const char *rootDir, int latencyUSec, int bandwidthKBps);
+void iFuseMockBackendDestroy();
+iFuseRodsClientBackend_t *iFuseMockBackendGet();
+
+#endif	/* IFUSE_LIB_MOCKBACKEND_HPP */
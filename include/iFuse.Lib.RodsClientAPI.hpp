@@ -10,12 +10,68 @@
 #include "iFuse.Lib.Util.hpp"
 
 #define IFUSE_RODSCLIENTAPI_TIMEOUT_SEC     (90)
+// number of operations timed at the same time
+#define IFUSE_RODSCLIENTAPI_MAX_OPERATIONS  1024
 
+// operation classes having separate deadlines
+#define IFUSE_RODSCLIENTAPI_CLASS_METADATA  0
+#define IFUSE_RODSCLIENTAPI_CLASS_SMALL_IO  1
+#define IFUSE_RODSCLIENTAPI_CLASS_BULK_IO   2
+#define IFUSE_RODSCLIENTAPI_CLASS_NUM       3
+
+#define IFUSE_RODSCLIENTAPI_METADATA_TIMEOUT_SEC    (30)
+// 0 means following IFUSE_RODSCLIENTAPI_TIMEOUT_SEC
+#define IFUSE_RODSCLIENTAPI_SMALL_IO_TIMEOUT_SEC    (0)
+#define IFUSE_RODSCLIENTAPI_BULK_IO_TIMEOUT_SEC     (0)
+
+// reads and writes larger than this are bulk-io
+#define IFUSE_RODSCLIENTAPI_SMALL_IO_LEN    (64*1024)
+
+/*
+ * Backend serving iRODS client API calls
+ * the default backend talks to iRODS servers through rcComm_t,
+ * others (e.g., the mock backend) can be plugged in at init.
+ */
+typedef struct IFuseRodsClientBackend {
+    const char *name;
+    rcComm_t *(*connect)(const char *rodsHost, int rodsPort, const char *userName, const char *rodsZone, int reconnFlag, rErrMsg_t *errMsg);
+    int (*login)(rcComm_t *conn);
+    int (*disconnect)(rcComm_t *conn);
+    int (*ticketAdmin)(rcComm_t *conn, ticketAdminInp_t *ticketAdminInp);
+    int (*dataObjOpen)(rcComm_t *conn, dataObjInp_t *dataObjInp);
+    int (*dataObjClose)(rcComm_t *conn, openedDataObjInp_t *dataObjCloseInp);
+    int (*openCollection)(rcComm_t *conn, char *collection, int flag, collHandle_t *collHandle);
+    int (*closeCollection)(collHandle_t *collHandle);
+    int (*readCollection)(rcComm_t *conn, collHandle_t *collHandle, collEnt_t *collEnt);
+    int (*getHostForGet)(rcComm_t *conn, dataObjInp_t *dataObjInp, char **outHost);
+    int (*getHostForPut)(rcComm_t *conn, dataObjInp_t *dataObjInp, char **outHost);
+    int (*getMiscSvrInfo)(rcComm_t *conn, miscSvrInfo_t **miscSvrInfoOut);
+    int (*objStat)(rcComm_t *conn, dataObjInp_t *dataObjInp, rodsObjStat_t **rodsObjStatOut);
+    int (*dataObjLseek)(rcComm_t *conn, openedDataObjInp_t *dataObjLseekInp, fileLseekOut_t **dataObjLseekOut);
+    int (*dataObjRead)(rcComm_t *conn, openedDataObjInp_t *dataObjReadInp, bytesBuf_t *dataObjReadOutBBuf);
+    int (*dataObjWrite)(rcComm_t *conn, openedDataObjInp_t *dataObjWriteInp, bytesBuf_t *dataObjWriteInpBBuf);
+    int (*dataObjCreate)(rcComm_t *conn, dataObjInp_t *dataObjInp);
+    int (*dataObjUnlink)(rcComm_t *conn, dataObjInp_t *dataObjUnlinkInp);
+    int (*collCreate)(rcComm_t *conn, collInp_t *collCreateInp);
+    int (*rmColl)(rcComm_t *conn, collInp_t *rmCollInp, int vFlag);
+    int (*dataObjRename)(rcComm_t *conn, dataObjCopyInp_t *dataObjRenameInp);
+    int (*dataObjTruncate)(rcComm_t *conn, dataObjInp_t *dataObjInp);
+    int (*modDataObjMeta)(rcComm_t *conn, modDataObjMeta_t *modDataObjMetaInp);
+} iFuseRodsClientBackend_t;
+
+// called with the status of every timed operation
+// conn is NULL and rttUSec is 0 if the operation was not timed,
+// rttUSec is also 0 for bulk-io taking long for the transfer
+typedef void (*iFuseRodsClientResultHandlerCB) (rcComm_t *conn, int status, unsigned long long rttUSec);
 
 void iFuseRodsClientInit();
 void iFuseRodsClientDestroy();
+void iFuseRodsClientSetResultHandler(iFuseRodsClientResultHandlerCB callback);
+
+const char *iFuseRodsClientGetBackendName();
 
 int iFuseRodsClientReadMsgError(int status);
+int iFuseRodsClientTimedOutError(int status);
 
 rcComm_t *iFuseRodsClientConnect(const char *rodsHost, int rodsPort, const char *userName, const char *rodsZone, int reconnFlag, rErrMsg_t *errMsg);
 int iFuseRodsClientLogin(rcComm_t *conn);
@@ -29,6 +85,9 @@ int iFuseRodsClientDataObjOpen(rcComm_t *conn, dataObjInp_t *dataObjInp);
 int iFuseRodsClientDataObjClose(rcComm_t *conn, openedDataObjInp_t *dataObjCloseInp);
 int iFuseRodsClientOpenCollection( rcComm_t *conn, char *collection, int flag, collHandle_t *collHandle );
 int iFuseRodsClientCloseCollection(collHandle_t *collHandle);
+int iFuseRodsClientGetHostForGet(rcComm_t *conn, dataObjInp_t *dataObjInp, char **outHost);
+int iFuseRodsClientGetHostForPut(rcComm_t *conn, dataObjInp_t *dataObjInp, char **outHost);
+int iFuseRodsClientGetMiscSvrInfo(rcComm_t *conn, miscSvrInfo_t **miscSvrInfoOut);
 int iFuseRodsClientObjStat(rcComm_t *conn, dataObjInp_t *dataObjInp, rodsObjStat_t **rodsObjStatOut);
 int iFuseRodsClientDataObjLseek(rcComm_t *conn, openedDataObjInp_t *dataObjLseekInp, fileLseekOut_t **dataObjLseekOut);
 int iFuseRodsClientDataObjRead(rcComm_t *conn, openedDataObjInp_t *dataObjReadInp, bytesBuf_t *dataObjReadOutBBuf);
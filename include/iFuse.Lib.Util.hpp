@@ -62,6 +62,9 @@ time_t iFuseLibGetCurrentTime();
 void iFuseLibGetStrCurrentTime(char *buff);
 void iFuseLibGetStrTime(time_t time, char *buff);
 double iFuseLibDiffTimeSec(time_t end, time_t beginning);
+unsigned long long iFuseLibGetMonotonicTimeMSec();
+unsigned long long iFuseLibGetMonotonicTimeUSec();
+void iFuseLibGetTimespecAfterMSec(struct timespec *ts, int msec);
 int iFuseLibSplitPath(const char *srcPath, char *dir, unsigned int maxDirLen, char *file, unsigned int maxFileLen);
 int iFuseLibJoinPath(const char *dir, const char *file, char *destPath, unsigned int maxDestPathLen);
 int iFuseLibGetFilename(const char *srcPath, char *file, unsigned int maxFileLen);
@@ -23,16 +23,48 @@ typedef struct IFuseOpt {
     bool directio;
     bool bufferedFS;
     bool preload;
+    bool writeBehind;
     bool cacheMetadata;
     int maxConn;
+    int minConn;
+    int connWaitTargetMSec;
+    int maxShortopConn;
+    int maxBackgroundConn;
     int blocksize;
+    int cacheMB;
+    int dirtyMB;
+    int maxDirtyMB;
+    int bufferPoolMB;
+    bool hugepage;
+    int writeStripeNum;
+    int hedgeReadPercentile;
+    int workerNum;
+    int maxRPCNum;
+    int maxConnectingNum;
+    int maxBackgroundMB;
+    int admissionWaitMSec;
     bool connReuse;
+    int connWaitTimeoutMSec;
+    int connBreakerFailNum;
+    int connBreakerCoolDownSec;
+    int connWarmUpNum;
+    bool directData;
+    int readStreams;
+    char *hosts;
     int connTimeoutSec;
     int connKeepAliveSec;
     int connCheckIntervalSec;
     int rodsapiTimeoutSec;
+    int rodsapiMetadataTimeoutSec;
+    int rodsapiSmallIOTimeoutSec;
+    int rodsapiBulkIOTimeoutSec;
     int preloadNumBlocks;
+    int preloadStripeNum;
+    int preloadStripeMinSizeMB;
     int metadataCacheTimeoutSec;
+    char *mockBackend;
+    int mockLatencyUSec;
+    int mockBandwidthKBps;
     char *ticket;
     char *workdir;
     char *mountpoint;
@@ -9,10 +9,16 @@
 #include <pthread.h>
 #include "iFuse.BufferedFS.hpp"
 #include "iFuse.Lib.Fd.hpp"
+#include "iFuse.Lib.Engine.hpp"
 
 #define IFUSE_PRELOAD_PBLOCK_NUM             3
 #define IFUSE_PRELOAD_MAX_PBLOCK_NUM         10
 
+// read-only files at least this large are fetched over more connections in parallel
+// 0 turns striping off
+#define IFUSE_PRELOAD_STRIPE_NUM             0
+#define IFUSE_PRELOAD_STRIPE_MIN_SIZE_MB     32
+
 #define IFUSE_PRELOAD_PBLOCK_STATUS_INIT                 0
 #define IFUSE_PRELOAD_PBLOCK_STATUS_RUNNING              1
 #define IFUSE_PRELOAD_PBLOCK_STATUS_COMPLETED            2
@@ -23,8 +29,8 @@ typedef struct IFusePreloadPBlock {
     iFuseFd_t *fd;
     unsigned int blockID;
     int status;
-    bool threadJoined;
-    pthread_t thread;
+    bool taskJoined;
+    iFuseEngineRequest_t *request;
     pthread_rwlockattr_t lockAttr;
     pthread_rwlock_t lock;
 } iFusePreloadPBlock_t;
@@ -32,15 +38,17 @@ typedef struct IFusePreloadPBlock {
 typedef struct IFusePreload {
     unsigned long fdId;
     char *iRodsPath;
+    off_t size;
+    int numBlocks;
     std::list<iFusePreloadPBlock_t*> *pblocks;
     pthread_rwlockattr_t lockAttr;
     pthread_rwlock_t lock;
 } iFusePreload_t;
 
-typedef struct IFusePreloadThreadParam {
+typedef struct IFusePreloadTaskParam {
     iFusePreload_t *preload;
     iFusePreloadPBlock_t *pblock;
-} iFusePreloadThreadParam_t;
+} iFusePreloadTaskParam_t;
 
 void iFusePreloadInit();
 void iFusePreloadDestroy();
@@ -11,12 +11,13 @@
 //#define USE_CONNREUSE
 
 #define IFUSE_CMD_ARG_MAX_TOKEN_LEN 30
+#define IFUSE_CMD_ARG_MAX_VALUE_LEN 1024
 
 typedef struct IFuseCmdArg {
     int start;
     int end;
     char command[IFUSE_CMD_ARG_MAX_TOKEN_LEN];
-    char value[IFUSE_CMD_ARG_MAX_TOKEN_LEN];
+    char value[IFUSE_CMD_ARG_MAX_VALUE_LEN];
 } iFuseCmdArg_t;
 
 void iFuseCmdOptsInit();
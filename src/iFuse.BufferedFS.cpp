@@ -9,11 +9,15 @@
 #include <assert.h>
 #include <pthread.h>
 #include <map>
+#include <algorithm>
 #include <string>
 #include <cstring>
 #include "iFuse.FS.hpp"
 #include "iFuse.Lib.hpp"
 #include "iFuse.Lib.Fd.hpp"
+#include "iFuse.Lib.Engine.hpp"
+#include "iFuse.Lib.BufferPool.hpp"
+#include "iFuse.Lib.MetadataCache.hpp"
 #include "iFuse.BufferedFS.hpp"
 #include "iFuse.Lib.Util.hpp"
 #include "iFuse.Lib.RodsClientAPI.hpp"
@@ -22,10 +26,48 @@
 static pthread_rwlockattr_t g_BufferCacheLockAttr;
 static pthread_rwlock_t g_BufferCacheLock;
 
-static std::map<std::string, iFuseBufferCache_t*> g_DeltaMap;
-static std::map<unsigned long, iFuseBufferCache_t*> g_CacheMap;
+typedef std::pair<std::string, unsigned int> iFuseBufferCacheKey_t;
+
+// blocks being written, keyed by path and block ID, so a file's blocks are in offset order
+static std::map<iFuseBufferCacheKey_t, iFuseBufferCache_t*> g_DirtyMap;
+// blocks cached, keyed by path and block ID, shared by all descriptors
+static std::map<iFuseBufferCacheKey_t, iFuseBufferCache_t*> g_CacheMap;
+// stamps of open descriptors, blocks filled through a descriptor carry its stamp
+static std::map<unsigned long, iFuseBufferCacheStamp_t> g_StampMap;
+// eviction resumes from where it stopped
+static iFuseBufferCacheKey_t g_CacheClockHand;
 
 static int g_Blocksize = IFUSE_BUFFER_CACHE_BLOCK_SIZE;
+static size_t g_MaxCacheBlockNum = 0;
+static size_t g_MaxDirtyBlockNum = 0;
+// dirty blocks of all files, including ones being written back, writers write back theirs when over the limit
+static size_t g_DirtyBlockNum = 0;
+// dirty blocks handed over to be written back and not written yet, of all files
+static size_t g_QueuedBlockNum = 0;
+static pthread_mutex_t g_DirtyWaitMutex;
+static pthread_cond_t g_DirtyWaitCond;
+static int g_DirtyWaiters = 0;
+static size_t g_MaxTotalDirtyBlockNum = 0;
+
+static pthread_rwlockattr_t g_StripedWriteLockAttr;
+static pthread_rwlock_t g_StripedWriteLock;
+
+static std::map<unsigned long, iFuseStripedWrite_t*> g_StripedWriteMap;
+
+static int g_WriteStripeNum = IFUSE_WRITE_STRIPE_NUM;
+static bool g_WriteBehind = true;
+
+static int g_HedgePercentile = IFUSE_HEDGE_READ_PERCENTILE;
+
+static pthread_mutex_t g_ReadLatencyMutex;
+static unsigned long long g_ReadLatencyUSec[IFUSE_HEDGE_LATENCY_SAMPLES];
+static int g_ReadLatencyNum = 0;
+static int g_ReadLatencyNext = 0;
+
+static pthread_mutex_t g_HedgedReadFdMutex;
+static pthread_cond_t g_HedgedReadFdCond;
+// reads still running on a caller's descriptor after the caller returned, keyed by fdId
+static std::map<unsigned long, int> g_HedgedReadFdMap;
 
 static int _newBufferCache(iFuseBufferCache_t **iFuseBufferCache) {
     iFuseBufferCache_t *tmpIFuseBufferCache = NULL;
@@ -53,10 +95,15 @@ static int _freeBufferCache(iFuseBufferCache_t *iFuseBufferCache) {
     }
 
     if(iFuseBufferCache->buffer != NULL) {
-        free(iFuseBufferCache->buffer);
+        iFuseBufferPoolFree(iFuseBufferCache->buffer);
         iFuseBufferCache->buffer = NULL;
     }
 
+    if(iFuseBufferCache->extents != NULL) {
+        delete iFuseBufferCache->extents;
+        iFuseBufferCache->extents = NULL;
+    }
+
     iFuseBufferCache->offset = 0;
     iFuseBufferCache->size = 0;
 
@@ -100,102 +147,1441 @@ static bool _isSameBlock(off_t off1, off_t off2) {
     return getBlockID(off1) == getBlockID(off2);
 }
 
-static void _applyDeltaToCache(const char *iRodsPath, const char *buf, off_t off, size_t size) {
-    std::map<unsigned long, iFuseBufferCache_t*>::iterator it_cachemap;
+static bool _isSameStamp(const iFuseBufferCacheStamp_t *stamp1, const iFuseBufferCacheStamp_t *stamp2) {
+    return stamp1->size == stamp2->size && stamp1->mtime == stamp2->mtime;
+}
+
+/*
+ * Get the stamp of the file descriptor, g_BufferCacheLock must be held
+ */
+static void _getStamp(iFuseFd_t *iFuseFd, iFuseBufferCacheStamp_t *stamp) {
+    std::map<unsigned long, iFuseBufferCacheStamp_t>::iterator it_stampmap;
+
+    it_stampmap = g_StampMap.find(iFuseFd->fdId);
+    if(it_stampmap != g_StampMap.end()) {
+        *stamp = it_stampmap->second;
+    } else {
+        bzero(stamp, sizeof(iFuseBufferCacheStamp_t));
+    }
+}
+
+/*
+ * Take a reference to a cached block, g_BufferCacheLock must be held
+ * the buffer can be read without the lock until the reference is released
+ */
+static void _refBufferCache(iFuseBufferCache_t *iFuseBufferCache) {
+    __sync_fetch_and_add(&iFuseBufferCache->refCount, 1);
+    __sync_fetch_and_or(&iFuseBufferCache->referenced, 1);
+}
+
+static void _unrefBufferCache(iFuseBufferCache_t *iFuseBufferCache) {
+    // detached is only set with the lock held for write
+    pthread_rwlock_rdlock(&g_BufferCacheLock);
+
+    if(__sync_sub_and_fetch(&iFuseBufferCache->refCount, 1) == 0 && iFuseBufferCache->detached) {
+        _freeBufferCache(iFuseBufferCache);
+    }
+
+    pthread_rwlock_unlock(&g_BufferCacheLock);
+}
+
+/*
+ * Drop a block removed from g_CacheMap, g_BufferCacheLock must be held for write
+ * a block still being read is freed by the last reader
+ */
+static void _detachBufferCache(iFuseBufferCache_t *iFuseBufferCache) {
+    iFuseBufferCache->detached = true;
+
+    if(iFuseBufferCache->refCount == 0) {
+        _freeBufferCache(iFuseBufferCache);
+    }
+}
+
+/*
+ * Evict blocks until no more than maxBlockNum are cached, g_BufferCacheLock must be held for write
+ * blocks accessed since the clock hand passed them last get another round
+ * blocks being read are skipped, the cache goes over the limit if all are
+ * returns the number of blocks evicted
+ */
+static int _evictCache(size_t maxBlockNum) {
+    std::map<iFuseBufferCacheKey_t, iFuseBufferCache_t*>::iterator it_cachemap;
+    iFuseBufferCache_t *iFuseBufferCache = NULL;
+    size_t steps = 0;
+    int evicted = 0;
+
+    it_cachemap = g_CacheMap.lower_bound(g_CacheClockHand);
+    while(!g_CacheMap.empty() && g_CacheMap.size() > maxBlockNum && steps < g_CacheMap.size() * 2) {
+        if(it_cachemap == g_CacheMap.end()) {
+            it_cachemap = g_CacheMap.begin();
+        }
+
+        steps++;
+
+        iFuseBufferCache = it_cachemap->second;
+        if(iFuseBufferCache->refCount > 0) {
+            it_cachemap++;
+            continue;
+        }
+
+        if(iFuseBufferCache->referenced) {
+            iFuseBufferCache->referenced = 0;
+            it_cachemap++;
+            continue;
+        }
+
+        iFuseLibLog(LOG_DEBUG, "_evictCache: evict %s - offset: %lld", iFuseBufferCache->iRodsPath, (long long)iFuseBufferCache->offset);
+
+        g_CacheMap.erase(it_cachemap++);
+        _freeBufferCache(iFuseBufferCache);
+        evicted++;
+    }
+
+    if(it_cachemap != g_CacheMap.end()) {
+        g_CacheClockHand = it_cachemap->first;
+    } else {
+        g_CacheClockHand = iFuseBufferCacheKey_t();
+    }
+
+    return evicted;
+}
+
+/*
+ * Called by the buffer pool at its limit, frees cached blocks not being read
+ */
+static int _reclaimCache(size_t size) {
+    size_t blockNum = (size + g_Blocksize - 1) / g_Blocksize;
+    int evicted = 0;
+
+    pthread_rwlock_wrlock(&g_BufferCacheLock);
+
+    evicted = _evictCache(g_CacheMap.size() > blockNum ? g_CacheMap.size() - blockNum : 0);
+
+    pthread_rwlock_unlock(&g_BufferCacheLock);
+
+    iFuseLibLog(LOG_DEBUG, "_reclaimCache: %d blocks evicted", evicted);
+    return evicted;
+}
+
+/*
+ * Drop cached blocks of the path and of all paths under it
+ */
+static void _invalidateCache(const char *iRodsPath) {
+    std::map<iFuseBufferCacheKey_t, iFuseBufferCache_t*>::iterator it_cachemap;
     iFuseBufferCache_t *iFuseBufferCache = NULL;
+    size_t pathLen = 0;
 
     assert(iRodsPath != NULL);
-    assert(buf != NULL);
-    assert(off >= 0);
-    assert(size > 0);
 
-    for (it_cachemap = g_CacheMap.begin(); it_cachemap != g_CacheMap.end(); it_cachemap++) {
+    pathLen = strlen(iRodsPath);
+
+    pthread_rwlock_wrlock(&g_BufferCacheLock);
+
+    it_cachemap = g_CacheMap.lower_bound(iFuseBufferCacheKey_t(iRodsPath, 0));
+    while(it_cachemap != g_CacheMap.end()) {
+        const std::string &path = it_cachemap->first.first;
+
+        if(path.compare(0, pathLen, iRodsPath) != 0) {
+            // past paths starting with iRodsPath
+            break;
+        }
+
+        if(path.length() > pathLen && path[pathLen] != '/') {
+            // a sibling sharing the prefix
+            it_cachemap++;
+            continue;
+        }
+
         iFuseBufferCache = it_cachemap->second;
+        g_CacheMap.erase(it_cachemap++);
+        _detachBufferCache(iFuseBufferCache);
+    }
+
+    pthread_rwlock_unlock(&g_BufferCacheLock);
+}
 
-        iFuseLibLog(LOG_DEBUG, "_applyDeltaToCache: comp %s - %s", iFuseBufferCache->iRodsPath, iRodsPath);
-        if (strcmp(iFuseBufferCache->iRodsPath, iRodsPath) == 0) {
-            if (_isSameBlock(iFuseBufferCache->offset, off)) {
-                // update
-                off_t endOffset = off + size >  iFuseBufferCache->offset + iFuseBufferCache->size ? off + size : iFuseBufferCache->offset + iFuseBufferCache->size;
-                size_t newSize = endOffset - iFuseBufferCache->offset;
+static size_t _getDirtySize(iFuseBufferCache_t *iFuseBufferCache) {
+    std::map<off_t, size_t>::iterator it_extent;
+    size_t dirtySize = 0;
 
-                assert(newSize > 0);
+    for(it_extent = iFuseBufferCache->extents->begin(); it_extent != iFuseBufferCache->extents->end(); it_extent++) {
+        dirtySize += it_extent->second;
+    }
 
-                memcpy(iFuseBufferCache->buffer + (off - iFuseBufferCache->offset), buf, size);
+    return dirtySize;
+}
 
-                iFuseBufferCache->size = newSize;
-            }
+/*
+ * Write dirty ranges of a block through the file descriptor, in offset order
+ */
+static int _writeDirtyBlock(iFuseFd_t *iFuseFd, iFuseBufferCache_t *iFuseBufferCache) {
+    int status = 0;
+    std::map<off_t, size_t>::iterator it_extent;
+
+    for(it_extent = iFuseBufferCache->extents->begin(); it_extent != iFuseBufferCache->extents->end(); it_extent++) {
+        status = iFuseFsWrite(iFuseFd, iFuseBufferCache->buffer + it_extent->first, iFuseBufferCache->offset + it_extent->first, it_extent->second);
+        if (status < 0) {
+            iFuseLibLogError(LOG_ERROR, status, "_writeDirtyBlock: iFuseFsWrite of %s error, status = %d",
+                    iFuseFd->iRodsPath, status);
+            return status;
         }
     }
+
+    return 0;
+}
+
+/*
+ * Free a dirty block written back or dropped
+ * dirty blocks are counted until then, also while being written back without g_BufferCacheLock
+ */
+static void _freeDirtyBlock(iFuseBufferCache_t *iFuseBufferCache) {
+    __sync_fetch_and_sub(&g_DirtyBlockNum, 1);
+    _freeBufferCache(iFuseBufferCache);
+}
+
+/*
+ * Wait while dirty blocks of all files are over the limit and some are being written back
+ * blocks other files keep without writing back are written at their flush
+ */
+static void _waitDirtyBlocksWrittenBack() {
+    pthread_mutex_lock(&g_DirtyWaitMutex);
+
+    __sync_fetch_and_add(&g_DirtyWaiters, 1);
+
+    while(__sync_fetch_and_add(&g_DirtyBlockNum, 0) >= g_MaxTotalDirtyBlockNum &&
+            __sync_fetch_and_add(&g_QueuedBlockNum, 0) > 0) {
+        pthread_cond_wait(&g_DirtyWaitCond, &g_DirtyWaitMutex);
+    }
+
+    __sync_fetch_and_sub(&g_DirtyWaiters, 1);
+
+    pthread_mutex_unlock(&g_DirtyWaitMutex);
+}
+
+/*
+ * A block handed over was written back, g_QueuedBlockNum is decreased before
+ */
+static void _wakeDirtyWaiters() {
+    if(__sync_fetch_and_add(&g_DirtyWaiters, 0) == 0) {
+        return;
+    }
+
+    pthread_mutex_lock(&g_DirtyWaitMutex);
+    pthread_cond_broadcast(&g_DirtyWaitCond);
+    pthread_mutex_unlock(&g_DirtyWaitMutex);
 }
 
-static int _flushDelta(iFuseFd_t *iFuseFd) {
+/*
+ * Write blocks handed over until none is left, each through a free stripe
+ */
+static int _stripedWriteTask(void* param) {
     int status = 0;
-    std::map<std::string, iFuseBufferCache_t*>::iterator it_deltamap;
+    int writeStatus = 0;
+    iFuseStripedWrite_t *iFuseStripedWrite;
     iFuseBufferCache_t *iFuseBufferCache = NULL;
-    std::string pathkey(iFuseFd->iRodsPath);
+    iFuseFd_t *iFuseFd = NULL;
+    unsigned long long startUSec = 0;
+    size_t dirtySize = 0;
+    int stripe = 0;
+    int i;
+
+    assert(param != NULL);
+
+    iFuseStripedWrite = (iFuseStripedWrite_t*)param;
+
+    pthread_mutex_lock(&iFuseStripedWrite->mutex);
+
+    while(!iFuseStripedWrite->blocks->empty()) {
+        // no more tasks run than stripes, so one is always free
+        for(i=0;i<iFuseStripedWrite->stripeNum;i++) {
+            if(!iFuseStripedWrite->stripeBusy[i]) {
+                stripe = i;
+                break;
+            }
+        }
+
+        assert(i < iFuseStripedWrite->stripeNum);
+
+        iFuseBufferCache = iFuseStripedWrite->blocks->front();
+        iFuseStripedWrite->blocks->pop_front();
+
+        iFuseStripedWrite->stripeBusy[stripe] = true;
+        iFuseFd = iFuseStripedWrite->fds[stripe];
+
+        pthread_mutex_unlock(&iFuseStripedWrite->mutex);
+
+        iFuseLibLog(LOG_DEBUG, "_stripedWriteTask: writing %s (%d) - offset: %lld, size: %lld", iFuseFd->iRodsPath, iFuseFd->fd, (long long)iFuseBufferCache->offset, (long long)iFuseBufferCache->size);
+
+        dirtySize = _getDirtySize(iFuseBufferCache);
+        startUSec = iFuseLibGetMonotonicTimeUSec();
+
+        writeStatus = _writeDirtyBlock(iFuseFd, iFuseBufferCache);
+
+        iFuseFsCountWriteBehindDone(dirtySize, iFuseLibGetMonotonicTimeUSec() - startUSec, writeStatus);
+
+        _freeDirtyBlock(iFuseBufferCache);
+
+        pthread_mutex_lock(&iFuseStripedWrite->mutex);
+
+        if(writeStatus < 0) {
+            // keep the first error until it is reported
+            if(iFuseStripedWrite->error == 0) {
+                iFuseStripedWrite->error = writeStatus;
+            }
+            status = writeStatus;
+        }
+
+        iFuseStripedWrite->stripeBusy[stripe] = false;
+        iFuseStripedWrite->queued--;
+        if(iFuseStripedWrite->queued == 0) {
+            iFuseStripedWrite->queuedEndOffset = 0;
+        }
+        pthread_cond_broadcast(&iFuseStripedWrite->cond);
+
+        __sync_fetch_and_sub(&g_QueuedBlockNum, 1);
+        _wakeDirtyWaiters();
+    }
+
+    iFuseStripedWrite->running--;
+    pthread_cond_broadcast(&iFuseStripedWrite->cond);
+
+    pthread_mutex_unlock(&iFuseStripedWrite->mutex);
+    return status;
+}
+
+/*
+ * Wait for all blocks handed over to be written
+ * blocks still queued in the engine are written by the waiting thread
+ */
+static void _drainStripedWrite(iFuseStripedWrite_t *iFuseStripedWrite) {
+    iFuseEngineRequest_t *iFuseEngineRequest = NULL;
+
+    assert(iFuseStripedWrite != NULL);
+
+    pthread_mutex_lock(&iFuseStripedWrite->mutex);
+
+    while(true) {
+        if(!iFuseStripedWrite->requests->empty()) {
+            iFuseEngineRequest = iFuseStripedWrite->requests->front();
+            iFuseStripedWrite->requests->pop_front();
+
+            pthread_mutex_unlock(&iFuseStripedWrite->mutex);
+
+            iFuseEngineWait(iFuseEngineRequest);
+            iFuseEngineRelease(iFuseEngineRequest);
+
+            pthread_mutex_lock(&iFuseStripedWrite->mutex);
+            continue;
+        }
+
+        // requests taken by other waiters
+        if(iFuseStripedWrite->running == 0) {
+            break;
+        }
+
+        pthread_cond_wait(&iFuseStripedWrite->cond, &iFuseStripedWrite->mutex);
+    }
+
+    pthread_mutex_unlock(&iFuseStripedWrite->mutex);
+}
+
+/*
+ * Wait for all blocks handed over to be written
+ * returns the first error since the last wait
+ */
+static int _waitStripedWrite(iFuseStripedWrite_t *iFuseStripedWrite) {
+    int status = 0;
+
+    assert(iFuseStripedWrite != NULL);
+
+    _drainStripedWrite(iFuseStripedWrite);
+
+    pthread_mutex_lock(&iFuseStripedWrite->mutex);
+
+    status = iFuseStripedWrite->error;
+    iFuseStripedWrite->error = 0;
+
+    pthread_mutex_unlock(&iFuseStripedWrite->mutex);
+    return status;
+}
+
+static int _freeStripedWrite(iFuseStripedWrite_t *iFuseStripedWrite) {
+    int i;
+
+    assert(iFuseStripedWrite != NULL);
+
+    _drainStripedWrite(iFuseStripedWrite);
+
+    for(i=0;i<iFuseStripedWrite->stripeNum;i++) {
+        if(iFuseStripedWrite->fds[i] != NULL) {
+            // the file's own descriptor is closed by its owner
+            if(!iFuseStripedWrite->ownFd) {
+                iFuseFsClose(iFuseStripedWrite->fds[i]);
+            }
+            iFuseStripedWrite->fds[i] = NULL;
+        }
+    }
+
+    if(iFuseStripedWrite->blocks != NULL) {
+        assert(iFuseStripedWrite->blocks->empty());
+        delete iFuseStripedWrite->blocks;
+    }
+
+    if(iFuseStripedWrite->requests != NULL) {
+        delete iFuseStripedWrite->requests;
+    }
+
+    if(iFuseStripedWrite->iRodsPath != NULL) {
+        free(iFuseStripedWrite->iRodsPath);
+        iFuseStripedWrite->iRodsPath = NULL;
+    }
+
+    pthread_cond_destroy(&iFuseStripedWrite->cond);
+    pthread_mutex_destroy(&iFuseStripedWrite->mutex);
+
+    free(iFuseStripedWrite);
+    return 0;
+}
+
+/*
+ * Drop a reference to the writer, the last one frees it
+ */
+static void _unrefStripedWrite(iFuseStripedWrite_t *iFuseStripedWrite) {
+    assert(iFuseStripedWrite != NULL);
+
+    if(__sync_sub_and_fetch(&iFuseStripedWrite->refCount, 1) == 0) {
+        _freeStripedWrite(iFuseStripedWrite);
+    }
+}
+
+/*
+ * Make a writer of the file descriptor, blocks are written back by engine workers
+ * through extra descriptors of the file, or through the file's own if none is opened
+ */
+static int _newStripedWrite(iFuseFd_t *iFuseFd, iFuseStripedWrite_t **iFuseStripedWrite) {
+    int status = 0;
+    iFuseStripedWrite_t *tmpIFuseStripedWrite = NULL;
+    iFuseFd_t *stripeFd = NULL;
+    int i;
 
     assert(iFuseFd != NULL);
+    assert(iFuseStripedWrite != NULL);
 
-    if((iFuseFd->openFlag & O_ACCMODE) != O_RDONLY) {
-        pthread_rwlock_wrlock(&g_BufferCacheLock);
+    *iFuseStripedWrite = NULL;
+
+    tmpIFuseStripedWrite = (iFuseStripedWrite_t *) calloc(1, sizeof ( iFuseStripedWrite_t));
+    if (tmpIFuseStripedWrite == NULL) {
+        return SYS_MALLOC_ERR;
+    }
+
+    // we must use new keyword instead of calloc since it contains c++ stl list object
+    tmpIFuseStripedWrite->blocks = new std::list<iFuseBufferCache_t*>();
+    if(tmpIFuseStripedWrite->blocks == NULL) {
+        free(tmpIFuseStripedWrite);
+        return SYS_MALLOC_ERR;
+    }
+
+    tmpIFuseStripedWrite->requests = new std::list<iFuseEngineRequest_t*>();
+    if(tmpIFuseStripedWrite->requests == NULL) {
+        delete tmpIFuseStripedWrite->blocks;
+        free(tmpIFuseStripedWrite);
+        return SYS_MALLOC_ERR;
+    }
+
+    tmpIFuseStripedWrite->fdId = iFuseFd->fdId;
+    tmpIFuseStripedWrite->iRodsPath = strdup(iFuseFd->iRodsPath);
+    tmpIFuseStripedWrite->lastOffset = -1;
+    // reference of g_StripedWriteMap
+    tmpIFuseStripedWrite->refCount = 1;
+
+    pthread_mutex_init(&tmpIFuseStripedWrite->mutex, NULL);
+    pthread_cond_init(&tmpIFuseStripedWrite->cond, NULL);
+
+    for(i=0;i<g_WriteStripeNum;i++) {
+        // each descriptor gets its own connection
+        status = iFuseFsOpen(iFuseFd->iRodsPath, &stripeFd, O_WRONLY);
+        if(status < 0) {
+            iFuseLibLogError(LOG_ERROR, status, "_newStripedWrite: iFuseFsOpen of %s error, status = %d",
+                    iFuseFd->iRodsPath, status);
+            break;
+        }
+
+        tmpIFuseStripedWrite->fds[i] = stripeFd;
+        tmpIFuseStripedWrite->stripeNum++;
+    }
+
+    if(tmpIFuseStripedWrite->stripeNum == 0) {
+        // no extra descriptors - blocks are written back through the file's own descriptor
+        tmpIFuseStripedWrite->fds[0] = iFuseFd;
+        tmpIFuseStripedWrite->stripeNum = 1;
+        tmpIFuseStripedWrite->ownFd = true;
+    }
+
+    iFuseLibLog(LOG_DEBUG, "_newStripedWrite: writing %s in %d stripes", iFuseFd->iRodsPath, tmpIFuseStripedWrite->stripeNum);
+
+    *iFuseStripedWrite = tmpIFuseStripedWrite;
+    return 0;
+}
+
+static iFuseStripedWrite_t *_getStripedWrite(iFuseFd_t *iFuseFd) {
+    std::map<unsigned long, iFuseStripedWrite_t*>::iterator it_stripedwritemap;
+    iFuseStripedWrite_t *iFuseStripedWrite = NULL;
+
+    assert(iFuseFd != NULL);
+
+    pthread_rwlock_rdlock(&g_StripedWriteLock);
+
+    it_stripedwritemap = g_StripedWriteMap.find(iFuseFd->fdId);
+    if(it_stripedwritemap != g_StripedWriteMap.end()) {
+        iFuseStripedWrite = it_stripedwritemap->second;
+    }
+
+    pthread_rwlock_unlock(&g_StripedWriteLock);
+    return iFuseStripedWrite;
+}
+
+/*
+ * Get the number of blocks of the file descriptor handed over and not written yet
+ */
+static size_t _getQueuedBlockNum(iFuseFd_t *iFuseFd) {
+    iFuseStripedWrite_t *iFuseStripedWrite = NULL;
+    size_t blockNum = 0;
+
+    assert(iFuseFd != NULL);
+
+    iFuseStripedWrite = _getStripedWrite(iFuseFd);
+    if(iFuseStripedWrite == NULL) {
+        return 0;
+    }
+
+    pthread_mutex_lock(&iFuseStripedWrite->mutex);
+    blockNum = iFuseStripedWrite->queued;
+    pthread_mutex_unlock(&iFuseStripedWrite->mutex);
+    return blockNum;
+}
+
+/*
+ * Wait for blocks of the path being written by any file descriptor but the given writer
+ */
+static void _waitStripedWritesOfPath(const char *iRodsPath, iFuseStripedWrite_t *except) {
+    std::map<unsigned long, iFuseStripedWrite_t*>::iterator it_stripedwritemap;
+    std::list<iFuseStripedWrite_t*> writers;
+    std::list<iFuseStripedWrite_t*>::iterator it_writer;
+    iFuseStripedWrite_t *iFuseStripedWrite = NULL;
+
+    assert(iRodsPath != NULL);
+
+    pthread_rwlock_rdlock(&g_StripedWriteLock);
+
+    for(it_stripedwritemap = g_StripedWriteMap.begin(); it_stripedwritemap != g_StripedWriteMap.end(); it_stripedwritemap++) {
+        iFuseStripedWrite = it_stripedwritemap->second;
+
+        if(iFuseStripedWrite != except && strcmp(iFuseStripedWrite->iRodsPath, iRodsPath) == 0) {
+            // kept while waiting, its descriptor may be closed meanwhile
+            __sync_fetch_and_add(&iFuseStripedWrite->refCount, 1);
+            writers.push_back(iFuseStripedWrite);
+        }
+    }
+
+    pthread_rwlock_unlock(&g_StripedWriteLock);
+
+    // wait without blocking others opening or releasing writers
+    for(it_writer = writers.begin(); it_writer != writers.end(); it_writer++) {
+        _drainStripedWrite(*it_writer);
+        _unrefStripedWrite(*it_writer);
+    }
+}
+
+/*
+ * Get the end of blocks of the path handed over and not written yet, 0 if none
+ */
+static off_t _getStripedWriteEndOfPath(const char *iRodsPath) {
+    std::map<unsigned long, iFuseStripedWrite_t*>::iterator it_stripedwritemap;
+    iFuseStripedWrite_t *iFuseStripedWrite = NULL;
+    off_t endOffset = 0;
+
+    assert(iRodsPath != NULL);
+
+    pthread_rwlock_rdlock(&g_StripedWriteLock);
+
+    for(it_stripedwritemap = g_StripedWriteMap.begin(); it_stripedwritemap != g_StripedWriteMap.end(); it_stripedwritemap++) {
+        iFuseStripedWrite = it_stripedwritemap->second;
+
+        if(strcmp(iFuseStripedWrite->iRodsPath, iRodsPath) == 0) {
+            pthread_mutex_lock(&iFuseStripedWrite->mutex);
+            if(iFuseStripedWrite->queued > 0 && iFuseStripedWrite->queuedEndOffset > endOffset) {
+                endOffset = iFuseStripedWrite->queuedEndOffset;
+            }
+            pthread_mutex_unlock(&iFuseStripedWrite->mutex);
+        }
+    }
+
+    pthread_rwlock_unlock(&g_StripedWriteLock);
+    return endOffset;
+}
+
+/*
+ * Hand a dirty block over to engine workers writing it back, the caller goes on meanwhile
+ * waits while too many blocks of the file, or of all files, are not written yet
+ * the block is freed after written
+ */
+static int _queueStripedWrite(iFuseFd_t *iFuseFd, iFuseBufferCache_t *iFuseBufferCache) {
+    int status = 0;
+    std::map<unsigned long, iFuseStripedWrite_t*>::iterator it_stripedwritemap;
+    iFuseStripedWrite_t *iFuseStripedWrite = NULL;
+    iFuseStripedWrite_t *newStripedWrite = NULL;
+    iFuseEngineRequest_t *iFuseEngineRequest = NULL;
+    std::list<iFuseEngineRequest_t*>::iterator it_request;
+    unsigned long long startUSec = 0;
+    size_t dirtySize = 0;
+    off_t endOffset = 0;
+    bool sequential = false;
+    bool startTask = false;
+
+    assert(iFuseFd != NULL);
+    assert(iFuseBufferCache != NULL);
+
+    iFuseStripedWrite = _getStripedWrite(iFuseFd);
+    if(iFuseStripedWrite == NULL) {
+        status = _newStripedWrite(iFuseFd, &newStripedWrite);
+        if(status < 0) {
+            _freeDirtyBlock(iFuseBufferCache);
+            return status;
+        }
+
+        pthread_rwlock_wrlock(&g_StripedWriteLock);
+
+        it_stripedwritemap = g_StripedWriteMap.find(iFuseFd->fdId);
+        if(it_stripedwritemap != g_StripedWriteMap.end()) {
+            iFuseStripedWrite = it_stripedwritemap->second;
+        } else {
+            g_StripedWriteMap[iFuseFd->fdId] = newStripedWrite;
+            iFuseStripedWrite = newStripedWrite;
+            newStripedWrite = NULL;
+        }
+
+        pthread_rwlock_unlock(&g_StripedWriteLock);
+
+        if(newStripedWrite != NULL) {
+            // another thread writing to the file descriptor made one meanwhile
+            _freeStripedWrite(newStripedWrite);
+        }
+    }
+
+    pthread_mutex_lock(&iFuseStripedWrite->mutex);
+    sequential = (iFuseBufferCache->offset > iFuseStripedWrite->lastOffset);
+    pthread_mutex_unlock(&iFuseStripedWrite->mutex);
+
+    if(!sequential) {
+        // not sequential - blocks written at the same time must not overlap
+        _waitStripedWritesOfPath(iFuseStripedWrite->iRodsPath, NULL);
+    } else {
+        // blocks handed over through other descriptors of the file go first
+        _waitStripedWritesOfPath(iFuseStripedWrite->iRodsPath, iFuseStripedWrite);
+    }
+
+    // the block belongs to workers once handed over
+    dirtySize = _getDirtySize(iFuseBufferCache);
+
+    pthread_mutex_lock(&iFuseStripedWrite->mutex);
+
+    // bound memory of blocks not written yet, the block handed over is counted already
+    while(iFuseStripedWrite->error == 0 && iFuseStripedWrite->queued > 0 &&
+            ((size_t)iFuseStripedWrite->queued >= g_MaxDirtyBlockNum ||
+            __sync_fetch_and_add(&g_DirtyBlockNum, 0) >= g_MaxTotalDirtyBlockNum)) {
+        if(startUSec == 0) {
+            startUSec = iFuseLibGetMonotonicTimeUSec();
+        }
+        pthread_cond_wait(&iFuseStripedWrite->cond, &iFuseStripedWrite->mutex);
+    }
+
+    if(startUSec > 0) {
+        iFuseFsCountWriteBehindWait(iFuseLibGetMonotonicTimeUSec() - startUSec);
+    }
+
+    if(iFuseStripedWrite->error != 0) {
+        // reported by flush/close as well
+        status = iFuseStripedWrite->error;
+        pthread_mutex_unlock(&iFuseStripedWrite->mutex);
+        _freeDirtyBlock(iFuseBufferCache);
+        return status;
+    }
+
+    // release requests completed
+    it_request = iFuseStripedWrite->requests->begin();
+    while(it_request != iFuseStripedWrite->requests->end()) {
+        if(iFuseEngineIsDone(*it_request)) {
+            iFuseEngineRelease(*it_request);
+            it_request = iFuseStripedWrite->requests->erase(it_request);
+        } else {
+            it_request++;
+        }
+    }
+
+    iFuseStripedWrite->blocks->push_back(iFuseBufferCache);
+    iFuseStripedWrite->queued++;
+    __sync_fetch_and_add(&g_QueuedBlockNum, 1);
+    iFuseStripedWrite->lastOffset = iFuseBufferCache->offset;
+
+    endOffset = iFuseBufferCache->offset + iFuseBufferCache->size;
+    if(endOffset > iFuseStripedWrite->queuedEndOffset) {
+        iFuseStripedWrite->queuedEndOffset = endOffset;
+    }
+
+    // a task writes blocks until none is left, at most one task per stripe
+    if(iFuseStripedWrite->running < iFuseStripedWrite->stripeNum) {
+        iFuseStripedWrite->running++;
+        startTask = true;
+    }
+
+    pthread_mutex_unlock(&iFuseStripedWrite->mutex);
+
+    iFuseFsCountWriteBehindQueue(dirtySize);
+
+    if(!startTask) {
+        return 0;
+    }
+
+    status = iFuseEngineSubmitBackground(_stripedWriteTask, (void*)iFuseStripedWrite, g_Blocksize, &iFuseEngineRequest);
+    if(status < 0) {
+        // shed by admission control or not submitted, the writer uploads the blocks by itself
+        // errors are reported the same way as others
+        iFuseLibLog(LOG_DEBUG, "_queueStripedWrite: writing %s in the caller, status = %d", iFuseFd->iRodsPath, status);
+        _stripedWriteTask((void*)iFuseStripedWrite);
+        return 0;
+    }
+
+    pthread_mutex_lock(&iFuseStripedWrite->mutex);
+    iFuseStripedWrite->requests->push_back(iFuseEngineRequest);
+    pthread_mutex_unlock(&iFuseStripedWrite->mutex);
+    return 0;
+}
+
+/*
+ * Wait for blocks of the file descriptor being written
+ * returns the first write error since the last wait
+ */
+static int _syncStripedWrite(iFuseFd_t *iFuseFd) {
+    iFuseStripedWrite_t *iFuseStripedWrite = NULL;
+
+    assert(iFuseFd != NULL);
+
+    iFuseStripedWrite = _getStripedWrite(iFuseFd);
+    if(iFuseStripedWrite == NULL) {
+        return 0;
+    }
+
+    return _waitStripedWrite(iFuseStripedWrite);
+}
+
+/*
+ * Write all blocks, close extra descriptors and release the writer
+ */
+static int _releaseStripedWrite(iFuseFd_t *iFuseFd) {
+    int status = 0;
+    std::map<unsigned long, iFuseStripedWrite_t*>::iterator it_stripedwritemap;
+    iFuseStripedWrite_t *iFuseStripedWrite = NULL;
+
+    assert(iFuseFd != NULL);
+
+    pthread_rwlock_wrlock(&g_StripedWriteLock);
+
+    it_stripedwritemap = g_StripedWriteMap.find(iFuseFd->fdId);
+    if(it_stripedwritemap != g_StripedWriteMap.end()) {
+        iFuseStripedWrite = it_stripedwritemap->second;
+        g_StripedWriteMap.erase(it_stripedwritemap);
+    }
+
+    pthread_rwlock_unlock(&g_StripedWriteLock);
+
+    if(iFuseStripedWrite != NULL) {
+        status = _waitStripedWrite(iFuseStripedWrite);
+        _unrefStripedWrite(iFuseStripedWrite);
+    }
+
+    return status;
+}
+
+static void _addReadLatency(unsigned long long latencyUSec) {
+    pthread_mutex_lock(&g_ReadLatencyMutex);
+
+    g_ReadLatencyUSec[g_ReadLatencyNext] = latencyUSec;
+    g_ReadLatencyNext = (g_ReadLatencyNext + 1) % IFUSE_HEDGE_LATENCY_SAMPLES;
+    if(g_ReadLatencyNum < IFUSE_HEDGE_LATENCY_SAMPLES) {
+        g_ReadLatencyNum++;
+    }
+
+    pthread_mutex_unlock(&g_ReadLatencyMutex);
+}
+
+/*
+ * Time to wait for a block read before sending it again
+ * returns 0 when too few reads are seen to tell slow ones
+ */
+static int _getHedgeDelayMSec() {
+    unsigned long long samples[IFUSE_HEDGE_LATENCY_SAMPLES];
+    int sampleNum = 0;
+    int nth = 0;
+    int delayMSec = 0;
+
+    pthread_mutex_lock(&g_ReadLatencyMutex);
+
+    sampleNum = g_ReadLatencyNum;
+    memcpy(samples, g_ReadLatencyUSec, sizeof(unsigned long long) * sampleNum);
+
+    pthread_mutex_unlock(&g_ReadLatencyMutex);
+
+    if(sampleNum < IFUSE_HEDGE_MIN_SAMPLES) {
+        return 0;
+    }
+
+    nth = (sampleNum * g_HedgePercentile) / 100;
+    if(nth >= sampleNum) {
+        nth = sampleNum - 1;
+    }
+
+    std::nth_element(samples, samples + nth, samples + sampleNum);
+
+    delayMSec = (int)((samples[nth] + 999) / 1000);
+    if(delayMSec < IFUSE_HEDGE_MIN_DELAY_MSEC) {
+        delayMSec = IFUSE_HEDGE_MIN_DELAY_MSEC;
+    }
+    return delayMSec;
+}
+
+static void _freeHedgedRead(iFuseHedgedRead_t *iFuseHedgedRead) {
+    assert(iFuseHedgedRead != NULL);
+
+    if(iFuseHedgedRead->iRodsPath != NULL) {
+        free(iFuseHedgedRead->iRodsPath);
+        iFuseHedgedRead->iRodsPath = NULL;
+    }
+
+    pthread_cond_destroy(&iFuseHedgedRead->cond);
+    pthread_mutex_destroy(&iFuseHedgedRead->mutex);
+
+    free(iFuseHedgedRead);
+}
+
+/*
+ * Keep the descriptor open while a read on it runs in background
+ */
+static void _pinHedgedReadFd(iFuseFd_t *iFuseFd) {
+    assert(iFuseFd != NULL);
+
+    pthread_mutex_lock(&g_HedgedReadFdMutex);
+    g_HedgedReadFdMap[iFuseFd->fdId]++;
+    pthread_mutex_unlock(&g_HedgedReadFdMutex);
+}
+
+static void _unpinHedgedReadFd(unsigned long fdId) {
+    std::map<unsigned long, int>::iterator it_fdmap;
+
+    pthread_mutex_lock(&g_HedgedReadFdMutex);
+    it_fdmap = g_HedgedReadFdMap.find(fdId);
+    assert(it_fdmap != g_HedgedReadFdMap.end());
+
+    it_fdmap->second--;
+    if(it_fdmap->second == 0) {
+        g_HedgedReadFdMap.erase(it_fdmap);
+        pthread_cond_broadcast(&g_HedgedReadFdCond);
+    }
+    pthread_mutex_unlock(&g_HedgedReadFdMutex);
+}
+
+/*
+ * Wait for reads that lost a race but still use the descriptor
+ */
+static void _waitHedgedReadsOfFd(iFuseFd_t *iFuseFd) {
+    assert(iFuseFd != NULL);
+
+    pthread_mutex_lock(&g_HedgedReadFdMutex);
+    while(g_HedgedReadFdMap.find(iFuseFd->fdId) != g_HedgedReadFdMap.end()) {
+        pthread_cond_wait(&g_HedgedReadFdCond, &g_HedgedReadFdMutex);
+    }
+    pthread_mutex_unlock(&g_HedgedReadFdMutex);
+}
+
+/*
+ * Drop a reference to the hedged read, the last one frees it
+ */
+static void _unrefHedgedRead(iFuseHedgedRead_t *iFuseHedgedRead) {
+    bool last = false;
+
+    assert(iFuseHedgedRead != NULL);
+
+    pthread_mutex_lock(&iFuseHedgedRead->mutex);
+    iFuseHedgedRead->refCount--;
+    last = (iFuseHedgedRead->refCount == 0);
+    pthread_mutex_unlock(&iFuseHedgedRead->mutex);
+
+    if(last) {
+        _freeHedgedRead(iFuseHedgedRead);
+    }
+}
+
+static int _hedgedReadTask(void* param) {
+    int status = 0;
+    iFuseHedgedReadTaskParam_t *iFuseHedgedReadTaskParam;
+    iFuseHedgedRead_t *iFuseHedgedRead;
+    iFuseFd_t *iFuseFd = NULL;
+    char *buffer = NULL;
+    bool hedge = false;
+    bool done = false;
+    unsigned long long startUSec = 0;
+
+    assert(param != NULL);
+
+    iFuseHedgedReadTaskParam = (iFuseHedgedReadTaskParam_t*)param;
+    iFuseHedgedRead = iFuseHedgedReadTaskParam->hedgedRead;
+    iFuseFd = iFuseHedgedReadTaskParam->iFuseFd;
+    buffer = iFuseHedgedReadTaskParam->buffer;
+    hedge = iFuseHedgedReadTaskParam->hedge;
+
+    free(iFuseHedgedReadTaskParam);
+
+    if(hedge) {
+        pthread_mutex_lock(&iFuseHedgedRead->mutex);
+        done = iFuseHedgedRead->done;
+        pthread_mutex_unlock(&iFuseHedgedRead->mutex);
+
+        if(done) {
+            // the original read completed while this one was queued
+            status = 0;
+        } else {
+            // each descriptor gets its own connection
+            status = iFuseFsOpen(iFuseHedgedRead->iRodsPath, &iFuseFd, O_RDONLY);
+            if(status < 0) {
+                iFuseLibLogError(LOG_ERROR, status, "_hedgedReadTask: iFuseFsOpen of %s error, status = %d",
+                        iFuseHedgedRead->iRodsPath, status);
+            } else {
+                status = iFuseFsRead(iFuseFd, buffer, iFuseHedgedRead->offset, iFuseHedgedRead->size);
+
+                // the descriptor is opened only for this read
+                iFuseFsClose(iFuseFd);
+            }
+        }
+    } else {
+        startUSec = iFuseLibGetMonotonicTimeUSec();
+
+        status = iFuseFsRead(iFuseFd, buffer, iFuseHedgedRead->offset, iFuseHedgedRead->size);
+
+        // only reads of the original descriptor tell how slow the server is
+        _addReadLatency(iFuseLibGetMonotonicTimeUSec() - startUSec);
+
+        // the caller's descriptor may be closed from here
+        _unpinHedgedReadFd(iFuseFd->fdId);
+    }
+
+    pthread_mutex_lock(&iFuseHedgedRead->mutex);
+
+    iFuseHedgedRead->pending--;
+
+    // the first success wins, a failure is taken only when no other read is left
+    if(!done && !iFuseHedgedRead->done && (status >= 0 || iFuseHedgedRead->pending == 0)) {
+        iFuseHedgedRead->done = true;
+        iFuseHedgedRead->status = status;
+        iFuseHedgedRead->buffer = buffer;
+        iFuseHedgedRead->hedgeWon = hedge;
+        buffer = NULL;
+
+        pthread_cond_broadcast(&iFuseHedgedRead->cond);
+    }
+
+    pthread_mutex_unlock(&iFuseHedgedRead->mutex);
+
+    if(buffer != NULL) {
+        // lost
+        iFuseBufferPoolFree(buffer);
+    }
+
+    _unrefHedgedRead(iFuseHedgedRead);
+    return status;
+}
+
+static int _submitHedgedReadTask(iFuseHedgedRead_t *iFuseHedgedRead, iFuseFd_t *iFuseFd, bool hedge, iFuseEngineRequest_t **request) {
+    int status = 0;
+    iFuseHedgedReadTaskParam_t *iFuseHedgedReadTaskParam = NULL;
+
+    iFuseHedgedReadTaskParam = (iFuseHedgedReadTaskParam_t*) calloc(1, sizeof(iFuseHedgedReadTaskParam_t));
+    if(iFuseHedgedReadTaskParam == NULL) {
+        return SYS_MALLOC_ERR;
+    }
+
+    iFuseHedgedReadTaskParam->buffer = iFuseBufferPoolAlloc(true);
+    if(iFuseHedgedReadTaskParam->buffer == NULL) {
+        free(iFuseHedgedReadTaskParam);
+        return SYS_MALLOC_ERR;
+    }
+
+    iFuseHedgedReadTaskParam->hedgedRead = iFuseHedgedRead;
+    iFuseHedgedReadTaskParam->iFuseFd = iFuseFd;
+    iFuseHedgedReadTaskParam->hedge = hedge;
+
+    pthread_mutex_lock(&iFuseHedgedRead->mutex);
+    iFuseHedgedRead->refCount++;
+    iFuseHedgedRead->pending++;
+    pthread_mutex_unlock(&iFuseHedgedRead->mutex);
+
+    if(!hedge) {
+        _pinHedgedReadFd(iFuseFd);
+    }
+
+    status = iFuseEngineSubmitBackground(_hedgedReadTask, (void*)iFuseHedgedReadTaskParam, iFuseHedgedRead->size, request);
+    if(status < 0) {
+        if(status != -EBUSY) {
+            iFuseLibLogError(LOG_ERROR, status, "_submitHedgedReadTask: failed to submit a task for %s, status = %d",
+                    iFuseHedgedRead->iRodsPath, status);
+        }
+
+        pthread_mutex_lock(&iFuseHedgedRead->mutex);
+        iFuseHedgedRead->refCount--;
+        iFuseHedgedRead->pending--;
+        pthread_mutex_unlock(&iFuseHedgedRead->mutex);
+
+        if(!hedge) {
+            _unpinHedgedReadFd(iFuseFd->fdId);
+        }
+
+        iFuseBufferPoolFree(iFuseHedgedReadTaskParam->buffer);
+        free(iFuseHedgedReadTaskParam);
+        return status;
+    }
+
+    return 0;
+}
+
+/*
+ * Read a block into a newly allocated buffer in the caller
+ * the latency is recorded to decide when reads are hedged
+ */
+static int _readTimed(iFuseFd_t *iFuseFd, char **buffer, off_t off, size_t size) {
+    int status = 0;
+    unsigned long long startUSec = 0;
+
+    assert(size <= iFuseBufferPoolGetBufferSize());
+
+    *buffer = iFuseBufferPoolAlloc(true);
+    if(*buffer == NULL) {
+        return SYS_MALLOC_ERR;
+    }
+
+    startUSec = iFuseLibGetMonotonicTimeUSec();
+    status = iFuseFsRead(iFuseFd, *buffer, off, size);
+    if(status < 0) {
+        iFuseBufferPoolFree(*buffer);
+        *buffer = NULL;
+        return status;
+    }
+
+    _addReadLatency(iFuseLibGetMonotonicTimeUSec() - startUSec);
+    return status;
+}
+
+/*
+ * Read a block into a newly allocated buffer
+ * when the read takes longer than most recent ones, the same range is read
+ * again through a descriptor on another connection and the first response wins.
+ * a read that lost keeps running in background until the server responds,
+ * closing the descriptor waits for it.
+ */
+static int _readHedged(iFuseFd_t *iFuseFd, char **buffer, off_t off, size_t size) {
+    int status = 0;
+    iFuseHedgedRead_t *iFuseHedgedRead = NULL;
+    iFuseEngineRequest_t *iFuseEngineRequest = NULL;
+    int delayMSec = 0;
+    bool hedgeWon = false;
+
+    assert(iFuseFd != NULL);
+    assert(buffer != NULL);
+
+    *buffer = NULL;
+
+    delayMSec = _getHedgeDelayMSec();
+    if(delayMSec == 0) {
+        // learn how long block reads take
+        return _readTimed(iFuseFd, buffer, off, size);
+    }
+
+    iFuseHedgedRead = (iFuseHedgedRead_t *) calloc(1, sizeof ( iFuseHedgedRead_t));
+    if (iFuseHedgedRead == NULL) {
+        return SYS_MALLOC_ERR;
+    }
+
+    iFuseHedgedRead->iRodsPath = strdup(iFuseFd->iRodsPath);
+    iFuseHedgedRead->offset = off;
+    iFuseHedgedRead->size = size;
+    // reference of the caller
+    iFuseHedgedRead->refCount = 1;
+
+    pthread_mutex_init(&iFuseHedgedRead->mutex, NULL);
+    pthread_cond_init(&iFuseHedgedRead->cond, NULL);
+
+    status = _submitHedgedReadTask(iFuseHedgedRead, iFuseFd, false, &iFuseEngineRequest);
+    if(status < 0) {
+        _freeHedgedRead(iFuseHedgedRead);
+        if(status == -EBUSY) {
+            // shed by admission control, the server is already loaded
+            return _readTimed(iFuseFd, buffer, off, size);
+        }
+        return status;
+    }
+
+    // a read still queued runs here, without hedging
+    status = iFuseEngineTimedWait(iFuseEngineRequest, delayMSec);
+    iFuseEngineRelease(iFuseEngineRequest);
+
+    if(status == -ETIMEDOUT) {
+        iFuseLibLog(LOG_DEBUG, "_readHedged: read of %s is slower than %d ms - offset: %lld, size: %lld", iFuseFd->iRodsPath, delayMSec, (long long)off, (long long)size);
+
+        status = _submitHedgedReadTask(iFuseHedgedRead, NULL, true, NULL);
+        if(status == 0) {
+            iFuseFsCountReadHedge();
+        }
+    }
+
+    pthread_mutex_lock(&iFuseHedgedRead->mutex);
+    while(!iFuseHedgedRead->done) {
+        pthread_cond_wait(&iFuseHedgedRead->cond, &iFuseHedgedRead->mutex);
+    }
+
+    status = iFuseHedgedRead->status;
+    *buffer = iFuseHedgedRead->buffer;
+    hedgeWon = iFuseHedgedRead->hedgeWon;
+    pthread_mutex_unlock(&iFuseHedgedRead->mutex);
+
+    if(hedgeWon) {
+        iFuseLibLog(LOG_DEBUG, "_readHedged: hedged read of %s won - offset: %lld, size: %lld", iFuseFd->iRodsPath, (long long)off, (long long)size);
+        iFuseFsCountReadHedgeWin();
+    }
+
+    _unrefHedgedRead(iFuseHedgedRead);
+
+    if(status < 0 && *buffer != NULL) {
+        iFuseBufferPoolFree(*buffer);
+        *buffer = NULL;
+    }
+
+    return status;
+}
+
+static void _applyDeltaToCache(const char *iRodsPath, const char *buf, off_t off, size_t size) {
+    std::map<iFuseBufferCacheKey_t, iFuseBufferCache_t*>::iterator it_cachemap;
+    iFuseBufferCache_t *iFuseBufferCache = NULL;
+
+    assert(iRodsPath != NULL);
+    assert(buf != NULL);
+    assert(off >= 0);
+    assert(size > 0);
+
+    // the file now reaches past blocks cached as its end, the rest of them is a hole
+    // cached buffers are zero past the size
+    it_cachemap = g_CacheMap.lower_bound(iFuseBufferCacheKey_t(iRodsPath, getBlockID(off)));
+    while(it_cachemap != g_CacheMap.begin()) {
+        it_cachemap--;
+
+        if(it_cachemap->first.first != iRodsPath ||
+                it_cachemap->second->size == (size_t)g_Blocksize) {
+            break;
+        }
+
+        it_cachemap->second->size = g_Blocksize;
+    }
+
+    it_cachemap = g_CacheMap.find(iFuseBufferCacheKey_t(iRodsPath, getBlockID(off)));
+    if(it_cachemap != g_CacheMap.end()) {
+        iFuseBufferCache = it_cachemap->second;
+
+        if(iFuseBufferCache->refCount > 0) {
+            // readers are copying out of the block - update a copy
+            iFuseBufferCache_t *newBufferCache = NULL;
+            // no reclaiming or waiting for buffers with the lock held
+            char *newBuf = iFuseBufferPoolAlloc(false);
+
+            if(newBuf == NULL || _newBufferCache(&newBufferCache) < 0) {
+                // out of memory - drop the block instead
+                if(newBuf != NULL) {
+                    iFuseBufferPoolFree(newBuf);
+                }
+
+                g_CacheMap.erase(it_cachemap);
+                _detachBufferCache(iFuseBufferCache);
+                return;
+            }
+
+            memcpy(newBuf, iFuseBufferCache->buffer, iFuseBufferCache->size);
+            // a range written past the end leaves a hole
+            bzero(newBuf + iFuseBufferCache->size, g_Blocksize - iFuseBufferCache->size);
+
+            newBufferCache->fdId = iFuseBufferCache->fdId;
+            newBufferCache->iRodsPath = strdup(iFuseBufferCache->iRodsPath);
+            newBufferCache->buffer = newBuf;
+            newBufferCache->offset = iFuseBufferCache->offset;
+            newBufferCache->size = iFuseBufferCache->size;
+            newBufferCache->stamp = iFuseBufferCache->stamp;
+            newBufferCache->referenced = 1;
+
+            it_cachemap->second = newBufferCache;
+            _detachBufferCache(iFuseBufferCache);
+
+            iFuseBufferCache = newBufferCache;
+        }
+
+        // update
+        off_t endOffset = off + size >  iFuseBufferCache->offset + iFuseBufferCache->size ? off + size : iFuseBufferCache->offset + iFuseBufferCache->size;
+        size_t newSize = endOffset - iFuseBufferCache->offset;
+
+        assert(newSize > 0);
+
+        memcpy(iFuseBufferCache->buffer + (off - iFuseBufferCache->offset), buf, size);
+
+        iFuseBufferCache->size = newSize;
+    }
+}
+
+static bool _isCompleteDirtyBlock(iFuseBufferCache_t *iFuseBufferCache) {
+    return iFuseBufferCache->extents->size() == 1 &&
+        iFuseBufferCache->extents->begin()->first == 0 &&
+        iFuseBufferCache->extents->begin()->second == (size_t)g_Blocksize;
+}
+
+/*
+ * Add a range to dirty ranges of a block, g_BufferCacheLock must be held for write
+ * overlapping or adjacent ranges are merged into one
+ */
+static void _addDirtyExtent(iFuseBufferCache_t *iFuseBufferCache, off_t inBlockOffset, size_t size) {
+    std::map<off_t, size_t>::iterator it_extent;
+    off_t startOffset = inBlockOffset;
+    off_t endOffset = inBlockOffset + size;
+
+    assert(iFuseBufferCache->extents != NULL);
+    assert(endOffset <= g_Blocksize);
+
+    // the range before may reach this one
+    it_extent = iFuseBufferCache->extents->upper_bound(startOffset);
+    if(it_extent != iFuseBufferCache->extents->begin()) {
+        it_extent--;
+        if((off_t)(it_extent->first + it_extent->second) < startOffset) {
+            it_extent++;
+        }
+    }
+
+    while(it_extent != iFuseBufferCache->extents->end() && it_extent->first <= endOffset) {
+        if(it_extent->first < startOffset) {
+            startOffset = it_extent->first;
+        }
+
+        if((off_t)(it_extent->first + it_extent->second) > endOffset) {
+            endOffset = it_extent->first + it_extent->second;
+        }
+
+        iFuseBufferCache->extents->erase(it_extent++);
+    }
+
+    (*iFuseBufferCache->extents)[startOffset] = endOffset - startOffset;
+
+    it_extent = iFuseBufferCache->extents->end();
+    it_extent--;
+    iFuseBufferCache->size = it_extent->first + it_extent->second;
+}
+
+/*
+ * Apply dirty ranges of a block to the cached block, g_BufferCacheLock must be held for write
+ */
+static void _applyDirtyToCache(iFuseBufferCache_t *iFuseBufferCache) {
+    std::map<off_t, size_t>::iterator it_extent;
+
+    for(it_extent = iFuseBufferCache->extents->begin(); it_extent != iFuseBufferCache->extents->end(); it_extent++) {
+        _applyDeltaToCache(iFuseBufferCache->iRodsPath, iFuseBufferCache->buffer + it_extent->first, iFuseBufferCache->offset + it_extent->first, it_extent->second);
+    }
+}
+
+static size_t _getDirtyBlockNum(const std::string &pathkey) {
+    std::map<iFuseBufferCacheKey_t, iFuseBufferCache_t*>::iterator it_dirtymap;
+    size_t blockNum = 0;
+
+    it_dirtymap = g_DirtyMap.lower_bound(iFuseBufferCacheKey_t(pathkey, 0));
+    while(it_dirtymap != g_DirtyMap.end() && it_dirtymap->first.first == pathkey) {
+        blockNum++;
+        it_dirtymap++;
+    }
+
+    return blockNum;
+}
+
+/*
+ * Write back all dirty blocks of the file in offset order
+ * with write-behind, blocks are handed over to engine workers and, with wait, waited for
+ * every block is tried, returns the first error
+ */
+static int _flushDirty(iFuseFd_t *iFuseFd, bool wait) {
+    int status = 0;
+    int writeStatus = 0;
+    std::map<iFuseBufferCacheKey_t, iFuseBufferCache_t*>::iterator it_dirtymap;
+    std::list<iFuseBufferCache_t*> dirtyBlocks;
+    std::list<iFuseBufferCache_t*>::iterator it_dirtyblock;
+    iFuseBufferCache_t *iFuseBufferCache = NULL;
+    std::string pathkey(iFuseFd->iRodsPath);
+
+    assert(iFuseFd != NULL);
+
+    if((iFuseFd->openFlag & O_ACCMODE) == O_RDONLY) {
+        return 0;
+    }
+
+    pthread_rwlock_wrlock(&g_BufferCacheLock);
+
+    it_dirtymap = g_DirtyMap.lower_bound(iFuseBufferCacheKey_t(pathkey, 0));
+    while(it_dirtymap != g_DirtyMap.end() && it_dirtymap->first.first == pathkey) {
+        iFuseBufferCache = it_dirtymap->second;
+
+        // apply to caches
+        _applyDirtyToCache(iFuseBufferCache);
+
+        dirtyBlocks.push_back(iFuseBufferCache);
+        g_DirtyMap.erase(it_dirtymap++);
+    }
+
+    // release lock before making write requests
+    pthread_rwlock_unlock(&g_BufferCacheLock);
+
+    for(it_dirtyblock = dirtyBlocks.begin(); it_dirtyblock != dirtyBlocks.end(); it_dirtyblock++) {
+        iFuseBufferCache = *it_dirtyblock;
+
+        if(g_WriteBehind) {
+            // upload in the background while the caller goes on
+            writeStatus = _queueStripedWrite(iFuseFd, iFuseBufferCache);
+        } else {
+            writeStatus = _writeDirtyBlock(iFuseFd, iFuseBufferCache);
+            _freeDirtyBlock(iFuseBufferCache);
+        }
+
+        if(writeStatus < 0 && status == 0) {
+            status = writeStatus;
+        }
+    }
+
+    if(wait) {
+        // blocks handed over to engine workers
+        writeStatus = _syncStripedWrite(iFuseFd);
+        if(writeStatus < 0 && status == 0) {
+            status = writeStatus;
+        }
+    }
+
+    if (status < 0) {
+        iFuseLibLogError(LOG_ERROR, status, "_flushDirty: write of %s error, status = %d",
+                iFuseFd->iRodsPath, status);
+        return -ENOENT;
+    }
+
+    return 0;
+}
+
+/*
+ * Drop dirty ranges of the path past the size
+ */
+static void _truncateDirty(const char *iRodsPath, off_t size) {
+    std::map<iFuseBufferCacheKey_t, iFuseBufferCache_t*>::iterator it_dirtymap;
+    std::map<off_t, size_t>::iterator it_extent;
+    iFuseBufferCache_t *iFuseBufferCache = NULL;
+    std::string pathkey(iRodsPath);
+
+    assert(iRodsPath != NULL);
+    assert(size >= 0);
+
+    pthread_rwlock_wrlock(&g_BufferCacheLock);
 
-        it_deltamap = g_DeltaMap.find(pathkey);
-        if(it_deltamap != g_DeltaMap.end()) {
-            // has it - flush
-            iFuseBufferCache = it_deltamap->second;
+    it_dirtymap = g_DirtyMap.lower_bound(iFuseBufferCacheKey_t(pathkey, getBlockID(size)));
+    while(it_dirtymap != g_DirtyMap.end() && it_dirtymap->first.first == pathkey) {
+        iFuseBufferCache = it_dirtymap->second;
 
-            g_DeltaMap.erase(it_deltamap);
+        it_extent = iFuseBufferCache->extents->begin();
+        while(it_extent != iFuseBufferCache->extents->end()) {
+            off_t extentOffset = iFuseBufferCache->offset + it_extent->first;
 
-            // apply to caches
-            _applyDeltaToCache(iFuseFd->iRodsPath, iFuseBufferCache->buffer, iFuseBufferCache->offset, iFuseBufferCache->size);
-            
-            // release lock before making a write request
-            pthread_rwlock_unlock(&g_BufferCacheLock);
+            if(extentOffset >= size) {
+                iFuseBufferCache->extents->erase(it_extent++);
+                continue;
+            }
 
-            status = iFuseFsWrite(iFuseFd, iFuseBufferCache->buffer, iFuseBufferCache->offset, iFuseBufferCache->size);
-            if (status < 0) {
-                iFuseLibLogError(LOG_ERROR, status, "_flushDelta: iFuseFsWrite of %s error, status = %d",
-                        iFuseFd->iRodsPath, status);
-                return -ENOENT;
+            if((off_t)(extentOffset + it_extent->second) > size) {
+                it_extent->second = size - extentOffset;
             }
+            it_extent++;
+        }
 
-            // release
-            _freeBufferCache(iFuseBufferCache);
-        } else {
-            pthread_rwlock_unlock(&g_BufferCacheLock);
+        if(iFuseBufferCache->extents->empty()) {
+            g_DirtyMap.erase(it_dirtymap++);
+            _freeDirtyBlock(iFuseBufferCache);
+            continue;
         }
+
+        it_extent = iFuseBufferCache->extents->end();
+        it_extent--;
+        iFuseBufferCache->size = it_extent->first + it_extent->second;
+        it_dirtymap++;
     }
 
-    return 0;
+    pthread_rwlock_unlock(&g_BufferCacheLock);
+}
+
+/*
+ * Copy the part of src that falls in the requested in-block range into buf
+ * src == NULL fills the part with zero
+ */
+static void _copyToRange(char *buf, off_t inBlockOffset, size_t size, const char *src, off_t srcInBlockOffset, size_t srcSize) {
+    off_t startOffset = inBlockOffset > srcInBlockOffset ? inBlockOffset : srcInBlockOffset;
+    off_t endOffset = (off_t)(inBlockOffset + size) < (off_t)(srcInBlockOffset + srcSize) ? (off_t)(inBlockOffset + size) : (off_t)(srcInBlockOffset + srcSize);
+
+    if(endOffset <= startOffset) {
+        return;
+    }
+
+    if(src != NULL) {
+        memcpy(buf + (startOffset - inBlockOffset), src + (startOffset - srcInBlockOffset), endOffset - startOffset);
+        iFuseFsCountReadCopy(endOffset - startOffset);
+    } else {
+        bzero(buf + (startOffset - inBlockOffset), endOffset - startOffset);
+    }
 }
 
-static int _readBlock(iFuseFd_t *iFuseFd, char *buf, unsigned int blockID) {
+/*
+ * Read a block and copy the requested in-block range to buf
+ * buf can be null to only load the block into the cache
+ * returns the size of the block
+ */
+static int _readBlock(iFuseFd_t *iFuseFd, char *buf, unsigned int blockID, off_t inBlockOffset, size_t size) {
     int status = 0;
     off_t blockStartOffset = 0;
     size_t readSize = 0;
-    std::map<unsigned long, iFuseBufferCache_t*>::iterator it_cachemap;
-    std::map<std::string, iFuseBufferCache_t*>::iterator it_deltamap;
+    std::map<iFuseBufferCacheKey_t, iFuseBufferCache_t*>::iterator it_cachemap;
+    std::map<iFuseBufferCacheKey_t, iFuseBufferCache_t*>::iterator it_dirtymap;
+    std::map<off_t, size_t>::iterator it_extent;
     iFuseBufferCache_t *iFuseBufferCache = NULL;
+    iFuseBufferCacheStamp_t stamp;
     bool hasCache = false;
-    std::string pathkey(iFuseFd->iRodsPath);
+    iFuseBufferCacheKey_t cachekey(iFuseFd->iRodsPath, blockID);
 
     assert(iFuseFd != NULL);
-    assert(buf != NULL);
+    assert(inBlockOffset >= 0);
+    assert(inBlockOffset + size <= (size_t)g_Blocksize);
 
     blockStartOffset = getBlockStartOffset(blockID);
 
     pthread_rwlock_rdlock(&g_BufferCacheLock);
 
+    _getStamp(iFuseFd, &stamp);
+
     // check cache
-    it_cachemap = g_CacheMap.find(iFuseFd->fdId);
+    it_cachemap = g_CacheMap.find(cachekey);
     if(it_cachemap != g_CacheMap.end()) {
         // has it
         iFuseBufferCache = it_cachemap->second;
 
-        if(iFuseBufferCache->offset == blockStartOffset &&
+        // a block read before the file changed on the server is stale
+        if(_isSameStamp(&iFuseBufferCache->stamp, &stamp) &&
                 iFuseBufferCache->buffer != NULL) {
-            memcpy(buf, iFuseBufferCache->buffer, iFuseBufferCache->size);
+            _refBufferCache(iFuseBufferCache);
 
             readSize = iFuseBufferCache->size;
             hasCache = true;
@@ -204,218 +1590,288 @@ static int _readBlock(iFuseFd_t *iFuseFd, char *buf, unsigned int blockID) {
 
     pthread_rwlock_unlock(&g_BufferCacheLock);
 
+    if(hasCache) {
+        iFuseFsCountReadCacheHit();
 
-    if(!hasCache) {
+        // copy only the requested range, other readers and writers are not held up
+        if(buf != NULL) {
+            _copyToRange(buf, inBlockOffset, size, iFuseBufferCache->buffer, 0, readSize);
+        }
+
+        _unrefBufferCache(iFuseBufferCache);
+    } else {
         char *blockBuffer = NULL;
-        
-        // remove
-        pthread_rwlock_wrlock(&g_BufferCacheLock);
-        it_cachemap = g_CacheMap.find(iFuseFd->fdId);
-        if(it_cachemap != g_CacheMap.end()) {
-            iFuseBufferCache = it_cachemap->second;
-            
-            g_CacheMap.erase(it_cachemap);
 
-            // release
-            _freeBufferCache(iFuseBufferCache);
-        }
-        pthread_rwlock_unlock(&g_BufferCacheLock);
-        
-        // read
-        status = _newBufferCache(&iFuseBufferCache);
-        if(status < 0) {
-            return status;
+        iFuseFsCountReadCacheMiss();
+
+        // blocks being uploaded are not visible on the server yet
+        if(g_WriteBehind) {
+            _waitStripedWritesOfPath(iFuseFd->iRodsPath, NULL);
         }
 
-        assert(iFuseBufferCache != NULL);
+        // a hedged read may land after we return, so it never goes to the caller's buffer
+        if(buf != NULL && inBlockOffset == 0 && size == (size_t)g_Blocksize && g_HedgePercentile == 0) {
+            // whole block is wanted - receive it straight into the caller's buffer
+            status = iFuseFsRead(iFuseFd, buf, blockStartOffset, g_Blocksize);
+            if (status < 0) {
+                iFuseLibLogError(LOG_ERROR, status, "_readBlock: iFuseFsRead of %s error, status = %d",
+                        iFuseFd->iRodsPath, status);
+                return -ENOENT;
+            }
 
-        // read from server
-        blockBuffer = (char*)calloc(1, g_Blocksize);
-        if(blockBuffer == NULL) {
-            _freeBufferCache(iFuseBufferCache);
-            return SYS_MALLOC_ERR;
-        }
+            iFuseLibLog(LOG_DEBUG, "_readBlock: iFuseFsRead of %s into caller's buffer - offset: %lld, size: %lld", iFuseFd->iRodsPath, (long long)blockStartOffset, (long long)status);
 
-        status = iFuseFsRead(iFuseFd, blockBuffer, blockStartOffset, g_Blocksize);
-        if (status < 0) {
-            iFuseLibLogError(LOG_ERROR, status, "_readBlock: iFuseFsRead of %s error, status = %d",
-                    iFuseFd->iRodsPath, status);
-            free(blockBuffer);
-            _freeBufferCache(iFuseBufferCache);
-            return -ENOENT;
-        }
+            iFuseFsCountReadDirect(status);
+            readSize = status;
+        } else {
+            // read
+            status = _newBufferCache(&iFuseBufferCache);
+            if(status < 0) {
+                return status;
+            }
 
-        iFuseLibLog(LOG_DEBUG, "_readBlock: iFuseFsRead of %s - offset: %lld, size: %lld", iFuseFd->iRodsPath, (long long)blockStartOffset, (long long)status);
+            assert(iFuseBufferCache != NULL);
+
+            if(g_HedgePercentile > 0) {
+                status = _readHedged(iFuseFd, &blockBuffer, blockStartOffset, g_Blocksize);
+                if (status < 0) {
+                    iFuseLibLogError(LOG_ERROR, status, "_readBlock: _readHedged of %s error, status = %d",
+                            iFuseFd->iRodsPath, status);
+                    _freeBufferCache(iFuseBufferCache);
+                    return -ENOENT;
+                }
+            } else {
+                // read from server straight into the cache block
+                blockBuffer = iFuseBufferPoolAlloc(true);
+                if(blockBuffer == NULL) {
+                    _freeBufferCache(iFuseBufferCache);
+                    return SYS_MALLOC_ERR;
+                }
+
+                status = iFuseFsRead(iFuseFd, blockBuffer, blockStartOffset, g_Blocksize);
+                if (status < 0) {
+                    iFuseLibLogError(LOG_ERROR, status, "_readBlock: iFuseFsRead of %s error, status = %d",
+                            iFuseFd->iRodsPath, status);
+                    iFuseBufferPoolFree(blockBuffer);
+                    _freeBufferCache(iFuseBufferCache);
+                    return -ENOENT;
+                }
+            }
 
-        iFuseBufferCache->fdId = iFuseFd->fdId;
-        iFuseBufferCache->iRodsPath = strdup(iFuseFd->iRodsPath);
-        iFuseBufferCache->buffer = blockBuffer;
-        iFuseBufferCache->offset = blockStartOffset;
-        iFuseBufferCache->size = status;
+            iFuseLibLog(LOG_DEBUG, "_readBlock: iFuseFsRead of %s - offset: %lld, size: %lld", iFuseFd->iRodsPath, (long long)blockStartOffset, (long long)status);
 
-        pthread_rwlock_wrlock(&g_BufferCacheLock);
+            // pool buffers are not zero-filled, a write past the end of the last block leaves a hole
+            if(status < g_Blocksize) {
+                bzero(blockBuffer + status, g_Blocksize - status);
+            }
+
+            iFuseBufferCache->fdId = iFuseFd->fdId;
+            iFuseBufferCache->iRodsPath = strdup(iFuseFd->iRodsPath);
+            iFuseBufferCache->buffer = blockBuffer;
+            iFuseBufferCache->offset = blockStartOffset;
+            iFuseBufferCache->size = status;
+            iFuseBufferCache->stamp = stamp;
 
-        g_CacheMap[iFuseFd->fdId] = iFuseBufferCache;
+            pthread_rwlock_wrlock(&g_BufferCacheLock);
 
-        // copy
-        memcpy(buf, iFuseBufferCache->buffer, iFuseBufferCache->size);
+            // replace a stale block or one filled by another reader meanwhile
+            it_cachemap = g_CacheMap.find(cachekey);
+            if(it_cachemap != g_CacheMap.end()) {
+                _detachBufferCache(it_cachemap->second);
+                g_CacheMap.erase(it_cachemap);
+            }
 
-        readSize = iFuseBufferCache->size;
+            _evictCache(g_MaxCacheBlockNum - 1);
 
-        pthread_rwlock_unlock(&g_BufferCacheLock);
+            g_CacheMap[cachekey] = iFuseBufferCache;
+
+            _refBufferCache(iFuseBufferCache);
+            readSize = iFuseBufferCache->size;
+
+            pthread_rwlock_unlock(&g_BufferCacheLock);
+
+            // copy
+            if(buf != NULL) {
+                _copyToRange(buf, inBlockOffset, size, iFuseBufferCache->buffer, 0, readSize);
+            }
+
+            _unrefBufferCache(iFuseBufferCache);
+        }
     }
 
     pthread_rwlock_rdlock(&g_BufferCacheLock);
 
-    // check delta
-    it_deltamap = g_DeltaMap.find(pathkey);
-    if(it_deltamap != g_DeltaMap.end()) {
-        // has delta
-        iFuseBufferCache = it_deltamap->second;
+    // check dirty ranges
+    it_dirtymap = g_DirtyMap.find(cachekey);
+    if(it_dirtymap != g_DirtyMap.end()) {
+        // has dirty ranges
+        iFuseBufferCache = it_dirtymap->second;
 
-        if(getBlockID(iFuseBufferCache->offset) == blockID &&
-                iFuseBufferCache->buffer != NULL) {
-            size_t deltaSize = 0;
-
-            assert((iFuseBufferCache->offset - blockStartOffset) >= 0);
+        for(it_extent = iFuseBufferCache->extents->begin(); it_extent != iFuseBufferCache->extents->end(); it_extent++) {
+            off_t extentInBlockOffset = it_extent->first;
+            size_t extentEnd = it_extent->first + it_extent->second;
 
-            memcpy(buf + (iFuseBufferCache->offset - blockStartOffset), iFuseBufferCache->buffer, iFuseBufferCache->size);
+            if(buf != NULL) {
+                // a hole between the block data and the range reads as zero
+                if((size_t)extentInBlockOffset > readSize) {
+                    _copyToRange(buf, inBlockOffset, size, NULL, readSize, extentInBlockOffset - readSize);
+                }
 
-            deltaSize = (iFuseBufferCache->offset - blockStartOffset) + iFuseBufferCache->size;
+                _copyToRange(buf, inBlockOffset, size, iFuseBufferCache->buffer + extentInBlockOffset, extentInBlockOffset, it_extent->second);
+            }
 
-            if(readSize < deltaSize) {
-                readSize = deltaSize;
+            if(readSize < extentEnd) {
+                readSize = extentEnd;
             }
         }
     }
 
+    // dirty blocks further on - the rest of the block is a hole
+    it_dirtymap = g_DirtyMap.upper_bound(cachekey);
+    if(it_dirtymap != g_DirtyMap.end() && it_dirtymap->first.first == cachekey.first &&
+            readSize < (size_t)g_Blocksize) {
+        if(buf != NULL) {
+            _copyToRange(buf, inBlockOffset, size, NULL, readSize, g_Blocksize - readSize);
+        }
+
+        readSize = g_Blocksize;
+    }
+
     pthread_rwlock_unlock(&g_BufferCacheLock);
     return readSize;
 }
 
 static int _writeBlock(iFuseFd_t *iFuseFd, const char *buf, off_t off, size_t size) {
     int status = 0;
-    std::map<std::string, iFuseBufferCache_t*>::iterator it_deltamap;
+    std::map<iFuseBufferCacheKey_t, iFuseBufferCache_t*>::iterator it_dirtymap;
     iFuseBufferCache_t *iFuseBufferCache = NULL;
-    std::string pathkey(iFuseFd->iRodsPath);
+    iFuseBufferCache_t *completedBufferCache = NULL;
+    iFuseBufferCacheKey_t dirtykey(iFuseFd->iRodsPath, getBlockID(off));
+    off_t inBlockOffset = getInBlockOffset(off);
+    size_t dirtyBlockNum = 0;
+    size_t totalDirtyBlockNum = 0;
+    bool overLimit = false;
+    char *newBuf = NULL;
 
     assert(iFuseFd != NULL);
     assert(buf != NULL);
     assert(size > 0);
 
-    pthread_rwlock_wrlock(&g_BufferCacheLock);
+    while(true) {
+        pthread_rwlock_wrlock(&g_BufferCacheLock);
 
-    it_deltamap = g_DeltaMap.find(pathkey);
-    if(it_deltamap != g_DeltaMap.end()) {
-        // has it - determine flush or extend
-        iFuseBufferCache = it_deltamap->second;
-
-        if(_isSameBlock(iFuseBufferCache->offset, off) &&
-            (off_t)(iFuseBufferCache->offset + iFuseBufferCache->size) >= off &&
-            iFuseBufferCache->offset <= (off_t)(off + size)) {
-            // intersect - expand
-            off_t startOffset = off > iFuseBufferCache->offset ? iFuseBufferCache->offset : off;
-            off_t endOffset = (off + size) > (iFuseBufferCache->offset + iFuseBufferCache->size) ? (off + size) : (iFuseBufferCache->offset + iFuseBufferCache->size);
-            size_t newSize = endOffset - startOffset;
-            char *newBuf = (char*)calloc(1, newSize);
-            if(newBuf == NULL) {
+        it_dirtymap = g_DirtyMap.find(dirtykey);
+        if(it_dirtymap != g_DirtyMap.end()) {
+            // has it - absorb in place
+            iFuseBufferCache = it_dirtymap->second;
+            break;
+        }
+
+        if(newBuf != NULL) {
+            // no dirty block - make one
+            status = _newBufferCache(&iFuseBufferCache);
+            if(status < 0) {
                 pthread_rwlock_unlock(&g_BufferCacheLock);
-                return SYS_MALLOC_ERR;
+                iFuseBufferPoolFree(newBuf);
+                return status;
             }
 
-            assert(newSize > 0);
-            assert((iFuseBufferCache->offset - startOffset) >= 0);
-            assert((off - startOffset) >= 0);
-
-            memcpy(newBuf + (iFuseBufferCache->offset - startOffset), iFuseBufferCache->buffer, iFuseBufferCache->size);
-            memcpy(newBuf + (off - startOffset), buf, size);
-
-            free(iFuseBufferCache->buffer);
+            assert(iFuseBufferCache != NULL);
 
+            // we must use new keyword instead of calloc since it is c++ stl map object
+            iFuseBufferCache->extents = new std::map<off_t, size_t>();
+            iFuseBufferCache->fdId = iFuseFd->fdId;
+            iFuseBufferCache->iRodsPath = strdup(iFuseFd->iRodsPath);
             iFuseBufferCache->buffer = newBuf;
-            iFuseBufferCache->offset = startOffset;
-            iFuseBufferCache->size = newSize;
-
-            pthread_rwlock_unlock(&g_BufferCacheLock);
-        } else {
-            char *newBuf = (char*)calloc(1, size);
-            char *bufFlush = iFuseBufferCache->buffer;
-            off_t offFlush = iFuseBufferCache->offset;
-            size_t sizeFlush = iFuseBufferCache->size;
+            iFuseBufferCache->offset = getBlockStartOffset(dirtykey.second);
+            iFuseBufferCache->size = 0;
 
-            if(newBuf == NULL) {
-                pthread_rwlock_unlock(&g_BufferCacheLock);
-                return SYS_MALLOC_ERR;
-            }
+            g_DirtyMap[dirtykey] = iFuseBufferCache;
+            __sync_fetch_and_add(&g_DirtyBlockNum, 1);
 
-            // disjunction
-            // apply delta to caches
-            _applyDeltaToCache(iFuseFd->iRodsPath, iFuseBufferCache->buffer, iFuseBufferCache->offset, iFuseBufferCache->size);
+            newBuf = NULL;
+            break;
+        }
 
-            memcpy(newBuf, buf, size);
+        dirtyBlockNum = _getDirtyBlockNum(dirtykey.first);
+        totalDirtyBlockNum = __sync_fetch_and_add(&g_DirtyBlockNum, 0);
 
-            iFuseBufferCache->buffer = newBuf;
-            iFuseBufferCache->offset = off;
-            iFuseBufferCache->size = size;
+        pthread_rwlock_unlock(&g_BufferCacheLock);
 
-            // release lock before making write request
-            pthread_rwlock_unlock(&g_BufferCacheLock);
+        // blocks being written back count too
+        overLimit = dirtyBlockNum + _getQueuedBlockNum(iFuseFd) >= g_MaxDirtyBlockNum ||
+            totalDirtyBlockNum >= g_MaxTotalDirtyBlockNum;
 
-            // flush
-            status = iFuseFsWrite(iFuseFd, bufFlush, offFlush, sizeFlush);
-            if (status < 0) {
-                iFuseLibLogError(LOG_ERROR, status, "_writeBlock: iFuseFsWrite of %s error, status = %d",
-                        iFuseFd->iRodsPath, status);
-                return -ENOENT;
+        if(overLimit && dirtyBlockNum > 0) {
+            // too much buffered - write back the file's dirty blocks first
+            status = _flushDirty(iFuseFd, false);
+            if(status < 0) {
+                return status;
             }
-
-            free(bufFlush);
+        } else if(totalDirtyBlockNum >= g_MaxTotalDirtyBlockNum) {
+            // nothing of the file to write back - wait for blocks of other files being written back
+            _waitDirtyBlocksWrittenBack();
         }
-    } else {
-        char *newBuf = (char*)calloc(1, size);
+
+        // a dirty block is a block-sized buffer, taken without the lock as the pool may reclaim cached blocks
+        newBuf = iFuseBufferPoolAlloc(true);
         if(newBuf == NULL) {
-            pthread_rwlock_unlock(&g_BufferCacheLock);
-            return SYS_MALLOC_ERR;
-        }
+            // out of buffers - the file's dirty blocks give theirs back
+            status = _flushDirty(iFuseFd, false);
+            if(status < 0) {
+                return status;
+            }
 
-        // no delta
-        status = _newBufferCache(&iFuseBufferCache);
-        if(status < 0) {
-            pthread_rwlock_unlock(&g_BufferCacheLock);
-            return status;
+            newBuf = iFuseBufferPoolAlloc(true);
+            if(newBuf == NULL) {
+                return SYS_MALLOC_ERR;
+            }
         }
+    }
 
-        assert(iFuseBufferCache != NULL);
+    memcpy(iFuseBufferCache->buffer + inBlockOffset, buf, size);
+    _addDirtyExtent(iFuseBufferCache, inBlockOffset, size);
 
-        memcpy(newBuf, buf, size);
+    if(g_WriteBehind && (size_t)(inBlockOffset + size) == (size_t)g_Blocksize &&
+            _isCompleteDirtyBlock(iFuseBufferCache)) {
+        // completed block of a sequential write - upload in the background while following blocks are written
+        _applyDirtyToCache(iFuseBufferCache);
+        g_DirtyMap.erase(dirtykey);
+        completedBufferCache = iFuseBufferCache;
+    }
 
-        iFuseBufferCache->fdId = iFuseFd->fdId;
-        iFuseBufferCache->iRodsPath = strdup(iFuseFd->iRodsPath);
-        iFuseBufferCache->buffer = newBuf;
-        iFuseBufferCache->offset = off;
-        iFuseBufferCache->size = size;
+    pthread_rwlock_unlock(&g_BufferCacheLock);
 
-        g_DeltaMap[pathkey] = iFuseBufferCache;
+    if(newBuf != NULL) {
+        // another writer made the block meanwhile
+        iFuseBufferPoolFree(newBuf);
+    }
 
-        pthread_rwlock_unlock(&g_BufferCacheLock);
+    if(completedBufferCache != NULL) {
+        status = _queueStripedWrite(iFuseFd, completedBufferCache);
+        if (status < 0) {
+            iFuseLibLogError(LOG_ERROR, status, "_writeBlock: _queueStripedWrite of %s error, status = %d",
+                    iFuseFd->iRodsPath, status);
+            return -ENOENT;
+        }
     }
 
     return 0;
 }
 
 static int _releaseAllCache() {
-    std::map<std::string, iFuseBufferCache_t*>::iterator it_deltamap;
-    std::map<unsigned long, iFuseBufferCache_t*>::iterator it_cachemap;
+    std::map<iFuseBufferCacheKey_t, iFuseBufferCache_t*>::iterator it_dirtymap;
+    std::map<iFuseBufferCacheKey_t, iFuseBufferCache_t*>::iterator it_cachemap;
     iFuseBufferCache_t *iFuseBufferCache = NULL;
 
     pthread_rwlock_wrlock(&g_BufferCacheLock);
 
     // release all caches
-    while(!g_DeltaMap.empty()) {
-        it_deltamap = g_DeltaMap.begin();
-        if(it_deltamap != g_DeltaMap.end()) {
-            iFuseBufferCache = it_deltamap->second;
-            g_DeltaMap.erase(it_deltamap);
+    while(!g_DirtyMap.empty()) {
+        it_dirtymap = g_DirtyMap.begin();
+        if(it_dirtymap != g_DirtyMap.end()) {
+            iFuseBufferCache = it_dirtymap->second;
+            g_DirtyMap.erase(it_dirtymap);
 
             _freeBufferCache(iFuseBufferCache);
         }
@@ -431,6 +1887,10 @@ static int _releaseAllCache() {
         }
     }
 
+    g_DirtyBlockNum = 0;
+    g_QueuedBlockNum = 0;
+    g_StampMap.clear();
+
     pthread_rwlock_unlock(&g_BufferCacheLock);
     return 0;
 }
@@ -443,24 +1903,115 @@ void iFuseBufferedFSInit() {
     if(iFuseLibGetOption()->blocksize > 0) {
         g_Blocksize = iFuseLibGetOption()->blocksize;
     }
+
+    iFuseBufferPoolInit(g_Blocksize);
+    iFuseBufferPoolSetReclaimHandler(_reclaimCache);
+
+    g_MaxCacheBlockNum = ((size_t)IFUSE_BUFFER_CACHE_MB * 1024 * 1024) / g_Blocksize;
+    if(iFuseLibGetOption()->cacheMB > 0) {
+        g_MaxCacheBlockNum = ((size_t)iFuseLibGetOption()->cacheMB * 1024 * 1024) / g_Blocksize;
+    }
+
+    // at least a block is needed to serve partial block reads
+    if(g_MaxCacheBlockNum < 1) {
+        g_MaxCacheBlockNum = 1;
+    }
+
+    g_MaxDirtyBlockNum = ((size_t)IFUSE_BUFFER_DIRTY_MB * 1024 * 1024) / g_Blocksize;
+    if(iFuseLibGetOption()->dirtyMB > 0) {
+        g_MaxDirtyBlockNum = ((size_t)iFuseLibGetOption()->dirtyMB * 1024 * 1024) / g_Blocksize;
+    }
+
+    if(g_MaxDirtyBlockNum < 1) {
+        g_MaxDirtyBlockNum = 1;
+    }
+
+    g_MaxTotalDirtyBlockNum = ((size_t)IFUSE_BUFFER_MAX_DIRTY_MB * 1024 * 1024) / g_Blocksize;
+    if(iFuseLibGetOption()->maxDirtyMB > 0) {
+        g_MaxTotalDirtyBlockNum = ((size_t)iFuseLibGetOption()->maxDirtyMB * 1024 * 1024) / g_Blocksize;
+    }
+
+    // dirty blocks must not take buffers readers need
+    if(iFuseBufferPoolGetMaxBufferNum() > 0 && g_MaxTotalDirtyBlockNum > (size_t)iFuseBufferPoolGetMaxBufferNum() / 2) {
+        g_MaxTotalDirtyBlockNum = iFuseBufferPoolGetMaxBufferNum() / 2;
+    }
+
+    if(g_MaxTotalDirtyBlockNum < 1) {
+        g_MaxTotalDirtyBlockNum = 1;
+    }
+
+    g_WriteStripeNum = iFuseLibGetOption()->writeStripeNum;
+    if(g_WriteStripeNum > IFUSE_MAX_NUM_WRITE_STRIPE) {
+        g_WriteStripeNum = IFUSE_MAX_NUM_WRITE_STRIPE;
+    }
+
+    // extra descriptors only write in the background
+    g_WriteBehind = iFuseLibGetOption()->writeBehind || g_WriteStripeNum > 0;
+
+    g_HedgePercentile = iFuseLibGetOption()->hedgeReadPercentile;
+    if(g_HedgePercentile < 0) {
+        g_HedgePercentile = 0;
+    } else if(g_HedgePercentile > 100) {
+        g_HedgePercentile = 100;
+    }
+
+    pthread_mutex_init(&g_ReadLatencyMutex, NULL);
+
+    pthread_mutex_init(&g_HedgedReadFdMutex, NULL);
+    pthread_cond_init(&g_HedgedReadFdCond, NULL);
+
+    pthread_mutex_init(&g_DirtyWaitMutex, NULL);
+    pthread_cond_init(&g_DirtyWaitCond, NULL);
    
     pthread_rwlockattr_init(&g_BufferCacheLockAttr);
     pthread_rwlock_init(&g_BufferCacheLock, &g_BufferCacheLockAttr);
+
+    pthread_rwlockattr_init(&g_StripedWriteLockAttr);
+    pthread_rwlock_init(&g_StripedWriteLock, &g_StripedWriteLockAttr);
 }
 
 /*
  * Destroy buffer cache manager
  */
 void iFuseBufferedFSDestroy() {
+    std::map<unsigned long, iFuseStripedWrite_t*>::iterator it_stripedwritemap;
+    iFuseStripedWrite_t *iFuseStripedWrite = NULL;
+
+    pthread_rwlock_wrlock(&g_StripedWriteLock);
+
+    // release all writers
+    while(!g_StripedWriteMap.empty()) {
+        it_stripedwritemap = g_StripedWriteMap.begin();
+        iFuseStripedWrite = it_stripedwritemap->second;
+        g_StripedWriteMap.erase(it_stripedwritemap);
+
+        _unrefStripedWrite(iFuseStripedWrite);
+    }
+
+    pthread_rwlock_unlock(&g_StripedWriteLock);
+
     _releaseAllCache();
 
+    iFuseBufferPoolDestroy();
+
     pthread_rwlock_destroy(&g_BufferCacheLock);
     pthread_rwlockattr_destroy(&g_BufferCacheLockAttr);
+
+    pthread_rwlock_destroy(&g_StripedWriteLock);
+    pthread_rwlockattr_destroy(&g_StripedWriteLockAttr);
+
+    pthread_mutex_destroy(&g_ReadLatencyMutex);
+
+    pthread_cond_destroy(&g_HedgedReadFdCond);
+    pthread_mutex_destroy(&g_HedgedReadFdMutex);
+
+    pthread_cond_destroy(&g_DirtyWaitCond);
+    pthread_mutex_destroy(&g_DirtyWaitMutex);
 }
 
 int iFuseBufferedFsGetAttr(const char *iRodsPath, struct stat *stbuf) {
     int status = 0;
-    std::map<std::string, iFuseBufferCache_t*>::iterator it_deltamap;
+    std::map<iFuseBufferCacheKey_t, iFuseBufferCache_t*>::iterator it_dirtymap;
     iFuseBufferCache_t *iFuseBufferCache = NULL;
     std::string pathkey(iRodsPath);
 
@@ -478,10 +2029,11 @@ int iFuseBufferedFsGetAttr(const char *iRodsPath, struct stat *stbuf) {
 
     pthread_rwlock_rdlock(&g_BufferCacheLock);
 
-    it_deltamap = g_DeltaMap.find(pathkey);
-    if(it_deltamap != g_DeltaMap.end()) {
+    // the last dirty block of the path
+    it_dirtymap = g_DirtyMap.upper_bound(iFuseBufferCacheKey_t(pathkey, (unsigned int)-1));
+    if(it_dirtymap != g_DirtyMap.begin() && (--it_dirtymap)->first.first == pathkey) {
         // has it
-        iFuseBufferCache = it_deltamap->second;
+        iFuseBufferCache = it_dirtymap->second;
 
         off_t newSize = iFuseBufferCache->offset + iFuseBufferCache->size;
         if(newSize > stbuf->st_size) {
@@ -490,6 +2042,15 @@ int iFuseBufferedFsGetAttr(const char *iRodsPath, struct stat *stbuf) {
     }
 
     pthread_rwlock_unlock(&g_BufferCacheLock);
+
+    if(g_WriteBehind) {
+        // blocks being uploaded are not visible on the server yet
+        off_t newSize = _getStripedWriteEndOfPath(iRodsPath);
+        if(newSize > stbuf->st_size) {
+            stbuf->st_size = newSize;
+        }
+    }
+
     return status;
 }
 
@@ -498,6 +2059,8 @@ int iFuseBufferedFsGetAttr(const char *iRodsPath, struct stat *stbuf) {
  */
 int iFuseBufferedFsOpen(const char *iRodsPath, iFuseFd_t **iFuseFd, int openFlag) {
     int status = 0;
+    struct stat stbuf;
+    iFuseBufferCacheStamp_t stamp;
 
     assert(iRodsPath != NULL);
     assert(iFuseFd != NULL);
@@ -511,7 +2074,24 @@ int iFuseBufferedFsOpen(const char *iRodsPath, iFuseFd_t **iFuseFd, int openFlag
         return status;
     }
 
-    return status;
+    // cached blocks are used only if the file has not changed since they were read
+    // a cached stat may predate a change made by another client, ask the server
+    if(iFuseLibGetOption()->cacheMetadata) {
+        iFuseMetadataCacheRemoveStat(iRodsPath);
+    }
+
+    bzero(&stamp, sizeof(iFuseBufferCacheStamp_t));
+    bzero(&stbuf, sizeof(struct stat));
+    if(iFuseFsGetAttr(iRodsPath, &stbuf) == 0) {
+        stamp.size = stbuf.st_size;
+        stamp.mtime = stbuf.st_mtime;
+    }
+
+    pthread_rwlock_wrlock(&g_BufferCacheLock);
+    g_StampMap[(*iFuseFd)->fdId] = stamp;
+    pthread_rwlock_unlock(&g_BufferCacheLock);
+
+    return 0;
 }
 
 /*
@@ -519,8 +2099,7 @@ int iFuseBufferedFsOpen(const char *iRodsPath, iFuseFd_t **iFuseFd, int openFlag
  */
 int iFuseBufferedFsClose(iFuseFd_t *iFuseFd) {
     int status = 0;
-    std::map<unsigned long, iFuseBufferCache_t*>::iterator it_cachemap;
-    iFuseBufferCache_t *iFuseBufferCache = NULL;
+    int closeStatus = 0;
     char *iRodsPath;
 
     assert(iFuseFd != NULL);
@@ -529,38 +2108,46 @@ int iFuseBufferedFsClose(iFuseFd_t *iFuseFd) {
 
     if((iFuseFd->openFlag & O_ACCMODE) != O_RDONLY) {
         // flush if necessary
-        status = _flushDelta(iFuseFd);
+        status = _flushDirty(iFuseFd, true);
         if (status < 0) {
-            iFuseLibLogError(LOG_ERROR, status, "iFuseBufferedFsClose: _flushCache of %s error, status = %d",
+            iFuseLibLogError(LOG_ERROR, status, "iFuseBufferedFsClose: _flushDirty of %s error, status = %d",
                     iFuseFd->iRodsPath, status);
-            return -ENOENT;
         }
-    }
-
-    pthread_rwlock_wrlock(&g_BufferCacheLock);
-
-    it_cachemap = g_CacheMap.find(iFuseFd->fdId);
-    if(it_cachemap != g_CacheMap.end()) {
-        // has it
-        iFuseBufferCache = it_cachemap->second;
-        g_CacheMap.erase(it_cachemap);
 
-        _freeBufferCache(iFuseBufferCache);
+        // the writer may write through the file's own descriptor, release it first
+        closeStatus = _releaseStripedWrite(iFuseFd);
+        if (closeStatus < 0) {
+            iFuseLibLogError(LOG_ERROR, closeStatus, "iFuseBufferedFsClose: _releaseStripedWrite of %s error, status = %d",
+                    iFuseFd->iRodsPath, closeStatus);
+            if(status == 0) {
+                status = closeStatus;
+            }
+        }
     }
 
+    // a read that lost to a hedged one may still use the descriptor
+    _waitHedgedReadsOfFd(iFuseFd);
+
+    // cached blocks stay for other descriptors
+    pthread_rwlock_wrlock(&g_BufferCacheLock);
+    g_StampMap.erase(iFuseFd->fdId);
     pthread_rwlock_unlock(&g_BufferCacheLock);
 
     iRodsPath = strdup(iFuseFd->iRodsPath);
 
-    status = iFuseFsClose(iFuseFd);
-    if (status < 0) {
-        iFuseLibLogError(LOG_ERROR, status, "iFuseBufferedFsClose: iFuseFsClose of %s error, status = %d",
-                iRodsPath, status);
-        free(iRodsPath);
-        return -ENOENT;
+    // close even if buffered data was not written, so the descriptor is not leaked
+    closeStatus = iFuseFsClose(iFuseFd);
+    if (closeStatus < 0) {
+        iFuseLibLogError(LOG_ERROR, closeStatus, "iFuseBufferedFsClose: iFuseFsClose of %s error, status = %d",
+                iRodsPath, closeStatus);
+        if(status == 0) {
+            status = closeStatus;
+        }
     }
 
     free(iRodsPath);
+
+    // the first error is reported
     return status;
 }
 
@@ -575,9 +2162,9 @@ int iFuseBufferedFsFlush(iFuseFd_t *iFuseFd) {
     iFuseLibLog(LOG_DEBUG, "iFuseBufferedFsFlush: %s", iFuseFd->iRodsPath);
 
     if((iFuseFd->openFlag & O_ACCMODE) != O_RDONLY) {
-        status = _flushDelta(iFuseFd);
+        status = _flushDirty(iFuseFd, true);
         if (status < 0) {
-            iFuseLibLogError(LOG_ERROR, status, "iFuseBufferedFsFlush: _flushCache of %s error, status = %d",
+            iFuseLibLogError(LOG_ERROR, status, "iFuseBufferedFsFlush: _flushDirty of %s error, status = %d",
                     iFuseFd->iRodsPath, status);
             return -ENOENT;
         }
@@ -593,15 +2180,14 @@ int iFuseBufferedFsFlush(iFuseFd_t *iFuseFd) {
     return status;
 }
 
-int iFuseBufferedFsReadBlock(iFuseFd_t *iFuseFd, char *buf, unsigned int blockID) {
+int iFuseBufferedFsReadBlock(iFuseFd_t *iFuseFd, char *buf, unsigned int blockID, off_t inBlockOffset, size_t size) {
     int status = 0;
 
     assert(iFuseFd != NULL);
-    assert(buf != NULL);
 
-    iFuseLibLog(LOG_DEBUG, "iFuseBufferedFsReadBlock: %s, blockID: %u", iFuseFd->iRodsPath, blockID);
+    iFuseLibLog(LOG_DEBUG, "iFuseBufferedFsReadBlock: %s, blockID: %u, in-block offset: %lld, size: %lld", iFuseFd->iRodsPath, blockID, (long long)inBlockOffset, (long long)size);
 
-    status = _readBlock(iFuseFd, buf, blockID);
+    status = _readBlock(iFuseFd, buf, blockID, inBlockOffset, size);
     if(status < 0) {
         iFuseLibLogError(LOG_ERROR, status, "iFuseBufferedFsReadBlock: _readBlock of %s error, status = %d",
             iFuseFd->iRodsPath, status);
@@ -619,10 +2205,6 @@ int iFuseBufferedFsRead(iFuseFd_t *iFuseFd, char *buf, off_t off, size_t size) {
     size_t readSize = 0;
     size_t remain = 0;
     off_t curOffset = 0;
-    char *blockBuffer = (char*)calloc(1, g_Blocksize);
-    if(blockBuffer == NULL) {
-        return SYS_MALLOC_ERR;
-    }
 
     assert(iFuseFd != NULL);
     assert(buf != NULL);
@@ -638,7 +2220,8 @@ int iFuseBufferedFsRead(iFuseFd_t *iFuseFd, char *buf, off_t off, size_t size) {
         size_t curSize = inBlockAvail > remain ? remain : inBlockAvail;
         size_t blockSize = 0;
 
-        status = _readBlock(iFuseFd, blockBuffer, getBlockID(curOffset));
+        // block data lands in the caller's buffer directly
+        status = _readBlock(iFuseFd, buf + readSize, getBlockID(curOffset), inBlockOffset, curSize);
         if(status < 0) {
             iFuseLibLogError(LOG_ERROR, status, "iFuseBufferedFsRead: _readBlock of %s error, status = %d",
                 iFuseFd->iRodsPath, status);
@@ -652,19 +2235,16 @@ int iFuseBufferedFsRead(iFuseFd_t *iFuseFd, char *buf, off_t off, size_t size) {
 
         iFuseLibLog(LOG_DEBUG, "iFuseBufferedFsRead: _readBlock of %s, offset: %lld, in-block offset: %lld, curSize: %lld, size: %lld", iFuseFd->iRodsPath, (long long)curOffset, (long long)inBlockOffset, (long long)curSize, (long long)blockSize);
 
-        if(inBlockOffset + curSize > blockSize) {
-            curSize = blockSize - inBlockOffset;
-        }
-
-        if (curSize == 0) {
+        if((size_t)inBlockOffset >= blockSize) {
             // eof
             break;
         }
 
-        iFuseLibLog(LOG_DEBUG, "iFuseBufferedFsRead: block read of %s - offset %lld, size %lld", iFuseFd->iRodsPath, (long long)curOffset, (long long)curSize);
+        if(inBlockOffset + curSize > blockSize) {
+            curSize = blockSize - inBlockOffset;
+        }
 
-        // copy
-        memcpy(buf + readSize, blockBuffer + inBlockOffset, curSize);
+        iFuseLibLog(LOG_DEBUG, "iFuseBufferedFsRead: block read of %s - offset %lld, size %lld", iFuseFd->iRodsPath, (long long)curOffset, (long long)curSize);
 
         readSize += curSize;
         remain -= curSize;
@@ -676,8 +2256,6 @@ int iFuseBufferedFsRead(iFuseFd_t *iFuseFd, char *buf, off_t off, size_t size) {
         }
     }
 
-    free(blockBuffer);
-
     return readSize;
 }
 
@@ -719,3 +2297,85 @@ int iFuseBufferedFsWrite(iFuseFd_t *iFuseFd, const char *buf, off_t off, size_t
 
     return writtenSize;
 }
+
+/*
+ * Delete a file and drop its cached blocks
+ */
+int iFuseBufferedFsUnlink(const char *iRodsPath) {
+    int status = 0;
+
+    assert(iRodsPath != NULL);
+
+    iFuseLibLog(LOG_DEBUG, "iFuseBufferedFsUnlink: %s", iRodsPath);
+
+    status = iFuseFsUnlink(iRodsPath);
+
+    // after the request, so blocks filled while it was in flight are dropped too
+    _invalidateCache(iRodsPath);
+
+    if (status < 0) {
+        iFuseLibLogError(LOG_ERROR, status, "iFuseBufferedFsUnlink: iFuseFsUnlink of %s error, status = %d",
+                iRodsPath, status);
+        return status;
+    }
+
+    return status;
+}
+
+/*
+ * Rename a file or a directory and drop cached blocks of both paths
+ */
+int iFuseBufferedFsRename(const char *iRodsFromPath, const char *iRodsToPath) {
+    int status = 0;
+
+    assert(iRodsFromPath != NULL);
+    assert(iRodsToPath != NULL);
+
+    iFuseLibLog(LOG_DEBUG, "iFuseBufferedFsRename: %s to %s", iRodsFromPath, iRodsToPath);
+
+    status = iFuseFsRename(iRodsFromPath, iRodsToPath);
+
+    // after the request, so blocks filled while it was in flight are dropped too
+    _invalidateCache(iRodsFromPath);
+    _invalidateCache(iRodsToPath);
+
+    if (status < 0) {
+        iFuseLibLogError(LOG_ERROR, status, "iFuseBufferedFsRename: iFuseFsRename of %s to %s error, status = %d",
+                iRodsFromPath, iRodsToPath, status);
+        return status;
+    }
+
+    return status;
+}
+
+/*
+ * Truncate a file and drop its cached blocks and dirty ranges past the size
+ */
+int iFuseBufferedFsTruncate(const char *iRodsPath, off_t size) {
+    int status = 0;
+
+    assert(iRodsPath != NULL);
+
+    iFuseLibLog(LOG_DEBUG, "iFuseBufferedFsTruncate: %s, size: %lld", iRodsPath, (long long)size);
+
+    // dirty ranges past the size must not grow the file again when written back
+    _truncateDirty(iRodsPath, size);
+
+    if(g_WriteBehind) {
+        // blocks being uploaded must land before the size changes
+        _waitStripedWritesOfPath(iRodsPath, NULL);
+    }
+
+    status = iFuseFsTruncate(iRodsPath, size);
+
+    // after the request, so blocks filled while it was in flight are dropped too
+    _invalidateCache(iRodsPath);
+
+    if (status < 0) {
+        iFuseLibLogError(LOG_ERROR, status, "iFuseBufferedFsTruncate: iFuseFsTruncate of %s error, status = %d",
+                iRodsPath, status);
+        return status;
+    }
+
+    return status;
+}
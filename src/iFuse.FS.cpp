@@ -20,6 +20,26 @@
 
 static bool g_ConnReuse = false;
 static bool g_CacheMetadata = true;
+static bool g_DirectData = false;
+
+// bytes returned to FUSE, bytes received straight into FUSE buffers and bytes memcpy'd on the way
+static unsigned long long g_ReadDeliveredBytes = 0;
+static unsigned long long g_ReadDirectBytes = 0;
+static unsigned long long g_ReadCopiedBytes = 0;
+static unsigned long long g_ReadHedgeCount = 0;
+static unsigned long long g_ReadHedgeWinCount = 0;
+static unsigned long long g_ReadCacheHitCount = 0;
+static unsigned long long g_ReadCacheMissCount = 0;
+
+// blocks handed to write-behind and written back, time spent uploading and writers held by the dirty limit
+static unsigned long long g_WriteBehindQueuedCount = 0;
+static unsigned long long g_WriteBehindQueuedBytes = 0;
+static unsigned long long g_WriteBehindDoneCount = 0;
+static unsigned long long g_WriteBehindDoneBytes = 0;
+static unsigned long long g_WriteBehindUSec = 0;
+static unsigned long long g_WriteBehindErrorCount = 0;
+static unsigned long long g_WriteBehindWaitCount = 0;
+static unsigned long long g_WriteBehindWaitUSec = 0;
 
 static int _safeAtoi(char *str) {
     if(str == NULL) {
@@ -71,6 +91,125 @@ static int _fillDirStat(struct stat *stbuf, uint ino, uint ctime, uint mtime, ui
 void iFuseFsInit() {
     g_ConnReuse = iFuseLibGetOption()->connReuse;
     g_CacheMetadata = iFuseLibGetOption()->cacheMetadata;
+    g_DirectData = iFuseLibGetOption()->directData;
+}
+
+/*
+ * Resolve the resource server holding the best replica of the file
+ * returns 1 and fills host if the data can be accessed directly
+ * returns 0 if the data has to go through the iRODS host
+ */
+static int _getDataHost(const char *iRodsPath, int openFlag, char *host) {
+    int status = 0;
+    dataObjInp_t dataObjInp;
+    char *outHost = NULL;
+    iFuseConn_t *iFuseConn = NULL;
+    iFuseConn_t *retryConn = NULL;
+    rodsEnv *myRodsEnv = iFuseLibGetRodsEnv();
+
+    status = iFuseConnGetAndUse(&iFuseConn, IFUSE_CONN_TYPE_FOR_SHORTOP);
+    if (status < 0) {
+        iFuseLibLogError(LOG_ERROR, status, "_getDataHost: iFuseConnGetAndUse of %s error", iRodsPath);
+        return 0;
+    }
+
+    bzero(&dataObjInp, sizeof ( dataObjInp_t));
+    dataObjInp.openFlags = openFlag;
+    rstrcpy(dataObjInp.objPath, iRodsPath, MAX_NAME_LEN);
+
+    status = iFuseConnLock(iFuseConn);
+    if (status < 0) {
+        iFuseConnUnuse(iFuseConn);
+        return 0;
+    }
+
+    if((openFlag & O_ACCMODE) == O_RDONLY) {
+        status = iFuseRodsClientGetHostForGet(iFuseConn->conn, &dataObjInp, &outHost);
+    } else {
+        status = iFuseRodsClientGetHostForPut(iFuseConn->conn, &dataObjInp, &outHost);
+    }
+    iFuseConnUpdateLastActTime(iFuseConn, false);
+    if (status < 0 && iFuseRodsClientTimedOutError(status) && iFuseConnRetryTimedOut(iFuseConn, &retryConn) >= 0) {
+        // resolving the host is idempotent, retry on another connection right away
+        iFuseConnUnlock(iFuseConn);
+        iFuseConnUnuse(iFuseConn);
+        iFuseConn = retryConn;
+
+        if((openFlag & O_ACCMODE) == O_RDONLY) {
+            status = iFuseRodsClientGetHostForGet(iFuseConn->conn, &dataObjInp, &outHost);
+        } else {
+            status = iFuseRodsClientGetHostForPut(iFuseConn->conn, &dataObjInp, &outHost);
+        }
+        iFuseConnUpdateLastActTime(iFuseConn, false);
+    }
+
+    if (status < 0 && iFuseRodsClientReadMsgError(status)) {
+        if(iFuseConnReconnect(iFuseConn) >= 0) {
+            if((openFlag & O_ACCMODE) == O_RDONLY) {
+                status = iFuseRodsClientGetHostForGet(iFuseConn->conn, &dataObjInp, &outHost);
+            } else {
+                status = iFuseRodsClientGetHostForPut(iFuseConn->conn, &dataObjInp, &outHost);
+            }
+        }
+    }
+
+    iFuseConnUnlock(iFuseConn);
+    iFuseConnUnuse(iFuseConn);
+
+    if (status < 0 || outHost == NULL) {
+        iFuseLibLogError(LOG_DEBUG, status, "_getDataHost: cannot resolve data host of %s, status = %d",
+                iRodsPath, status);
+        if(outHost != NULL) {
+            free(outHost);
+        }
+        return 0;
+    }
+
+    // "thisAddress" means the host we are talking to already has the replica
+    if(strcmp(outHost, THIS_ADDRESS) == 0 || strcmp(outHost, myRodsEnv->rodsHost) == 0) {
+        free(outHost);
+        return 0;
+    }
+
+    rstrcpy(host, outHost, NAME_LEN);
+    free(outHost);
+    return 1;
+}
+
+/*
+ * Open the file on a connection to the resource server holding the replica
+ */
+static int _openDirect(const char *iRodsPath, iFuseFd_t **iFuseFd, int openFlag) {
+    int status = 0;
+    iFuseConn_t *iFuseConn = NULL;
+    char host[NAME_LEN];
+
+    if(_getDataHost(iRodsPath, openFlag, host) <= 0) {
+        return -1;
+    }
+
+    iFuseLibLog(LOG_DEBUG, "_openDirect: open %s on %s", iRodsPath, host);
+
+    if(g_ConnReuse) {
+        status = iFuseConnGetAndUseForHost(&iFuseConn, IFUSE_CONN_TYPE_FOR_FILE_IO, host);
+    } else {
+        status = iFuseConnGetAndUseForHost(&iFuseConn, IFUSE_CONN_TYPE_FOR_ONETIMEUSE, host);
+    }
+
+    if (status < 0) {
+        iFuseLibLogError(LOG_ERROR, status, "_openDirect: iFuseConnGetAndUseForHost of %s to %s error",
+                iRodsPath, host);
+        return status;
+    }
+
+    status = iFuseFdOpen(iFuseFd, iFuseConn, iRodsPath, openFlag);
+    if (status < 0) {
+        iFuseLibLogError(LOG_ERROR, status, "_openDirect: iFuseFdOpen of %s on %s error, status = %d",
+                iRodsPath, host, status);
+        iFuseConnUnuse(iFuseConn);
+        return status;
+    }
+    return 0;
 }
 
 /*
@@ -84,6 +223,7 @@ int iFuseFsGetAttr(const char *iRodsPath, struct stat *stbuf) {
     dataObjInp_t dataObjInp;
     rodsObjStat_t *rodsObjStatOut = NULL;
     iFuseConn_t *iFuseConn = NULL;
+    iFuseConn_t *retryConn = NULL;
 
     assert(iRodsPath != NULL);
     assert(stbuf != NULL);
@@ -130,10 +270,25 @@ int iFuseFsGetAttr(const char *iRodsPath, struct stat *stbuf) {
     bzero(&dataObjInp, sizeof ( dataObjInp_t));
     rstrcpy(dataObjInp.objPath, iRodsPath, MAX_NAME_LEN);
 
-    iFuseConnLock(iFuseConn);
+    status = iFuseConnLock(iFuseConn);
+    if (status < 0) {
+        iFuseConnUnuse(iFuseConn);
+        return status;
+    }
 
     status = iFuseRodsClientObjStat(iFuseConn->conn, &dataObjInp, &rodsObjStatOut);
     iFuseConnUpdateLastActTime(iFuseConn, false);
+    if (status < 0 && iFuseRodsClientTimedOutError(status) && iFuseConnRetryTimedOut(iFuseConn, &retryConn) >= 0) {
+        // stat is idempotent, retry on another connection right away
+        iFuseLibLog(LOG_DEBUG, "iFuseFsGetAttr: iFuseRodsClientObjStat of %s timed out, retry on another connection", iRodsPath);
+        iFuseConnUnlock(iFuseConn);
+        iFuseConnUnuse(iFuseConn);
+        iFuseConn = retryConn;
+
+        status = iFuseRodsClientObjStat(iFuseConn->conn, &dataObjInp, &rodsObjStatOut);
+        iFuseConnUpdateLastActTime(iFuseConn, false);
+    }
+
     if (status < 0 && status != USER_FILE_DOES_NOT_EXIST) {
         if (iFuseRodsClientReadMsgError(status)) {
             if(iFuseConnReconnect(iFuseConn) < 0) {
@@ -223,6 +378,20 @@ int iFuseFsOpen(const char *iRodsPath, iFuseFd_t **iFuseFd, int openFlag) {
 
     iFuseLibLog(LOG_DEBUG, "iFuseFsOpen: %s, openFlag: 0x%08x", iRodsPath, openFlag);
 
+    // try the resource server holding the replica first
+    // falls back to the iRODS host on failure
+    if(g_DirectData) {
+        if(_openDirect(iRodsPath, iFuseFd, openFlag) == 0) {
+            // clear stat cache
+            if(g_CacheMetadata) {
+                if((openFlag & O_ACCMODE) != O_RDONLY) {
+                    iFuseMetadataCacheRemoveStat(iRodsPath);
+                }
+            }
+            return 0;
+        }
+    }
+
     // obtain a connection for a file
     // must be released lock after use
     // while the file is opened, connection is in-use status.
@@ -296,6 +465,16 @@ int iFuseFsClose(iFuseFd_t *iFuseFd) {
     return 0;
 }
 
+/*
+ * File pointer of the single descriptor of a file after it moved to another connection
+ */
+static off_t *_getFdFilePointer(iFuseFd_t *iFuseFd) {
+    if(iFuseFd->streamNum > 0) {
+        return &iFuseFd->streams[0].lastFilePointer;
+    }
+    return &iFuseFd->lastFilePointer;
+}
+
 int iFuseFsRead(iFuseFd_t *iFuseFd, char *buf, off_t off, size_t size) {
     int status = 0;
     int readError = 0;
@@ -304,6 +483,9 @@ int iFuseFsRead(iFuseFd_t *iFuseFd, char *buf, off_t off, size_t size) {
     fileLseekOut_t *dataObjLseekOut = NULL;
     openedDataObjInp_t dataObjReadInp;
     bytesBuf_t dataObjReadOutBBuf;
+    iFuseFdStream_t *iFuseFdStream = NULL;
+    int fd = 0;
+    off_t *lastFilePointer = NULL;
 
     assert(iFuseFd != NULL);
     assert(iFuseFd->iRodsPath != NULL);
@@ -311,15 +493,30 @@ int iFuseFsRead(iFuseFd_t *iFuseFd, char *buf, off_t off, size_t size) {
 
     iFuseLibLog(LOG_DEBUG, "iFuseFsRead: %s, offset: %lld, size: %lld", iFuseFd->iRodsPath, (long long)off, (long long)size);
 
+    iFuseFdLock(iFuseFd);
+
+    // the descriptor may move to another connection on a timeout
     iFuseConn = iFuseFd->conn;
+    status = iFuseConnLock(iFuseConn);
+    if (status < 0) {
+        iFuseFdUnlock(iFuseFd);
+        return status;
+    }
 
-    iFuseFdLock(iFuseFd);
-    iFuseConnLock(iFuseConn);
+    // interleaved readers of a read-only file get their own server-side descriptors
+    iFuseFdStream = iFuseFdGetReadStream(iFuseFd, off);
+    if(iFuseFdStream != NULL) {
+        fd = iFuseFdStream->fd;
+        lastFilePointer = &iFuseFdStream->lastFilePointer;
+    } else {
+        fd = iFuseFd->fd;
+        lastFilePointer = &iFuseFd->lastFilePointer;
+    }
 
-    if(iFuseFd->lastFilePointer != off) {
+    if(*lastFilePointer != off) {
         bzero(&dataObjLseekInp, sizeof( openedDataObjInp_t ));
 
-        dataObjLseekInp.l1descInx = iFuseFd->fd;
+        dataObjLseekInp.l1descInx = fd;
         dataObjLseekInp.offset = off;
         dataObjLseekInp.whence = SEEK_SET;
 
@@ -327,13 +524,24 @@ int iFuseFsRead(iFuseFd_t *iFuseFd, char *buf, off_t off, size_t size) {
 
         status = iFuseRodsClientDataObjLseek(iFuseConn->conn, &dataObjLseekInp, &dataObjLseekOut);
         iFuseConnUpdateLastActTime(iFuseConn, false);
+        if (status < 0 && iFuseRodsClientTimedOutError(status) && iFuseFdRetryTimedOut(iFuseFd, 0) >= 0) {
+            // seek is idempotent, retry on the file opened again on another connection
+            iFuseConn = iFuseFd->conn;
+            fd = iFuseFd->fd;
+            lastFilePointer = _getFdFilePointer(iFuseFd);
+            dataObjLseekInp.l1descInx = fd;
+
+            status = iFuseRodsClientDataObjLseek(iFuseConn->conn, &dataObjLseekInp, &dataObjLseekOut);
+            iFuseConnUpdateLastActTime(iFuseConn, false);
+        }
+
         if (status < 0 || dataObjLseekOut == NULL) {
             if (iFuseRodsClientReadMsgError(status)) {
                 if(iFuseConnReconnect(iFuseConn) < 0) {
                     iFuseLibLogError(LOG_ERROR, status, "iFuseFsRead: iFuseConnReconnect of %s error, status = %d",
                         iFuseFd->iRodsPath, status);
 
-                    iFuseFd->lastFilePointer = -1;
+                    *lastFilePointer = -1;
 
                     iFuseConnUnlock(iFuseConn);
                     iFuseFdUnlock(iFuseFd);
@@ -344,7 +552,7 @@ int iFuseFsRead(iFuseFd_t *iFuseFd, char *buf, off_t off, size_t size) {
                         iFuseLibLogError(LOG_ERROR, status, "iFuseFsRead: iFuseRodsClientDataObjLseek of %s error, status = %d",
                             iFuseFd->iRodsPath, status);
 
-                        iFuseFd->lastFilePointer = -1;
+                        *lastFilePointer = -1;
 
                         iFuseConnUnlock(iFuseConn);
                         iFuseFdUnlock(iFuseFd);
@@ -355,7 +563,7 @@ int iFuseFsRead(iFuseFd_t *iFuseFd, char *buf, off_t off, size_t size) {
                 iFuseLibLogError(LOG_ERROR, status, "iFuseFsRead: iFuseRodsClientDataObjLseek of %s error, status = %d",
                     iFuseFd->iRodsPath, status);
 
-                iFuseFd->lastFilePointer = -1;
+                *lastFilePointer = -1;
 
                 iFuseConnUnlock(iFuseConn);
                 iFuseFdUnlock(iFuseFd);
@@ -367,7 +575,7 @@ int iFuseFsRead(iFuseFd_t *iFuseFd, char *buf, off_t off, size_t size) {
             iFuseLibLogError(LOG_ERROR, status, "iFuseFsRead: iFuseRodsClientDataObjLseek failed on seek %s error, offset = %lu, requested = %lu",
                     iFuseFd->iRodsPath, dataObjLseekOut->offset, off);
 
-            iFuseFd->lastFilePointer = -1;
+            *lastFilePointer = -1;
 
             iFuseConnUnlock(iFuseConn);
             iFuseFdUnlock(iFuseFd);
@@ -378,7 +586,7 @@ int iFuseFsRead(iFuseFd_t *iFuseFd, char *buf, off_t off, size_t size) {
             iFuseLibLogError(LOG_ERROR, status, "iFuseFsRead: iFuseRodsClientDataObjLseek failed on seek %s error, offset = %lu, requested = %lu",
                     iFuseFd->iRodsPath, dataObjLseekOut->offset, off);
 
-            iFuseFd->lastFilePointer = -1;
+            *lastFilePointer = -1;
 
             free(dataObjLseekOut);
             iFuseConnUnlock(iFuseConn);
@@ -389,19 +597,37 @@ int iFuseFsRead(iFuseFd_t *iFuseFd, char *buf, off_t off, size_t size) {
         free(dataObjLseekOut);
         dataObjLseekOut = NULL;
 
-        iFuseFd->lastFilePointer = off;
+        *lastFilePointer = off;
     }
 
     bzero(&dataObjReadInp, sizeof ( openedDataObjInp_t));
     bzero(&dataObjReadOutBBuf, sizeof ( bytesBuf_t));
 
-    dataObjReadInp.l1descInx = iFuseFd->fd;
+    dataObjReadInp.l1descInx = fd;
     dataObjReadInp.len = size;
 
+    // receive the payload straight into the caller's buffer
+    dataObjReadOutBBuf.buf = buf;
+    dataObjReadOutBBuf.len = size;
+
     iFuseLibLog(LOG_DEBUG, "iFuseFsRead: iFuseRodsClientDataObjRead %s, offset: %lld, size: %lld", iFuseFd->iRodsPath, (long long)off, (long long)size);
 
     status = iFuseRodsClientDataObjRead(iFuseConn->conn, &dataObjReadInp, &dataObjReadOutBBuf);
     iFuseConnUpdateLastActTime(iFuseConn, false);
+    if (status < 0 && iFuseRodsClientTimedOutError(status) && iFuseFdRetryTimedOut(iFuseFd, off) >= 0) {
+        // reading a read-only file is idempotent, retry on the file opened again at off on another connection
+        iFuseLibLog(LOG_DEBUG, "iFuseFsRead: iFuseRodsClientDataObjRead of %s timed out, retry on another connection", iFuseFd->iRodsPath);
+        iFuseConn = iFuseFd->conn;
+        fd = iFuseFd->fd;
+        lastFilePointer = _getFdFilePointer(iFuseFd);
+        dataObjReadInp.l1descInx = fd;
+        dataObjReadOutBBuf.buf = buf;
+        dataObjReadOutBBuf.len = size;
+
+        status = iFuseRodsClientDataObjRead(iFuseConn->conn, &dataObjReadInp, &dataObjReadOutBBuf);
+        iFuseConnUpdateLastActTime(iFuseConn, false);
+    }
+
     if (status < 0) {
         if (iFuseRodsClientReadMsgError(status)) {
             if(iFuseConnReconnect(iFuseConn) < 0) {
@@ -441,14 +667,14 @@ int iFuseFsRead(iFuseFd_t *iFuseFd, char *buf, off_t off, size_t size) {
 
     assert(size >= (size_t)status);
 
-    memcpy(buf, dataObjReadOutBBuf.buf, status);
-
-    if(dataObjReadOutBBuf.buf != NULL) {
+    if(dataObjReadOutBBuf.buf != buf && dataObjReadOutBBuf.buf != NULL) {
+        // the client library allocated its own buffer, copy the payload over
+        memcpy(buf, dataObjReadOutBBuf.buf, status);
         free(dataObjReadOutBBuf.buf);
-        dataObjReadOutBBuf.buf = NULL;
+        iFuseFsCountReadCopy(status);
     }
 
-    iFuseFd->lastFilePointer += status;
+    *lastFilePointer += status;
 
     iFuseConnUnlock(iFuseConn);
     iFuseFdUnlock(iFuseFd);
@@ -473,7 +699,11 @@ int iFuseFsWrite(iFuseFd_t *iFuseFd, const char *buf, off_t off, size_t size) {
     iFuseConn = iFuseFd->conn;
 
     iFuseFdLock(iFuseFd);
-    iFuseConnLock(iFuseConn);
+    status = iFuseConnLock(iFuseConn);
+    if (status < 0) {
+        iFuseFdUnlock(iFuseFd);
+        return status;
+    }
 
     if(iFuseFd->lastFilePointer != off) {
         bzero(&dataObjLseekInp, sizeof( openedDataObjInp_t ));
@@ -653,7 +883,11 @@ int iFuseFsCreate(const char *iRodsPath, mode_t mode) {
         return -EIO;
     }
 
-    iFuseConnLock(iFuseConn);
+    status = iFuseConnLock(iFuseConn);
+    if (status < 0) {
+        iFuseConnUnuse(iFuseConn);
+        return status;
+    }
 
     bzero(&dataObjInp, sizeof ( dataObjInp_t));
     rstrcpy(dataObjInp.objPath, iRodsPath, MAX_NAME_LEN);
@@ -773,7 +1007,11 @@ int iFuseFsUnlink(const char *iRodsPath) {
         return -EIO;
     }
 
-    iFuseConnLock(iFuseConn);
+    status = iFuseConnLock(iFuseConn);
+    if (status < 0) {
+        iFuseConnUnuse(iFuseConn);
+        return status;
+    }
 
     bzero(&dataObjInp, sizeof ( dataObjInp_t));
 
@@ -878,7 +1116,7 @@ int iFuseFsOpenDir(const char *iRodsPath, iFuseDir_t **iFuseDir) {
         // obtain a connection for a file
         // while the file is opened, connection is in-use status.
         if(g_ConnReuse) {
-            status = iFuseConnGetAndUse(&iFuseConn, IFUSE_CONN_TYPE_FOR_FILE_IO);
+            status = iFuseConnGetAndUseForMetadata(&iFuseConn, IFUSE_CONN_TYPE_FOR_FILE_IO);
         } else {
             status = iFuseConnGetAndUse(&iFuseConn, IFUSE_CONN_TYPE_FOR_ONETIMEUSE);
         }
@@ -937,6 +1175,9 @@ int iFuseFsReadDir(iFuseDir_t *iFuseDir, iFuseDirFiller filler, void *buf, off_t
     collEnt_t collEnt;
     struct stat stbuf;
     char *entryPtr = NULL;
+    int entryCount = 0;
+    int skipCount = 0;
+    bool retried = false;
     
     assert(iFuseDir != NULL);
     assert(iFuseDir->iRodsPath != NULL);
@@ -966,15 +1207,36 @@ int iFuseFsReadDir(iFuseDir_t *iFuseDir, iFuseDirFiller filler, void *buf, off_t
         iFuseMetadataCacheRemoveDir(iFuseDir->iRodsPath);
     }
 
-    iFuseConn = iFuseDir->conn;
-
     iFuseDirLock(iFuseDir);
-    iFuseConnLock(iFuseConn);
+
+    // the descriptor may move to another connection on a timeout
+    iFuseConn = iFuseDir->conn;
+    status = iFuseConnLock(iFuseConn);
+    if (status < 0) {
+        iFuseDirUnlock(iFuseDir);
+        return status;
+    }
 
     bzero(&collEnt, sizeof ( collEnt_t));
     
-    while ((status = iFuseRodsClientReadCollection(iFuseConn->conn, iFuseDir->handle, &collEnt)) >= 0) {
+    while ((status = iFuseRodsClientReadCollection(iFuseConn->conn, iFuseDir->handle, &collEnt)) >= 0 ||
+           (!retried && iFuseRodsClientTimedOutError(status) && iFuseDirRetryTimedOut(iFuseDir) >= 0)) {
+        if (status < 0) {
+            // listing is idempotent, list again on another connection and skip entries given already
+            iFuseLibLog(LOG_DEBUG, "iFuseFsReadDir: iFuseRodsClientReadCollection of %s timed out, retry on another connection", iFuseDir->iRodsPath);
+            iFuseConn = iFuseDir->conn;
+            retried = true;
+            skipCount = entryCount;
+            continue;
+        }
+
         iFuseConnUpdateLastActTime(iFuseConn, false);
+        if (skipCount > 0) {
+            skipCount--;
+            continue;
+        }
+
+        entryCount++;
         if (collEnt.objType == DATA_OBJ_T) {
             if(g_CacheMetadata) {
                 bzero(&stbuf, sizeof ( struct stat));
@@ -1036,7 +1298,11 @@ int iFuseFsMakeDir(const char *iRodsPath, mode_t mode) {
         return -EIO;
     }
 
-    iFuseConnLock(iFuseConn);
+    status = iFuseConnLock(iFuseConn);
+    if (status < 0) {
+        iFuseConnUnuse(iFuseConn);
+        return status;
+    }
 
     bzero(&collCreateInp, sizeof ( collInp_t));
     rstrcpy(collCreateInp.collName, iRodsPath, MAX_NAME_LEN);
@@ -1106,7 +1372,11 @@ int iFuseFsRemoveDir(const char *iRodsPath) {
         return -EIO;
     }
 
-    iFuseConnLock(iFuseConn);
+    status = iFuseConnLock(iFuseConn);
+    if (status < 0) {
+        iFuseConnUnuse(iFuseConn);
+        return status;
+    }
 
     bzero(&collInp, sizeof ( collInp_t));
 
@@ -1203,7 +1473,11 @@ int iFuseFsRename(const char *iRodsFromPath, const char *iRodsToPath) {
         return -EIO;
     }
 
-    iFuseConnLock(iFuseConn);
+    status = iFuseConnLock(iFuseConn);
+    if (status < 0) {
+        iFuseConnUnuse(iFuseConn);
+        return status;
+    }
 
     bzero(&dataObjRenameInp, sizeof ( dataObjCopyInp_t));
 
@@ -1293,7 +1567,11 @@ int iFuseFsTruncate(const char *iRodsPath, off_t size) {
         return -EIO;
     }
 
-    iFuseConnLock(iFuseConn);
+    status = iFuseConnLock(iFuseConn);
+    if (status < 0) {
+        iFuseConnUnuse(iFuseConn);
+        return status;
+    }
 
     bzero(&dataObjInp, sizeof ( dataObjInp_t));
 
@@ -1362,7 +1640,11 @@ int iFuseFsChmod(const char *iRodsPath, mode_t mode) {
         return -EIO;
     }
 
-    iFuseConnLock(iFuseConn);
+    status = iFuseConnLock(iFuseConn);
+    if (status < 0) {
+        iFuseConnUnuse(iFuseConn);
+        return status;
+    }
 
     bzero(&regParam, sizeof ( keyValPair_t));
     snprintf(dataMode, SHORT_STR_LEN, "%d", mode);
@@ -1453,6 +1735,46 @@ int iFuseFsIoctl(const char *iRodsPath, int cmd, void *arg, struct fuse_file_inf
                 *(iFuseFsConnReport_t*) data = report;
             }
             return 0;
+        case IFUSEIOC_SHOW_READ_COPIES:
+            {
+                // show bytes copied on the read path
+                iFuseFsReadReport_t report;
+                iFuseLibLog(LOG_DEBUG, "iFuseFsIoctl: showing read copies");
+
+                iFuseFsReadReport(&report);
+                *(iFuseFsReadReport_t*) data = report;
+            }
+            return 0;
+        case IFUSEIOC_SHOW_ADMISSION:
+            {
+                // show requests held or dropped by admission control
+                iFuseFsAdmissionReport_t report;
+                iFuseLibLog(LOG_DEBUG, "iFuseFsIoctl: showing admission control");
+
+                iFuseAdmissionReport(&report);
+                *(iFuseFsAdmissionReport_t*) data = report;
+            }
+            return 0;
+        case IFUSEIOC_SHOW_BUFFER_POOL:
+            {
+                // show block buffers allocated and in use
+                iFuseBufferPoolReport_t report;
+                iFuseLibLog(LOG_DEBUG, "iFuseFsIoctl: showing buffer pool");
+
+                iFuseBufferPoolReport(&report);
+                *(iFuseBufferPoolReport_t*) data = report;
+            }
+            return 0;
+        case IFUSEIOC_SHOW_WRITES:
+            {
+                // show blocks written back in the background
+                iFuseFsWriteReport_t report;
+                iFuseLibLog(LOG_DEBUG, "iFuseFsIoctl: showing writes");
+
+                iFuseFsWriteReport(&report);
+                *(iFuseFsWriteReport_t*) data = report;
+            }
+            return 0;
     	default:
     		return -EINVAL;
 	}
@@ -1460,6 +1782,115 @@ int iFuseFsIoctl(const char *iRodsPath, int cmd, void *arg, struct fuse_file_inf
     return 0;
 }
 
+void iFuseFsCountReadDelivery(size_t size) {
+    __sync_fetch_and_add(&g_ReadDeliveredBytes, (unsigned long long)size);
+}
+
+void iFuseFsCountReadDirect(size_t size) {
+    __sync_fetch_and_add(&g_ReadDirectBytes, (unsigned long long)size);
+}
+
+void iFuseFsCountReadCopy(size_t size) {
+    __sync_fetch_and_add(&g_ReadCopiedBytes, (unsigned long long)size);
+}
+
+void iFuseFsCountReadHedge() {
+    __sync_fetch_and_add(&g_ReadHedgeCount, 1);
+}
+
+void iFuseFsCountReadHedgeWin() {
+    __sync_fetch_and_add(&g_ReadHedgeWinCount, 1);
+}
+
+void iFuseFsCountReadCacheHit() {
+    __sync_fetch_and_add(&g_ReadCacheHitCount, 1);
+}
+
+void iFuseFsCountReadCacheMiss() {
+    __sync_fetch_and_add(&g_ReadCacheMissCount, 1);
+}
+
+/*
+ * Report bytes copied per byte delivered on the read path
+ * how often slow block reads were sent again and block cache lookups hit
+ */
+void iFuseFsReadReport(iFuseFsReadReport_t *report) {
+    unsigned long long delivered = __sync_fetch_and_add(&g_ReadDeliveredBytes, 0);
+    unsigned long long direct = __sync_fetch_and_add(&g_ReadDirectBytes, 0);
+    unsigned long long copied = __sync_fetch_and_add(&g_ReadCopiedBytes, 0);
+
+    assert(report != NULL);
+
+    bzero(report, sizeof(iFuseFsReadReport_t));
+
+    report->deliveredKB = (int)(delivered / 1024);
+    report->directKB = (int)(direct / 1024);
+    report->copiedKB = (int)(copied / 1024);
+    if(delivered > 0) {
+        report->copiesPerByteX100 = (int)(copied * 100 / delivered);
+    }
+
+    report->hedgedReads = (int)__sync_fetch_and_add(&g_ReadHedgeCount, 0);
+    report->hedgeWins = (int)__sync_fetch_and_add(&g_ReadHedgeWinCount, 0);
+    report->cacheHits = (int)__sync_fetch_and_add(&g_ReadCacheHitCount, 0);
+    report->cacheMisses = (int)__sync_fetch_and_add(&g_ReadCacheMissCount, 0);
+
+    iFuseLibLog(LOG_DEBUG, "iFuseFsReadReport: delivered = %llu bytes, direct = %llu bytes, copied = %llu bytes", delivered, direct, copied);
+}
+
+void iFuseFsCountWriteBehindQueue(size_t size) {
+    __sync_fetch_and_add(&g_WriteBehindQueuedCount, 1);
+    __sync_fetch_and_add(&g_WriteBehindQueuedBytes, (unsigned long long)size);
+}
+
+void iFuseFsCountWriteBehindDone(size_t size, unsigned long long elapsedUSec, int status) {
+    __sync_fetch_and_add(&g_WriteBehindDoneCount, 1);
+    __sync_fetch_and_add(&g_WriteBehindDoneBytes, (unsigned long long)size);
+    __sync_fetch_and_add(&g_WriteBehindUSec, elapsedUSec);
+    if(status < 0) {
+        __sync_fetch_and_add(&g_WriteBehindErrorCount, 1);
+    }
+}
+
+void iFuseFsCountWriteBehindWait(unsigned long long elapsedUSec) {
+    __sync_fetch_and_add(&g_WriteBehindWaitCount, 1);
+    __sync_fetch_and_add(&g_WriteBehindWaitUSec, elapsedUSec);
+}
+
+/*
+ * Report blocks written back in the background, their upload speed per stream
+ * and how long writers waited for uploads over the dirty limit
+ */
+void iFuseFsWriteReport(iFuseFsWriteReport_t *report) {
+    unsigned long long queuedBytes = __sync_fetch_and_add(&g_WriteBehindQueuedBytes, 0);
+    unsigned long long doneCount = __sync_fetch_and_add(&g_WriteBehindDoneCount, 0);
+    unsigned long long doneBytes = __sync_fetch_and_add(&g_WriteBehindDoneBytes, 0);
+    unsigned long long elapsedUSec = __sync_fetch_and_add(&g_WriteBehindUSec, 0);
+
+    assert(report != NULL);
+
+    bzero(report, sizeof(iFuseFsWriteReport_t));
+
+    report->queuedBlocks = (int)__sync_fetch_and_add(&g_WriteBehindQueuedCount, 0);
+    report->writtenBlocks = (int)doneCount;
+    if(queuedBytes > doneBytes) {
+        report->pendingKB = (int)((queuedBytes - doneBytes) / 1024);
+    }
+    report->writtenKB = (int)(doneBytes / 1024);
+    if(elapsedUSec > 0) {
+        report->streamKBPerSec = (int)(doneBytes * 1000000 / 1024 / elapsedUSec);
+    }
+    if(doneCount > 0) {
+        report->avgBlockMSec = (int)(elapsedUSec / doneCount / 1000);
+    }
+
+    report->errors = (int)__sync_fetch_and_add(&g_WriteBehindErrorCount, 0);
+    report->writerWaits = (int)__sync_fetch_and_add(&g_WriteBehindWaitCount, 0);
+    report->writerWaitMSec = (int)(__sync_fetch_and_add(&g_WriteBehindWaitUSec, 0) / 1000);
+
+    iFuseLibLog(LOG_DEBUG, "iFuseFsWriteReport: queued = %llu bytes, written = %llu bytes in %llu usec", queuedBytes, doneBytes, elapsedUSec);
+}
+
 int iFuseFsCacheDir(const char *iRodsPath) {
     int status = 0;
     iFuseConn_t *iFuseConn = NULL;
@@ -1488,7 +1919,7 @@ int iFuseFsCacheDir(const char *iRodsPath) {
         // obtain a connection for a file
         // while the file is opened, connection is in-use status.
         if(g_ConnReuse) {
-            status = iFuseConnGetAndUse(&iFuseConn, IFUSE_CONN_TYPE_FOR_FILE_IO);
+            status = iFuseConnGetAndUseForMetadata(&iFuseConn, IFUSE_CONN_TYPE_FOR_FILE_IO);
         } else {
             status = iFuseConnGetAndUse(&iFuseConn, IFUSE_CONN_TYPE_FOR_ONETIMEUSE);
         }
@@ -1505,10 +1936,19 @@ int iFuseFsCacheDir(const char *iRodsPath) {
                     iRodsPath, status);
             return -ENOENT;
         }
+
+        // the descriptor may have opened on another connection
+        iFuseConn = iFuseDir->conn;
         
         // read & cache
         iFuseDirLock(iFuseDir);
-        iFuseConnLock(iFuseConn);
+        status = iFuseConnLock(iFuseConn);
+        if (status < 0) {
+            iFuseDirUnlock(iFuseDir);
+            iFuseDirClose(iFuseDir);
+            iFuseConnUnuse(iFuseConn);
+            return status;
+        }
 
         bzero(&collEnt, sizeof ( collEnt_t));
         
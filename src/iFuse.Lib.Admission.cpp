@@ -0,0 +1,277 @@
+/*** Copyright (c), The Regents of the University of California            ***
+ *** For more information please refer to files in the COPYRIGHT directory ***/
+/*** This code is written by Illyoung Choi (iychoi@email.arizona.edu)      ***
+ *** funded by iPlantCollaborative (www.iplantcollaborative.org).          ***/
+#include <stdio.h>
+#include <stdlib.h>
+#include <errno.h>
+#include <time.h>
+#include <assert.h>
+#include <pthread.h>
+#include <string.h>
+#include "iFuse.Lib.hpp"
+#include "iFuse.Lib.Admission.hpp"
+#include "iFuse.Lib.Engine.hpp"
+#include "iFuse.Lib.Util.hpp"
+
+#define IFUSE_ADMISSION_RESOURCE_RPC        0
+#define IFUSE_ADMISSION_RESOURCE_CONNECT    1
+#define IFUSE_ADMISSION_RESOURCE_NUM        2
+
+/*
+ * All counters are protected by g_AdmissionMutex.
+ * Waiters of all resources sleep on g_AdmissionCond, woken up on every leave.
+ */
+static pthread_mutex_t g_AdmissionMutex;
+static pthread_cond_t g_AdmissionCond;
+
+static int g_AdmissionUsed[IFUSE_ADMISSION_RESOURCE_NUM];
+static int g_AdmissionLimit[IFUSE_ADMISSION_RESOURCE_NUM];
+static int g_AdmissionForegroundWaiters[IFUSE_ADMISSION_RESOURCE_NUM];
+
+static size_t g_BackgroundBytes = 0;
+static size_t g_MaxBackgroundBytes = 0;
+
+static int g_AdmissionWaitMSec = IFUSE_ADMISSION_WAIT_MSEC;
+
+static unsigned long long g_ForegroundWaitCount = 0;
+static unsigned long long g_ForegroundRejectCount = 0;
+static unsigned long long g_ForegroundWaitTotalMSec = 0;
+static unsigned long long g_ForegroundWaitMaxMSec = 0;
+static unsigned long long g_BackgroundWaitCount = 0;
+static unsigned long long g_BackgroundRejectCount = 0;
+static unsigned long long g_BackgroundShedCount = 0;
+
+static bool _isFull(int resource) {
+    return g_AdmissionLimit[resource] > 0 && g_AdmissionUsed[resource] >= g_AdmissionLimit[resource];
+}
+
+/*
+ * Take a unit of the resource, wait for others to leave if over the limit
+ * background callers also wait while foreground callers are waiting.
+ * limits are never exceeded.
+ * returns -EAGAIN if no unit is free after g_AdmissionWaitMSec
+ */
+static int _enter(int resource) {
+    unsigned long long start;
+    unsigned long long waited;
+    struct timespec deadline;
+    bool background;
+    int rc = 0;
+
+    background = iFuseEngineIsBackgroundThread();
+
+    pthread_mutex_lock(&g_AdmissionMutex);
+
+    if(!_isFull(resource) && (!background || g_AdmissionForegroundWaiters[resource] == 0)) {
+        g_AdmissionUsed[resource]++;
+        pthread_mutex_unlock(&g_AdmissionMutex);
+        return 0;
+    }
+
+    start = iFuseLibGetMonotonicTimeMSec();
+    iFuseLibGetTimespecAfterMSec(&deadline, g_AdmissionWaitMSec);
+
+    if(background) {
+        g_BackgroundWaitCount++;
+
+        while((_isFull(resource) || g_AdmissionForegroundWaiters[resource] > 0) && rc != ETIMEDOUT) {
+            rc = pthread_cond_timedwait(&g_AdmissionCond, &g_AdmissionMutex, &deadline);
+        }
+
+        if(_isFull(resource) || g_AdmissionForegroundWaiters[resource] > 0) {
+            g_BackgroundRejectCount++;
+            iFuseLibLog(LOG_DEBUG, "_enter: rejected a background request for resource %d over the limit %d", resource, g_AdmissionLimit[resource]);
+            pthread_mutex_unlock(&g_AdmissionMutex);
+            return -EAGAIN;
+        }
+    } else {
+        g_AdmissionForegroundWaiters[resource]++;
+
+        while(_isFull(resource) && rc != ETIMEDOUT) {
+            rc = pthread_cond_timedwait(&g_AdmissionCond, &g_AdmissionMutex, &deadline);
+        }
+
+        g_AdmissionForegroundWaiters[resource]--;
+
+        waited = iFuseLibGetMonotonicTimeMSec() - start;
+
+        g_ForegroundWaitCount++;
+        g_ForegroundWaitTotalMSec += waited;
+        if(waited > g_ForegroundWaitMaxMSec) {
+            g_ForegroundWaitMaxMSec = waited;
+        }
+
+        // let background waiters re-check
+        pthread_cond_broadcast(&g_AdmissionCond);
+
+        if(_isFull(resource)) {
+            g_ForegroundRejectCount++;
+            iFuseLibLog(LOG_DEBUG, "_enter: rejected a request for resource %d over the limit %d after %llu ms", resource, g_AdmissionLimit[resource], waited);
+            pthread_mutex_unlock(&g_AdmissionMutex);
+            return -EAGAIN;
+        }
+    }
+
+    g_AdmissionUsed[resource]++;
+
+    pthread_mutex_unlock(&g_AdmissionMutex);
+    return 0;
+}
+
+/*
+ * Take a unit of the resource without waiting, even over the limit
+ */
+static void _enterNoWait(int resource) {
+    pthread_mutex_lock(&g_AdmissionMutex);
+    g_AdmissionUsed[resource]++;
+    pthread_mutex_unlock(&g_AdmissionMutex);
+}
+
+static void _leave(int resource) {
+    pthread_mutex_lock(&g_AdmissionMutex);
+
+    g_AdmissionUsed[resource]--;
+    assert(g_AdmissionUsed[resource] >= 0);
+
+    pthread_cond_broadcast(&g_AdmissionCond);
+
+    pthread_mutex_unlock(&g_AdmissionMutex);
+}
+
+/*
+ * Initialize admission control
+ */
+void iFuseAdmissionInit() {
+    int i;
+
+    for(i=0;i<IFUSE_ADMISSION_RESOURCE_NUM;i++) {
+        g_AdmissionUsed[i] = 0;
+        g_AdmissionForegroundWaiters[i] = 0;
+    }
+
+    g_AdmissionLimit[IFUSE_ADMISSION_RESOURCE_RPC] = IFUSE_ADMISSION_MAX_RPC_NUM;
+    if(iFuseLibGetOption()->maxRPCNum >= 0) {
+        g_AdmissionLimit[IFUSE_ADMISSION_RESOURCE_RPC] = iFuseLibGetOption()->maxRPCNum;
+    }
+
+    g_AdmissionLimit[IFUSE_ADMISSION_RESOURCE_CONNECT] = IFUSE_ADMISSION_MAX_CONNECTING_NUM;
+    if(iFuseLibGetOption()->maxConnectingNum >= 0) {
+        g_AdmissionLimit[IFUSE_ADMISSION_RESOURCE_CONNECT] = iFuseLibGetOption()->maxConnectingNum;
+    }
+
+    g_MaxBackgroundBytes = (size_t)IFUSE_ADMISSION_MAX_BACKGROUND_MB * 1024 * 1024;
+    if(iFuseLibGetOption()->maxBackgroundMB >= 0) {
+        g_MaxBackgroundBytes = (size_t)iFuseLibGetOption()->maxBackgroundMB * 1024 * 1024;
+    }
+
+    if(iFuseLibGetOption()->admissionWaitMSec > 0) {
+        g_AdmissionWaitMSec = iFuseLibGetOption()->admissionWaitMSec;
+    }
+
+    g_BackgroundBytes = 0;
+
+    pthread_mutex_init(&g_AdmissionMutex, NULL);
+    pthread_cond_init(&g_AdmissionCond, NULL);
+}
+
+/*
+ * Destroy admission control
+ */
+void iFuseAdmissionDestroy() {
+    pthread_cond_destroy(&g_AdmissionCond);
+    pthread_mutex_destroy(&g_AdmissionMutex);
+}
+
+/*
+ * Report status of admission control
+ */
+void iFuseAdmissionReport(iFuseFsAdmissionReport_t *report) {
+    assert(report != NULL);
+
+    bzero(report, sizeof(iFuseFsAdmissionReport_t));
+
+    pthread_mutex_lock(&g_AdmissionMutex);
+
+    report->rpcs = g_AdmissionUsed[IFUSE_ADMISSION_RESOURCE_RPC];
+    report->maxRPCs = g_AdmissionLimit[IFUSE_ADMISSION_RESOURCE_RPC];
+    report->connecting = g_AdmissionUsed[IFUSE_ADMISSION_RESOURCE_CONNECT];
+    report->maxConnecting = g_AdmissionLimit[IFUSE_ADMISSION_RESOURCE_CONNECT];
+    report->backgroundKB = (int)(g_BackgroundBytes / 1024);
+    report->maxBackgroundKB = (int)(g_MaxBackgroundBytes / 1024);
+    report->foregroundWaits = (int)g_ForegroundWaitCount;
+    report->foregroundRejected = (int)g_ForegroundRejectCount;
+    if(g_ForegroundWaitCount > 0) {
+        report->foregroundWaitAvgMSec = (int)(g_ForegroundWaitTotalMSec / g_ForegroundWaitCount);
+    }
+    report->foregroundWaitMaxMSec = (int)g_ForegroundWaitMaxMSec;
+    report->backgroundWaits = (int)g_BackgroundWaitCount;
+    report->backgroundRejected = (int)g_BackgroundRejectCount;
+    report->backgroundShed = (int)g_BackgroundShedCount;
+
+    pthread_mutex_unlock(&g_AdmissionMutex);
+}
+
+int iFuseAdmissionEnterRPC() {
+    return _enter(IFUSE_ADMISSION_RESOURCE_RPC);
+}
+
+/*
+ * Count an RPC releasing server-side resources (e.g., close)
+ * it is never held back, so descriptors are not leaked on a slow server
+ */
+void iFuseAdmissionEnterRPCNoWait() {
+    _enterNoWait(IFUSE_ADMISSION_RESOURCE_RPC);
+}
+
+void iFuseAdmissionLeaveRPC() {
+    _leave(IFUSE_ADMISSION_RESOURCE_RPC);
+}
+
+int iFuseAdmissionEnterConnect() {
+    return _enter(IFUSE_ADMISSION_RESOURCE_CONNECT);
+}
+
+void iFuseAdmissionLeaveConnect() {
+    _leave(IFUSE_ADMISSION_RESOURCE_CONNECT);
+}
+
+/*
+ * Admit a background request holding size bytes until it completes
+ * returns false if the request should be shed
+ */
+bool iFuseAdmissionAdmitBackground(size_t size) {
+    int i;
+
+    pthread_mutex_lock(&g_AdmissionMutex);
+
+    // foreground callers are held up, the server is slow
+    for(i=0;i<IFUSE_ADMISSION_RESOURCE_NUM;i++) {
+        if(g_AdmissionForegroundWaiters[i] > 0 || _isFull(i)) {
+            g_BackgroundShedCount++;
+            pthread_mutex_unlock(&g_AdmissionMutex);
+            return false;
+        }
+    }
+
+    // a request larger than the limit alone is admitted when nothing else is in flight
+    if(g_MaxBackgroundBytes > 0 && g_BackgroundBytes > 0 && g_BackgroundBytes + size > g_MaxBackgroundBytes) {
+        g_BackgroundShedCount++;
+        pthread_mutex_unlock(&g_AdmissionMutex);
+        return false;
+    }
+
+    g_BackgroundBytes += size;
+
+    pthread_mutex_unlock(&g_AdmissionMutex);
+    return true;
+}
+
+void iFuseAdmissionReleaseBackground(size_t size) {
+    pthread_mutex_lock(&g_AdmissionMutex);
+
+    assert(g_BackgroundBytes >= size);
+    g_BackgroundBytes -= size;
+
+    pthread_mutex_unlock(&g_AdmissionMutex);
+}
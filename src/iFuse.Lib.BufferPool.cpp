@@ -0,0 +1,536 @@
+/*** Copyright (c), The Regents of the University of California            ***
+ *** For more information please refer to files in the COPYRIGHT directory ***/
+/*** This code is written by Illyoung Choi (iychoi@email.arizona.edu)      ***
+ *** funded by iPlantCollaborative (www.iplantcollaborative.org).          ***/
+#include <stdio.h>
+#include <stdlib.h>
+#include <errno.h>
+#include <time.h>
+#include <assert.h>
+#include <pthread.h>
+#include <string.h>
+#include <unistd.h>
+#include <sys/mman.h>
+#include <list>
+#include "iFuse.Lib.hpp"
+#include "iFuse.Lib.BufferPool.hpp"
+#include "iFuse.Lib.Util.hpp"
+
+/*
+ * Free buffers, counts and thread caches are protected by g_BufferPoolMutex.
+ * Buffers in a thread cache are protected by the cache's own mutex,
+ * which is taken by other threads only to steal buffers at the limit.
+ * A thread exiting only marks its cache under the cache's mutex, so it never
+ * touches the pool, which may be destroyed already. Whichever of the thread
+ * and the pool comes last frees the cache.
+ */
+static pthread_mutex_t g_BufferPoolMutex;
+static pthread_cond_t g_BufferPoolCond;
+
+static pthread_key_t g_ThreadCacheKey;
+
+static std::list<char*> *g_FreeBuffers = NULL;
+static std::list<iFuseBufferPoolThreadCache_t*> *g_ThreadCaches = NULL;
+static std::list<char*> *g_HugepageChunks = NULL;
+
+static size_t g_BufferSize = 0;
+static int g_MaxBufferNum = 0;
+static int g_BufferNum = 0;
+static int g_InUseBufferNum = 0;
+static int g_Waiters = 0;
+
+static bool g_Hugepage = false;
+static size_t g_ChunkSize = 0;
+static int g_ChunkBufferNum = 0;
+
+static volatile iFuseBufferPoolReclaimCB g_ReclaimHandler = NULL;
+
+static unsigned long long g_ThreadCacheHitCount = 0;
+static unsigned long long g_PoolHitCount = 0;
+static unsigned long long g_NewBufferCount = 0;
+static unsigned long long g_ReclaimedCount = 0;
+static unsigned long long g_WaitCount = 0;
+static unsigned long long g_FailureCount = 0;
+
+/*
+ * Map a chunk aligned to a huge page and ask for transparent huge pages
+ */
+static char *_newHugepageChunk() {
+    size_t mapSize = g_ChunkSize + IFUSE_BUFFER_POOL_HUGEPAGE_SIZE;
+    char *mapped = NULL;
+    char *chunk = NULL;
+    size_t head = 0;
+    size_t tail = 0;
+
+    mapped = (char*)mmap(NULL, mapSize, PROT_READ | PROT_WRITE, MAP_PRIVATE | MAP_ANONYMOUS, -1, 0);
+    if(mapped == MAP_FAILED) {
+        iFuseLibLog(LOG_ERROR, "_newHugepageChunk: mmap of %lld bytes error, errno = %d", (long long)mapSize, errno);
+        return NULL;
+    }
+
+    chunk = (char*)(((unsigned long)mapped + IFUSE_BUFFER_POOL_HUGEPAGE_SIZE - 1) & ~((unsigned long)IFUSE_BUFFER_POOL_HUGEPAGE_SIZE - 1));
+    head = chunk - mapped;
+    tail = mapSize - head - g_ChunkSize;
+
+    if(head > 0) {
+        munmap(mapped, head);
+    }
+
+    if(tail > 0) {
+        munmap(chunk + g_ChunkSize, tail);
+    }
+
+#ifdef MADV_HUGEPAGE
+    if(madvise(chunk, g_ChunkSize, MADV_HUGEPAGE) != 0) {
+        iFuseLibLog(LOG_DEBUG, "_newHugepageChunk: madvise error, errno = %d", errno);
+    }
+#endif
+
+    return chunk;
+}
+
+/*
+ * Allocate new buffers up to the limit and add them to the free list
+ * g_BufferPoolMutex must be held, returns false at the limit or on failure
+ */
+static bool _growPool() {
+    char *buffer = NULL;
+    char *chunk = NULL;
+    int i;
+
+    if(g_Hugepage) {
+        if(g_MaxBufferNum > 0 && g_BufferNum + g_ChunkBufferNum > g_MaxBufferNum) {
+            return false;
+        }
+
+        chunk = _newHugepageChunk();
+        if(chunk == NULL) {
+            return false;
+        }
+
+        g_HugepageChunks->push_back(chunk);
+
+        for(i=0;i<g_ChunkBufferNum;i++) {
+            g_FreeBuffers->push_back(chunk + (i * g_BufferSize));
+        }
+
+        g_BufferNum += g_ChunkBufferNum;
+        g_NewBufferCount += g_ChunkBufferNum;
+        return true;
+    }
+
+    if(g_MaxBufferNum > 0 && g_BufferNum >= g_MaxBufferNum) {
+        return false;
+    }
+
+    if(posix_memalign((void**)&buffer, sysconf(_SC_PAGESIZE), g_BufferSize) != 0) {
+        return false;
+    }
+
+    g_FreeBuffers->push_back(buffer);
+
+    g_BufferNum++;
+    g_NewBufferCount++;
+    return true;
+}
+
+/*
+ * Move buffers kept by threads to the free list, caches of exited threads are freed
+ * g_BufferPoolMutex must be held, returns false if no thread keeps any
+ */
+static bool _stealThreadCaches() {
+    std::list<iFuseBufferPoolThreadCache_t*>::iterator it_threadcache;
+    iFuseBufferPoolThreadCache_t *iFuseBufferPoolThreadCache = NULL;
+    bool stolen = false;
+    bool exited = false;
+
+    it_threadcache = g_ThreadCaches->begin();
+    while(it_threadcache != g_ThreadCaches->end()) {
+        iFuseBufferPoolThreadCache = *it_threadcache;
+
+        pthread_mutex_lock(&iFuseBufferPoolThreadCache->mutex);
+        while(iFuseBufferPoolThreadCache->num > 0) {
+            iFuseBufferPoolThreadCache->num--;
+            g_FreeBuffers->push_back(iFuseBufferPoolThreadCache->buffers[iFuseBufferPoolThreadCache->num]);
+            stolen = true;
+        }
+        exited = iFuseBufferPoolThreadCache->exited;
+        pthread_mutex_unlock(&iFuseBufferPoolThreadCache->mutex);
+
+        if(exited) {
+            it_threadcache = g_ThreadCaches->erase(it_threadcache);
+
+            pthread_mutex_destroy(&iFuseBufferPoolThreadCache->mutex);
+            free(iFuseBufferPoolThreadCache);
+        } else {
+            it_threadcache++;
+        }
+    }
+
+    return stolen;
+}
+
+/*
+ * Put a free buffer back, g_BufferPoolMutex must be held
+ * buffers over IFUSE_BUFFER_POOL_FREE_NUM go back to the system unless someone waits
+ */
+static void _putFreeBuffer(char *buffer) {
+    if(g_Hugepage || __sync_fetch_and_add(&g_Waiters, 0) > 0 || g_FreeBuffers->size() < IFUSE_BUFFER_POOL_FREE_NUM) {
+        g_FreeBuffers->push_back(buffer);
+    } else {
+        free(buffer);
+        g_BufferNum--;
+    }
+
+    pthread_cond_broadcast(&g_BufferPoolCond);
+}
+
+/*
+ * Return buffers kept by exited threads and free their caches
+ * g_BufferPoolMutex must be held
+ */
+static void _releaseExitedThreadCaches() {
+    std::list<iFuseBufferPoolThreadCache_t*>::iterator it_threadcache;
+    iFuseBufferPoolThreadCache_t *iFuseBufferPoolThreadCache = NULL;
+    bool exited = false;
+
+    it_threadcache = g_ThreadCaches->begin();
+    while(it_threadcache != g_ThreadCaches->end()) {
+        iFuseBufferPoolThreadCache = *it_threadcache;
+
+        // the thread is gone, no one else takes the mutex but the pool
+        pthread_mutex_lock(&iFuseBufferPoolThreadCache->mutex);
+        exited = iFuseBufferPoolThreadCache->exited;
+        pthread_mutex_unlock(&iFuseBufferPoolThreadCache->mutex);
+
+        if(!exited) {
+            it_threadcache++;
+            continue;
+        }
+
+        it_threadcache = g_ThreadCaches->erase(it_threadcache);
+
+        while(iFuseBufferPoolThreadCache->num > 0) {
+            iFuseBufferPoolThreadCache->num--;
+            _putFreeBuffer(iFuseBufferPoolThreadCache->buffers[iFuseBufferPoolThreadCache->num]);
+        }
+
+        pthread_mutex_destroy(&iFuseBufferPoolThreadCache->mutex);
+        free(iFuseBufferPoolThreadCache);
+    }
+}
+
+/*
+ * Called when a thread exits
+ * buffers it keeps go back to the pool when the next thread comes or at the limit
+ */
+static void _releaseThreadCache(void *param) {
+    iFuseBufferPoolThreadCache_t *iFuseBufferPoolThreadCache = (iFuseBufferPoolThreadCache_t*)param;
+    bool orphaned = false;
+
+    assert(iFuseBufferPoolThreadCache != NULL);
+
+    pthread_mutex_lock(&iFuseBufferPoolThreadCache->mutex);
+    orphaned = iFuseBufferPoolThreadCache->orphaned;
+    iFuseBufferPoolThreadCache->exited = true;
+    pthread_mutex_unlock(&iFuseBufferPoolThreadCache->mutex);
+
+    if(orphaned) {
+        // the pool is gone and took the buffers already
+        pthread_mutex_destroy(&iFuseBufferPoolThreadCache->mutex);
+        free(iFuseBufferPoolThreadCache);
+    }
+}
+
+static iFuseBufferPoolThreadCache_t *_getThreadCache() {
+    iFuseBufferPoolThreadCache_t *tmpIFuseBufferPoolThreadCache = NULL;
+
+    tmpIFuseBufferPoolThreadCache = (iFuseBufferPoolThreadCache_t*)pthread_getspecific(g_ThreadCacheKey);
+    if(tmpIFuseBufferPoolThreadCache != NULL) {
+        return tmpIFuseBufferPoolThreadCache;
+    }
+
+    tmpIFuseBufferPoolThreadCache = (iFuseBufferPoolThreadCache_t*)calloc(1, sizeof(iFuseBufferPoolThreadCache_t));
+    if(tmpIFuseBufferPoolThreadCache == NULL) {
+        return NULL;
+    }
+
+    pthread_mutex_init(&tmpIFuseBufferPoolThreadCache->mutex, NULL);
+
+    pthread_mutex_lock(&g_BufferPoolMutex);
+    // keep the list as long as the live threads
+    _releaseExitedThreadCaches();
+    g_ThreadCaches->push_back(tmpIFuseBufferPoolThreadCache);
+    pthread_mutex_unlock(&g_BufferPoolMutex);
+
+    pthread_setspecific(g_ThreadCacheKey, tmpIFuseBufferPoolThreadCache);
+    return tmpIFuseBufferPoolThreadCache;
+}
+
+/*
+ * Initialize the buffer pool
+ */
+void iFuseBufferPoolInit(size_t bufferSize) {
+    int poolMB = 0;
+
+    assert(bufferSize > 0);
+
+    g_BufferSize = bufferSize;
+
+    poolMB = IFUSE_BUFFER_POOL_MAX_MB;
+    if(iFuseLibGetOption()->bufferPoolMB >= 0) {
+        poolMB = iFuseLibGetOption()->bufferPoolMB;
+    }
+
+    g_MaxBufferNum = (int)(((size_t)poolMB * 1024 * 1024) / g_BufferSize);
+
+    g_Hugepage = iFuseLibGetOption()->hugepage;
+    if(g_Hugepage) {
+        // a chunk is a multiple of the huge page size holding whole buffers
+        g_ChunkSize = ((g_BufferSize + IFUSE_BUFFER_POOL_HUGEPAGE_SIZE - 1) / IFUSE_BUFFER_POOL_HUGEPAGE_SIZE) * IFUSE_BUFFER_POOL_HUGEPAGE_SIZE;
+        g_ChunkBufferNum = (int)(g_ChunkSize / g_BufferSize);
+    }
+
+    // a limit below a buffer (or a chunk) is rounded up
+    if(poolMB > 0 && g_MaxBufferNum < 1) {
+        g_MaxBufferNum = 1;
+    }
+
+    if(g_Hugepage && g_MaxBufferNum > 0 && g_MaxBufferNum < g_ChunkBufferNum) {
+        g_MaxBufferNum = g_ChunkBufferNum;
+    }
+
+    g_BufferNum = 0;
+    g_InUseBufferNum = 0;
+    g_Waiters = 0;
+
+    // we must use new keyword instead of calloc since it contains c++ stl list object
+    g_FreeBuffers = new std::list<char*>();
+    g_ThreadCaches = new std::list<iFuseBufferPoolThreadCache_t*>();
+    g_HugepageChunks = new std::list<char*>();
+
+    pthread_key_create(&g_ThreadCacheKey, _releaseThreadCache);
+
+    pthread_mutex_init(&g_BufferPoolMutex, NULL);
+    pthread_cond_init(&g_BufferPoolCond, NULL);
+}
+
+/*
+ * Destroy the buffer pool
+ */
+void iFuseBufferPoolDestroy() {
+    std::list<iFuseBufferPoolThreadCache_t*>::iterator it_threadcache;
+    std::list<char*>::iterator it_buffer;
+    iFuseBufferPoolThreadCache_t *iFuseBufferPoolThreadCache = NULL;
+    bool exited = false;
+
+    g_ReclaimHandler = NULL;
+
+    // the key is kept, destructors of threads still alive free their caches
+    pthread_mutex_lock(&g_BufferPoolMutex);
+
+    for(it_threadcache = g_ThreadCaches->begin(); it_threadcache != g_ThreadCaches->end(); it_threadcache++) {
+        iFuseBufferPoolThreadCache = *it_threadcache;
+
+        pthread_mutex_lock(&iFuseBufferPoolThreadCache->mutex);
+        while(iFuseBufferPoolThreadCache->num > 0) {
+            iFuseBufferPoolThreadCache->num--;
+            g_FreeBuffers->push_back(iFuseBufferPoolThreadCache->buffers[iFuseBufferPoolThreadCache->num]);
+        }
+        exited = iFuseBufferPoolThreadCache->exited;
+        iFuseBufferPoolThreadCache->orphaned = true;
+        pthread_mutex_unlock(&iFuseBufferPoolThreadCache->mutex);
+
+        if(exited) {
+            pthread_mutex_destroy(&iFuseBufferPoolThreadCache->mutex);
+            free(iFuseBufferPoolThreadCache);
+        }
+    }
+
+    pthread_mutex_unlock(&g_BufferPoolMutex);
+
+    if(g_Hugepage) {
+        for(it_buffer = g_HugepageChunks->begin(); it_buffer != g_HugepageChunks->end(); it_buffer++) {
+            munmap(*it_buffer, g_ChunkSize);
+        }
+    } else {
+        for(it_buffer = g_FreeBuffers->begin(); it_buffer != g_FreeBuffers->end(); it_buffer++) {
+            free(*it_buffer);
+        }
+    }
+
+    delete g_FreeBuffers;
+    delete g_ThreadCaches;
+    delete g_HugepageChunks;
+
+    g_FreeBuffers = NULL;
+    g_ThreadCaches = NULL;
+    g_HugepageChunks = NULL;
+
+    pthread_cond_destroy(&g_BufferPoolCond);
+    pthread_mutex_destroy(&g_BufferPoolMutex);
+}
+
+void iFuseBufferPoolSetReclaimHandler(iFuseBufferPoolReclaimCB callback) {
+    g_ReclaimHandler = callback;
+}
+
+/*
+ * Report buffers allocated and in use
+ */
+void iFuseBufferPoolReport(iFuseBufferPoolReport_t *report) {
+    assert(report != NULL);
+
+    bzero(report, sizeof(iFuseBufferPoolReport_t));
+
+    pthread_mutex_lock(&g_BufferPoolMutex);
+
+    report->bufferKB = (int)(g_BufferSize / 1024);
+    report->allocatedKB = (int)(((size_t)g_BufferNum * g_BufferSize) / 1024);
+    report->inUseKB = (int)(((size_t)__sync_fetch_and_add(&g_InUseBufferNum, 0) * g_BufferSize) / 1024);
+    report->maxKB = (int)(((size_t)g_MaxBufferNum * g_BufferSize) / 1024);
+    report->hugepage = g_Hugepage ? 1 : 0;
+    report->threadCacheHits = (int)__sync_fetch_and_add(&g_ThreadCacheHitCount, 0);
+    report->poolHits = (int)g_PoolHitCount;
+    report->newBuffers = (int)g_NewBufferCount;
+    report->reclaimed = (int)g_ReclaimedCount;
+    report->waits = (int)g_WaitCount;
+    report->failures = (int)g_FailureCount;
+
+    pthread_mutex_unlock(&g_BufferPoolMutex);
+}
+
+size_t iFuseBufferPoolGetBufferSize() {
+    return g_BufferSize;
+}
+
+/*
+ * returns the max number of buffers allocated, 0 means unlimited
+ */
+int iFuseBufferPoolGetMaxBufferNum() {
+    return g_MaxBufferNum;
+}
+
+/*
+ * Get a buffer of the pool's buffer size
+ * at the limit, if wait is set, buffers are reclaimed and released ones are waited for
+ * with wait, must not be called with locks the reclaim handler takes
+ * returns NULL if no buffer is available
+ */
+char *iFuseBufferPoolAlloc(bool wait) {
+    iFuseBufferPoolThreadCache_t *iFuseBufferPoolThreadCache = NULL;
+    iFuseBufferPoolReclaimCB reclaimHandler = NULL;
+    char *buffer = NULL;
+    struct timespec deadline;
+    bool reclaimed = false;
+    bool waited = false;
+    int freed = 0;
+    int rc = 0;
+
+    iFuseBufferPoolThreadCache = _getThreadCache();
+    if(iFuseBufferPoolThreadCache != NULL) {
+        pthread_mutex_lock(&iFuseBufferPoolThreadCache->mutex);
+        if(iFuseBufferPoolThreadCache->num > 0) {
+            iFuseBufferPoolThreadCache->num--;
+            buffer = iFuseBufferPoolThreadCache->buffers[iFuseBufferPoolThreadCache->num];
+        }
+        pthread_mutex_unlock(&iFuseBufferPoolThreadCache->mutex);
+
+        if(buffer != NULL) {
+            __sync_fetch_and_add(&g_InUseBufferNum, 1);
+            __sync_fetch_and_add(&g_ThreadCacheHitCount, 1);
+            return buffer;
+        }
+    }
+
+    pthread_mutex_lock(&g_BufferPoolMutex);
+
+    while(true) {
+        if(!g_FreeBuffers->empty()) {
+            buffer = g_FreeBuffers->front();
+            g_FreeBuffers->pop_front();
+            g_PoolHitCount++;
+            break;
+        }
+
+        if(_growPool() || _stealThreadCaches()) {
+            continue;
+        }
+
+        // at the limit - free buffers held by the cache
+        reclaimHandler = g_ReclaimHandler;
+        if(wait && !reclaimed && reclaimHandler != NULL) {
+            reclaimed = true;
+
+            pthread_mutex_unlock(&g_BufferPoolMutex);
+            freed = reclaimHandler(g_BufferSize);
+            pthread_mutex_lock(&g_BufferPoolMutex);
+
+            if(freed > 0) {
+                g_ReclaimedCount += freed;
+                continue;
+            }
+        }
+
+        if(!wait || (waited && rc == ETIMEDOUT)) {
+            iFuseLibLog(LOG_DEBUG, "iFuseBufferPoolAlloc: no buffer is available, %d buffers in use", __sync_fetch_and_add(&g_InUseBufferNum, 0));
+            g_FailureCount++;
+            break;
+        }
+
+        if(!waited) {
+            waited = true;
+            g_WaitCount++;
+            iFuseLibGetTimespecAfterMSec(&deadline, IFUSE_BUFFER_POOL_WAIT_MSEC);
+        }
+
+        __sync_fetch_and_add(&g_Waiters, 1);
+        rc = pthread_cond_timedwait(&g_BufferPoolCond, &g_BufferPoolMutex, &deadline);
+        __sync_fetch_and_sub(&g_Waiters, 1);
+
+        // the cache may have grown back meanwhile
+        reclaimed = false;
+    }
+
+    pthread_mutex_unlock(&g_BufferPoolMutex);
+
+    if(buffer != NULL) {
+        __sync_fetch_and_add(&g_InUseBufferNum, 1);
+    }
+
+    return buffer;
+}
+
+/*
+ * Release a buffer from iFuseBufferPoolAlloc
+ */
+void iFuseBufferPoolFree(char *buffer) {
+    iFuseBufferPoolThreadCache_t *iFuseBufferPoolThreadCache = NULL;
+    bool cached = false;
+
+    if(buffer == NULL) {
+        return;
+    }
+
+    __sync_fetch_and_sub(&g_InUseBufferNum, 1);
+
+    // waiters get buffers through the pool
+    if(__sync_fetch_and_add(&g_Waiters, 0) == 0) {
+        iFuseBufferPoolThreadCache = _getThreadCache();
+        if(iFuseBufferPoolThreadCache != NULL) {
+            pthread_mutex_lock(&iFuseBufferPoolThreadCache->mutex);
+            if(iFuseBufferPoolThreadCache->num < IFUSE_BUFFER_POOL_THREAD_CACHE_NUM) {
+                iFuseBufferPoolThreadCache->buffers[iFuseBufferPoolThreadCache->num] = buffer;
+                iFuseBufferPoolThreadCache->num++;
+                cached = true;
+            }
+            pthread_mutex_unlock(&iFuseBufferPoolThreadCache->mutex);
+        }
+    }
+
+    if(!cached) {
+        pthread_mutex_lock(&g_BufferPoolMutex);
+        _putFreeBuffer(buffer);
+        pthread_mutex_unlock(&g_BufferPoolMutex);
+    }
+}
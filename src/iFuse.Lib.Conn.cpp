@@ -10,18 +10,21 @@
 #include <pthread.h>
 #include <list>
 #include <map>
+#include <algorithm>
 #include "iFuse.Lib.hpp"
 #include "iFuse.Lib.RodsClientAPI.hpp"
+#include "iFuse.Lib.Admission.hpp"
 #include "iFuse.Lib.Conn.hpp"
+#include "iFuse.Lib.Engine.hpp"
 #include "iFuse.Lib.Util.hpp"
 
 static pthread_rwlock_t g_ConnectedConnLock;
 static pthread_rwlockattr_t g_ConnectedConnLockAttr;
 
-static iFuseConn_t* g_InUseShortopConn;
+static iFuseConn_t** g_InUseShortopConn;
 static iFuseConn_t** g_InUseConn;
 static std::map<unsigned long, iFuseConn_t*> g_InUseOnetimeuseConn;
-static iFuseConn_t* g_FreeShortopConn;
+static std::list<iFuseConn_t*> g_FreeShortopConn;
 static std::list<iFuseConn_t*> g_FreeConn;
 
 static pthread_rwlockattr_t g_IDGenLockAttr;
@@ -29,18 +32,152 @@ static pthread_rwlock_t g_IDGenLock;
 
 static unsigned long g_ConnIDGen;
 
+typedef struct IFuseConnWaiter {
+    iFuseConn_t *conn;
+    const char *host;
+    int connClass;
+    bool woken;
+    pthread_cond_t cond;
+} iFuseConnWaiter_t;
+
+static pthread_mutex_t g_ConnWaitMutex;
+static std::list<iFuseConnWaiter_t*> g_ConnWaiters;
+
+static int g_ConnWaitTimeoutMSec = IFUSE_CONN_WAIT_TIMEOUT_MSEC;
+static unsigned long long g_ConnWaitCount = 0;
+static unsigned long long g_ConnWaitTimeoutCount = 0;
+static unsigned long long g_ConnWaitTotalMSec = 0;
+static unsigned long long g_ConnWaitMaxMSec = 0;
+
 static int g_MaxConnNum = IFUSE_MAX_NUM_CONN;
+static int g_MinConnNum = IFUSE_MIN_NUM_CONN;
+static int g_TargetConnNum = IFUSE_MAX_NUM_CONN;
+static int g_PeakInUseConnNum = 0;
+static int g_ConnWaitTargetMSec = IFUSE_CONN_WAIT_TARGET_MSEC;
+static int g_MaxShortopConnNum = IFUSE_MAX_NUM_SHORTOP_CONN;
+static int g_MaxBackgroundConnNum = IFUSE_MAX_NUM_BACKGROUND_CONN;
+static int g_NextShortopConnIndex = 0;
 static int g_ConnTimeoutSec = IFUSE_FREE_CONN_TIMEOUT_SEC;
 static int g_ConnKeepAliveSec = IFUSE_FREE_CONN_KEEPALIVE_SEC;
 static int g_ConnCheckIntervalSec = IFUSE_FREE_CONN_CHECK_INTERVAL_SEC;
 
 static time_t g_LastConnCheck = 0;
 
+static unsigned long long g_KeepAliveCount = 0;
+static unsigned long long g_KeepAliveFailCount = 0;
+static unsigned long long g_KeepAliveSkipCount = 0;
+static unsigned long long g_KeepAliveLockHoldUSec = 0;
+static unsigned long long g_KeepAliveLockHoldMaxUSec = 0;
+static bool g_KeepAliveRunning = false;
+// the last keep-alive task submitted, touched by the timer thread only
+static iFuseEngineRequest_t *g_KeepAliveRequest = NULL;
+
+// queueing delay of file-io connections, accumulated without locks
+static unsigned long long g_ConnQueueDelayUSec = 0;
+static unsigned long long g_ConnQueueDelayCount = 0;
+
+static unsigned long long g_LastPoolAdjust = 0;
+static unsigned long long g_LastQueueDelayAvgUSec = 0;
+static int g_LastConnUtilization = 0;
+static unsigned long long g_ConnGrowCount = 0;
+static unsigned long long g_ConnShrinkCount = 0;
+
+static int g_ConnWarmUpNum = IFUSE_CONN_WARMUP_NUM;
+static iFuseEngineRequest_t **g_WarmUpRequests = NULL;
+static int g_WarmUpRequestNum = 0;
+
+typedef struct IFuseConnEndpoint {
+    char host[NAME_LEN];
+    int port;
+    int connNum;
+    unsigned long long latencyUSec;
+    int failCount;
+    time_t ejectedUntil;
+} iFuseConnEndpoint_t;
+
+/*
+ * Circuit breaker
+ * - CLOSED: requests go through, network failures in a row are counted
+ * - OPEN: requests fail fast until the cool-down passes
+ * - HALF_OPEN: a single request probes the server, others fail fast.
+ *   its success closes the breaker, its failure opens it again.
+ *   a probe giving back its connection without a result lets the next one probe.
+ * Failures are connection failures and network errors of operations,
+ * any response of the server is a success.
+ */
+static pthread_mutex_t g_BreakerMutex;
+static volatile int g_BreakerState = IFUSE_CONN_BREAKER_CLOSED;
+static volatile int g_BreakerFailCount = 0;
+static time_t g_BreakerUntil = 0;
+static int g_BreakerMaxFailNum = IFUSE_CONN_BREAKER_FAIL_NUM;
+static int g_BreakerCoolDownSec = IFUSE_CONN_BREAKER_COOLDOWN_SEC;
+static unsigned long long g_BreakerOpenCount = 0;
+static unsigned long long g_BreakerFastFailCount = 0;
+// set in the thread let through to probe until it reports a result
+static __thread bool g_BreakerProbing = false;
+
+static pthread_mutex_t g_EndpointMutex;
+static iFuseConnEndpoint_t g_Endpoints[IFUSE_MAX_NUM_ENDPOINT];
+static int g_EndpointNum = 0;
+
 /*
  * Lock order :
  * - g_ConnectedConnLock
  * - iFuseConn_t
+ * - g_EndpointMutex
+ *
+ * inuseCnt and lastUseTime of a connection are protected by g_ConnectedConnLock.
+ * New connections are put into the table in IFUSE_CONN_STATE_CONNECTING state
+ * and established after g_ConnectedConnLock is released. Others who pick up
+ * such a connection wait on its stateCond until it becomes ready or fails.
+ *
+ * When all file-io connections are in use, callers may wait in g_ConnWaiters
+ * for a connection released by others. Waiters of a higher class are served
+ * first, FIFO within a class. g_ConnWaitMutex is taken after
+ * g_ConnectedConnLock.
+ *
+ * Background requests (run by engine workers) take at most
+ * g_MaxBackgroundConnNum file-io slots, and share a connection taken by other
+ * background requests beyond that.
+ */
+
+/*
+ * Class of the caller asking for a connection
+ */
+static int _getConnClass(int connType) {
+    if(connType == IFUSE_CONN_TYPE_FOR_SHORTOP) {
+        return IFUSE_CONN_CLASS_METADATA;
+    }
+
+    if(iFuseEngineIsBackgroundThread()) {
+        return IFUSE_CONN_CLASS_BACKGROUND;
+    }
+    return IFUSE_CONN_CLASS_DATA;
+}
+
+/*
+ * Count file-io slots taken by background requests
+ * g_ConnectedConnLock must be held by caller
+ */
+static int _countBackgroundConn() {
+    int i;
+    int count = 0;
+
+    for(i=0;i<g_MaxConnNum;i++) {
+        if(g_InUseConn[i] != NULL && g_InUseConn[i]->connClass == IFUSE_CONN_CLASS_BACKGROUND) {
+            count++;
+        }
+    }
+    return count;
+}
+
+/*
+ * Tell if a background request can take another file-io slot
+ * g_ConnectedConnLock must be held by caller
  */
+static bool _canTakeBackgroundConn() {
+    return _countBackgroundConn() < g_MaxBackgroundConnNum;
+}
 
 static unsigned long _genNextConnID() {
     unsigned long newId;
@@ -54,7 +191,301 @@ static unsigned long _genNextConnID() {
     return newId;
 }
 
-static int _connect(iFuseConn_t *iFuseConn) {
+/*
+ * Build endpoint list from "host[:port],host[:port],..."
+ * falls back to the iRODS host in the environment
+ */
+static void _initEndpoints(const char *hosts) {
+    rodsEnv *myRodsEnv = iFuseLibGetRodsEnv();
+    char *hostsCopy;
+    char *token;
+    char *saveptr = NULL;
+    char *portStr;
+
+    g_EndpointNum = 0;
+    bzero(g_Endpoints, sizeof(g_Endpoints));
+
+    if(hosts != NULL) {
+        hostsCopy = strdup(hosts);
+        if(hostsCopy != NULL) {
+            token = strtok_r(hostsCopy, ",", &saveptr);
+            while(token != NULL && g_EndpointNum < IFUSE_MAX_NUM_ENDPOINT) {
+                g_Endpoints[g_EndpointNum].port = myRodsEnv->rodsPort;
+
+                portStr = strchr(token, ':');
+                if(portStr != NULL) {
+                    *portStr = 0;
+                    if(atoi(portStr + 1) > 0) {
+                        g_Endpoints[g_EndpointNum].port = atoi(portStr + 1);
+                    }
+                }
+
+                if(strlen(token) > 0) {
+                    rstrcpy(g_Endpoints[g_EndpointNum].host, token, NAME_LEN);
+                    iFuseLibLog(LOG_DEBUG, "_initEndpoints: endpoint %s:%d", g_Endpoints[g_EndpointNum].host, g_Endpoints[g_EndpointNum].port);
+                    g_EndpointNum++;
+                }
+
+                token = strtok_r(NULL, ",", &saveptr);
+            }
+            free(hostsCopy);
+        }
+    }
+
+    if(g_EndpointNum == 0) {
+        rstrcpy(g_Endpoints[0].host, myRodsEnv->rodsHost, NAME_LEN);
+        g_Endpoints[0].port = myRodsEnv->rodsPort;
+        g_EndpointNum = 1;
+    }
+}
+
+/*
+ * Pick an endpoint for a new connection
+ * endpoints never measured are tried first, then the one with
+ * the least (connections * latency). ejected endpoints are skipped
+ * unless all of them are ejected.
+ * g_EndpointMutex must be held by caller
+ */
+static int _pickEndpoint() {
+    int i;
+    int picked = -1;
+    unsigned long long pickedScore = 0;
+    time_t current = iFuseLibGetCurrentTime();
+
+    for(i=0;i<g_EndpointNum;i++) {
+        unsigned long long score;
+
+        if(g_Endpoints[i].ejectedUntil > current) {
+            continue;
+        }
+
+        if(g_Endpoints[i].latencyUSec == 0) {
+            // not measured yet, spread by number of connections
+            score = g_Endpoints[i].connNum;
+        } else {
+            score = (g_Endpoints[i].connNum + 1) * g_Endpoints[i].latencyUSec;
+        }
+
+        if(picked < 0 ||
+            (g_Endpoints[i].latencyUSec == 0 && g_Endpoints[picked].latencyUSec != 0) ||
+            ((g_Endpoints[i].latencyUSec == 0) == (g_Endpoints[picked].latencyUSec == 0) && score < pickedScore)) {
+            picked = i;
+            pickedScore = score;
+        }
+    }
+
+    if(picked < 0) {
+        // all ejected, use the one coming back first
+        picked = 0;
+        for(i=1;i<g_EndpointNum;i++) {
+            if(g_Endpoints[i].ejectedUntil < g_Endpoints[picked].ejectedUntil) {
+                picked = i;
+            }
+        }
+    }
+    return picked;
+}
+
+/*
+ * Assign an endpoint to a connection to the iRODS host
+ */
+static void _assignEndpoint(iFuseConn_t *iFuseConn) {
+    int endpoint;
+
+    pthread_mutex_lock(&g_EndpointMutex);
+
+    if(iFuseConn->endpoint >= 0) {
+        g_Endpoints[iFuseConn->endpoint].connNum--;
+    }
+
+    endpoint = _pickEndpoint();
+    g_Endpoints[endpoint].connNum++;
+
+    iFuseConn->endpoint = endpoint;
+    rstrcpy(iFuseConn->host, g_Endpoints[endpoint].host, NAME_LEN);
+    iFuseConn->port = g_Endpoints[endpoint].port;
+
+    pthread_mutex_unlock(&g_EndpointMutex);
+}
+
+static void _releaseEndpoint(iFuseConn_t *iFuseConn) {
+    if(iFuseConn->endpoint < 0) {
+        return;
+    }
+
+    pthread_mutex_lock(&g_EndpointMutex);
+
+    g_Endpoints[iFuseConn->endpoint].connNum--;
+    iFuseConn->endpoint = -1;
+
+    pthread_mutex_unlock(&g_EndpointMutex);
+}
+
+/*
+ * Add a round-trip time sample of an endpoint, moving average (1/8)
+ * connections made to other hosts (e.g., resource servers) are ignored
+ */
+static void _addEndpointLatency(const char *host, int port, unsigned long long latencyUSec) {
+    iFuseConnEndpoint_t *endpoint;
+    int i;
+
+    if(latencyUSec == 0) {
+        latencyUSec = 1;
+    }
+
+    pthread_mutex_lock(&g_EndpointMutex);
+
+    for(i=0;i<g_EndpointNum;i++) {
+        endpoint = &g_Endpoints[i];
+        if(endpoint->port == port && strcmp(endpoint->host, host) == 0) {
+            if(endpoint->latencyUSec == 0) {
+                endpoint->latencyUSec = latencyUSec;
+            } else {
+                endpoint->latencyUSec = (endpoint->latencyUSec * 7 + latencyUSec) / 8;
+            }
+            break;
+        }
+    }
+
+    pthread_mutex_unlock(&g_EndpointMutex);
+}
+
+/*
+ * Record a result of connecting to an endpoint
+ * an endpoint failing IFUSE_ENDPOINT_MAX_FAIL times in a row is ejected
+ */
+static void _setEndpointConnectResult(iFuseConn_t *iFuseConn, int status) {
+    iFuseConnEndpoint_t *endpoint;
+
+    if(iFuseConn->endpoint < 0) {
+        return;
+    }
+
+    pthread_mutex_lock(&g_EndpointMutex);
+
+    endpoint = &g_Endpoints[iFuseConn->endpoint];
+    if(status < 0) {
+        endpoint->failCount++;
+        if(endpoint->failCount >= IFUSE_ENDPOINT_MAX_FAIL) {
+            endpoint->ejectedUntil = iFuseLibGetCurrentTime() + IFUSE_ENDPOINT_EJECT_SEC;
+            iFuseLibLog(LOG_ERROR, "_setEndpointConnectResult: endpoint %s:%d failed %d times, not used for %d sec", endpoint->host, endpoint->port, endpoint->failCount, IFUSE_ENDPOINT_EJECT_SEC);
+        }
+    } else {
+        endpoint->failCount = 0;
+        endpoint->ejectedUntil = 0;
+    }
+
+    pthread_mutex_unlock(&g_EndpointMutex);
+}
+
+/*
+ * Record a result of talking to the server
+ */
+static void _setBreakerResult(bool success) {
+    g_BreakerProbing = false;
+
+    if(g_BreakerMaxFailNum <= 0) {
+        return;
+    }
+
+    if(success && g_BreakerState == IFUSE_CONN_BREAKER_CLOSED && g_BreakerFailCount == 0) {
+        // nothing to change
+        return;
+    }
+
+    pthread_mutex_lock(&g_BreakerMutex);
+
+    if(success) {
+        if(g_BreakerState != IFUSE_CONN_BREAKER_CLOSED) {
+            iFuseLibLog(LOG_ERROR, "_setBreakerResult: server is back, circuit breaker is closed");
+        }
+
+        g_BreakerState = IFUSE_CONN_BREAKER_CLOSED;
+        g_BreakerFailCount = 0;
+    } else {
+        g_BreakerFailCount++;
+
+        if(g_BreakerState == IFUSE_CONN_BREAKER_HALF_OPEN ||
+            (g_BreakerState == IFUSE_CONN_BREAKER_CLOSED && g_BreakerFailCount >= g_BreakerMaxFailNum)) {
+            g_BreakerState = IFUSE_CONN_BREAKER_OPEN;
+            g_BreakerUntil = iFuseLibGetCurrentTime() + g_BreakerCoolDownSec;
+            g_BreakerOpenCount++;
+
+            iFuseLibLog(LOG_ERROR, "_setBreakerResult: %d network failures in a row, requests fail fast for %d sec", g_BreakerFailCount, g_BreakerCoolDownSec);
+        }
+    }
+
+    pthread_mutex_unlock(&g_BreakerMutex);
+}
+
+/*
+ * Decide whether a request can go to the server
+ * after the cool-down, one request is let through to probe the server.
+ * if the probe does not finish in another cool-down, a new one is let through.
+ */
+static bool _passBreaker() {
+    time_t current;
+
+    if(g_BreakerMaxFailNum <= 0 || g_BreakerState == IFUSE_CONN_BREAKER_CLOSED) {
+        return true;
+    }
+
+    pthread_mutex_lock(&g_BreakerMutex);
+
+    if(g_BreakerState == IFUSE_CONN_BREAKER_CLOSED) {
+        pthread_mutex_unlock(&g_BreakerMutex);
+        return true;
+    }
+
+    current = iFuseLibGetCurrentTime();
+    if(iFuseLibDiffTimeSec(current, g_BreakerUntil) >= 0) {
+        iFuseLibLog(LOG_DEBUG, "_passBreaker: probing the server");
+
+        g_BreakerState = IFUSE_CONN_BREAKER_HALF_OPEN;
+        g_BreakerUntil = current + g_BreakerCoolDownSec;
+        g_BreakerProbing = true;
+        pthread_mutex_unlock(&g_BreakerMutex);
+        return true;
+    }
+
+    g_BreakerFastFailCount++;
+
+    pthread_mutex_unlock(&g_BreakerMutex);
+    return false;
+}
+
+/*
+ * Give up the probe when the thread let through gives back its connection
+ * without talking to the server, so the next request probes right away
+ */
+static void _releaseBreakerProbe() {
+    if(!g_BreakerProbing) {
+        return;
+    }
+
+    g_BreakerProbing = false;
+
+    pthread_mutex_lock(&g_BreakerMutex);
+
+    if(g_BreakerState == IFUSE_CONN_BREAKER_HALF_OPEN) {
+        iFuseLibLog(LOG_DEBUG, "_releaseBreakerProbe: probe ended without a result");
+
+        g_BreakerState = IFUSE_CONN_BREAKER_OPEN;
+        g_BreakerUntil = iFuseLibGetCurrentTime();
+    }
+
+    pthread_mutex_unlock(&g_BreakerMutex);
+}
+
+static void _rodsClientResultHandler(rcComm_t *conn, int status, unsigned long long rttUSec) {
+    _setBreakerResult(status >= 0 || !iFuseRodsClientReadMsgError(status));
+
+    if(conn != NULL && rttUSec > 0 && status >= 0) {
+        _addEndpointLatency(conn->host, conn->portNum, rttUSec);
+    }
+}
+
+static int _connectAndLogin(iFuseConn_t *iFuseConn) {
     int status = 0;
     rodsEnv *myRodsEnv = iFuseLibGetRodsEnv();
     
@@ -65,17 +496,19 @@ static int _connect(iFuseConn_t *iFuseConn) {
 
     if (iFuseConn->conn == NULL) {
         rErrMsg_t errMsg;
-        iFuseConn->conn = iFuseRodsClientConnect(myRodsEnv->rodsHost, myRodsEnv->rodsPort,
+        iFuseConn->conn = iFuseRodsClientConnect(iFuseConn->host, iFuseConn->port,
                 myRodsEnv->rodsUserName, myRodsEnv->rodsZone, reconnFlag, &errMsg);
         if (iFuseConn->conn == NULL) {
             // try one more
-            iFuseConn->conn = iFuseRodsClientConnect(myRodsEnv->rodsHost, myRodsEnv->rodsPort,
+            iFuseConn->conn = iFuseRodsClientConnect(iFuseConn->host, iFuseConn->port,
                     myRodsEnv->rodsUserName, myRodsEnv->rodsZone, reconnFlag, &errMsg);
             if (iFuseConn->conn == NULL) {
                 // failed
+                _setBreakerResult(false);
+
                 iFuseLibLogError(LOG_ERROR, errMsg.status,
                         "_connect: iFuseRodsClientConnect failure %s", errMsg.msg);
-                iFuseLibLog(LOG_ERROR, "Cannot connect to iRODS Host - %s:%d error - %s", myRodsEnv->rodsHost, myRodsEnv->rodsPort, errMsg.msg);
+                iFuseLibLog(LOG_ERROR, "Cannot connect to iRODS Host - %s:%d error - %s", iFuseConn->host, iFuseConn->port, errMsg.msg);
                 if (errMsg.status < 0) {
                     return errMsg.status;
                 } else {
@@ -84,183 +517,863 @@ static int _connect(iFuseConn_t *iFuseConn) {
             }
         }
 
-        assert(iFuseConn->conn != NULL);
+        assert(iFuseConn->conn != NULL);
+
+        status = iFuseRodsClientLogin(iFuseConn->conn);
+        if (status != 0) {
+            iFuseRodsClientDisconnect(iFuseConn->conn);
+            iFuseConn->conn = NULL;
+
+            // failed
+            iFuseLibLog(LOG_ERROR, "iFuseRodsClientLogin failure, status = %d", status);
+            iFuseLibLog(LOG_ERROR, "Cannot log in to iRODS - account %s", myRodsEnv->rodsUserName);
+            return status;
+        }
+        
+        if(iFuseLibGetOption()->ticket != NULL) {
+            char* ticket = iFuseLibGetOption()->ticket;
+            ticketAdminInp_t ticketAdminInp;
+            
+            bzero(&ticketAdminInp, sizeof ( ticketAdminInp_t));
+            ticketAdminInp.arg1 = "session";
+            ticketAdminInp.arg2 = ticket;
+            ticketAdminInp.arg3 = "";
+            ticketAdminInp.arg4 = "";
+            ticketAdminInp.arg5 = "";
+            ticketAdminInp.arg6 = "";
+            
+            status = iFuseRodsClientSetSessionTicket(iFuseConn->conn, &ticketAdminInp);
+            if (status != 0) {
+                iFuseRodsClientDisconnect(iFuseConn->conn);
+                iFuseConn->conn = NULL;
+
+                // failed
+                iFuseLibLog(LOG_ERROR, "iFuseRodsClientSetSessionTicket failure, status = %d", status);
+                iFuseLibLog(LOG_ERROR, "Cannot set session-ticket - ticket %s", ticket);
+                return status;
+            }
+        }
+    }
+
+    return status;
+}
+
+/*
+ * Connect to the host and log in
+ * may wait if too many connections are being established,
+ * a connection being established never waits for anything else
+ */
+static int _connect(iFuseConn_t *iFuseConn) {
+    int status = 0;
+
+    status = iFuseAdmissionEnterConnect();
+    if(status < 0) {
+        iFuseLibLogError(LOG_ERROR, status, "_connect: too many connections are being established");
+        return status;
+    }
+
+    status = _connectAndLogin(iFuseConn);
+    iFuseAdmissionLeaveConnect();
+
+    return status;
+}
+
+static void _disconnect(iFuseConn_t *iFuseConn) {
+    assert(iFuseConn != NULL);
+
+    if (iFuseConn->conn != NULL) {
+        iFuseRodsClientDisconnect(iFuseConn->conn);
+        iFuseConn->conn = NULL;
+    }
+}
+
+static int _newConn(iFuseConn_t **iFuseConn, int connType, const char *host) {
+    iFuseConn_t *tmpIFuseConn = NULL;
+    rodsEnv *myRodsEnv = iFuseLibGetRodsEnv();
+
+    assert(iFuseConn != NULL);
+
+    tmpIFuseConn = (iFuseConn_t *) calloc(1, sizeof ( iFuseConn_t));
+    if (tmpIFuseConn == NULL) {
+        *iFuseConn = NULL;
+        return SYS_MALLOC_ERR;
+    }
+
+    tmpIFuseConn->connId = _genNextConnID();
+
+    iFuseLibLog(LOG_DEBUG, "_newConn: creating a new connection - %lu", tmpIFuseConn->connId);
+
+    pthread_rwlockattr_init(&tmpIFuseConn->lockAttr);
+    pthread_rwlock_init(&tmpIFuseConn->lock, &tmpIFuseConn->lockAttr);
+
+    pthread_mutex_init(&tmpIFuseConn->stateMutex, NULL);
+    pthread_cond_init(&tmpIFuseConn->stateCond, NULL);
+
+    tmpIFuseConn->type = connType;
+    tmpIFuseConn->state = IFUSE_CONN_STATE_CONNECTING;
+
+    // data-path connections go to the given resource server directly
+    tmpIFuseConn->endpoint = -1;
+    if(host != NULL) {
+        rstrcpy(tmpIFuseConn->host, host, NAME_LEN);
+        tmpIFuseConn->port = myRodsEnv->rodsPort;
+        tmpIFuseConn->direct = true;
+    } else {
+        _assignEndpoint(tmpIFuseConn);
+        tmpIFuseConn->direct = false;
+    }
+    tmpIFuseConn->lastActTime = iFuseLibGetCurrentTime();
+
+    *iFuseConn = tmpIFuseConn;
+    return 0;
+}
+
+static int _freeConn(iFuseConn_t *iFuseConn) {
+    assert(iFuseConn != NULL);
+
+    iFuseLibLog(LOG_DEBUG, "_freeConn: disconnecting - %lu", iFuseConn->connId);
+
+    // disconnect first
+    _disconnect(iFuseConn);
+    _releaseEndpoint(iFuseConn);
+
+    pthread_rwlock_destroy(&iFuseConn->lock);
+    pthread_rwlockattr_destroy(&iFuseConn->lockAttr);
+
+    pthread_cond_destroy(&iFuseConn->stateCond);
+    pthread_mutex_destroy(&iFuseConn->stateMutex);
+
+    free(iFuseConn);
+    return 0;
+}
+
+static int _getConnState(iFuseConn_t *iFuseConn) {
+    int state;
+
+    assert(iFuseConn != NULL);
+
+    pthread_mutex_lock(&iFuseConn->stateMutex);
+    state = iFuseConn->state;
+    pthread_mutex_unlock(&iFuseConn->stateMutex);
+
+    return state;
+}
+
+static void _setConnState(iFuseConn_t *iFuseConn, int state, int connectStatus) {
+    assert(iFuseConn != NULL);
+
+    pthread_mutex_lock(&iFuseConn->stateMutex);
+    iFuseConn->state = state;
+    iFuseConn->connectStatus = connectStatus;
+    pthread_cond_broadcast(&iFuseConn->stateCond);
+    pthread_mutex_unlock(&iFuseConn->stateMutex);
+}
+
+/*
+ * Wait until the connection is established by whom created it
+ */
+static int _waitConn(iFuseConn_t *iFuseConn) {
+    int status = 0;
+
+    assert(iFuseConn != NULL);
+
+    pthread_mutex_lock(&iFuseConn->stateMutex);
+
+    while(iFuseConn->state == IFUSE_CONN_STATE_CONNECTING) {
+        pthread_cond_wait(&iFuseConn->stateCond, &iFuseConn->stateMutex);
+    }
+
+    if(iFuseConn->state == IFUSE_CONN_STATE_FAILED) {
+        status = iFuseConn->connectStatus;
+    }
+
+    pthread_mutex_unlock(&iFuseConn->stateMutex);
+    return status;
+}
+
+/*
+ * Check if the connection goes to the host
+ * NULL host means the default iRODS host
+ */
+static bool _isConnToHost(iFuseConn_t *iFuseConn, const char *host) {
+    if(host == NULL) {
+        return !iFuseConn->direct;
+    }
+    return iFuseConn->direct && strcmp(iFuseConn->host, host) == 0;
+}
+
+/*
+ * Find a free file-io connection to the host
+ * g_ConnectedConnLock must be held by caller
+ */
+static iFuseConn_t *_findFreeFileIOConn(const char *host) {
+    std::list<iFuseConn_t*>::iterator it_conn;
+
+    for(it_conn=g_FreeConn.begin();it_conn!=g_FreeConn.end();it_conn++) {
+        if(_isConnToHost(*it_conn, host)) {
+            return *it_conn;
+        }
+    }
+    return NULL;
+}
+
+/*
+ * Find an empty slot for a file-io connection
+ * g_ConnectedConnLock must be held by caller
+ */
+static int _findEmptyFileIOSlot(int connClass) {
+    int i;
+    int inuse = 0;
+    int emptyIndex = -1;
+
+    if(connClass == IFUSE_CONN_CLASS_BACKGROUND && !_canTakeBackgroundConn()) {
+        return -1;
+    }
+
+    for(i=0;i<g_MaxConnNum;i++) {
+        if(g_InUseConn[i] == NULL) {
+            if(emptyIndex < 0) {
+                emptyIndex = i;
+            }
+        } else {
+            inuse++;
+        }
+    }
+
+    // pool size is limited by g_TargetConnNum
+    if(inuse >= g_TargetConnNum) {
+        return -1;
+    }
+
+    if(inuse + 1 > g_PeakInUseConnNum) {
+        g_PeakInUseConnNum = inuse + 1;
+    }
+    return emptyIndex;
+}
+
+/*
+
+ * Hand over a released file-io connection to the first waiter of the highest class for its host
+ * Background waiters are skipped if it would take another slot over the limit
+ * If conn is NULL, the waiter is just woken up to retry as a slot became free
+ * g_ConnectedConnLock must be held by caller
+ */
+static bool _wakeConnWaiter(iFuseConn_t *iFuseConn) {
+    std::list<iFuseConnWaiter_t*>::iterator it_waiter;
+    iFuseConnWaiter_t *waiter = NULL;
+    bool backgroundAllowed;
+
+    backgroundAllowed = (iFuseConn != NULL && iFuseConn->connClass == IFUSE_CONN_CLASS_BACKGROUND) || _canTakeBackgroundConn();
+
+    pthread_mutex_lock(&g_ConnWaitMutex);
+
+    for(it_waiter=g_ConnWaiters.begin();it_waiter!=g_ConnWaiters.end();it_waiter++) {
+        if(iFuseConn != NULL && !_isConnToHost(iFuseConn, (*it_waiter)->host)) {
+            continue;
+        }
+
+        if((*it_waiter)->connClass == IFUSE_CONN_CLASS_BACKGROUND && !backgroundAllowed) {
+            continue;
+        }
+
+        if(waiter == NULL || waiter->connClass > (*it_waiter)->connClass) {
+            waiter = *it_waiter;
+        }
+    }
+
+    if(waiter == NULL) {
+        pthread_mutex_unlock(&g_ConnWaitMutex);
+        return false;
+    }
+
+    g_ConnWaiters.remove(waiter);
+
+    if(iFuseConn != NULL) {
+        iFuseConn->lastUseTime = iFuseLibGetCurrentTime();
+        iFuseConn->inuseCnt++;
+        iFuseConn->connClass = waiter->connClass;
+    }
+
+    waiter->conn = iFuseConn;
+    waiter->woken = true;
+    pthread_cond_signal(&waiter->cond);
+
+    pthread_mutex_unlock(&g_ConnWaitMutex);
+    return true;
+}
+
+static void _addConnQueueDelay(unsigned long long delayUSec) {
+    __sync_fetch_and_add(&g_ConnQueueDelayUSec, delayUSec);
+    __sync_fetch_and_add(&g_ConnQueueDelayCount, 1);
+}
+
+/*
+ * Grow or shrink file-io connection pool between g_MinConnNum and g_MaxConnNum
+ * - grow when callers wait for connections longer than the target on average
+ * - shrink when connections are not fully used for an interval
+ * g_ConnectedConnLock must be held by caller
+ * Returns the number of free connections exceeding the pool size
+ */
+static int _adjustPoolSize() {
+    unsigned long long current = iFuseLibGetMonotonicTimeUSec();
+    unsigned long long elapsed;
+    unsigned long long delay;
+    unsigned long long delayCount;
+    unsigned long long busy;
+    unsigned long long total;
+    int utilization = 0;
+    int inuse = 0;
+    int excess;
+    int i;
+
+    elapsed = current - g_LastPoolAdjust;
+    g_LastPoolAdjust = current;
+
+    delay = __sync_lock_test_and_set(&g_ConnQueueDelayUSec, 0);
+    delayCount = __sync_lock_test_and_set(&g_ConnQueueDelayCount, 0);
+
+    g_LastQueueDelayAvgUSec = 0;
+    if(delayCount > 0) {
+        g_LastQueueDelayAvgUSec = delay / delayCount;
+    }
+
+    // utilization of connections in use
+    for(i=0;i<g_MaxConnNum;i++) {
+        if(g_InUseConn[i] != NULL) {
+            // busyUSec is added by users without the table lock
+            total = __sync_fetch_and_add(&g_InUseConn[i]->busyUSec, 0);
+            busy = total - g_InUseConn[i]->lastBusyUSec;
+            g_InUseConn[i]->lastBusyUSec = total;
+
+            if(elapsed > 0) {
+                utilization += (int)(busy * 100 / elapsed);
+            }
+            inuse++;
+        }
+    }
+
+    g_LastConnUtilization = 0;
+    if(inuse > 0) {
+        g_LastConnUtilization = utilization / inuse;
+    }
+
+    if(g_ConnWaitTargetMSec <= 0) {
+        // adaptive sizing is off
+        return 0;
+    }
+
+    if(g_LastQueueDelayAvgUSec > (unsigned long long)g_ConnWaitTargetMSec * 1000) {
+        if(g_TargetConnNum < g_MaxConnNum) {
+            g_TargetConnNum++;
+            g_ConnGrowCount++;
+
+            iFuseLibLog(LOG_DEBUG, "_adjustPoolSize: grow pool to %d, avg wait = %llu usec", g_TargetConnNum, g_LastQueueDelayAvgUSec);
+
+            // let a waiter take the new slot
+            _wakeConnWaiter(NULL);
+        }
+    } else if(g_PeakInUseConnNum < g_TargetConnNum) {
+        if(g_TargetConnNum > g_MinConnNum) {
+            g_TargetConnNum--;
+            g_ConnShrinkCount++;
+
+            iFuseLibLog(LOG_DEBUG, "_adjustPoolSize: shrink pool to %d, peak use = %d", g_TargetConnNum, g_PeakInUseConnNum);
+        }
+    }
+
+    g_PeakInUseConnNum = inuse;
+
+    excess = inuse + (int)g_FreeConn.size() - g_TargetConnNum;
+    if(excess > (int)g_FreeConn.size()) {
+        excess = g_FreeConn.size();
+    }
+    return excess;
+}
+
+/*
+ * Wait until a file-io connection is released by others or timed out
+ * g_ConnectedConnLock must be held by caller and is released here
+ * Returns the connection handed over, or NULL if timed out or need to retry
+ */
+
+static iFuseConn_t *_waitFileIOConn(int connClass, const char *host) {
+    iFuseConnWaiter_t waiter;
+    struct timespec deadline;
+    unsigned long long start;
+    unsigned long long waited;
+    int rc = 0;
+
+    bzero(&waiter, sizeof(iFuseConnWaiter_t));
+    pthread_cond_init(&waiter.cond, NULL);
+
+    waiter.connClass = connClass;
+    waiter.host = host;
+
+    pthread_mutex_lock(&g_ConnWaitMutex);
+    g_ConnWaiters.push_back(&waiter);
+    pthread_mutex_unlock(&g_ConnWaitMutex);
+
+    pthread_rwlock_unlock(&g_ConnectedConnLock);
+
+    start = iFuseLibGetMonotonicTimeMSec();
+    iFuseLibGetTimespecAfterMSec(&deadline, g_ConnWaitTimeoutMSec);
+
+    pthread_mutex_lock(&g_ConnWaitMutex);
+
+    while(!waiter.woken && rc != ETIMEDOUT) {
+        rc = pthread_cond_timedwait(&waiter.cond, &g_ConnWaitMutex, &deadline);
+    }
+
+    waited = iFuseLibGetMonotonicTimeMSec() - start;
+    _addConnQueueDelay(waited * 1000);
+
+    if(!waiter.woken) {
+        g_ConnWaiters.remove(&waiter);
+        g_ConnWaitTimeoutCount++;
+    }
+
+    g_ConnWaitCount++;
+    g_ConnWaitTotalMSec += waited;
+    if(waited > g_ConnWaitMaxMSec) {
+        g_ConnWaitMaxMSec = waited;
+    }
+
+    pthread_mutex_unlock(&g_ConnWaitMutex);
+
+    pthread_cond_destroy(&waiter.cond);
+
+    iFuseLibLog(LOG_DEBUG, "_waitFileIOConn: waited %llu msec for a connection", waited);
+    return waiter.conn;
+}
+
+/*
+ * Remove the connection from in-use table
+ * g_ConnectedConnLock must be held by caller
+ */
+static void _detachConn(iFuseConn_t *iFuseConn) {
+    std::map<unsigned long, iFuseConn_t*>::iterator it_connmap;
+    int i;
+
+    assert(iFuseConn != NULL);
+
+    if(iFuseConn->type == IFUSE_CONN_TYPE_FOR_SHORTOP) {
+        for(i=0;i<g_MaxShortopConnNum;i++) {
+            if(g_InUseShortopConn[i] == iFuseConn) {
+                g_InUseShortopConn[i] = NULL;
+                break;
+            }
+        }
+    } else if(iFuseConn->type == IFUSE_CONN_TYPE_FOR_FILE_IO) {
+        for(i=0;i<g_MaxConnNum;i++) {
+            if(g_InUseConn[i] == iFuseConn) {
+                g_InUseConn[i] = NULL;
+
+                // let a waiter take the slot
+                _wakeConnWaiter(NULL);
+                break;
+            }
+        }
+    } else if(iFuseConn->type == IFUSE_CONN_TYPE_FOR_ONETIMEUSE) {
+        it_connmap = g_InUseOnetimeuseConn.find(iFuseConn->connId);
+        if(it_connmap != g_InUseOnetimeuseConn.end()) {
+            g_InUseOnetimeuseConn.erase(it_connmap);
+        }
+    }
+}
+
+/*
+ * Establish a connection reserved in the in-use table
+ * g_ConnectedConnLock must not be held by caller
+ */
+static int _establishConn(iFuseConn_t *iFuseConn) {
+    int status = 0;
+
+    assert(iFuseConn != NULL);
+
+    iFuseLibLog(LOG_DEBUG, "_establishConn: connecting - %lu", iFuseConn->connId);
+
+    status = _connect(iFuseConn);
+    _setEndpointConnectResult(iFuseConn, status);
+    iFuseConn->lastActTime = iFuseLibGetCurrentTime();
+
+    if(status < 0) {
+        // not to let others pick up the failed connection
+        pthread_rwlock_wrlock(&g_ConnectedConnLock);
+        _detachConn(iFuseConn);
+        pthread_rwlock_unlock(&g_ConnectedConnLock);
+
+        _setConnState(iFuseConn, IFUSE_CONN_STATE_FAILED, status);
+        return status;
+    }
+
+    _setConnState(iFuseConn, IFUSE_CONN_STATE_READY, 0);
+    return 0;
+}
+
+static int _freeAllConn() {
+    iFuseConn_t *tmpIFuseConn;
+    std::map<unsigned long, iFuseConn_t*>::iterator it_connmap;
+    int i;
+
+    pthread_rwlock_wrlock(&g_ConnectedConnLock);
+
+    // disconnect all free connections
+    while(!g_FreeConn.empty()) {
+        tmpIFuseConn = g_FreeConn.front();
+        g_FreeConn.pop_front();
+
+        _freeConn(tmpIFuseConn);
+    }
+
+    while(!g_FreeShortopConn.empty()) {
+        tmpIFuseConn = g_FreeShortopConn.front();
+        g_FreeShortopConn.pop_front();
+
+        _freeConn(tmpIFuseConn);
+    }
+
+    // disconnect all inuse connections
+    for(i=0;i<g_MaxConnNum;i++) {
+        if(g_InUseConn[i] != NULL) {
+            tmpIFuseConn = g_InUseConn[i];
+            g_InUseConn[i] = NULL;
+            _freeConn(tmpIFuseConn);
+        }
+    }
+
+    for(i=0;i<g_MaxShortopConnNum;i++) {
+        if(g_InUseShortopConn[i] != NULL) {
+            tmpIFuseConn = g_InUseShortopConn[i];
+            g_InUseShortopConn[i] = NULL;
+            _freeConn(tmpIFuseConn);
+        }
+    }
+
+    while(!g_InUseOnetimeuseConn.empty()) {
+        it_connmap = g_InUseOnetimeuseConn.begin();
+        if(it_connmap != g_InUseOnetimeuseConn.end()) {
+            tmpIFuseConn = it_connmap->second;
+            g_InUseOnetimeuseConn.erase(it_connmap);
+
+            _freeConn(tmpIFuseConn);
+        }
+    }
+    
+    pthread_rwlock_unlock(&g_ConnectedConnLock);
+
+    return 0;
+}
+
+/*
+ * Decrease reference count, move to free list if no one uses
+ */
+static int _releaseConn(iFuseConn_t *iFuseConn, bool updateUseTime) {
+    int i;
+    std::map<unsigned long, iFuseConn_t*>::iterator it_connmap;
+
+    assert(iFuseConn != NULL);
+
+    pthread_rwlock_wrlock(&g_ConnectedConnLock);
+
+    if(updateUseTime) {
+        iFuseConn->lastUseTime = iFuseLibGetCurrentTime();
+    }
+    iFuseConn->inuseCnt--;
+
+    assert(iFuseConn->inuseCnt >= 0);
+
+    if(iFuseConn->inuseCnt == 0) {
+        if(iFuseConn->discarded || _getConnState(iFuseConn) == IFUSE_CONN_STATE_FAILED) {
+            // discarded or failed to connect - already detached from the table
+            pthread_rwlock_unlock(&g_ConnectedConnLock);
+
+            _freeConn(iFuseConn);
+            return 0;
+        }
+
+        // move to free list
+        if(iFuseConn->type == IFUSE_CONN_TYPE_FOR_SHORTOP) {
+            for(i=0;i<g_MaxShortopConnNum;i++) {
+                if(g_InUseShortopConn[i] == iFuseConn) {
+                    g_InUseShortopConn[i] = NULL;
+                    break;
+                }
+            }
+
+            g_FreeShortopConn.push_front(iFuseConn);
+
+            pthread_rwlock_unlock(&g_ConnectedConnLock);
+            return 0;
+        } else if(iFuseConn->type == IFUSE_CONN_TYPE_FOR_FILE_IO) {
+            // hand over to a waiter for the same host directly to keep the order
+            if(_wakeConnWaiter(iFuseConn)) {
+                pthread_rwlock_unlock(&g_ConnectedConnLock);
+                return 0;
+            }
+
+            for(i=0;i<g_MaxConnNum;i++) {
+                if(g_InUseConn[i] == iFuseConn) {
+                    g_InUseConn[i] = NULL;
+                    break;
+                }
+            }
+
+            g_FreeConn.push_front(iFuseConn);
+
+            // waiters for other hosts can take the slot
+            _wakeConnWaiter(NULL);
+
+            pthread_rwlock_unlock(&g_ConnectedConnLock);
+            return 0;
+        } else if(iFuseConn->type == IFUSE_CONN_TYPE_FOR_ONETIMEUSE) {
+            it_connmap = g_InUseOnetimeuseConn.find(iFuseConn->connId);
+            if(it_connmap != g_InUseOnetimeuseConn.end()) {
+                // has it - remove
+                g_InUseOnetimeuseConn.erase(it_connmap);
+            }
+
+            pthread_rwlock_unlock(&g_ConnectedConnLock);
+
+            _freeConn(iFuseConn);
+            return 0;
+        } else {
+            assert(0);
+        }
+    }
+
+    pthread_rwlock_unlock(&g_ConnectedConnLock);
+    return 0;
+}
+
+static int _warmUpTask(void* param) {
+    int status;
+    int connType = (int)(long)param;
+    iFuseConn_t *tmpIFuseConn = NULL;
 
-        status = iFuseRodsClientLogin(iFuseConn->conn);
-        if (status != 0) {
-            iFuseRodsClientDisconnect(iFuseConn->conn);
-            iFuseConn->conn = NULL;
+    status = _newConn(&tmpIFuseConn, connType, NULL);
+    if (status < 0) {
+        iFuseLibLogError(LOG_ERROR, status, "_warmUpTask: _newConn error");
+        return status;
+    }
 
-            // failed
-            iFuseLibLog(LOG_ERROR, "iFuseRodsClientLogin failure, status = %d", status);
-            iFuseLibLog(LOG_ERROR, "Cannot log in to iRODS - account %s", myRodsEnv->rodsUserName);
-            return status;
-        }
-        
-        if(iFuseLibGetOption()->ticket != NULL) {
-            char* ticket = iFuseLibGetOption()->ticket;
-            ticketAdminInp_t ticketAdminInp;
-            
-            bzero(&ticketAdminInp, sizeof ( ticketAdminInp_t));
-            ticketAdminInp.arg1 = "session";
-            ticketAdminInp.arg2 = ticket;
-            ticketAdminInp.arg3 = "";
-            ticketAdminInp.arg4 = "";
-            ticketAdminInp.arg5 = "";
-            ticketAdminInp.arg6 = "";
-            
-            status = iFuseRodsClientSetSessionTicket(iFuseConn->conn, &ticketAdminInp);
-            if (status != 0) {
-                iFuseRodsClientDisconnect(iFuseConn->conn);
-                iFuseConn->conn = NULL;
+    status = _establishConn(tmpIFuseConn);
+    if (status < 0) {
+        iFuseLibLogError(LOG_ERROR, status, "_warmUpTask: _establishConn error");
+        _freeConn(tmpIFuseConn);
+        return status;
+    }
 
-                // failed
-                iFuseLibLog(LOG_ERROR, "iFuseRodsClientSetSessionTicket failure, status = %d", status);
-                iFuseLibLog(LOG_ERROR, "Cannot set session-ticket - ticket %s", ticket);
-                return status;
-            }
-        }
+    tmpIFuseConn->lastUseTime = iFuseLibGetCurrentTime();
+
+    pthread_rwlock_wrlock(&g_ConnectedConnLock);
+
+    if(connType == IFUSE_CONN_TYPE_FOR_SHORTOP) {
+        g_FreeShortopConn.push_back(tmpIFuseConn);
+    } else {
+        g_FreeConn.push_back(tmpIFuseConn);
     }
 
-    return status;
+    pthread_rwlock_unlock(&g_ConnectedConnLock);
+
+    iFuseLibLog(LOG_DEBUG, "_warmUpTask: connection %lu is ready", tmpIFuseConn->connId);
+    return 0;
 }
 
-static void _disconnect(iFuseConn_t *iFuseConn) {
-    assert(iFuseConn != NULL);
+static void _joinWarmUpTasks() {
+    int i;
 
-    if (iFuseConn->conn != NULL) {
-        iFuseRodsClientDisconnect(iFuseConn->conn);
-        iFuseConn->conn = NULL;
+    for(i=0;i<g_WarmUpRequestNum;i++) {
+        iFuseEngineWait(g_WarmUpRequests[i]);
+        iFuseEngineRelease(g_WarmUpRequests[i]);
+    }
+
+    if(g_WarmUpRequests != NULL) {
+        free(g_WarmUpRequests);
+        g_WarmUpRequests = NULL;
     }
+    g_WarmUpRequestNum = 0;
 }
 
-static int _newConn(iFuseConn_t **iFuseConn) {
+/*
+ * Send a keep-alive request
+ * Returns 1 if skipped as the connection is busy
+ */
+static int _keepAlive(iFuseConn_t *iFuseConn) {
     int status = 0;
-    iFuseConn_t *tmpIFuseConn = NULL;
+    miscSvrInfo_t *miscSvrInfoOut = NULL;
 
-    assert(iFuseConn != NULL);
+    // a connection being used by others is alive
+    if(pthread_rwlock_trywrlock(&iFuseConn->lock) != 0) {
+        return 1;
+    }
 
-    tmpIFuseConn = (iFuseConn_t *) calloc(1, sizeof ( iFuseConn_t));
-    if (tmpIFuseConn == NULL) {
-        *iFuseConn = NULL;
-        return SYS_MALLOC_ERR;
+    iFuseLibLog(LOG_DEBUG, "_keepAlive: connection %lu", iFuseConn->connId);
+
+    status = iFuseRodsClientGetMiscSvrInfo(iFuseConn->conn, &miscSvrInfoOut);
+    if (status < 0) {
+        iFuseLibLogError(LOG_ERROR, status, "_keepAlive: iFuseRodsClientGetMiscSvrInfo error, status = %d",
+            status);
+        pthread_rwlock_unlock(&iFuseConn->lock);
+        return status;
     }
 
-    tmpIFuseConn->connId = _genNextConnID();
+    if(miscSvrInfoOut != NULL) {
+        free(miscSvrInfoOut);
+    }
 
-    iFuseLibLog(LOG_DEBUG, "_newConn: creating a new connection - %lu", tmpIFuseConn->connId);
+    // update last act time
+    iFuseConn->lastActTime = iFuseLibGetCurrentTime();
 
-    pthread_rwlockattr_init(&tmpIFuseConn->lockAttr);
-    pthread_rwlock_init(&tmpIFuseConn->lock, &tmpIFuseConn->lockAttr);
-    
-    // connect
-    status = _connect(tmpIFuseConn);
-    tmpIFuseConn->lastActTime = iFuseLibGetCurrentTime();
-    *iFuseConn = tmpIFuseConn;
-    return status;
+    pthread_rwlock_unlock(&iFuseConn->lock);
+    return 0;
 }
 
-static int _freeConn(iFuseConn_t *iFuseConn) {
-    assert(iFuseConn != NULL);
-
-    iFuseLibLog(LOG_DEBUG, "_freeConn: disconnecting - %lu", iFuseConn->connId);
+static void _countKeepAlive(int status) {
+    // only one keep-alive task runs at a time
+    if(status > 0) {
+        g_KeepAliveSkipCount++;
+    } else if(status < 0) {
+        g_KeepAliveCount++;
+        g_KeepAliveFailCount++;
+    } else {
+        g_KeepAliveCount++;
+    }
+}
 
-    // disconnect first
-    _disconnect(iFuseConn);
+static bool _needKeepAlive(iFuseConn_t *iFuseConn, time_t current) {
+    if(iFuseConn == NULL) {
+        return false;
+    }
 
-    pthread_rwlock_destroy(&iFuseConn->lock);
-    pthread_rwlockattr_destroy(&iFuseConn->lockAttr);
+    if(_getConnState(iFuseConn) != IFUSE_CONN_STATE_READY) {
+        return false;
+    }
 
-    free(iFuseConn);
-    return 0;
+    // skip connections that did real work recently
+    if(iFuseLibDiffTimeSec(current, iFuseConn->lastActTime) < g_ConnKeepAliveSec) {
+        return false;
+    }
+    return true;
 }
 
-static int _freeAllConn() {
-    iFuseConn_t *tmpIFuseConn;
-    std::map<unsigned long, iFuseConn_t*>::iterator it_connmap;
-    int i;
+static int _newConnKeepAlive(iFuseConnKeepAlive_t **iFuseConnKeepAlive) {
+    iFuseConnKeepAlive_t *tmpIFuseConnKeepAlive = NULL;
 
-    pthread_rwlock_wrlock(&g_ConnectedConnLock);
+    assert(iFuseConnKeepAlive != NULL);
 
-    // disconnect all free connections
-    while(!g_FreeConn.empty()) {
-        tmpIFuseConn = g_FreeConn.front();
-        g_FreeConn.pop_front();
+    *iFuseConnKeepAlive = NULL;
 
-        _freeConn(tmpIFuseConn);
+    tmpIFuseConnKeepAlive = (iFuseConnKeepAlive_t *) calloc(1, sizeof ( iFuseConnKeepAlive_t));
+    if (tmpIFuseConnKeepAlive == NULL) {
+        return SYS_MALLOC_ERR;
     }
 
-    if(g_FreeShortopConn != NULL) {
-        _freeConn(g_FreeShortopConn);
-        g_FreeShortopConn = NULL;
+    // we must use new keyword instead of calloc since it contains c++ stl list object
+    tmpIFuseConnKeepAlive->inuseConns = new std::list<iFuseConn_t*>();
+    tmpIFuseConnKeepAlive->freeConns = new std::list<iFuseConn_t*>();
+
+    *iFuseConnKeepAlive = tmpIFuseConnKeepAlive;
+    return 0;
+}
+
+static void _freeConnKeepAlive(iFuseConnKeepAlive_t *iFuseConnKeepAlive) {
+    assert(iFuseConnKeepAlive != NULL);
+
+    if(iFuseConnKeepAlive->inuseConns != NULL) {
+        delete iFuseConnKeepAlive->inuseConns;
     }
 
-    // disconnect all inuse connections
-    for(i=0;i<g_MaxConnNum;i++) {
-        if(g_InUseConn[i] != NULL) {
-            tmpIFuseConn = g_InUseConn[i];
-            g_InUseConn[i] = NULL;
-            _freeConn(tmpIFuseConn);
-        }
+    if(iFuseConnKeepAlive->freeConns != NULL) {
+        delete iFuseConnKeepAlive->freeConns;
     }
 
-    if(g_InUseShortopConn != NULL) {
-        _freeConn(g_InUseShortopConn);
-        g_InUseShortopConn = NULL;
+    free(iFuseConnKeepAlive);
+}
+
+/*
+ * Send keep-alive requests to connections taken by _connChecker
+ * and put them back
+ */
+static int _keepAliveTask(void* param) {
+    iFuseConnKeepAlive_t *iFuseConnKeepAlive;
+    std::list<iFuseConn_t*> removeList;
+    std::list<iFuseConn_t*>::iterator it_conn;
+    iFuseConn_t *iFuseConn;
+    int status;
+
+    assert(param != NULL);
+
+    iFuseConnKeepAlive = (iFuseConnKeepAlive_t*)param;
+
+    // send keep-alive requests without holding the table lock
+    // in-use connections failed are reconnected by their users
+    for(it_conn=iFuseConnKeepAlive->inuseConns->begin();it_conn!=iFuseConnKeepAlive->inuseConns->end();it_conn++) {
+        status = _keepAlive(*it_conn);
+        _countKeepAlive(status);
     }
 
-    while(!g_InUseOnetimeuseConn.empty()) {
-        it_connmap = g_InUseOnetimeuseConn.begin();
-        if(it_connmap != g_InUseOnetimeuseConn.end()) {
-            tmpIFuseConn = it_connmap->second;
-            g_InUseOnetimeuseConn.erase(it_connmap);
+    for(it_conn=iFuseConnKeepAlive->freeConns->begin();it_conn!=iFuseConnKeepAlive->freeConns->end();it_conn++) {
+        status = _keepAlive(*it_conn);
+        _countKeepAlive(status);
 
-            _freeConn(tmpIFuseConn);
+        if(status < 0) {
+            removeList.push_back(*it_conn);
         }
     }
-    
-    pthread_rwlock_unlock(&g_ConnectedConnLock);
 
-    return 0;
-}
-
-static void _keepAlive(iFuseConn_t *iFuseConn) {
-    int status = 0;
-    char iRodsPath[MAX_NAME_LEN];
-    dataObjInp_t dataObjInp;
-    rodsObjStat_t *rodsObjStatOut = NULL;
+    // release pinned connections
+    while(!iFuseConnKeepAlive->inuseConns->empty()) {
+        iFuseConn = iFuseConnKeepAlive->inuseConns->front();
+        iFuseConnKeepAlive->inuseConns->pop_front();
 
-    bzero(iRodsPath, MAX_NAME_LEN);
-    status = iFuseRodsClientMakeRodsPath("/", iRodsPath);
-    if (status < 0) {
-        iFuseLibLogError(LOG_ERROR, status,
-                "_keepAlive: iFuseRodsClientMakeRodsPath of %s error", iRodsPath);
-        return;
+        _releaseConn(iFuseConn, false);
     }
 
-    iFuseLibLog(LOG_DEBUG, "_keepAlive: connection %lu", iFuseConn->connId);
+    pthread_rwlock_wrlock(&g_ConnectedConnLock);
 
-    bzero(&dataObjInp, sizeof ( dataObjInp_t));
-    rstrcpy(dataObjInp.objPath, iRodsPath, MAX_NAME_LEN);
+    // return free connections alive to the back of free lists
+    while(!iFuseConnKeepAlive->freeConns->empty()) {
+        iFuseConn = iFuseConnKeepAlive->freeConns->front();
+        iFuseConnKeepAlive->freeConns->pop_front();
 
-    pthread_rwlock_wrlock(&iFuseConn->lock);
+        if(std::find(removeList.begin(), removeList.end(), iFuseConn) != removeList.end()) {
+            continue;
+        }
 
-    status = iFuseRodsClientObjStat(iFuseConn->conn, &dataObjInp, &rodsObjStatOut);
-    if (status < 0) {
-        iFuseLibLogError(LOG_ERROR, status, "_keepAlive: iFuseRodsClientObjStat of %s error, status = %d",
-            iRodsPath, status);
-        pthread_rwlock_unlock(&iFuseConn->lock);
-        return;
+        if(iFuseConn->type == IFUSE_CONN_TYPE_FOR_SHORTOP) {
+            g_FreeShortopConn.push_back(iFuseConn);
+        } else {
+            g_FreeConn.push_back(iFuseConn);
+        }
     }
 
-    if(rodsObjStatOut != NULL) {
-        freeRodsObjStat(rodsObjStatOut);
+    g_KeepAliveRunning = false;
+
+    pthread_rwlock_unlock(&g_ConnectedConnLock);
+
+    // disconnect without holding the table lock
+    while(!removeList.empty()) {
+        iFuseConn = removeList.front();
+        removeList.pop_front();
+
+        iFuseLibLog(LOG_DEBUG, "_keepAliveTask: release broken connection %lu", iFuseConn->connId);
+        _freeConn(iFuseConn);
     }
 
-    // update last act time
-    iFuseConn->lastActTime = iFuseLibGetCurrentTime();
+    _freeConnKeepAlive(iFuseConnKeepAlive);
+    return 0;
+}
 
-    pthread_rwlock_unlock(&iFuseConn->lock);
+/*
+ * Wait for the last keep-alive task
+ * free connections it took are not in the table until it completes
+ */
+static void _joinKeepAliveTask() {
+    if(g_KeepAliveRequest != NULL) {
+        iFuseEngineWait(g_KeepAliveRequest);
+        iFuseEngineRelease(g_KeepAliveRequest);
+        g_KeepAliveRequest = NULL;
+    }
 }
 
 static void _connChecker() {
@@ -268,7 +1381,12 @@ static void _connChecker() {
     std::list<iFuseConn_t*>::iterator it_conn;
     std::map<unsigned long, iFuseConn_t*>::iterator it_connmap;
     iFuseConn_t *iFuseConn;
+    iFuseConnKeepAlive_t *iFuseConnKeepAlive = NULL;
     time_t current;
+    unsigned long long lockStart;
+    unsigned long long lockHold;
+    int status;
+    int excess;
     int i;
     
     //iFuseLibLog(LOG_DEBUG, "_connChecker is called");
@@ -277,47 +1395,104 @@ static void _connChecker() {
 
     if(iFuseLibDiffTimeSec(current, g_LastConnCheck) > g_ConnCheckIntervalSec) {
         //iFuseLibLog(LOG_DEBUG, "_connChecker: sending keep-alive requests");
-        pthread_rwlock_rdlock(&g_ConnectedConnLock);
 
-        for(i=0;i<g_MaxConnNum;i++) {
-            if(g_InUseConn[i] != NULL) {
-                if(iFuseLibDiffTimeSec(current, g_InUseConn[i]->lastActTime) >= g_ConnKeepAliveSec) {
-                    _keepAlive(g_InUseConn[i]);
+        // take a snapshot of connections to send keep-alive requests
+        // in-use connections are pinned by increasing reference count,
+        // free connections are taken out of free lists while sending requests
+        lockStart = iFuseLibGetMonotonicTimeUSec();
+        pthread_rwlock_wrlock(&g_ConnectedConnLock);
+
+        // the previous keep-alive task is still sending requests
+        if(!g_KeepAliveRunning) {
+            status = _newConnKeepAlive(&iFuseConnKeepAlive);
+        }
+
+        if(iFuseConnKeepAlive != NULL) {
+            for(i=0;i<g_MaxConnNum;i++) {
+                if(_needKeepAlive(g_InUseConn[i], current)) {
+                    g_InUseConn[i]->inuseCnt++;
+                    iFuseConnKeepAlive->inuseConns->push_back(g_InUseConn[i]);
                 }
             }
-        }
 
-        if(g_InUseShortopConn != NULL) {
-            if(iFuseLibDiffTimeSec(current, g_InUseShortopConn->lastActTime) >= g_ConnKeepAliveSec) {
-                _keepAlive(g_InUseShortopConn);
+            for(i=0;i<g_MaxShortopConnNum;i++) {
+                if(_needKeepAlive(g_InUseShortopConn[i], current)) {
+                    g_InUseShortopConn[i]->inuseCnt++;
+                    iFuseConnKeepAlive->inuseConns->push_back(g_InUseShortopConn[i]);
+                }
             }
-        }
 
-        for(it_connmap=g_InUseOnetimeuseConn.begin();it_connmap!=g_InUseOnetimeuseConn.end();it_connmap++) {
-            iFuseConn = it_connmap->second;
+            for(it_connmap=g_InUseOnetimeuseConn.begin();it_connmap!=g_InUseOnetimeuseConn.end();it_connmap++) {
+                iFuseConn = it_connmap->second;
 
-            if(iFuseLibDiffTimeSec(current, iFuseConn->lastActTime) >= g_ConnKeepAliveSec) {
-                _keepAlive(iFuseConn);
+                if(_needKeepAlive(iFuseConn, current)) {
+                    iFuseConn->inuseCnt++;
+                    iFuseConnKeepAlive->inuseConns->push_back(iFuseConn);
+                }
             }
-        }
-        
-        for(it_conn=g_FreeConn.begin();it_conn!=g_FreeConn.end();it_conn++) {
-            iFuseConn = *it_conn;
 
-            if(iFuseLibDiffTimeSec(current, iFuseConn->lastActTime) >= g_ConnKeepAliveSec) {
-                _keepAlive(iFuseConn);
+            for(it_conn=g_FreeConn.begin();it_conn!=g_FreeConn.end();it_conn++) {
+                iFuseConn = *it_conn;
+
+                if(_needKeepAlive(iFuseConn, current)) {
+                    iFuseConnKeepAlive->freeConns->push_back(iFuseConn);
+                }
             }
-        }
-        
-        if(g_FreeShortopConn != NULL) {
-            if(iFuseLibDiffTimeSec(current, g_FreeShortopConn->lastActTime) >= g_ConnKeepAliveSec) {
-                _keepAlive(g_FreeShortopConn);
+
+            for(it_conn=g_FreeShortopConn.begin();it_conn!=g_FreeShortopConn.end();it_conn++) {
+                iFuseConn = *it_conn;
+
+                if(_needKeepAlive(iFuseConn, current)) {
+                    iFuseConnKeepAlive->freeConns->push_back(iFuseConn);
+                }
+            }
+
+            for(it_conn=iFuseConnKeepAlive->freeConns->begin();it_conn!=iFuseConnKeepAlive->freeConns->end();it_conn++) {
+                iFuseConn = *it_conn;
+
+                if(iFuseConn->type == IFUSE_CONN_TYPE_FOR_SHORTOP) {
+                    g_FreeShortopConn.remove(iFuseConn);
+                } else {
+                    g_FreeConn.remove(iFuseConn);
+                }
+            }
+
+            if(iFuseConnKeepAlive->inuseConns->empty() && iFuseConnKeepAlive->freeConns->empty()) {
+                _freeConnKeepAlive(iFuseConnKeepAlive);
+                iFuseConnKeepAlive = NULL;
+            } else {
+                g_KeepAliveRunning = true;
             }
         }
-        
+
         pthread_rwlock_unlock(&g_ConnectedConnLock);
+        lockHold = iFuseLibGetMonotonicTimeUSec() - lockStart;
+
+        // send keep-alive requests in background, not to hold up timer handlers
+        if(iFuseConnKeepAlive != NULL) {
+            // the previous one has completed
+            _joinKeepAliveTask();
+
+            status = iFuseEngineSubmit(_keepAliveTask, (void*)iFuseConnKeepAlive, &g_KeepAliveRequest);
+            if(status < 0) {
+                iFuseLibLogError(LOG_ERROR, status, "_connChecker: failed to submit a keep-alive task, status = %d", status);
+                _keepAliveTask((void*)iFuseConnKeepAlive);
+            }
+        }
 
+        lockStart = iFuseLibGetMonotonicTimeUSec();
         pthread_rwlock_wrlock(&g_ConnectedConnLock);
+
+        // release free connections exceeding the pool size, least recently used first
+        excess = _adjustPoolSize();
+        for(i=0;i<excess;i++) {
+            iFuseConn = g_FreeConn.back();
+            g_FreeConn.pop_back();
+
+            iFuseLibLog(LOG_DEBUG, "_connChecker: release excess connection %lu", iFuseConn->connId);
+            removeList.push_back(iFuseConn);
+        }
+
         // iterate free conn list to check timedout connections
         for(it_conn=g_FreeConn.begin();it_conn!=g_FreeConn.end();it_conn++) {
             iFuseConn = *it_conn;
@@ -328,22 +1503,41 @@ static void _connChecker() {
             }
         }
 
-        // iterate remove list
-        while(!removeList.empty()) {
-            iFuseConn = removeList.front();
-            removeList.pop_front();
-            g_FreeConn.remove(iFuseConn);
-            _freeConn(iFuseConn);
+        for(it_conn=g_FreeShortopConn.begin();it_conn!=g_FreeShortopConn.end();it_conn++) {
+            iFuseConn = *it_conn;
+
+            if(iFuseLibDiffTimeSec(current, iFuseConn->lastUseTime) >= g_ConnTimeoutSec) {
+                iFuseLibLog(LOG_DEBUG, "_connChecker: release idle short-op connection %lu", iFuseConn->connId);
+                removeList.push_back(iFuseConn);
+            }
         }
 
-        if(g_FreeShortopConn != NULL) {
-            if(iFuseLibDiffTimeSec(current, g_FreeShortopConn->lastUseTime) >= g_ConnTimeoutSec) {
-                _freeConn(g_FreeShortopConn);
-                g_FreeShortopConn = NULL;
+        for(it_conn=removeList.begin();it_conn!=removeList.end();it_conn++) {
+            iFuseConn = *it_conn;
+
+            // connections removed already are not in the lists
+            if(iFuseConn->type == IFUSE_CONN_TYPE_FOR_SHORTOP) {
+                g_FreeShortopConn.remove(iFuseConn);
+            } else {
+                g_FreeConn.remove(iFuseConn);
             }
         }
 
+        lockHold += iFuseLibGetMonotonicTimeUSec() - lockStart;
+
+        g_KeepAliveLockHoldUSec = lockHold;
+        if(lockHold > g_KeepAliveLockHoldMaxUSec) {
+            g_KeepAliveLockHoldMaxUSec = lockHold;
+        }
+
         pthread_rwlock_unlock(&g_ConnectedConnLock);
+
+        // disconnect without holding the table lock
+        while(!removeList.empty()) {
+            iFuseConn = removeList.front();
+            removeList.pop_front();
+            _freeConn(iFuseConn);
+        }
         
         g_LastConnCheck = iFuseLibGetCurrentTime();
     }
@@ -408,6 +1602,60 @@ void iFuseConnInit() {
         g_MaxConnNum = iFuseLibGetOption()->maxConn;
     }
 
+    g_TargetConnNum = g_MaxConnNum;
+
+    if(iFuseLibGetOption()->connWaitTargetMSec > 0) {
+        // adaptive pool sizing
+        g_ConnWaitTargetMSec = iFuseLibGetOption()->connWaitTargetMSec;
+
+        if(iFuseLibGetOption()->minConn > 0) {
+            g_MinConnNum = iFuseLibGetOption()->minConn;
+        }
+
+        if(g_MinConnNum > g_MaxConnNum) {
+            g_MinConnNum = g_MaxConnNum;
+        }
+
+        g_TargetConnNum = g_MinConnNum;
+    }
+
+    g_LastPoolAdjust = iFuseLibGetMonotonicTimeUSec();
+
+    if(iFuseLibGetOption()->maxShortopConn > 0) {
+        g_MaxShortopConnNum = iFuseLibGetOption()->maxShortopConn;
+    }
+
+    // background requests take at most half of file-io connections by default
+    g_MaxBackgroundConnNum = g_MaxConnNum / 2;
+    if(iFuseLibGetOption()->maxBackgroundConn > 0) {
+        g_MaxBackgroundConnNum = iFuseLibGetOption()->maxBackgroundConn;
+    }
+
+    if(g_MaxBackgroundConnNum > g_MaxConnNum) {
+        g_MaxBackgroundConnNum = g_MaxConnNum;
+    } else if(g_MaxBackgroundConnNum < 1) {
+        g_MaxBackgroundConnNum = 1;
+    }
+
+    if(iFuseLibGetOption()->connBreakerFailNum >= 0) {
+        g_BreakerMaxFailNum = iFuseLibGetOption()->connBreakerFailNum;
+    }
+
+    if(iFuseLibGetOption()->connBreakerCoolDownSec > 0) {
+        g_BreakerCoolDownSec = iFuseLibGetOption()->connBreakerCoolDownSec;
+    }
+
+    if(iFuseLibGetOption()->connWarmUpNum > 0) {
+        g_ConnWarmUpNum = iFuseLibGetOption()->connWarmUpNum;
+        if(g_ConnWarmUpNum > g_MaxConnNum) {
+            g_ConnWarmUpNum = g_MaxConnNum;
+        }
+    }
+
+    if(iFuseLibGetOption()->connWaitTimeoutMSec > 0) {
+        g_ConnWaitTimeoutMSec = iFuseLibGetOption()->connWaitTimeoutMSec;
+    }
+
     if(iFuseLibGetOption()->connTimeoutSec > 0) {
         g_ConnTimeoutSec = iFuseLibGetOption()->connTimeoutSec;
     }
@@ -429,11 +1677,26 @@ void iFuseConnInit() {
         g_InUseConn[i] = NULL;
     }
 
+    g_InUseShortopConn = (iFuseConn_t**)calloc(g_MaxShortopConnNum, sizeof(iFuseConn_t*));
+
+    for(i=0;i<g_MaxShortopConnNum;i++) {
+        g_InUseShortopConn[i] = NULL;
+    }
+
+    g_NextShortopConnIndex = 0;
+
+    pthread_mutex_init(&g_ConnWaitMutex, NULL);
+    pthread_mutex_init(&g_BreakerMutex, NULL);
+
+    pthread_mutex_init(&g_EndpointMutex, NULL);
+    _initEndpoints(iFuseLibGetOption()->hosts);
+
     g_ConnIDGen = 0;
     
     pthread_rwlockattr_init(&g_IDGenLockAttr);
     pthread_rwlock_init(&g_IDGenLock, &g_IDGenLockAttr);
 
+    iFuseRodsClientSetResultHandler(_rodsClientResultHandler);
     iFuseLibSetTimerTickHandler(_connChecker);
 }
 
@@ -442,6 +1705,10 @@ void iFuseConnInit() {
  */
 void iFuseConnDestroy() {
     iFuseLibUnsetTimerTickHandler(_connChecker);
+    iFuseRodsClientSetResultHandler(NULL);
+
+    _joinWarmUpTasks();
+    _joinKeepAliveTask();
     
     g_ConnIDGen = 0;
 
@@ -451,11 +1718,69 @@ void iFuseConnDestroy() {
     pthread_rwlockattr_destroy(&g_ConnectedConnLockAttr);
 
     free(g_InUseConn);
+    free(g_InUseShortopConn);
+
+    pthread_mutex_destroy(&g_ConnWaitMutex);
+    pthread_mutex_destroy(&g_BreakerMutex);
+
+    pthread_mutex_destroy(&g_EndpointMutex);
     
     pthread_rwlock_destroy(&g_IDGenLock);
     pthread_rwlockattr_destroy(&g_IDGenLockAttr);
 }
 
+/*
+ * Establish connections in background in parallel
+ * file-io connections are warmed up only when connections are reused
+ */
+void iFuseConnWarmUp() {
+    int shortopConnNum = 0;
+    int fileioConnNum = 0;
+    int i;
+    int status;
+
+    if(g_ConnWarmUpNum <= 0 || g_WarmUpRequests != NULL) {
+        return;
+    }
+
+    pthread_rwlock_rdlock(&g_ConnectedConnLock);
+
+    shortopConnNum = g_MaxShortopConnNum - g_FreeShortopConn.size();
+    for(i=0;i<g_MaxShortopConnNum;i++) {
+        if(g_InUseShortopConn[i] != NULL) {
+            shortopConnNum--;
+        }
+    }
+
+    pthread_rwlock_unlock(&g_ConnectedConnLock);
+
+    if(shortopConnNum < 0) {
+        shortopConnNum = 0;
+    }
+
+    if(iFuseLibGetOption()->connReuse) {
+        fileioConnNum = g_ConnWarmUpNum;
+    }
+
+    iFuseLibLog(LOG_DEBUG, "iFuseConnWarmUp: establishing %d short-op, %d file-io connections", shortopConnNum, fileioConnNum);
+
+    g_WarmUpRequests = (iFuseEngineRequest_t**)calloc(shortopConnNum + fileioConnNum, sizeof(iFuseEngineRequest_t*));
+    if(g_WarmUpRequests == NULL) {
+        return;
+    }
+
+    for(i=0;i<shortopConnNum + fileioConnNum;i++) {
+        long connType = (i < shortopConnNum) ? IFUSE_CONN_TYPE_FOR_SHORTOP : IFUSE_CONN_TYPE_FOR_FILE_IO;
+
+        status = iFuseEngineSubmit(_warmUpTask, (void*)connType, &g_WarmUpRequests[g_WarmUpRequestNum]);
+        if(status < 0) {
+            iFuseLibLogError(LOG_ERROR, status, "iFuseConnWarmUp: iFuseEngineSubmit error");
+            break;
+        }
+        g_WarmUpRequestNum++;
+    }
+}
+
 /*
  * Report status of connections
  */
@@ -463,6 +1788,7 @@ void iFuseConnReport(iFuseFsConnReport_t *report) {
     std::list<iFuseConn_t*>::iterator it_conn;
     std::map<unsigned long, iFuseConn_t*>::iterator it_connmap;
     iFuseConn_t *iFuseConn;
+    iFuseEngineReport_t engineReport;
     int i;
     time_t current;
     
@@ -474,15 +1800,23 @@ void iFuseConnReport(iFuseFsConnReport_t *report) {
     
     current = iFuseLibGetCurrentTime();
 
-    if(g_InUseShortopConn != NULL) {
-        iFuseLibLog(LOG_DEBUG, "iFuseConnReport: short-op connection (%lu) is in use, last act = %d sec ago, last use = %d sec ago", g_InUseShortopConn->connId, (int)iFuseLibDiffTimeSec(current, g_InUseShortopConn->lastActTime), (int)iFuseLibDiffTimeSec(current, g_InUseShortopConn->lastUseTime));
-        report->inuseShortOpConn++;
+    report->maxShortopConn = g_MaxShortopConnNum;
+
+    for(i=0;i<g_MaxShortopConnNum;i++) {
+        if(g_InUseShortopConn[i] != NULL) {
+            iFuseLibLog(LOG_DEBUG, "iFuseConnReport: short-op connection (%lu) is in use by %d, last act = %d sec ago, last use = %d sec ago", g_InUseShortopConn[i]->connId, g_InUseShortopConn[i]->inuseCnt, (int)iFuseLibDiffTimeSec(current, g_InUseShortopConn[i]->lastActTime), (int)iFuseLibDiffTimeSec(current, g_InUseShortopConn[i]->lastUseTime));
+            report->inuseShortOpConn++;
+            report->shortopConnUsers += g_InUseShortopConn[i]->inuseCnt;
+        }
     }
     
     for(i=0;i<g_MaxConnNum;i++) {
         if(g_InUseConn[i] != NULL) {
-            iFuseLibLog(LOG_DEBUG, "iFuseConnReport: general connection (%lu) is in use, last act = %d sec ago, last use = %d sec ago", g_InUseConn[i]->connId, (int)iFuseLibDiffTimeSec(current, g_InUseConn[i]->lastActTime), (int)iFuseLibDiffTimeSec(current, g_InUseConn[i]->lastUseTime));
+            iFuseLibLog(LOG_DEBUG, "iFuseConnReport: general connection (%lu) to %s is in use, last act = %d sec ago, last use = %d sec ago", g_InUseConn[i]->connId, g_InUseConn[i]->host, (int)iFuseLibDiffTimeSec(current, g_InUseConn[i]->lastActTime), (int)iFuseLibDiffTimeSec(current, g_InUseConn[i]->lastUseTime));
             report->inuseConn++;
+            if(g_InUseConn[i]->direct) {
+                report->directConn++;
+            }
         }
     }
 
@@ -493,31 +1827,97 @@ void iFuseConnReport(iFuseFsConnReport_t *report) {
         report->inuseOnetimeuseConn++;
     }
     
-    if(g_FreeShortopConn != NULL) {
-        iFuseLibLog(LOG_DEBUG, "iFuseConnReport: short-op connection (%lu) is free, last act = %d sec ago, last use = %d sec ago", g_FreeShortopConn->connId, (int)iFuseLibDiffTimeSec(current, g_FreeShortopConn->lastActTime), (int)iFuseLibDiffTimeSec(current, g_FreeShortopConn->lastUseTime));
-        
+    for(it_conn=g_FreeShortopConn.begin();it_conn!=g_FreeShortopConn.end();it_conn++) {
+        iFuseConn = *it_conn;
+
+        iFuseLibLog(LOG_DEBUG, "iFuseConnReport: short-op connection (%lu) is free, last act = %d sec ago, last use = %d sec ago", iFuseConn->connId, (int)iFuseLibDiffTimeSec(current, iFuseConn->lastActTime), (int)iFuseLibDiffTimeSec(current, iFuseConn->lastUseTime));
         report->freeShortopConn++;
     }
     
     for(it_conn=g_FreeConn.begin();it_conn!=g_FreeConn.end();it_conn++) {
         iFuseConn = *it_conn;
         
-        iFuseLibLog(LOG_DEBUG, "iFuseConnReport: connection (%lu) is free, last act = %d sec ago, last use = %d sec ago", iFuseConn->connId, (int)iFuseLibDiffTimeSec(current, iFuseConn->lastActTime), (int)iFuseLibDiffTimeSec(current, iFuseConn->lastUseTime));
+        iFuseLibLog(LOG_DEBUG, "iFuseConnReport: connection (%lu) to %s is free, last act = %d sec ago, last use = %d sec ago", iFuseConn->connId, iFuseConn->host, (int)iFuseLibDiffTimeSec(current, iFuseConn->lastActTime), (int)iFuseLibDiffTimeSec(current, iFuseConn->lastUseTime));
         report->freeConn++;
+        if(iFuseConn->direct) {
+            report->directConn++;
+        }
+    }
+
+    report->minConn = g_MinConnNum;
+    report->maxConn = g_MaxConnNum;
+    report->targetConn = g_TargetConnNum;
+    report->connGrowCount = g_ConnGrowCount;
+    report->connShrinkCount = g_ConnShrinkCount;
+    report->connQueueDelayAvgUSec = g_LastQueueDelayAvgUSec;
+    report->connUtilization = g_LastConnUtilization;
+    report->backgroundConn = _countBackgroundConn();
+    report->maxBackgroundConn = g_MaxBackgroundConnNum;
+
+    pthread_mutex_lock(&g_BreakerMutex);
+
+    report->breakerState = g_BreakerState;
+    report->breakerOpenCount = g_BreakerOpenCount;
+    report->breakerFastFailCount = g_BreakerFastFailCount;
+
+    pthread_mutex_unlock(&g_BreakerMutex);
+
+    report->keepAliveCount = g_KeepAliveCount;
+    report->keepAliveFailCount = g_KeepAliveFailCount;
+    report->keepAliveSkipCount = g_KeepAliveSkipCount;
+    report->keepAliveLockHoldUSec = g_KeepAliveLockHoldUSec;
+    report->keepAliveLockHoldMaxUSec = g_KeepAliveLockHoldMaxUSec;
+
+    pthread_mutex_lock(&g_ConnWaitMutex);
+
+    report->connWaiters = g_ConnWaiters.size();
+    report->connWaitCount = g_ConnWaitCount;
+    report->connWaitTimeoutCount = g_ConnWaitTimeoutCount;
+    if(g_ConnWaitCount > 0) {
+        report->connWaitAvgMSec = g_ConnWaitTotalMSec / g_ConnWaitCount;
+    }
+    report->connWaitMaxMSec = g_ConnWaitMaxMSec;
+
+    pthread_mutex_unlock(&g_ConnWaitMutex);
+
+    pthread_mutex_lock(&g_EndpointMutex);
+
+    report->endpoints = g_EndpointNum;
+    for(i=0;i<g_EndpointNum;i++) {
+        iFuseLibLog(LOG_DEBUG, "iFuseConnReport: endpoint %s:%d has %d connections, latency = %llu usec, failed = %d", g_Endpoints[i].host, g_Endpoints[i].port, g_Endpoints[i].connNum, g_Endpoints[i].latencyUSec, g_Endpoints[i].failCount);
+        if(g_Endpoints[i].ejectedUntil > current) {
+            report->ejectedEndpoints++;
+        }
     }
+
+    pthread_mutex_unlock(&g_EndpointMutex);
     
     pthread_rwlock_unlock(&g_ConnectedConnLock);
+
+    // background requests waiting for connections
+    iFuseEngineReport(&engineReport);
+
+    report->engineWorkers = engineReport.workers;
+    report->engineQueued = engineReport.queued;
+    report->engineRunning = engineReport.running;
+    report->engineMaxQueued = engineReport.maxQueued;
+    report->engineInlineCount = engineReport.inlineCount;
 }
 
 /*
- * Get connection and increase reference count
+ * Pick or create a connection and increase reference count
  */
-int iFuseConnGetAndUse(iFuseConn_t **iFuseConn, int connType) {
+static int _takeConn(iFuseConn_t **iFuseConn, int connType, const char *host, int connClass) {
     int status;
     iFuseConn_t *tmpIFuseConn;
     int i;
+    int j;
     int targetIndex;
     int inUseCount;
+    bool background;
+    bool sameHost;
+    bool sameClass;
+    bool tmpSameClass = false;
 
     assert(iFuseConn != NULL);
 
@@ -526,72 +1926,106 @@ int iFuseConnGetAndUse(iFuseConn_t **iFuseConn, int connType) {
     pthread_rwlock_wrlock(&g_ConnectedConnLock);
 
     if(connType == IFUSE_CONN_TYPE_FOR_SHORTOP) {
-        if(g_InUseShortopConn != NULL) {
-            pthread_rwlock_wrlock(&g_InUseShortopConn->lock);
-            g_InUseShortopConn->lastUseTime = iFuseLibGetCurrentTime();
-            g_InUseShortopConn->inuseCnt++;
-            pthread_rwlock_unlock(&g_InUseShortopConn->lock);
-
-            *iFuseConn = g_InUseShortopConn;
-            pthread_rwlock_unlock(&g_ConnectedConnLock);
-            return 0;
+        // Decide whether creating a new connection or reuse one of existing connections
+        targetIndex = -1;
+        for(i=0;i<g_MaxShortopConnNum;i++) {
+            if(g_InUseShortopConn[i] == NULL) {
+                targetIndex = i;
+                break;
+            }
         }
 
-        // not in inuseshortopconn
-        // check free conn
-        if (g_FreeShortopConn != NULL) {
-            // reuse existing connection
-            tmpIFuseConn = g_FreeShortopConn;
-            g_FreeShortopConn = NULL;
+        if(targetIndex >= 0) {
+            if (!g_FreeShortopConn.empty()) {
+                // reuse existing connection
+                tmpIFuseConn = g_FreeShortopConn.front();
+                tmpIFuseConn->lastUseTime = iFuseLibGetCurrentTime();
+                tmpIFuseConn->inuseCnt++;
+
+                *iFuseConn = tmpIFuseConn;
+
+                g_InUseShortopConn[targetIndex] = tmpIFuseConn;
+                g_FreeShortopConn.remove(tmpIFuseConn);
+
+                pthread_rwlock_unlock(&g_ConnectedConnLock);
+                return 0;
+            }
+
+            // create new
+            status = _newConn(&tmpIFuseConn, IFUSE_CONN_TYPE_FOR_SHORTOP, NULL);
+            if (status < 0) {
+                pthread_rwlock_unlock(&g_ConnectedConnLock);
+                return status;
+            }
 
-            pthread_rwlock_wrlock(&tmpIFuseConn->lock);
             tmpIFuseConn->lastUseTime = iFuseLibGetCurrentTime();
             tmpIFuseConn->inuseCnt++;
-            pthread_rwlock_unlock(&tmpIFuseConn->lock);
-
-            *iFuseConn = tmpIFuseConn;
 
-            g_InUseShortopConn = tmpIFuseConn;
+            g_InUseShortopConn[targetIndex] = tmpIFuseConn;
 
             pthread_rwlock_unlock(&g_ConnectedConnLock);
-            return 0;
-        }
+        } else {
+            // share the least loaded connection
+            // scan starts from the next of the last pick to break ties in round-robin
+            inUseCount = -1;
+            targetIndex = -1;
+            for(j=0;j<g_MaxShortopConnNum;j++) {
+                i = (g_NextShortopConnIndex + j) % g_MaxShortopConnNum;
+                if(g_InUseShortopConn[i] != NULL) {
+                    if(inUseCount < 0 || inUseCount > g_InUseShortopConn[i]->inuseCnt) {
+                        inUseCount = g_InUseShortopConn[i]->inuseCnt;
+                        targetIndex = i;
+                    }
+                }
+            }
 
-        // need to create new
-        status = _newConn(&tmpIFuseConn);
-        if (status < 0) {
-            _freeConn(tmpIFuseConn);
-            pthread_rwlock_unlock(&g_ConnectedConnLock);
-            return status;
-        }
+            assert(targetIndex >= 0);
 
-        tmpIFuseConn->type = IFUSE_CONN_TYPE_FOR_SHORTOP;
-        tmpIFuseConn->lastUseTime = iFuseLibGetCurrentTime();
-        tmpIFuseConn->inuseCnt++;
+            g_NextShortopConnIndex = (targetIndex + 1) % g_MaxShortopConnNum;
 
-        g_InUseShortopConn = tmpIFuseConn;
-        *iFuseConn = tmpIFuseConn;
+            tmpIFuseConn = g_InUseShortopConn[targetIndex];
+            tmpIFuseConn->lastUseTime = iFuseLibGetCurrentTime();
+            tmpIFuseConn->inuseCnt++;
 
-        pthread_rwlock_unlock(&g_ConnectedConnLock);
-        return 0;
+            pthread_rwlock_unlock(&g_ConnectedConnLock);
+
+            // the connection may be being established by others
+            status = _waitConn(tmpIFuseConn);
+            if (status < 0) {
+                iFuseConnUnuse(tmpIFuseConn);
+                return status;
+            }
+
+            *iFuseConn = tmpIFuseConn;
+            return 0;
+        }
     } else if(connType == IFUSE_CONN_TYPE_FOR_FILE_IO) {
         // Decide whether creating a new connection or reuse one of existing connections
-        targetIndex = -1;
-        for(i=0;i<g_MaxConnNum;i++) {
-            if(g_InUseConn[i] == NULL) {
-                targetIndex = i;
-                break;
+        targetIndex = _findEmptyFileIOSlot(connClass);
+
+        // background requests over the limit do not wait, not to take a slot
+        background = (connClass == IFUSE_CONN_CLASS_BACKGROUND);
+        if(targetIndex < 0 && g_ConnWaitTimeoutMSec > 0 && (!background || _canTakeBackgroundConn())) {
+            // wait for a connection released by others
+
+            tmpIFuseConn = _waitFileIOConn(connClass, host);
+            if(tmpIFuseConn != NULL) {
+                *iFuseConn = tmpIFuseConn;
+                return 0;
             }
+
+            // timed out or a slot became free
+            pthread_rwlock_wrlock(&g_ConnectedConnLock);
+            targetIndex = _findEmptyFileIOSlot(connClass);
         }
 
         if(targetIndex >= 0) {
-            if (!g_FreeConn.empty()) {
+            tmpIFuseConn = _findFreeFileIOConn(host);
+            if (tmpIFuseConn != NULL) {
                 // reuse existing connection
-                tmpIFuseConn = g_FreeConn.front();
-                pthread_rwlock_wrlock(&tmpIFuseConn->lock);
                 tmpIFuseConn->lastUseTime = iFuseLibGetCurrentTime();
                 tmpIFuseConn->inuseCnt++;
-                pthread_rwlock_unlock(&tmpIFuseConn->lock);
+                tmpIFuseConn->connClass = connClass;
 
                 *iFuseConn = tmpIFuseConn;
 
@@ -600,141 +2034,210 @@ int iFuseConnGetAndUse(iFuseConn_t **iFuseConn, int connType) {
 
                 pthread_rwlock_unlock(&g_ConnectedConnLock);
                 return 0;
-            } else {
-                // create new
-                status = _newConn(&tmpIFuseConn);
-                if (status < 0) {
-                    _freeConn(tmpIFuseConn);
-                    pthread_rwlock_unlock(&g_ConnectedConnLock);
-                    return status;
-                }
-
-                tmpIFuseConn->type = IFUSE_CONN_TYPE_FOR_FILE_IO;
-                tmpIFuseConn->lastUseTime = iFuseLibGetCurrentTime();
-                tmpIFuseConn->inuseCnt++;
-
-                g_InUseConn[targetIndex] = tmpIFuseConn;
-                *iFuseConn = tmpIFuseConn;
+            }
 
+            // create new
+            status = _newConn(&tmpIFuseConn, IFUSE_CONN_TYPE_FOR_FILE_IO, host);
+            if (status < 0) {
                 pthread_rwlock_unlock(&g_ConnectedConnLock);
-                return 0;
+                return status;
             }
+
+            tmpIFuseConn->lastUseTime = iFuseLibGetCurrentTime();
+            tmpIFuseConn->inuseCnt++;
+            tmpIFuseConn->connClass = connClass;
+
+            g_InUseConn[targetIndex] = tmpIFuseConn;
+
+            pthread_rwlock_unlock(&g_ConnectedConnLock);
         } else {
             // reuse existing connection
+            // prefer the least used one to the same host,
+            // background requests share with background requests and foreground with foreground
             inUseCount = -1;
             tmpIFuseConn = NULL;
             for(i=0;i<g_MaxConnNum;i++) {
                 if(g_InUseConn[i] != NULL) {
-                    if(inUseCount < 0) {
+                    sameHost = _isConnToHost(g_InUseConn[i], host);
+                    sameClass = (background == (g_InUseConn[i]->connClass == IFUSE_CONN_CLASS_BACKGROUND));
+                    if(tmpIFuseConn == NULL ||
+                        (sameHost && !_isConnToHost(tmpIFuseConn, host)) ||
+                        (sameHost == _isConnToHost(tmpIFuseConn, host) && sameClass && !tmpSameClass) ||
+                        (sameHost == _isConnToHost(tmpIFuseConn, host) && sameClass == tmpSameClass && inUseCount > g_InUseConn[i]->inuseCnt)) {
                         inUseCount = g_InUseConn[i]->inuseCnt;
                         tmpIFuseConn = g_InUseConn[i];
-                    } else {
-                        if(inUseCount > g_InUseConn[i]->inuseCnt) {
-                            inUseCount = g_InUseConn[i]->inuseCnt;
-                            tmpIFuseConn = g_InUseConn[i];
-                        }
+                        tmpSameClass = sameClass;
                     }
                 }
             }
 
             assert(tmpIFuseConn != NULL);
 
-            pthread_rwlock_wrlock(&tmpIFuseConn->lock);
             tmpIFuseConn->lastUseTime = iFuseLibGetCurrentTime();
             tmpIFuseConn->inuseCnt++;
-            pthread_rwlock_unlock(&tmpIFuseConn->lock);
-
-            *iFuseConn = tmpIFuseConn;
 
             pthread_rwlock_unlock(&g_ConnectedConnLock);
+
+            // the connection may be being established by others
+            status = _waitConn(tmpIFuseConn);
+            if (status < 0) {
+                iFuseConnUnuse(tmpIFuseConn);
+                return status;
+            }
+
+            *iFuseConn = tmpIFuseConn;
             return 0;
         }
     } else if(connType == IFUSE_CONN_TYPE_FOR_ONETIMEUSE) {
         // create new
-        status = _newConn(&tmpIFuseConn);
+        status = _newConn(&tmpIFuseConn, IFUSE_CONN_TYPE_FOR_ONETIMEUSE, host);
         if (status < 0) {
-            _freeConn(tmpIFuseConn);
             pthread_rwlock_unlock(&g_ConnectedConnLock);
             return status;
         }
 
-        tmpIFuseConn->type = IFUSE_CONN_TYPE_FOR_ONETIMEUSE;
         tmpIFuseConn->lastUseTime = iFuseLibGetCurrentTime();
         tmpIFuseConn->inuseCnt++;
 
         g_InUseOnetimeuseConn[tmpIFuseConn->connId] = tmpIFuseConn;
-        *iFuseConn = tmpIFuseConn;
 
         pthread_rwlock_unlock(&g_ConnectedConnLock);
-        return 0;
     } else {
         assert(0);
+        pthread_rwlock_unlock(&g_ConnectedConnLock);
+        return -EINVAL;
+    }
+
+    // connect without holding g_ConnectedConnLock
+    status = _establishConn(tmpIFuseConn);
+    if (status < 0) {
+        iFuseConnUnuse(tmpIFuseConn);
+        return status;
     }
-    assert(0);
+
+    *iFuseConn = tmpIFuseConn;
     return 0;
 }
 
+/*
+ * Get connection and increase reference count
+ * connClass decides the order among waiters and the slots background requests take
+ */
+static int _getAndUseConn(iFuseConn_t **iFuseConn, int connType, const char *host, int connClass) {
+    int status;
+
+    assert(iFuseConn != NULL);
+
+    *iFuseConn = NULL;
+
+    if(!_passBreaker()) {
+        // the server is down, fail fast
+        return -EIO;
+    }
+
+    status = _takeConn(iFuseConn, connType, host, connClass);
+    if(status < 0) {
+        _releaseBreakerProbe();
+    }
+
+    return status;
+}
+
+/*
+ * Get connection and increase reference count
+ */
+int iFuseConnGetAndUse(iFuseConn_t **iFuseConn, int connType) {
+    return iFuseConnGetAndUseForHost(iFuseConn, connType, NULL);
+}
+
+/*
+ * Get connection to the given host and increase reference count
+ * host is used for file-io and one-time-use connections only
+ * NULL host means the default iRODS host
+ */
+int iFuseConnGetAndUseForHost(iFuseConn_t **iFuseConn, int connType, const char *host) {
+    return _getAndUseConn(iFuseConn, connType, host, _getConnClass(connType));
+}
+
+/*
+ * Get connection for a metadata operation (e.g., listing a directory)
+ * served before data transfers even if it needs a file-io connection
+ */
+int iFuseConnGetAndUseForMetadata(iFuseConn_t **iFuseConn, int connType) {
+    return _getAndUseConn(iFuseConn, connType, NULL, IFUSE_CONN_CLASS_METADATA);
+}
+
 /*
  * Decrease reference count
  */
 int iFuseConnUnuse(iFuseConn_t *iFuseConn) {
-    int i;
-    std::map<unsigned long, iFuseConn_t*>::iterator it_connmap;
+    _releaseBreakerProbe();
+    return _releaseConn(iFuseConn, true);
+}
 
+/*
+ * Take a broken connection out of the table
+ * it is not given to others anymore, its current users keep it
+ * and it is freed when the last of them calls iFuseConnUnuse
+ */
+void iFuseConnDiscard(iFuseConn_t *iFuseConn) {
     assert(iFuseConn != NULL);
 
     pthread_rwlock_wrlock(&g_ConnectedConnLock);
-    pthread_rwlock_wrlock(&iFuseConn->lock);
 
-    iFuseConn->lastUseTime = iFuseLibGetCurrentTime();
-    iFuseConn->inuseCnt--;
+    if(!iFuseConn->discarded) {
+        iFuseLibLog(LOG_DEBUG, "iFuseConnDiscard: discarding - %lu", iFuseConn->connId);
 
-    assert(iFuseConn->inuseCnt >= 0);
+        _detachConn(iFuseConn);
+        iFuseConn->discarded = true;
+    }
 
-    if(iFuseConn->inuseCnt == 0) {
-        // move to free list
-        if(iFuseConn->type == IFUSE_CONN_TYPE_FOR_SHORTOP) {
-            assert(g_InUseShortopConn == iFuseConn);
-            assert(g_FreeShortopConn == NULL);
+    pthread_rwlock_unlock(&g_ConnectedConnLock);
+}
 
-            g_InUseShortopConn = NULL;
-            g_FreeShortopConn = iFuseConn;
+static void _lockConn(iFuseConn_t *iFuseConn) {
+    unsigned long long start;
 
-            pthread_rwlock_unlock(&iFuseConn->lock);
-            pthread_rwlock_unlock(&g_ConnectedConnLock);
-            return 0;
-        } else if(iFuseConn->type == IFUSE_CONN_TYPE_FOR_FILE_IO) {
-            for(i=0;i<g_MaxConnNum;i++) {
-                if(g_InUseConn[i] == iFuseConn) {
-                    g_InUseConn[i] = NULL;
-                    break;
-                }
-            }
+    start = iFuseLibGetMonotonicTimeUSec();
 
-            g_FreeConn.push_front(iFuseConn);
+    pthread_rwlock_wrlock(&iFuseConn->lock);
 
-            pthread_rwlock_unlock(&iFuseConn->lock);
-            pthread_rwlock_unlock(&g_ConnectedConnLock);
-            return 0;
-        } else if(iFuseConn->type == IFUSE_CONN_TYPE_FOR_ONETIMEUSE) {
-            it_connmap = g_InUseOnetimeuseConn.find(iFuseConn->connId);
-            if(it_connmap != g_InUseOnetimeuseConn.end()) {
-                // has it - remove
-                g_InUseOnetimeuseConn.erase(it_connmap);
-            }
+    iFuseConn->lockedTime = iFuseLibGetMonotonicTimeUSec();
+    if(iFuseConn->type == IFUSE_CONN_TYPE_FOR_FILE_IO) {
+        // time waited for others sharing the connection
+        _addConnQueueDelay(iFuseConn->lockedTime - start);
+    }
 
-            pthread_rwlock_unlock(&iFuseConn->lock);
-            pthread_rwlock_unlock(&g_ConnectedConnLock);
+    iFuseLibLog(LOG_DEBUG, "iFuseConnLock: connection locked - %lu", iFuseConn->connId);
+}
 
-            _freeConn(iFuseConn);
-            return 0;
-        } else {
-            assert(0);
-        }
+/*
+ * Get another connection to retry an idempotent operation timed out
+ * iFuseConn must be locked by caller, it is discarded but the caller keeps
+ * its use and lock until it switches to *retryConn, which is given back locked
+ */
+int iFuseConnRetryTimedOut(iFuseConn_t *iFuseConn, iFuseConn_t **retryConn) {
+    int status;
+    iFuseConn_t *tmpIFuseConn = NULL;
+
+    assert(iFuseConn != NULL);
+    assert(retryConn != NULL);
+
+    iFuseConnDiscard(iFuseConn);
+
+    // direct connections go to the same resource server again
+    status = _getAndUseConn(&tmpIFuseConn, iFuseConn->type, iFuseConn->direct ? iFuseConn->host : NULL, iFuseConn->connClass);
+    if(status < 0) {
+        return status;
     }
 
-    pthread_rwlock_unlock(&iFuseConn->lock);
-    pthread_rwlock_unlock(&g_ConnectedConnLock);
+    iFuseLibLog(LOG_DEBUG, "iFuseConnRetryTimedOut: retry on connection %lu instead of %lu", tmpIFuseConn->connId, iFuseConn->connId);
+
+    // not held back, the caller has been admitted for the connection it gives up
+    iFuseAdmissionEnterRPCNoWait();
+    _lockConn(tmpIFuseConn);
+
+    *retryConn = tmpIFuseConn;
     return 0;
 }
 
@@ -762,13 +2265,26 @@ int iFuseConnReconnect(iFuseConn_t *iFuseConn) {
     int status = 0;
     assert(iFuseConn != NULL);
 
+    if(!_passBreaker()) {
+        // the server is down, fail fast
+        // the broken connection is reconnected by the next user
+        iFuseLibLog(LOG_DEBUG, "iFuseConnReconnect: circuit breaker is open - %lu", iFuseConn->connId);
+        return -EIO;
+    }
+
     pthread_rwlock_wrlock(&iFuseConn->lock);
 
     iFuseLibLog(LOG_DEBUG, "iFuseConnReconnect: disconnecting - %lu", iFuseConn->connId);
     _disconnect(iFuseConn);
 
-    iFuseLibLog(LOG_DEBUG, "iFuseConnReconnect: connecting - %lu", iFuseConn->connId);
+    // the endpoint may have gone, pick again
+    if(!iFuseConn->direct) {
+        _assignEndpoint(iFuseConn);
+    }
+
+    iFuseLibLog(LOG_DEBUG, "iFuseConnReconnect: connecting - %lu to %s:%d", iFuseConn->connId, iFuseConn->host, iFuseConn->port);
     status = _connect(iFuseConn);
+    _setEndpointConnectResult(iFuseConn, status);
     
     iFuseConn->lastActTime = iFuseLibGetCurrentTime();
 
@@ -779,22 +2295,50 @@ int iFuseConnReconnect(iFuseConn_t *iFuseConn) {
 
 /*
  * Lock connection
+ * calls made while locked count as an RPC in flight, which may wait if too many are.
+ * the wait is done before locking, so no one waits with a connection locked
+ * returns -EAGAIN if the wait is over the admission wait, then the connection is not locked
  */
-void iFuseConnLock(iFuseConn_t *iFuseConn) {
+int iFuseConnLock(iFuseConn_t *iFuseConn) {
+    int status = 0;
+
     assert(iFuseConn != NULL);
 
-    pthread_rwlock_wrlock(&iFuseConn->lock);
+    status = iFuseAdmissionEnterRPC();
+    if(status < 0) {
+        iFuseLibLogError(LOG_ERROR, status, "iFuseConnLock: too many requests in flight - %lu", iFuseConn->connId);
+        return status;
+    }
 
-    iFuseLibLog(LOG_DEBUG, "iFuseConnLock: connection locked - %lu", iFuseConn->connId);
+    _lockConn(iFuseConn);
+    return 0;
+}
+
+/*
+ * Lock connection to release server-side resources (close)
+ * the call is counted as an RPC in flight but never held back
+ */
+void iFuseConnLockForRelease(iFuseConn_t *iFuseConn) {
+    assert(iFuseConn != NULL);
+
+    iFuseAdmissionEnterRPCNoWait();
+
+    _lockConn(iFuseConn);
 }
 
 /*
  * Unlock connection
  */
 void iFuseConnUnlock(iFuseConn_t *iFuseConn) {
+    unsigned long long lockHoldUSec;
+
     assert(iFuseConn != NULL);
 
+    lockHoldUSec = iFuseLibGetMonotonicTimeUSec() - iFuseConn->lockedTime;
+    __sync_fetch_and_add(&iFuseConn->busyUSec, lockHoldUSec);
+
     pthread_rwlock_unlock(&iFuseConn->lock);
+    iFuseAdmissionLeaveRPC();
 
     iFuseLibLog(LOG_DEBUG, "iFuseConnUnlock: connection unlocked - %lu", iFuseConn->connId);
 }
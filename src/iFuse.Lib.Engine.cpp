@@ -0,0 +1,560 @@
+/*** Copyright (c), The Regents of the University of California            ***
+ *** For more information please refer to files in the COPYRIGHT directory ***/
+/*** This code is written by Illyoung Choi (iychoi@email.arizona.edu)      ***
+ *** funded by iPlantCollaborative (www.iplantcollaborative.org).          ***/
+#include <stdio.h>
+#include <stdlib.h>
+#include <errno.h>
+#include <time.h>
+#include <assert.h>
+#include <pthread.h>
+#include <string.h>
+#include <list>
+#include "iFuse.Lib.hpp"
+#include "iFuse.Lib.Admission.hpp"
+#include "iFuse.Lib.Engine.hpp"
+#include "iFuse.Lib.Util.hpp"
+
+static pthread_mutex_t g_EngineMutex;
+static pthread_cond_t g_EngineCond;
+
+// foreground requests of FUSE callbacks are taken before background ones
+static std::list<iFuseEngineRequest_t*> g_EngineForegroundQueue;
+static std::list<iFuseEngineRequest_t*> g_EngineQueue;
+
+static pthread_t *g_EngineWorkers = NULL;
+static int g_EngineWorkerNum = 0;
+static bool g_EngineRunning = false;
+
+static int g_EngineMaxWorkerNum = IFUSE_ENGINE_WORKER_NUM;
+
+// set while a worker runs a background request,
+// requests run by waiters take the class of the waiter
+static __thread bool g_EngineBackgroundThread = false;
+
+static int g_EngineRunningNum = 0;
+// background requests leave some workers to foreground ones
+static int g_EngineBackgroundRunningNum = 0;
+static int g_EngineMaxBackgroundRunningNum = 0;
+static int g_EngineMaxQueued = 0;
+static unsigned long long g_EngineInlineCount = 0;
+
+static __thread bool g_EngineWorkerThread = false;
+
+static void _freeRequest(iFuseEngineRequest_t *iFuseEngineRequest) {
+    assert(iFuseEngineRequest != NULL);
+
+    pthread_cond_destroy(&iFuseEngineRequest->cond);
+    free(iFuseEngineRequest);
+}
+
+/*
+ * Run a request taken out of the queue
+ * g_EngineMutex must be held, it is released while the task runs
+ */
+static void _runRequest(iFuseEngineRequest_t *iFuseEngineRequest) {
+    int status = 0;
+    bool last = false;
+    bool background = false;
+
+    assert(iFuseEngineRequest != NULL);
+
+    background = !iFuseEngineRequest->foreground;
+
+    iFuseEngineRequest->state = IFUSE_ENGINE_REQUEST_STATE_RUNNING;
+    g_EngineRunningNum++;
+    if(background) {
+        g_EngineBackgroundRunningNum++;
+    }
+
+    pthread_mutex_unlock(&g_EngineMutex);
+
+    status = iFuseEngineRequest->task(iFuseEngineRequest->param);
+
+    pthread_mutex_lock(&g_EngineMutex);
+
+    g_EngineRunningNum--;
+    if(background) {
+        g_EngineBackgroundRunningNum--;
+        // a worker held back by the background limit may go on
+        pthread_cond_signal(&g_EngineCond);
+    }
+
+    if(iFuseEngineRequest->admittedSize > 0) {
+        iFuseAdmissionReleaseBackground(iFuseEngineRequest->admittedSize);
+        iFuseEngineRequest->admittedSize = 0;
+    }
+
+    iFuseEngineRequest->status = status;
+    iFuseEngineRequest->state = IFUSE_ENGINE_REQUEST_STATE_COMPLETED;
+    pthread_cond_broadcast(&iFuseEngineRequest->cond);
+
+    // reference of the engine
+    iFuseEngineRequest->refCount--;
+    last = (iFuseEngineRequest->refCount == 0);
+
+    if(last) {
+        _freeRequest(iFuseEngineRequest);
+    }
+}
+
+/*
+ * Check if a worker can take a background request
+ * g_EngineMutex must be held
+ */
+static bool _canRunBackground() {
+    return !g_EngineQueue.empty() && g_EngineBackgroundRunningNum < g_EngineMaxBackgroundRunningNum;
+}
+
+static void* _engineWorker(void* param) {
+    iFuseEngineRequest_t *iFuseEngineRequest = NULL;
+
+    UNUSED(param);
+
+    g_EngineWorkerThread = true;
+
+    pthread_mutex_lock(&g_EngineMutex);
+
+    while(true) {
+        while(g_EngineForegroundQueue.empty() && !_canRunBackground() && g_EngineRunning) {
+            pthread_cond_wait(&g_EngineCond, &g_EngineMutex);
+        }
+
+        if(!g_EngineForegroundQueue.empty()) {
+            iFuseEngineRequest = g_EngineForegroundQueue.front();
+            g_EngineForegroundQueue.pop_front();
+        } else if(_canRunBackground()) {
+            iFuseEngineRequest = g_EngineQueue.front();
+            g_EngineQueue.pop_front();
+        } else if(g_EngineQueue.empty()) {
+            // stopped and drained
+            break;
+        } else {
+            // stopped, other workers drain background requests
+            pthread_cond_wait(&g_EngineCond, &g_EngineMutex);
+            continue;
+        }
+
+        g_EngineBackgroundThread = !iFuseEngineRequest->foreground;
+        _runRequest(iFuseEngineRequest);
+        g_EngineBackgroundThread = false;
+    }
+
+    pthread_mutex_unlock(&g_EngineMutex);
+    return NULL;
+}
+
+/*
+ * Initialize the engine
+ */
+void iFuseEngineInit() {
+    g_EngineMaxWorkerNum = iFuseLibGetOption()->workerNum;
+    if(g_EngineMaxWorkerNum <= 0) {
+        g_EngineMaxWorkerNum = IFUSE_ENGINE_WORKER_NUM;
+    } else if(g_EngineMaxWorkerNum > IFUSE_MAX_ENGINE_WORKER_NUM) {
+        g_EngineMaxWorkerNum = IFUSE_MAX_ENGINE_WORKER_NUM;
+    }
+
+    pthread_mutex_init(&g_EngineMutex, NULL);
+    pthread_cond_init(&g_EngineCond, NULL);
+}
+
+/*
+ * Destroy the engine
+ */
+void iFuseEngineDestroy() {
+    iFuseEngineStop();
+
+    pthread_cond_destroy(&g_EngineCond);
+    pthread_mutex_destroy(&g_EngineMutex);
+}
+
+/*
+ * Start worker threads
+ * requests submitted before start or after stop run in the submitting thread
+ */
+void iFuseEngineStart() {
+    int status = 0;
+    int i;
+
+    pthread_mutex_lock(&g_EngineMutex);
+
+    if(g_EngineRunning) {
+        pthread_mutex_unlock(&g_EngineMutex);
+        return;
+    }
+
+    g_EngineWorkers = (pthread_t*)calloc(g_EngineMaxWorkerNum, sizeof(pthread_t));
+    if(g_EngineWorkers == NULL) {
+        pthread_mutex_unlock(&g_EngineMutex);
+        return;
+    }
+
+    g_EngineRunning = true;
+
+    for(i=0;i<g_EngineMaxWorkerNum;i++) {
+        status = pthread_create(&g_EngineWorkers[g_EngineWorkerNum], NULL, _engineWorker, NULL);
+        if(status != 0) {
+            iFuseLibLogError(LOG_ERROR, status, "iFuseEngineStart: pthread_create error");
+            break;
+        }
+        g_EngineWorkerNum++;
+    }
+
+    if(g_EngineWorkerNum == 0) {
+        g_EngineRunning = false;
+        free(g_EngineWorkers);
+        g_EngineWorkers = NULL;
+    }
+
+    // a quarter of the workers are kept for foreground requests
+    g_EngineMaxBackgroundRunningNum = g_EngineWorkerNum - g_EngineWorkerNum / 4;
+
+    iFuseLibLog(LOG_DEBUG, "iFuseEngineStart: %d workers are running", g_EngineWorkerNum);
+
+    pthread_mutex_unlock(&g_EngineMutex);
+}
+
+/*
+ * Run all queued requests and stop worker threads
+ */
+void iFuseEngineStop() {
+    int i;
+
+    pthread_mutex_lock(&g_EngineMutex);
+
+    if(!g_EngineRunning) {
+        pthread_mutex_unlock(&g_EngineMutex);
+        return;
+    }
+
+    g_EngineRunning = false;
+    pthread_cond_broadcast(&g_EngineCond);
+
+    pthread_mutex_unlock(&g_EngineMutex);
+
+    for(i=0;i<g_EngineWorkerNum;i++) {
+        pthread_join(g_EngineWorkers[i], NULL);
+    }
+
+    free(g_EngineWorkers);
+    g_EngineWorkers = NULL;
+    g_EngineWorkerNum = 0;
+
+    iFuseLibLog(LOG_DEBUG, "iFuseEngineStop: workers are stopped");
+}
+
+/*
+ * Report status of the engine
+ */
+void iFuseEngineReport(iFuseEngineReport_t *report) {
+    assert(report != NULL);
+
+    bzero(report, sizeof(iFuseEngineReport_t));
+
+    pthread_mutex_lock(&g_EngineMutex);
+
+    report->workers = g_EngineWorkerNum;
+    report->queued = g_EngineForegroundQueue.size() + g_EngineQueue.size();
+    report->running = g_EngineRunningNum;
+    report->maxQueued = g_EngineMaxQueued;
+    report->inlineCount = (int)g_EngineInlineCount;
+
+    pthread_mutex_unlock(&g_EngineMutex);
+}
+
+static iFuseEngineRequest_t *_newRequest(iFuseEngineTaskCB task, void *param, bool foreground) {
+    iFuseEngineRequest_t *iFuseEngineRequest = NULL;
+
+    iFuseEngineRequest = (iFuseEngineRequest_t *) calloc(1, sizeof ( iFuseEngineRequest_t));
+    if (iFuseEngineRequest == NULL) {
+        return NULL;
+    }
+
+    iFuseEngineRequest->task = task;
+    iFuseEngineRequest->param = param;
+    iFuseEngineRequest->foreground = foreground;
+    iFuseEngineRequest->state = IFUSE_ENGINE_REQUEST_STATE_QUEUED;
+    // reference of the engine
+    iFuseEngineRequest->refCount = 1;
+
+    pthread_cond_init(&iFuseEngineRequest->cond, NULL);
+    return iFuseEngineRequest;
+}
+
+/*
+ * Queue a request
+ * g_EngineMutex must be held
+ */
+static void _queueRequest(iFuseEngineRequest_t *iFuseEngineRequest) {
+    int queued = 0;
+
+    assert(iFuseEngineRequest != NULL);
+
+    if(iFuseEngineRequest->foreground) {
+        g_EngineForegroundQueue.push_back(iFuseEngineRequest);
+    } else {
+        g_EngineQueue.push_back(iFuseEngineRequest);
+    }
+
+    queued = g_EngineForegroundQueue.size() + g_EngineQueue.size();
+    if(queued > g_EngineMaxQueued) {
+        g_EngineMaxQueued = queued;
+    }
+
+    pthread_cond_signal(&g_EngineCond);
+}
+
+static int _submit(iFuseEngineTaskCB task, void *param, size_t admittedSize, iFuseEngineRequest_t **request) {
+    iFuseEngineRequest_t *tmpIFuseEngineRequest = NULL;
+
+    assert(task != NULL);
+
+    if(request != NULL) {
+        *request = NULL;
+    }
+
+    tmpIFuseEngineRequest = _newRequest(task, param, false);
+    if (tmpIFuseEngineRequest == NULL) {
+        return SYS_MALLOC_ERR;
+    }
+
+    tmpIFuseEngineRequest->admittedSize = admittedSize;
+
+    pthread_mutex_lock(&g_EngineMutex);
+
+    if(request != NULL) {
+        // reference of the caller
+        tmpIFuseEngineRequest->refCount++;
+        *request = tmpIFuseEngineRequest;
+    }
+
+    if(!g_EngineRunning) {
+        g_EngineInlineCount++;
+        _runRequest(tmpIFuseEngineRequest);
+        pthread_mutex_unlock(&g_EngineMutex);
+        return 0;
+    }
+
+    _queueRequest(tmpIFuseEngineRequest);
+
+    pthread_mutex_unlock(&g_EngineMutex);
+    return 0;
+}
+
+/*
+ * Queue a background request to be run by a worker
+ * request can be null if the caller does not wait for the result,
+ * otherwise it must be released by iFuseEngineRelease
+ */
+int iFuseEngineSubmit(iFuseEngineTaskCB task, void *param, iFuseEngineRequest_t **request) {
+    return _submit(task, param, 0, request);
+}
+
+/*
+ * Queue a background request holding size bytes (e.g., a block being preloaded)
+ * returns -EBUSY if the request is shed by admission control,
+ * then the caller takes care of the param
+ */
+int iFuseEngineSubmitBackground(iFuseEngineTaskCB task, void *param, size_t size, iFuseEngineRequest_t **request) {
+    int status = 0;
+
+    if(request != NULL) {
+        *request = NULL;
+    }
+
+    if(!iFuseAdmissionAdmitBackground(size)) {
+        return -EBUSY;
+    }
+
+    status = _submit(task, param, size, request);
+    if(status < 0) {
+        iFuseAdmissionReleaseBackground(size);
+    }
+    return status;
+}
+
+/*
+ * Run a foreground request by a worker and wait for its completion
+ * FUSE callbacks go through here, so the number of threads making iRODS
+ * calls is bounded by workers, not by FUSE threads.
+ * the request runs in the calling thread if workers are not running or
+ * the caller is a worker itself.
+ * returns the status returned by the task
+ */
+int iFuseEngineRun(iFuseEngineTaskCB task, void *param) {
+    int status = 0;
+    iFuseEngineRequest_t *tmpIFuseEngineRequest = NULL;
+
+    assert(task != NULL);
+
+    if(g_EngineWorkerThread) {
+        // do not wait for a worker while holding one
+        return task(param);
+    }
+
+    tmpIFuseEngineRequest = _newRequest(task, param, true);
+    if (tmpIFuseEngineRequest == NULL) {
+        // still serve the request
+        return task(param);
+    }
+
+    pthread_mutex_lock(&g_EngineMutex);
+
+    // reference of the caller
+    tmpIFuseEngineRequest->refCount++;
+
+    if(!g_EngineRunning) {
+        g_EngineInlineCount++;
+        _runRequest(tmpIFuseEngineRequest);
+    } else {
+        _queueRequest(tmpIFuseEngineRequest);
+
+        // not run here, waiting in line is what bounds the calls in flight
+        while(tmpIFuseEngineRequest->state != IFUSE_ENGINE_REQUEST_STATE_COMPLETED) {
+            pthread_cond_wait(&tmpIFuseEngineRequest->cond, &g_EngineMutex);
+        }
+    }
+
+    status = tmpIFuseEngineRequest->status;
+
+    pthread_mutex_unlock(&g_EngineMutex);
+
+    iFuseEngineRelease(tmpIFuseEngineRequest);
+    return status;
+}
+
+/*
+ * Wait for a request to complete
+ * returns the status returned by the task
+ */
+int iFuseEngineWait(iFuseEngineRequest_t *request) {
+    int status = 0;
+
+    assert(request != NULL);
+
+    pthread_mutex_lock(&g_EngineMutex);
+
+    if(request->state == IFUSE_ENGINE_REQUEST_STATE_QUEUED) {
+        // do not wait behind other requests
+        g_EngineQueue.remove(request);
+        g_EngineInlineCount++;
+        _runRequest(request);
+    }
+
+    while(request->state != IFUSE_ENGINE_REQUEST_STATE_COMPLETED) {
+        pthread_cond_wait(&request->cond, &g_EngineMutex);
+    }
+
+    status = request->status;
+
+    pthread_mutex_unlock(&g_EngineMutex);
+    return status;
+}
+
+/*
+ * Wait for a request to complete for given milliseconds
+ * returns -ETIMEDOUT if the request is still running
+ */
+int iFuseEngineTimedWait(iFuseEngineRequest_t *request, int msec) {
+    int status = 0;
+    struct timespec deadline;
+    int rc = 0;
+
+    assert(request != NULL);
+
+    pthread_mutex_lock(&g_EngineMutex);
+
+    if(request->state == IFUSE_ENGINE_REQUEST_STATE_QUEUED) {
+        // do not wait behind other requests
+        g_EngineQueue.remove(request);
+        g_EngineInlineCount++;
+        _runRequest(request);
+    }
+
+    iFuseLibGetTimespecAfterMSec(&deadline, msec);
+
+    while(request->state != IFUSE_ENGINE_REQUEST_STATE_COMPLETED && rc != ETIMEDOUT) {
+        rc = pthread_cond_timedwait(&request->cond, &g_EngineMutex, &deadline);
+    }
+
+    if(request->state == IFUSE_ENGINE_REQUEST_STATE_COMPLETED) {
+        status = request->status;
+    } else {
+        status = -ETIMEDOUT;
+    }
+
+    pthread_mutex_unlock(&g_EngineMutex);
+    return status;
+}
+
+/*
+ * Tell if the calling thread is a worker running a background request
+ */
+bool iFuseEngineIsBackgroundThread() {
+    return g_EngineBackgroundThread;
+}
+
+bool iFuseEngineIsDone(iFuseEngineRequest_t *request) {
+    bool done = false;
+
+    assert(request != NULL);
+
+    pthread_mutex_lock(&g_EngineMutex);
+    done = (request->state == IFUSE_ENGINE_REQUEST_STATE_COMPLETED);
+    pthread_mutex_unlock(&g_EngineMutex);
+
+    return done;
+}
+
+/*
+ * Take a request out of the queue before it runs
+ * returns false if the request is already running or completed,
+ * otherwise the caller takes care of the param given at submit
+ */
+bool iFuseEngineCancel(iFuseEngineRequest_t *request) {
+    assert(request != NULL);
+
+    pthread_mutex_lock(&g_EngineMutex);
+
+    if(request->state != IFUSE_ENGINE_REQUEST_STATE_QUEUED) {
+        pthread_mutex_unlock(&g_EngineMutex);
+        return false;
+    }
+
+    g_EngineQueue.remove(request);
+
+    if(request->admittedSize > 0) {
+        iFuseAdmissionReleaseBackground(request->admittedSize);
+        request->admittedSize = 0;
+    }
+
+    request->status = -ECANCELED;
+    request->state = IFUSE_ENGINE_REQUEST_STATE_COMPLETED;
+    pthread_cond_broadcast(&request->cond);
+
+    // reference of the engine, the caller still holds one
+    request->refCount--;
+
+    pthread_mutex_unlock(&g_EngineMutex);
+    return true;
+}
+
+/*
+ * Drop the caller's reference to a request
+ * a request still queued or running keeps going
+ */
+void iFuseEngineRelease(iFuseEngineRequest_t *request) {
+    bool last = false;
+
+    assert(request != NULL);
+
+    pthread_mutex_lock(&g_EngineMutex);
+    request->refCount--;
+    last = (request->refCount == 0);
+    pthread_mutex_unlock(&g_EngineMutex);
+
+    if(last) {
+        _freeRequest(request);
+    }
+}
@@ -31,6 +31,8 @@ static pthread_rwlock_t g_IDGenLock;
 static unsigned long g_FdIDGen;
 static unsigned long g_DdIDGen;
 
+static int g_FdStreamNum = IFUSE_FD_STREAM_NUM;
+
 /*
  * Lock order : 
  * - g_AssignedFdLock or g_AssignedDirLock
@@ -61,6 +63,92 @@ static unsigned long _genNextDdID() {
     return newId;
 }
 
+/*
+ * Open an extra server-side descriptor of a read-only file, positioned at off
+ * must be called with the connection locked
+ */
+static int _openStream(iFuseFd_t *iFuseFd, iFuseFdStream_t *stream, off_t off) {
+    dataObjInp_t dataObjOpenInp;
+    openedDataObjInp_t dataObjLseekInp;
+    fileLseekOut_t *dataObjLseekOut = NULL;
+    int status;
+    int fd;
+
+    assert(iFuseFd != NULL);
+    assert(iFuseFd->conn != NULL);
+    assert(stream != NULL);
+
+    bzero(&dataObjOpenInp, sizeof ( dataObjInp_t));
+    dataObjOpenInp.openFlags = iFuseFd->openFlag;
+    rstrcpy(dataObjOpenInp.objPath, iFuseFd->iRodsPath, MAX_NAME_LEN);
+
+    fd = iFuseRodsClientDataObjOpen(iFuseFd->conn->conn, &dataObjOpenInp);
+    iFuseConnUpdateLastActTime(iFuseFd->conn, false);
+    if (fd <= 0) {
+        iFuseLibLogError(LOG_ERROR, fd, "_openStream: iFuseRodsClientDataObjOpen of %s error, status = %d",
+            iFuseFd->iRodsPath, fd);
+        return -ENOENT;
+    }
+
+    iFuseLibLog(LOG_DEBUG, "_openStream: opened descriptor %d for another stream of %s", fd, iFuseFd->iRodsPath);
+
+    stream->fd = fd;
+    stream->lastFilePointer = 0;
+    stream->lastUseUSec = 0;
+
+    if(off > 0) {
+        bzero(&dataObjLseekInp, sizeof( openedDataObjInp_t ));
+
+        dataObjLseekInp.l1descInx = fd;
+        dataObjLseekInp.offset = off;
+        dataObjLseekInp.whence = SEEK_SET;
+
+        status = iFuseRodsClientDataObjLseek(iFuseFd->conn->conn, &dataObjLseekInp, &dataObjLseekOut);
+        iFuseConnUpdateLastActTime(iFuseFd->conn, false);
+        if (status < 0 || dataObjLseekOut == NULL) {
+            // the reader seeks again
+            iFuseLibLogError(LOG_ERROR, status, "_openStream: iFuseRodsClientDataObjLseek of %s error, status = %d",
+                iFuseFd->iRodsPath, status);
+            stream->lastFilePointer = -1;
+        } else {
+            stream->lastFilePointer = dataObjLseekOut->offset;
+        }
+
+        if(dataObjLseekOut != NULL) {
+            free(dataObjLseekOut);
+        }
+    }
+    return 0;
+}
+
+/*
+ * Close extra server-side descriptors of a read-only file
+ * must be called with the connection locked
+ */
+static void _closeExtraStreams(iFuseFd_t *iFuseFd) {
+    int status = 0;
+    openedDataObjInp_t dataObjCloseInp;
+    int i;
+
+    assert(iFuseFd != NULL);
+    assert(iFuseFd->conn != NULL);
+
+    for(i=1;i<iFuseFd->streamNum;i++) {
+        bzero(&dataObjCloseInp, sizeof (openedDataObjInp_t));
+        dataObjCloseInp.l1descInx = iFuseFd->streams[i].fd;
+
+        status = iFuseRodsClientDataObjClose(iFuseFd->conn->conn, &dataObjCloseInp);
+        if (status < 0) {
+            iFuseLibLogError(LOG_ERROR, status, "_closeExtraStreams: close of %s (%d) error",
+                iFuseFd->iRodsPath, iFuseFd->streams[i].fd);
+        }
+    }
+
+    if(iFuseFd->streamNum > 1) {
+        iFuseFd->streamNum = 1;
+    }
+}
+
 static int _closeFd(iFuseFd_t *iFuseFd) {
     int status = 0;
     openedDataObjInp_t dataObjCloseInp;
@@ -72,8 +160,10 @@ static int _closeFd(iFuseFd_t *iFuseFd) {
     
     if(iFuseFd->fd > 0 && iFuseFd->conn != NULL) {
         iFuseConn = iFuseFd->conn;
-        iFuseConnLock(iFuseConn);
+        iFuseConnLockForRelease(iFuseConn);
         
+        _closeExtraStreams(iFuseFd);
+
         bzero(&dataObjCloseInp, sizeof (openedDataObjInp_t));
         dataObjCloseInp.l1descInx = iFuseFd->fd;
 
@@ -105,6 +195,7 @@ static int _closeFd(iFuseFd_t *iFuseFd) {
     iFuseFd->fd = 0;
     iFuseFd->openFlag = 0;
     iFuseFd->lastFilePointer = -1;
+    iFuseFd->streamNum = 0;
     
     pthread_rwlock_unlock(&iFuseFd->lock);
     return status;
@@ -120,7 +211,7 @@ static int _closeDir(iFuseDir_t *iFuseDir) {
 
     if(iFuseDir->handle != NULL && iFuseDir->conn != NULL) {
         iFuseConn = iFuseDir->conn;
-        iFuseConnLock(iFuseConn);
+        iFuseConnLockForRelease(iFuseConn);
         status = iFuseRodsClientCloseCollection(iFuseDir->handle);
         if (status < 0) {
             if (iFuseRodsClientReadMsgError(status)) {
@@ -251,6 +342,13 @@ void iFuseFdInit() {
     
     pthread_rwlockattr_init(&g_IDGenLockAttr);
     pthread_rwlock_init(&g_IDGenLock, &g_IDGenLockAttr);
+
+    g_FdStreamNum = iFuseLibGetOption()->readStreams;
+    if(g_FdStreamNum < 1) {
+        g_FdStreamNum = 1;
+    } else if(g_FdStreamNum > IFUSE_MAX_NUM_FD_STREAM) {
+        g_FdStreamNum = IFUSE_MAX_NUM_FD_STREAM;
+    }
 }
 
 /*
@@ -286,6 +384,7 @@ int iFuseFdOpen(iFuseFd_t **iFuseFd, iFuseConn_t *iFuseConn, const char* iRodsPa
     dataObjInp_t dataObjOpenInp;
     int fd;
     iFuseFd_t *tmpIFuseDesc;
+    iFuseConn_t *retryConn = NULL;
 
     assert(iFuseFd != NULL);
     assert(iFuseConn != NULL);
@@ -293,7 +392,10 @@ int iFuseFdOpen(iFuseFd_t **iFuseFd, iFuseConn_t *iFuseConn, const char* iRodsPa
     
     *iFuseFd = NULL;
 
-    iFuseConnLock(iFuseConn);
+    status = iFuseConnLock(iFuseConn);
+    if (status < 0) {
+        return status;
+    }
     
     bzero(&dataObjOpenInp, sizeof ( dataObjInp_t));
     dataObjOpenInp.openFlags = openFlag;
@@ -303,6 +405,22 @@ int iFuseFdOpen(iFuseFd_t **iFuseFd, iFuseConn_t *iFuseConn, const char* iRodsPa
     
     fd = iFuseRodsClientDataObjOpen(iFuseConn->conn, &dataObjOpenInp);
     iFuseConnUpdateLastActTime(iFuseConn, false);
+    if (fd <= 0 && iFuseRodsClientTimedOutError(fd) && (openFlag & O_ACCMODE) == O_RDONLY &&
+        iFuseConnRetryTimedOut(iFuseConn, &retryConn) >= 0) {
+        // opening for read is idempotent, retry on another connection right away
+        fd = iFuseRodsClientDataObjOpen(retryConn->conn, &dataObjOpenInp);
+        iFuseConnUpdateLastActTime(retryConn, false);
+        if (fd > 0) {
+            // the descriptor takes the new connection, the caller's use of the old one ends here
+            iFuseConnUnlock(iFuseConn);
+            iFuseConnUnuse(iFuseConn);
+            iFuseConn = retryConn;
+        } else {
+            iFuseConnUnlock(retryConn);
+            iFuseConnUnuse(retryConn);
+        }
+    }
+
     if (fd <= 0) {
         if (iFuseRodsClientReadMsgError(fd)) {
             // reconnect and retry 
@@ -342,6 +460,12 @@ int iFuseFdOpen(iFuseFd_t **iFuseFd, iFuseConn_t *iFuseConn, const char* iRodsPa
     tmpIFuseDesc->iRodsPath = strdup(iRodsPath);
     tmpIFuseDesc->openFlag = openFlag;
     tmpIFuseDesc->lastFilePointer = -1;
+
+    if((openFlag & O_ACCMODE) == O_RDONLY) {
+        tmpIFuseDesc->streamNum = 1;
+        tmpIFuseDesc->streams[0].fd = fd;
+        tmpIFuseDesc->streams[0].lastFilePointer = -1;
+    }
     
     pthread_rwlockattr_init(&tmpIFuseDesc->lockAttr);
     pthread_rwlock_init(&tmpIFuseDesc->lock, &tmpIFuseDesc->lockAttr);
@@ -373,7 +497,13 @@ int iFuseFdReopen(iFuseFd_t *iFuseFd) {
     pthread_rwlock_wrlock(&iFuseFd->lock);
 
     iFuseConn = iFuseFd->conn;
-    iFuseConnLock(iFuseConn);
+    status = iFuseConnLock(iFuseConn);
+    if (status < 0) {
+        pthread_rwlock_unlock(&iFuseFd->lock);
+        return status;
+    }
+
+    _closeExtraStreams(iFuseFd);
 
     bzero(&dataObjCloseInp, sizeof (openedDataObjInp_t));
     dataObjCloseInp.l1descInx = iFuseFd->fd;
@@ -444,6 +574,11 @@ int iFuseFdReopen(iFuseFd_t *iFuseFd) {
     }
     
     iFuseFd->fd = fd;
+
+    if(iFuseFd->streamNum > 0) {
+        iFuseFd->streams[0].fd = fd;
+        iFuseFd->streams[0].lastFilePointer = -1;
+    }
     
     iFuseConnUnlock(iFuseConn);
     
@@ -451,6 +586,197 @@ int iFuseFdReopen(iFuseFd_t *iFuseFd) {
     return status;
 }
 
+/*
+ * Move a read-only file descriptor to another connection after an operation
+ * on it timed out, the file is opened again there and positioned at off.
+ * iFuseFd and its connection must be locked by caller, the new connection
+ * is locked on return
+ */
+int iFuseFdRetryTimedOut(iFuseFd_t *iFuseFd, off_t off) {
+    int status = 0;
+    dataObjInp_t dataObjOpenInp;
+    openedDataObjInp_t dataObjLseekInp;
+    fileLseekOut_t *dataObjLseekOut = NULL;
+    openedDataObjInp_t dataObjCloseInp;
+    iFuseConn_t *iFuseConn = NULL;
+    iFuseConn_t *retryConn = NULL;
+    int fd;
+
+    assert(iFuseFd != NULL);
+    assert(iFuseFd->conn != NULL);
+
+    if((iFuseFd->openFlag & O_ACCMODE) != O_RDONLY) {
+        // writes may have been applied already
+        return -EPERM;
+    }
+
+    iFuseConn = iFuseFd->conn;
+
+    status = iFuseConnRetryTimedOut(iFuseConn, &retryConn);
+    if(status < 0) {
+        return status;
+    }
+
+    bzero(&dataObjOpenInp, sizeof ( dataObjInp_t));
+    dataObjOpenInp.openFlags = iFuseFd->openFlag;
+    rstrcpy(dataObjOpenInp.objPath, iFuseFd->iRodsPath, MAX_NAME_LEN);
+
+    fd = iFuseRodsClientDataObjOpen(retryConn->conn, &dataObjOpenInp);
+    iFuseConnUpdateLastActTime(retryConn, false);
+    if (fd <= 0) {
+        iFuseLibLogError(LOG_ERROR, fd, "iFuseFdRetryTimedOut: iFuseRodsClientDataObjOpen of %s error, status = %d",
+            iFuseFd->iRodsPath, fd);
+        iFuseConnUnlock(retryConn);
+        iFuseConnUnuse(retryConn);
+        return fd;
+    }
+
+    if(off > 0) {
+        bzero(&dataObjLseekInp, sizeof( openedDataObjInp_t ));
+        dataObjLseekInp.l1descInx = fd;
+        dataObjLseekInp.offset = off;
+        dataObjLseekInp.whence = SEEK_SET;
+
+        status = iFuseRodsClientDataObjLseek(retryConn->conn, &dataObjLseekInp, &dataObjLseekOut);
+        iFuseConnUpdateLastActTime(retryConn, false);
+        if (status < 0 || dataObjLseekOut == NULL || dataObjLseekOut->offset != off) {
+            iFuseLibLogError(LOG_ERROR, status, "iFuseFdRetryTimedOut: iFuseRodsClientDataObjLseek of %s error, status = %d",
+                iFuseFd->iRodsPath, status);
+            if(dataObjLseekOut != NULL) {
+                free(dataObjLseekOut);
+            }
+
+            bzero(&dataObjCloseInp, sizeof (openedDataObjInp_t));
+            dataObjCloseInp.l1descInx = fd;
+            iFuseRodsClientDataObjClose(retryConn->conn, &dataObjCloseInp);
+
+            iFuseConnUnlock(retryConn);
+            iFuseConnUnuse(retryConn);
+            return status < 0 ? status : -EIO;
+        }
+
+        free(dataObjLseekOut);
+    }
+
+    iFuseLibLog(LOG_DEBUG, "iFuseFdRetryTimedOut: %s moved from connection %lu to %lu", iFuseFd->iRodsPath, iFuseConn->connId, retryConn->connId);
+
+    // descriptors on the discarded connection go with it
+    iFuseFd->conn = retryConn;
+    iFuseFd->fd = fd;
+    iFuseFd->lastFilePointer = off;
+
+    if(iFuseFd->streamNum > 0) {
+        iFuseFd->streamNum = 1;
+        iFuseFd->streams[0].fd = fd;
+        iFuseFd->streams[0].lastFilePointer = off;
+    }
+
+    iFuseConnUnlock(iFuseConn);
+    iFuseConnUnuse(iFuseConn);
+    return 0;
+}
+
+/*
+ * Move a directory descriptor to another connection after listing on it
+ * timed out, the collection is opened again there from the first entry.
+ * iFuseDir and its connection must be locked by caller, the new connection
+ * is locked on return
+ */
+int iFuseDirRetryTimedOut(iFuseDir_t *iFuseDir) {
+    int status = 0;
+    collHandle_t collHandle;
+    iFuseConn_t *iFuseConn = NULL;
+    iFuseConn_t *retryConn = NULL;
+
+    assert(iFuseDir != NULL);
+    assert(iFuseDir->conn != NULL);
+    assert(iFuseDir->handle != NULL);
+
+    iFuseConn = iFuseDir->conn;
+
+    status = iFuseConnRetryTimedOut(iFuseConn, &retryConn);
+    if(status < 0) {
+        return status;
+    }
+
+    bzero(&collHandle, sizeof ( collHandle_t));
+
+    status = iFuseRodsClientOpenCollection(retryConn->conn, iFuseDir->iRodsPath, 0, &collHandle);
+    iFuseConnUpdateLastActTime(retryConn, false);
+    if (status < 0) {
+        iFuseLibLogError(LOG_ERROR, status, "iFuseDirRetryTimedOut: iFuseRodsClientOpenCollection of %s error, status = %d",
+            iFuseDir->iRodsPath, status);
+        iFuseConnUnlock(retryConn);
+        iFuseConnUnuse(retryConn);
+        return status;
+    }
+
+    iFuseLibLog(LOG_DEBUG, "iFuseDirRetryTimedOut: %s moved from connection %lu to %lu", iFuseDir->iRodsPath, iFuseConn->connId, retryConn->connId);
+
+    iFuseRodsClientCloseCollection(iFuseDir->handle);
+    memcpy(iFuseDir->handle, &collHandle, sizeof(collHandle_t));
+    iFuseDir->conn = retryConn;
+
+    iFuseConnUnlock(iFuseConn);
+    iFuseConnUnuse(iFuseConn);
+    return 0;
+}
+
+/*
+ * Pick a server-side descriptor of a read-only file for a read at off
+ * - a descriptor positioned at off needs no seek
+ * - a descriptor not used yet
+ * - a new descriptor positioned at off for another access stream, until the limit
+ * - the least recently used descriptor
+ * returns NULL if the file has no streams (not read-only)
+ * must be called with the file descriptor and its connection locked
+ */
+iFuseFdStream_t *iFuseFdGetReadStream(iFuseFd_t *iFuseFd, off_t off) {
+    iFuseFdStream_t *stream = NULL;
+    int i;
+
+    assert(iFuseFd != NULL);
+
+    if(iFuseFd->streamNum == 0) {
+        return NULL;
+    }
+
+    for(i=0;i<iFuseFd->streamNum;i++) {
+        if(iFuseFd->streams[i].lastFilePointer == off) {
+            stream = &iFuseFd->streams[i];
+            break;
+        }
+    }
+
+    if(stream == NULL) {
+        for(i=0;i<iFuseFd->streamNum;i++) {
+            if(iFuseFd->streams[i].lastFilePointer < 0) {
+                stream = &iFuseFd->streams[i];
+                break;
+            }
+        }
+    }
+
+    if(stream == NULL && iFuseFd->streamNum < g_FdStreamNum) {
+        if(_openStream(iFuseFd, &iFuseFd->streams[iFuseFd->streamNum], off) == 0) {
+            stream = &iFuseFd->streams[iFuseFd->streamNum];
+            iFuseFd->streamNum++;
+        }
+    }
+
+    if(stream == NULL) {
+        stream = &iFuseFd->streams[0];
+        for(i=1;i<iFuseFd->streamNum;i++) {
+            if(iFuseFd->streams[i].lastUseUSec < stream->lastUseUSec) {
+                stream = &iFuseFd->streams[i];
+            }
+        }
+    }
+
+    stream->lastUseUSec = iFuseLibGetMonotonicTimeUSec();
+    return stream;
+}
+
 /*
  * Open a new directory descriptor
  */
@@ -458,6 +784,7 @@ int iFuseDirOpen(iFuseDir_t **iFuseDir, iFuseConn_t *iFuseConn, const char* iRod
     int status = 0;
     collHandle_t collHandle;
     iFuseDir_t *tmpIFuseDesc;
+    iFuseConn_t *retryConn = NULL;
 
     assert(iFuseDir != NULL);
     assert(iFuseConn != NULL);
@@ -465,13 +792,31 @@ int iFuseDirOpen(iFuseDir_t **iFuseDir, iFuseConn_t *iFuseConn, const char* iRod
     
     *iFuseDir = NULL;
 
-    iFuseConnLock(iFuseConn);
+    status = iFuseConnLock(iFuseConn);
+    if (status < 0) {
+        return status;
+    }
     
     bzero(&collHandle, sizeof ( collHandle_t));
     
     assert(iFuseConn->conn != NULL);
     
     status = iFuseRodsClientOpenCollection(iFuseConn->conn, (char*) iRodsPath, 0, &collHandle);
+    if (status < 0 && iFuseRodsClientTimedOutError(status) && iFuseConnRetryTimedOut(iFuseConn, &retryConn) >= 0) {
+        // listing is idempotent, retry on another connection right away
+        bzero(&collHandle, sizeof ( collHandle_t));
+        status = iFuseRodsClientOpenCollection(retryConn->conn, (char*) iRodsPath, 0, &collHandle);
+        if (status >= 0) {
+            // the descriptor takes the new connection, the caller's use of the old one ends here
+            iFuseConnUnlock(iFuseConn);
+            iFuseConnUnuse(iFuseConn);
+            iFuseConn = retryConn;
+        } else {
+            iFuseConnUnlock(retryConn);
+            iFuseConnUnuse(retryConn);
+        }
+    }
+
     if (status < 0) {
         if (iFuseRodsClientReadMsgError(status)) {
             // reconnect and retry 
@@ -0,0 +1,760 @@
+/*** Copyright (c), The Regents of the University of California            ***
+ *** For more information please refer to files in the COPYRIGHT directory ***/
+/*** This code is written by Illyoung Choi (iychoi@email.arizona.edu)      ***
+ *** funded by iPlantCollaborative (www.iplantcollaborative.org).          ***/
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <errno.h>
+#include <time.h>
+#include <assert.h>
+#include <pthread.h>
+#include <unistd.h>
+#include <fcntl.h>
+#include <dirent.h>
+#include <sys/stat.h>
+#include <sys/types.h>
+#include <map>
+#include "iFuse.Lib.hpp"
+#include "iFuse.Lib.MockBackend.hpp"
+#include "iFuse.Lib.Util.hpp"
+#include "rcMisc.h"
+
+typedef struct IFuseMockL1Desc {
+    bool inuse;
+    int fd;
+} iFuseMockL1Desc_t;
+
+typedef struct IFuseMockCollHandle {
+    bool inuse;
+    DIR *dir;
+    char collPath[MAX_NAME_LEN];
+    // storage of strings collEnt_t points to
+    char collName[MAX_NAME_LEN];
+    char dataName[MAX_NAME_LEN];
+    char dataId[NAME_LEN];
+    char createTime[TIME_LEN];
+    char modifyTime[TIME_LEN];
+} iFuseMockCollHandle_t;
+
+static pthread_mutex_t g_MockLock;
+static char g_MockRootDir[MAX_NAME_LEN];
+static int g_MockLatencyUSec = 0;
+static int g_MockBandwidthKBps = 0;
+
+// like iRODS agents, each connection has its own descriptor table
+static std::map<rcComm_t*, iFuseMockL1Desc_t*> g_MockL1Desc;
+static iFuseMockCollHandle_t g_MockCollHandle[IFUSE_MOCK_MAX_COLLHANDLE];
+
+/*
+ * Delay a call to model network latency and bandwidth
+ */
+static void _delay(int len) {
+    unsigned long long delayUSec = g_MockLatencyUSec;
+
+    if(g_MockBandwidthKBps > 0 && len > 0) {
+        delayUSec += ((unsigned long long)len * 1000000) / ((unsigned long long)g_MockBandwidthKBps * 1024);
+    }
+
+    if(delayUSec > 0) {
+        usleep(delayUSec);
+    }
+}
+
+static void _getLocalPath(const char *iRodsPath, char *localPath) {
+    snprintf(localPath, MAX_NAME_LEN, "%s%s", g_MockRootDir, iRodsPath);
+}
+
+static int _errorStatus(int baseErr, int err) {
+    if(err == ENOENT) {
+        return USER_FILE_DOES_NOT_EXIST;
+    }
+    return baseErr - err;
+}
+
+static void _makeDirs(const char *localPath) {
+    char path[MAX_NAME_LEN];
+    char *ptr;
+
+    rstrcpy(path, localPath, MAX_NAME_LEN);
+
+    for(ptr=path+1;*ptr!=0;ptr++) {
+        if(*ptr == '/') {
+            *ptr = 0;
+            mkdir(path, 0755);
+            *ptr = '/';
+        }
+    }
+    mkdir(path, 0755);
+}
+
+/*
+ * Find the descriptor table of the connection
+ * g_MockLock must be held by caller
+ */
+static iFuseMockL1Desc_t *_getL1DescTable(rcComm_t *conn) {
+    std::map<rcComm_t*, iFuseMockL1Desc_t*>::iterator it_desc;
+
+    it_desc = g_MockL1Desc.find(conn);
+    if(it_desc == g_MockL1Desc.end()) {
+        return NULL;
+    }
+    return it_desc->second;
+}
+
+static int _allocL1Desc(rcComm_t *conn, int fd) {
+    iFuseMockL1Desc_t *table;
+    int i;
+
+    pthread_mutex_lock(&g_MockLock);
+
+    table = _getL1DescTable(conn);
+    if(table == NULL) {
+        pthread_mutex_unlock(&g_MockLock);
+        return SYS_INVALID_INPUT_PARAM;
+    }
+
+    for(i=IFUSE_MOCK_MIN_L1DESC;i<IFUSE_MOCK_MAX_L1DESC;i++) {
+        if(!table[i].inuse) {
+            table[i].inuse = true;
+            table[i].fd = fd;
+
+            pthread_mutex_unlock(&g_MockLock);
+            return i;
+        }
+    }
+
+    pthread_mutex_unlock(&g_MockLock);
+    return SYS_OUT_OF_FILE_DESC;
+}
+
+/*
+ * Get the local fd of a descriptor
+ * a descriptor opened on another connection is not found
+ * returns -1 if not found, the fd is taken out of the table if release is set
+ */
+static int _getL1DescFd(rcComm_t *conn, int l1descInx, bool release) {
+    iFuseMockL1Desc_t *table;
+    int fd = -1;
+
+    if(l1descInx < IFUSE_MOCK_MIN_L1DESC || l1descInx >= IFUSE_MOCK_MAX_L1DESC) {
+        return -1;
+    }
+
+    pthread_mutex_lock(&g_MockLock);
+
+    table = _getL1DescTable(conn);
+    if(table != NULL && table[l1descInx].inuse) {
+        fd = table[l1descInx].fd;
+
+        if(release) {
+            table[l1descInx].inuse = false;
+            table[l1descInx].fd = -1;
+        }
+    }
+
+    pthread_mutex_unlock(&g_MockLock);
+    return fd;
+}
+
+/*
+ * Close all descriptors left open and drop the table
+ * g_MockLock must be held by caller
+ */
+static void _freeL1DescTable(iFuseMockL1Desc_t *table) {
+    int i;
+
+    for(i=0;i<IFUSE_MOCK_MAX_L1DESC;i++) {
+        if(table[i].inuse) {
+            close(table[i].fd);
+        }
+    }
+    free(table);
+}
+
+static rcComm_t *_mockConnect(const char *rodsHost, int rodsPort, const char *userName, const char *rodsZone, int reconnFlag, rErrMsg_t *errMsg) {
+    rcComm_t *conn;
+    iFuseMockL1Desc_t *table;
+
+    UNUSED(userName);
+    UNUSED(rodsZone);
+    UNUSED(reconnFlag);
+
+    _delay(0);
+
+    conn = (rcComm_t *)calloc(1, sizeof(rcComm_t));
+    if(conn == NULL) {
+        errMsg->status = SYS_MALLOC_ERR;
+        return NULL;
+    }
+
+    // no socket, the timeout checker cannot kill mock connections
+    conn->sock = -1;
+    conn->portNum = rodsPort;
+    rstrcpy(conn->host, rodsHost, NAME_LEN);
+
+    // calloc leaves all descriptors not in use
+    table = (iFuseMockL1Desc_t *)calloc(IFUSE_MOCK_MAX_L1DESC, sizeof(iFuseMockL1Desc_t));
+    if(table == NULL) {
+        free(conn);
+        errMsg->status = SYS_MALLOC_ERR;
+        return NULL;
+    }
+
+    pthread_mutex_lock(&g_MockLock);
+    g_MockL1Desc[conn] = table;
+    pthread_mutex_unlock(&g_MockLock);
+    return conn;
+}
+
+static int _mockLogin(rcComm_t *conn) {
+    UNUSED(conn);
+
+    _delay(0);
+    return 0;
+}
+
+static int _mockDisconnect(rcComm_t *conn) {
+    iFuseMockL1Desc_t *table;
+
+    // descriptors left open are closed as the agent exits
+    pthread_mutex_lock(&g_MockLock);
+
+    table = _getL1DescTable(conn);
+    if(table != NULL) {
+        g_MockL1Desc.erase(conn);
+        _freeL1DescTable(table);
+    }
+
+    pthread_mutex_unlock(&g_MockLock);
+
+    free(conn);
+    return 0;
+}
+
+static int _mockTicketAdmin(rcComm_t *conn, ticketAdminInp_t *ticketAdminInp) {
+    UNUSED(conn);
+    UNUSED(ticketAdminInp);
+
+    _delay(0);
+    return 0;
+}
+
+static int _mockDataObjOpen(rcComm_t *conn, dataObjInp_t *dataObjInp) {
+    char localPath[MAX_NAME_LEN];
+    int fd;
+    int l1descInx;
+
+    _delay(0);
+
+    _getLocalPath(dataObjInp->objPath, localPath);
+
+    fd = open(localPath, dataObjInp->openFlags & ~(O_CREAT | O_EXCL));
+    if(fd < 0) {
+        return _errorStatus(UNIX_FILE_OPEN_ERR, errno);
+    }
+
+    l1descInx = _allocL1Desc(conn, fd);
+    if(l1descInx < 0) {
+        close(fd);
+    }
+    return l1descInx;
+}
+
+static int _mockDataObjClose(rcComm_t *conn, openedDataObjInp_t *dataObjCloseInp) {
+    int fd;
+
+    _delay(0);
+
+    fd = _getL1DescFd(conn, dataObjCloseInp->l1descInx, true);
+    if(fd < 0) {
+        return SYS_FILE_DESC_OUT_OF_RANGE;
+    }
+
+    if(close(fd) < 0) {
+        return _errorStatus(UNIX_FILE_CLOSE_ERR, errno);
+    }
+    return 0;
+}
+
+static int _mockOpenCollection(rcComm_t *conn, char *collection, int flag, collHandle_t *collHandle) {
+    char localPath[MAX_NAME_LEN];
+    DIR *dir;
+    int i;
+
+    UNUSED(flag);
+
+    _delay(0);
+
+    _getLocalPath(collection, localPath);
+
+    dir = opendir(localPath);
+    if(dir == NULL) {
+        return _errorStatus(UNIX_FILE_OPENDIR_ERR, errno);
+    }
+
+    pthread_mutex_lock(&g_MockLock);
+
+    for(i=0;i<IFUSE_MOCK_MAX_COLLHANDLE;i++) {
+        if(!g_MockCollHandle[i].inuse) {
+            g_MockCollHandle[i].inuse = true;
+            g_MockCollHandle[i].dir = dir;
+            rstrcpy(g_MockCollHandle[i].collPath, collection, MAX_NAME_LEN);
+
+            pthread_mutex_unlock(&g_MockLock);
+
+            // collHandle is copied by callers, keep index only
+            bzero(collHandle, sizeof(collHandle_t));
+            collHandle->inuseFlag = 1;
+            collHandle->rowInx = i;
+            collHandle->conn = conn;
+            return 0;
+        }
+    }
+
+    pthread_mutex_unlock(&g_MockLock);
+
+    closedir(dir);
+    return SYS_OUT_OF_FILE_DESC;
+}
+
+static int _mockCloseCollection(collHandle_t *collHandle) {
+    int inx = collHandle->rowInx;
+
+    if(inx < 0 || inx >= IFUSE_MOCK_MAX_COLLHANDLE) {
+        return SYS_INVALID_INPUT_PARAM;
+    }
+
+    pthread_mutex_lock(&g_MockLock);
+
+    if(g_MockCollHandle[inx].inuse) {
+        closedir(g_MockCollHandle[inx].dir);
+        g_MockCollHandle[inx].dir = NULL;
+        g_MockCollHandle[inx].inuse = false;
+    }
+
+    pthread_mutex_unlock(&g_MockLock);
+
+    collHandle->inuseFlag = 0;
+    return 0;
+}
+
+static int _mockReadCollection(rcComm_t *conn, collHandle_t *collHandle, collEnt_t *collEnt) {
+    iFuseMockCollHandle_t *handle;
+    struct dirent *entry;
+    struct stat stbuf;
+    char localPath[MAX_NAME_LEN];
+    int inx = collHandle->rowInx;
+
+    UNUSED(conn);
+
+    if(inx < 0 || inx >= IFUSE_MOCK_MAX_COLLHANDLE || !g_MockCollHandle[inx].inuse) {
+        return SYS_INVALID_INPUT_PARAM;
+    }
+
+    handle = &g_MockCollHandle[inx];
+
+    // a handle is used by one reader at a time (iFuseDirLock)
+    while((entry = readdir(handle->dir)) != NULL) {
+        if(strcmp(entry->d_name, ".") == 0 || strcmp(entry->d_name, "..") == 0) {
+            continue;
+        }
+
+        snprintf(localPath, MAX_NAME_LEN, "%s%s/%s", g_MockRootDir, handle->collPath, entry->d_name);
+        if(lstat(localPath, &stbuf) < 0) {
+            continue;
+        }
+
+        _delay(0);
+
+        bzero(collEnt, sizeof(collEnt_t));
+        snprintf(handle->dataId, NAME_LEN, "%llu", (unsigned long long)stbuf.st_ino);
+        snprintf(handle->createTime, TIME_LEN, "%lld", (long long)stbuf.st_ctime);
+        snprintf(handle->modifyTime, TIME_LEN, "%lld", (long long)stbuf.st_mtime);
+        collEnt->dataId = handle->dataId;
+        collEnt->createTime = handle->createTime;
+        collEnt->modifyTime = handle->modifyTime;
+
+        if(S_ISDIR(stbuf.st_mode)) {
+            snprintf(handle->collName, MAX_NAME_LEN, "%s/%s", handle->collPath, entry->d_name);
+            collEnt->objType = COLL_OBJ_T;
+            collEnt->collName = handle->collName;
+        } else {
+            rstrcpy(handle->collName, handle->collPath, MAX_NAME_LEN);
+            rstrcpy(handle->dataName, entry->d_name, MAX_NAME_LEN);
+            collEnt->objType = DATA_OBJ_T;
+            collEnt->collName = handle->collName;
+            collEnt->dataName = handle->dataName;
+            collEnt->dataSize = stbuf.st_size;
+            collEnt->dataMode = stbuf.st_mode & 0777;
+        }
+        return 0;
+    }
+
+    return CAT_NO_ROWS_FOUND;
+}
+
+static int _mockGetHostForGet(rcComm_t *conn, dataObjInp_t *dataObjInp, char **outHost) {
+    UNUSED(conn);
+    UNUSED(dataObjInp);
+
+    _delay(0);
+
+    // data is always served by the host we are talking to
+    *outHost = strdup(THIS_ADDRESS);
+    if(*outHost == NULL) {
+        return SYS_MALLOC_ERR;
+    }
+    return 0;
+}
+
+static int _mockGetHostForPut(rcComm_t *conn, dataObjInp_t *dataObjInp, char **outHost) {
+    return _mockGetHostForGet(conn, dataObjInp, outHost);
+}
+
+static int _mockGetMiscSvrInfo(rcComm_t *conn, miscSvrInfo_t **miscSvrInfoOut) {
+    miscSvrInfo_t *info;
+
+    UNUSED(conn);
+
+    _delay(0);
+
+    info = (miscSvrInfo_t *)calloc(1, sizeof(miscSvrInfo_t));
+    if(info == NULL) {
+        return SYS_MALLOC_ERR;
+    }
+
+    rstrcpy(info->relVersion, "mock", NAME_LEN);
+    rstrcpy(info->rodsZone, iFuseLibGetRodsEnv()->rodsZone, NAME_LEN);
+    *miscSvrInfoOut = info;
+    return 0;
+}
+
+static int _mockObjStat(rcComm_t *conn, dataObjInp_t *dataObjInp, rodsObjStat_t **rodsObjStatOut) {
+    char localPath[MAX_NAME_LEN];
+    struct stat stbuf;
+    rodsObjStat_t *objStat;
+
+    UNUSED(conn);
+
+    _delay(0);
+
+    *rodsObjStatOut = NULL;
+
+    _getLocalPath(dataObjInp->objPath, localPath);
+
+    if(stat(localPath, &stbuf) < 0) {
+        return _errorStatus(UNIX_FILE_STAT_ERR, errno);
+    }
+
+    objStat = (rodsObjStat_t *)calloc(1, sizeof(rodsObjStat_t));
+    if(objStat == NULL) {
+        return SYS_MALLOC_ERR;
+    }
+
+    objStat->objType = S_ISDIR(stbuf.st_mode) ? COLL_OBJ_T : DATA_OBJ_T;
+    objStat->objSize = stbuf.st_size;
+    objStat->dataMode = stbuf.st_mode & 0777;
+    snprintf(objStat->dataId, NAME_LEN, "%llu", (unsigned long long)stbuf.st_ino);
+    snprintf(objStat->createTime, TIME_LEN, "%lld", (long long)stbuf.st_ctime);
+    snprintf(objStat->modifyTime, TIME_LEN, "%lld", (long long)stbuf.st_mtime);
+
+    *rodsObjStatOut = objStat;
+    return objStat->objType;
+}
+
+static int _mockDataObjLseek(rcComm_t *conn, openedDataObjInp_t *dataObjLseekInp, fileLseekOut_t **dataObjLseekOut) {
+    off_t offset;
+    int fd;
+
+    _delay(0);
+
+    *dataObjLseekOut = NULL;
+
+    fd = _getL1DescFd(conn, dataObjLseekInp->l1descInx, false);
+    if(fd < 0) {
+        return SYS_FILE_DESC_OUT_OF_RANGE;
+    }
+
+    offset = lseek(fd, dataObjLseekInp->offset, dataObjLseekInp->whence);
+    if(offset < 0) {
+        return _errorStatus(UNIX_FILE_LSEEK_ERR, errno);
+    }
+
+    *dataObjLseekOut = (fileLseekOut_t *)calloc(1, sizeof(fileLseekOut_t));
+    if(*dataObjLseekOut == NULL) {
+        return SYS_MALLOC_ERR;
+    }
+
+    (*dataObjLseekOut)->offset = offset;
+    return 0;
+}
+
+static int _mockDataObjRead(rcComm_t *conn, openedDataObjInp_t *dataObjReadInp, bytesBuf_t *dataObjReadOutBBuf) {
+    ssize_t readLen;
+    int fd;
+
+    fd = _getL1DescFd(conn, dataObjReadInp->l1descInx, false);
+    if(fd < 0) {
+        return SYS_FILE_DESC_OUT_OF_RANGE;
+    }
+
+    // like rcDataObjRead, allocate if caller gives no buffer
+    if(dataObjReadOutBBuf->buf == NULL) {
+        dataObjReadOutBBuf->buf = malloc(dataObjReadInp->len);
+        if(dataObjReadOutBBuf->buf == NULL) {
+            return SYS_MALLOC_ERR;
+        }
+    }
+
+    readLen = read(fd, dataObjReadOutBBuf->buf, dataObjReadInp->len);
+    if(readLen < 0) {
+        return _errorStatus(UNIX_FILE_READ_ERR, errno);
+    }
+
+    _delay(readLen);
+
+    dataObjReadOutBBuf->len = readLen;
+    return readLen;
+}
+
+static int _mockDataObjWrite(rcComm_t *conn, openedDataObjInp_t *dataObjWriteInp, bytesBuf_t *dataObjWriteInpBBuf) {
+    ssize_t writeLen;
+    int fd;
+
+    fd = _getL1DescFd(conn, dataObjWriteInp->l1descInx, false);
+    if(fd < 0) {
+        return SYS_FILE_DESC_OUT_OF_RANGE;
+    }
+
+    _delay(dataObjWriteInp->len);
+
+    writeLen = write(fd, dataObjWriteInpBBuf->buf, dataObjWriteInp->len);
+    if(writeLen < 0) {
+        return _errorStatus(UNIX_FILE_WRITE_ERR, errno);
+    }
+    return writeLen;
+}
+
+static int _mockDataObjCreate(rcComm_t *conn, dataObjInp_t *dataObjInp) {
+    char localPath[MAX_NAME_LEN];
+    int flags = O_CREAT | O_TRUNC | O_RDWR;
+    int fd;
+    int l1descInx;
+
+    _delay(0);
+
+    _getLocalPath(dataObjInp->objPath, localPath);
+
+    // iRODS refuses to overwrite without the force flag
+    if(getValByKey(&dataObjInp->condInput, FORCE_FLAG_KW) == NULL) {
+        flags |= O_EXCL;
+    }
+
+    fd = open(localPath, flags, dataObjInp->createMode & 0777);
+    if(fd < 0) {
+        if(errno == EEXIST) {
+            return OVERWRITE_WITHOUT_FORCE_FLAG;
+        }
+        return _errorStatus(UNIX_FILE_CREATE_ERR, errno);
+    }
+
+    l1descInx = _allocL1Desc(conn, fd);
+    if(l1descInx < 0) {
+        close(fd);
+    }
+    return l1descInx;
+}
+
+static int _mockDataObjUnlink(rcComm_t *conn, dataObjInp_t *dataObjUnlinkInp) {
+    char localPath[MAX_NAME_LEN];
+
+    UNUSED(conn);
+
+    _delay(0);
+
+    _getLocalPath(dataObjUnlinkInp->objPath, localPath);
+
+    if(unlink(localPath) < 0) {
+        return _errorStatus(UNIX_FILE_UNLINK_ERR, errno);
+    }
+    return 0;
+}
+
+static int _mockCollCreate(rcComm_t *conn, collInp_t *collCreateInp) {
+    char localPath[MAX_NAME_LEN];
+
+    UNUSED(conn);
+
+    _delay(0);
+
+    _getLocalPath(collCreateInp->collName, localPath);
+
+    if(mkdir(localPath, 0755) < 0) {
+        return _errorStatus(UNIX_FILE_MKDIR_ERR, errno);
+    }
+    return 0;
+}
+
+static int _mockRmColl(rcComm_t *conn, collInp_t *rmCollInp, int vFlag) {
+    char localPath[MAX_NAME_LEN];
+
+    UNUSED(conn);
+    UNUSED(vFlag);
+
+    _delay(0);
+
+    _getLocalPath(rmCollInp->collName, localPath);
+
+    if(rmdir(localPath) < 0) {
+        if(errno == ENOTEMPTY || errno == EEXIST) {
+            return CAT_COLLECTION_NOT_EMPTY;
+        }
+        return _errorStatus(UNIX_FILE_RMDIR_ERR, errno);
+    }
+    return 0;
+}
+
+static int _mockDataObjRename(rcComm_t *conn, dataObjCopyInp_t *dataObjRenameInp) {
+    char localFromPath[MAX_NAME_LEN];
+    char localToPath[MAX_NAME_LEN];
+
+    UNUSED(conn);
+
+    _delay(0);
+
+    _getLocalPath(dataObjRenameInp->srcDataObjInp.objPath, localFromPath);
+    _getLocalPath(dataObjRenameInp->destDataObjInp.objPath, localToPath);
+
+    if(rename(localFromPath, localToPath) < 0) {
+        return _errorStatus(UNIX_FILE_RENAME_ERR, errno);
+    }
+    return 0;
+}
+
+static int _mockDataObjTruncate(rcComm_t *conn, dataObjInp_t *dataObjInp) {
+    char localPath[MAX_NAME_LEN];
+
+    UNUSED(conn);
+
+    _delay(0);
+
+    _getLocalPath(dataObjInp->objPath, localPath);
+
+    if(truncate(localPath, dataObjInp->dataSize) < 0) {
+        return _errorStatus(UNIX_FILE_TRUNCATE_ERR, errno);
+    }
+    return 0;
+}
+
+static int _mockModDataObjMeta(rcComm_t *conn, modDataObjMeta_t *modDataObjMetaInp) {
+    char localPath[MAX_NAME_LEN];
+    char *dataMode;
+
+    UNUSED(conn);
+
+    _delay(0);
+
+    // only data mode is modeled
+    dataMode = getValByKey(modDataObjMetaInp->regParam, DATA_MODE_KW);
+    if(dataMode == NULL) {
+        return 0;
+    }
+
+    _getLocalPath(modDataObjMetaInp->dataObjInfo->objPath, localPath);
+
+    if(chmod(localPath, atoi(dataMode) & 0777) < 0) {
+        return _errorStatus(UNIX_FILE_CHMOD_ERR, errno);
+    }
+    return 0;
+}
+
+static iFuseRodsClientBackend_t g_MockBackend = {
+    "mock",
+    _mockConnect,
+    _mockLogin,
+    _mockDisconnect,
+    _mockTicketAdmin,
+    _mockDataObjOpen,
+    _mockDataObjClose,
+    _mockOpenCollection,
+    _mockCloseCollection,
+    _mockReadCollection,
+    _mockGetHostForGet,
+    _mockGetHostForPut,
+    _mockGetMiscSvrInfo,
+    _mockObjStat,
+    _mockDataObjLseek,
+    _mockDataObjRead,
+    _mockDataObjWrite,
+    _mockDataObjCreate,
+    _mockDataObjUnlink,
+    _mockCollCreate,
+    _mockRmColl,
+    _mockDataObjRename,
+    _mockDataObjTruncate,
+    _mockModDataObjMeta
+};
+
+/*
+ * Initialize mock backend
+ */
+void iFuseMockBackendInit(const char *rootDir, int latencyUSec, int bandwidthKBps) {
+    char localPath[MAX_NAME_LEN];
+    int i;
+
+    assert(rootDir != NULL);
+
+    rstrcpy(g_MockRootDir, rootDir, MAX_NAME_LEN);
+    // strip trailing '/'
+    i = strlen(g_MockRootDir);
+    while(i > 1 && g_MockRootDir[i - 1] == '/') {
+        g_MockRootDir[i - 1] = 0;
+        i--;
+    }
+
+    g_MockLatencyUSec = latencyUSec > 0 ? latencyUSec : 0;
+    g_MockBandwidthKBps = bandwidthKBps > 0 ? bandwidthKBps : 0;
+
+    for(i=0;i<IFUSE_MOCK_MAX_COLLHANDLE;i++) {
+        g_MockCollHandle[i].inuse = false;
+        g_MockCollHandle[i].dir = NULL;
+    }
+
+    pthread_mutex_init(&g_MockLock, NULL);
+
+    // make sure the home collection exists
+    _getLocalPath(iFuseLibGetRodsEnv()->rodsHome, localPath);
+    _makeDirs(localPath);
+
+    iFuseLibLog(LOG_DEBUG, "iFuseMockBackendInit: serving %s, latency = %d usec, bandwidth = %d KB/s", g_MockRootDir, g_MockLatencyUSec, g_MockBandwidthKBps);
+}
+
+/*
+ * Destroy mock backend
+ */
+void iFuseMockBackendDestroy() {
+    int i;
+
+    pthread_mutex_lock(&g_MockLock);
+
+    while(!g_MockL1Desc.empty()) {
+        _freeL1DescTable(g_MockL1Desc.begin()->second);
+        g_MockL1Desc.erase(g_MockL1Desc.begin());
+    }
+
+    for(i=0;i<IFUSE_MOCK_MAX_COLLHANDLE;i++) {
+        if(g_MockCollHandle[i].inuse) {
+            closedir(g_MockCollHandle[i].dir);
+            g_MockCollHandle[i].inuse = false;
+        }
+    }
+
+    pthread_mutex_unlock(&g_MockLock);
+
+    pthread_mutex_destroy(&g_MockLock);
+}
+
+iFuseRodsClientBackend_t *iFuseMockBackendGet() {
+    return &g_MockBackend;
+}
@@ -8,130 +8,337 @@
 #include <time.h>
 #include <assert.h>
 #include <pthread.h>
-#include <list>
+#include <sched.h>
 #include <arpa/inet.h>
 #include "iFuse.Lib.hpp"
 #include "iFuse.Lib.RodsClientAPI.hpp"
 #include "iFuse.Lib.Util.hpp"
+#include "iFuse.Lib.MockBackend.hpp"
 #include "sockComm.h"
 #include "miscUtil.h"
 #include "ticketAdmin.h"
 
+/*
+ * In-flight operations are tracked in a fixed table of deadline slots.
+ * A slot is claimed by a CAS on conn, hashed by the connection pointer,
+ * so starting and ending an operation needs neither a heap allocation
+ * nor a shared lock. A connection runs one operation at a time.
+ * The checker takes a timed-out operation by a CAS of state from RUNNING
+ * to KILLING. The owner ending the operation meanwhile waits until the
+ * connection is killed, so the checker never touches a connection
+ * released (or freed) by its owner.
+ */
+#define IFUSE_RODSCLIENTAPI_OPER_FREE       0
+#define IFUSE_RODSCLIENTAPI_OPER_RUNNING    1
+#define IFUSE_RODSCLIENTAPI_OPER_KILLING    2
+#define IFUSE_RODSCLIENTAPI_OPER_KILLED     3
+
 typedef struct IFuseRodsClientOperation {
-    time_t start;
-    rcComm_t *conn;
+    rcComm_t * volatile conn;
+    volatile int state;
+    time_t deadline;
+    int operClass;
+    unsigned long long startUSec;
 } iFuseRodsClientOperation_t;
 
-static pthread_rwlock_t g_RodsClientAPILock;
-static pthread_rwlockattr_t g_RodsClientAPILockAttr;
-static std::list<iFuseRodsClientOperation_t*> g_Operations;
+static iFuseRodsClientOperation_t g_Operations[IFUSE_RODSCLIENTAPI_MAX_OPERATIONS];
 
 static int g_RodsapiTimeoutSec = IFUSE_RODSCLIENTAPI_TIMEOUT_SEC;
+static int g_RodsapiClassTimeoutSec[IFUSE_RODSCLIENTAPI_CLASS_NUM];
 static time_t g_LastRodsapiTimeoutCheck = 0;
 
+static volatile iFuseRodsClientResultHandlerCB g_ResultHandler = NULL;
+
+/*
+ * Default backend talking to iRODS servers
+ */
+static rcComm_t *_rodsConnect(const char *rodsHost, int rodsPort, const char *userName, const char *rodsZone, int reconnFlag, rErrMsg_t *errMsg) {
+    rcComm_t *conn = NULL;
+    conn = rcConnect(rodsHost, rodsPort, userName, rodsZone, reconnFlag, errMsg);
+    if(conn != NULL) {
+        socklen_t len;
+        struct sockaddr_storage addr;
+        char ipstr[INET6_ADDRSTRLEN];
+        int port;
+        len = sizeof addr;
+
+        getsockname(conn->sock, (struct sockaddr*)&addr, &len);
+
+        // deal with both IPv4 and IPv6:
+        if (addr.ss_family == AF_INET) {
+            struct sockaddr_in *s = (struct sockaddr_in *)&addr;
+            port = ntohs(s->sin_port);
+            inet_ntop(AF_INET, &s->sin_addr, ipstr, sizeof ipstr);
+        } else { // AF_INET6
+            struct sockaddr_in6 *s = (struct sockaddr_in6 *)&addr;
+            port = ntohs(s->sin6_port);
+            inet_ntop(AF_INET6, &s->sin6_addr, ipstr, sizeof ipstr);
+        }
+
+        iFuseLibLog(LOG_DEBUG, "iFuseRodsClientConnect: Local IP address: %s:%d\n", ipstr, port);
+    }
+
+    return conn;
+}
+
+static int _rodsLogin(rcComm_t *conn) {
+    return clientLogin(conn);
+}
+
+static int _rodsDisconnect(rcComm_t *conn) {
+    return rcDisconnect(conn);
+}
+
+static int _rodsTicketAdmin(rcComm_t *conn, ticketAdminInp_t *ticketAdminInp) {
+    return rcTicketAdmin(conn, ticketAdminInp);
+}
+
+static int _rodsDataObjOpen(rcComm_t *conn, dataObjInp_t *dataObjInp) {
+    return rcDataObjOpen(conn, dataObjInp);
+}
+
+static int _rodsDataObjClose(rcComm_t *conn, openedDataObjInp_t *dataObjCloseInp) {
+    return rcDataObjClose(conn, dataObjCloseInp);
+}
+
+static int _rodsOpenCollection(rcComm_t *conn, char *collection, int flag, collHandle_t *collHandle) {
+    return rclOpenCollection(conn, collection, flag, collHandle);
+}
+
+static int _rodsCloseCollection(collHandle_t *collHandle) {
+    return rclCloseCollection(collHandle);
+}
+
+static int _rodsReadCollection(rcComm_t *conn, collHandle_t *collHandle, collEnt_t *collEnt) {
+    return rclReadCollection(conn, collHandle, collEnt);
+}
+
+static int _rodsGetHostForGet(rcComm_t *conn, dataObjInp_t *dataObjInp, char **outHost) {
+    return rcGetHostForGet(conn, dataObjInp, outHost);
+}
+
+static int _rodsGetHostForPut(rcComm_t *conn, dataObjInp_t *dataObjInp, char **outHost) {
+    return rcGetHostForPut(conn, dataObjInp, outHost);
+}
+
+static int _rodsGetMiscSvrInfo(rcComm_t *conn, miscSvrInfo_t **miscSvrInfoOut) {
+    return rcGetMiscSvrInfo(conn, miscSvrInfoOut);
+}
+
+static int _rodsObjStat(rcComm_t *conn, dataObjInp_t *dataObjInp, rodsObjStat_t **rodsObjStatOut) {
+    return rcObjStat(conn, dataObjInp, rodsObjStatOut);
+}
+
+static int _rodsDataObjLseek(rcComm_t *conn, openedDataObjInp_t *dataObjLseekInp, fileLseekOut_t **dataObjLseekOut) {
+    return rcDataObjLseek(conn, dataObjLseekInp, dataObjLseekOut);
+}
+
+static int _rodsDataObjRead(rcComm_t *conn, openedDataObjInp_t *dataObjReadInp, bytesBuf_t *dataObjReadOutBBuf) {
+    return rcDataObjRead(conn, dataObjReadInp, dataObjReadOutBBuf);
+}
+
+static int _rodsDataObjWrite(rcComm_t *conn, openedDataObjInp_t *dataObjWriteInp, bytesBuf_t *dataObjWriteInpBBuf) {
+    return rcDataObjWrite(conn, dataObjWriteInp, dataObjWriteInpBBuf);
+}
+
+static int _rodsDataObjCreate(rcComm_t *conn, dataObjInp_t *dataObjInp) {
+    return rcDataObjCreate(conn, dataObjInp);
+}
+
+static int _rodsDataObjUnlink(rcComm_t *conn, dataObjInp_t *dataObjUnlinkInp) {
+    return rcDataObjUnlink(conn, dataObjUnlinkInp);
+}
+
+static int _rodsCollCreate(rcComm_t *conn, collInp_t *collCreateInp) {
+    return rcCollCreate(conn, collCreateInp);
+}
+
+static int _rodsRmColl(rcComm_t *conn, collInp_t *rmCollInp, int vFlag) {
+    return rcRmColl(conn, rmCollInp, vFlag);
+}
+
+static int _rodsDataObjRename(rcComm_t *conn, dataObjCopyInp_t *dataObjRenameInp) {
+    return rcDataObjRename(conn, dataObjRenameInp);
+}
+
+static int _rodsDataObjTruncate(rcComm_t *conn, dataObjInp_t *dataObjInp) {
+    return rcDataObjTruncate(conn, dataObjInp);
+}
+
+static int _rodsModDataObjMeta(rcComm_t *conn, modDataObjMeta_t *modDataObjMetaInp) {
+    return rcModDataObjMeta(conn, modDataObjMetaInp);
+}
+
+static iFuseRodsClientBackend_t g_RodsBackend = {
+    "irods",
+    _rodsConnect,
+    _rodsLogin,
+    _rodsDisconnect,
+    _rodsTicketAdmin,
+    _rodsDataObjOpen,
+    _rodsDataObjClose,
+    _rodsOpenCollection,
+    _rodsCloseCollection,
+    _rodsReadCollection,
+    _rodsGetHostForGet,
+    _rodsGetHostForPut,
+    _rodsGetMiscSvrInfo,
+    _rodsObjStat,
+    _rodsDataObjLseek,
+    _rodsDataObjRead,
+    _rodsDataObjWrite,
+    _rodsDataObjCreate,
+    _rodsDataObjUnlink,
+    _rodsCollCreate,
+    _rodsRmColl,
+    _rodsDataObjRename,
+    _rodsDataObjTruncate,
+    _rodsModDataObjMeta
+};
+
+static iFuseRodsClientBackend_t *g_Backend = &g_RodsBackend;
+
+static void _killConnection(rcComm_t *conn) {
+    socklen_t len;
+    struct sockaddr_storage addr;
+    char ipstr[INET6_ADDRSTRLEN];
+    int port;
+    len = sizeof addr;
+
+    getsockname(conn->sock, (struct sockaddr*)&addr, &len);
+
+    // deal with both IPv4 and IPv6:
+    if (addr.ss_family == AF_INET) {
+        struct sockaddr_in *s = (struct sockaddr_in *)&addr;
+        port = ntohs(s->sin_port);
+        inet_ntop(AF_INET, &s->sin_addr, ipstr, sizeof ipstr);
+    } else { // AF_INET6
+        struct sockaddr_in6 *s = (struct sockaddr_in6 *)&addr;
+        port = ntohs(s->sin6_port);
+        inet_ntop(AF_INET6, &s->sin6_addr, ipstr, sizeof ipstr);
+    }
+
+    iFuseLibLog(LOG_DEBUG, "_timeoutChecker: kill connection (Local IP address): %s:%d", ipstr, port);
+
+    // kill the connection
+    shutdown(conn->sock, 2);
+}
+
 static void _timeoutChecker() {
-    std::list<iFuseRodsClientOperation_t*>::iterator it_oper;
-    std::list<iFuseRodsClientOperation_t*> removeList;
     iFuseRodsClientOperation_t *oper;
     time_t currentTime;
-    
-    bool hasTimeout = false;
+    int i;
     
     //iFuseLibLog(LOG_DEBUG, "_timeoutChecker is called");
     
     currentTime = iFuseLibGetCurrentTime();
     
-    if(iFuseLibDiffTimeSec(currentTime, g_LastRodsapiTimeoutCheck) > g_RodsapiTimeoutSec / 2) {
+    // deadlines differ per operation class, check every second
+    if(iFuseLibDiffTimeSec(currentTime, g_LastRodsapiTimeoutCheck) >= 1) {
         //iFuseLibLog(LOG_DEBUG, "_timeoutChecker: checking timedout rodsAPI calls");
-        pthread_rwlock_rdlock(&g_RodsClientAPILock);
         
-        // iterate operation list to check timedout
-        for(it_oper=g_Operations.begin();it_oper!=g_Operations.end();it_oper++) {
-            oper = *it_oper;
-            
-            if(iFuseLibDiffTimeSec(currentTime, oper->start) >= g_RodsapiTimeoutSec) {
-                hasTimeout = true;
-                break;
+        // iterate operation slots to check timedout
+        for(i=0;i<IFUSE_RODSCLIENTAPI_MAX_OPERATIONS;i++) {
+            oper = &g_Operations[i];
+
+            if(oper->state != IFUSE_RODSCLIENTAPI_OPER_RUNNING) {
+                continue;
             }
-        }
-        
-        pthread_rwlock_unlock(&g_RodsClientAPILock);
-        
-        if(hasTimeout) {
-            pthread_rwlock_wrlock(&g_RodsClientAPILock);
-            
-            // iterate operation list to check timedout
-            for(it_oper=g_Operations.begin();it_oper!=g_Operations.end();it_oper++) {
-                oper = *it_oper;
-                
-                if(iFuseLibDiffTimeSec(currentTime, oper->start) >= g_RodsapiTimeoutSec) {
-                    iFuseLibLog(LOG_DEBUG, "_timeoutChecker: detected timed-out operation\n");
-                    removeList.push_back(oper);
-                }
+
+            if(iFuseLibDiffTimeSec(currentTime, oper->deadline) < 0) {
+                continue;
             }
-            
-            // iterate remove list
-            while(!removeList.empty()) {
-                oper = removeList.front();
-                removeList.pop_front();
-                g_Operations.remove(oper);
-
-                if(oper->conn != NULL) {
-                    socklen_t len;
-                    struct sockaddr_storage addr;
-                    char ipstr[INET6_ADDRSTRLEN];
-                    int port;
-                    len = sizeof addr;
-
-                    getsockname(oper->conn->sock, (struct sockaddr*)&addr, &len);
-
-                    // deal with both IPv4 and IPv6:
-                    if (addr.ss_family == AF_INET) {
-                        struct sockaddr_in *s = (struct sockaddr_in *)&addr;
-                        port = ntohs(s->sin_port);
-                        inet_ntop(AF_INET, &s->sin_addr, ipstr, sizeof ipstr);
-                    } else { // AF_INET6
-                        struct sockaddr_in6 *s = (struct sockaddr_in6 *)&addr;
-                        port = ntohs(s->sin6_port);
-                        inet_ntop(AF_INET6, &s->sin6_addr, ipstr, sizeof ipstr);
-                    }
-
-                    iFuseLibLog(LOG_DEBUG, "_timeoutChecker: kill connection (Local IP address): %s:%d\n", ipstr, port);
-
-                    // kill the connection
-                    shutdown(oper->conn->sock, 2);
-                }
+
+            // take the operation, its owner cannot release the slot from now
+            if(!__sync_bool_compare_and_swap(&oper->state, IFUSE_RODSCLIENTAPI_OPER_RUNNING, IFUSE_RODSCLIENTAPI_OPER_KILLING)) {
+                continue;
             }
-            
-            pthread_rwlock_unlock(&g_RodsClientAPILock);
+
+            // the slot may have been reused by another operation before the CAS
+            if(iFuseLibDiffTimeSec(currentTime, oper->deadline) < 0) {
+                __sync_bool_compare_and_swap(&oper->state, IFUSE_RODSCLIENTAPI_OPER_KILLING, IFUSE_RODSCLIENTAPI_OPER_RUNNING);
+                continue;
+            }
+
+            iFuseLibLog(LOG_DEBUG, "_timeoutChecker: detected timed-out operation");
+            _killConnection(oper->conn);
+
+            __sync_bool_compare_and_swap(&oper->state, IFUSE_RODSCLIENTAPI_OPER_KILLING, IFUSE_RODSCLIENTAPI_OPER_KILLED);
         }
         
         g_LastRodsapiTimeoutCheck = iFuseLibGetCurrentTime();
     }
 }
 
-static iFuseRodsClientOperation_t *_startOperationTimeout(rcComm_t *conn) {
-    iFuseRodsClientOperation_t *oper = (iFuseRodsClientOperation_t *)calloc(1, sizeof(iFuseRodsClientOperation_t));
-    if(oper == NULL) {
-        return NULL;
+/*
+ * Claim a deadline slot for an operation of the class
+ * returns -1 if all slots are in use, then the operation is not timed
+ */
+static int _startOperationTimeout(rcComm_t *conn, int operClass) {
+    unsigned long hash = ((unsigned long)conn) >> 4;
+    int i;
+
+    for(i=0;i<IFUSE_RODSCLIENTAPI_MAX_OPERATIONS;i++) {
+        int slot = (hash + i) % IFUSE_RODSCLIENTAPI_MAX_OPERATIONS;
+
+        if(__sync_bool_compare_and_swap(&g_Operations[slot].conn, (rcComm_t*)NULL, conn)) {
+            g_Operations[slot].operClass = operClass;
+            g_Operations[slot].startUSec = iFuseLibGetMonotonicTimeUSec();
+            g_Operations[slot].deadline = iFuseLibGetCurrentTime() + g_RodsapiClassTimeoutSec[operClass];
+
+            // the checker sees the deadline set above
+            __sync_bool_compare_and_swap(&g_Operations[slot].state, IFUSE_RODSCLIENTAPI_OPER_FREE, IFUSE_RODSCLIENTAPI_OPER_RUNNING);
+            return slot;
+        }
     }
-    
-    oper->start = iFuseLibGetCurrentTime();
-    oper->conn = conn;
-    
-    pthread_rwlock_wrlock(&g_RodsClientAPILock);
-    g_Operations.push_back(oper);
-    pthread_rwlock_unlock(&g_RodsClientAPILock);
-    
-    return oper;
+
+    iFuseLibLog(LOG_DEBUG, "_startOperationTimeout: no free deadline slot, operation is not timed");
+    return -1;
 }
 
-static void _endOperationTimeout(iFuseRodsClientOperation_t *oper) {
-    pthread_rwlock_wrlock(&g_RodsClientAPILock);
-    g_Operations.remove(oper);
-    pthread_rwlock_unlock(&g_RodsClientAPILock);
-    
-    free(oper);
+/*
+ * Release the deadline slot
+ * returns SYS_SOCK_READ_TIMEDOUT if the operation failed as its connection
+ * was killed at the deadline, otherwise status
+ */
+static int _endOperationTimeout(int slot, int status) {
+    iFuseRodsClientResultHandlerCB handler;
+    rcComm_t *conn = NULL;
+    unsigned long long rttUSec = 0;
+
+    if(slot >= 0) {
+        // wait for the checker killing the connection
+        while(!__sync_bool_compare_and_swap(&g_Operations[slot].state, IFUSE_RODSCLIENTAPI_OPER_RUNNING, IFUSE_RODSCLIENTAPI_OPER_FREE)) {
+            if(__sync_bool_compare_and_swap(&g_Operations[slot].state, IFUSE_RODSCLIENTAPI_OPER_KILLED, IFUSE_RODSCLIENTAPI_OPER_FREE)) {
+                if(status < 0) {
+                    status = SYS_SOCK_READ_TIMEDOUT;
+                }
+                break;
+            }
+            sched_yield();
+        }
+
+        // time of bulk-io is mostly transfer, not a round trip
+        conn = g_Operations[slot].conn;
+        if(g_Operations[slot].operClass != IFUSE_RODSCLIENTAPI_CLASS_BULK_IO) {
+            rttUSec = iFuseLibGetMonotonicTimeUSec() - g_Operations[slot].startUSec;
+        }
+
+        __sync_lock_release(&g_Operations[slot].conn);
+    }
+
+    handler = g_ResultHandler;
+    if(handler != NULL) {
+        handler(conn, status, rttUSec);
+    }
+    return status;
+}
+
+static int _getIOClass(openedDataObjInp_t *dataObjInp) {
+    if(dataObjInp->len > IFUSE_RODSCLIENTAPI_SMALL_IO_LEN) {
+        return IFUSE_RODSCLIENTAPI_CLASS_BULK_IO;
+    }
+    return IFUSE_RODSCLIENTAPI_CLASS_SMALL_IO;
 }
 
 /*
@@ -142,9 +349,34 @@ void iFuseRodsClientInit() {
     if(iFuseLibGetOption()->rodsapiTimeoutSec > 0) {
         g_RodsapiTimeoutSec = iFuseLibGetOption()->rodsapiTimeoutSec;
     }
+
+    // classes without a deadline follow --apitimeout
+    g_RodsapiClassTimeoutSec[IFUSE_RODSCLIENTAPI_CLASS_METADATA] = g_RodsapiTimeoutSec;
+    g_RodsapiClassTimeoutSec[IFUSE_RODSCLIENTAPI_CLASS_SMALL_IO] = g_RodsapiTimeoutSec;
+    g_RodsapiClassTimeoutSec[IFUSE_RODSCLIENTAPI_CLASS_BULK_IO] = g_RodsapiTimeoutSec;
+
+    if(iFuseLibGetOption()->rodsapiMetadataTimeoutSec > 0) {
+        g_RodsapiClassTimeoutSec[IFUSE_RODSCLIENTAPI_CLASS_METADATA] = iFuseLibGetOption()->rodsapiMetadataTimeoutSec;
+    }
+
+    if(iFuseLibGetOption()->rodsapiSmallIOTimeoutSec > 0) {
+        g_RodsapiClassTimeoutSec[IFUSE_RODSCLIENTAPI_CLASS_SMALL_IO] = iFuseLibGetOption()->rodsapiSmallIOTimeoutSec;
+    }
+
+    if(iFuseLibGetOption()->rodsapiBulkIOTimeoutSec > 0) {
+        g_RodsapiClassTimeoutSec[IFUSE_RODSCLIENTAPI_CLASS_BULK_IO] = iFuseLibGetOption()->rodsapiBulkIOTimeoutSec;
+    }
    
-    pthread_rwlockattr_init(&g_RodsClientAPILockAttr);
-    pthread_rwlock_init(&g_RodsClientAPILock, &g_RodsClientAPILockAttr);
+    bzero(g_Operations, sizeof(g_Operations));
+
+    if(iFuseLibGetOption()->mockBackend != NULL) {
+        iFuseMockBackendInit(iFuseLibGetOption()->mockBackend, iFuseLibGetOption()->mockLatencyUSec, iFuseLibGetOption()->mockBandwidthKBps);
+        g_Backend = iFuseMockBackendGet();
+    } else {
+        g_Backend = &g_RodsBackend;
+    }
+
+    iFuseLibLog(LOG_DEBUG, "iFuseRodsClientInit: using %s backend", g_Backend->name);
     
     iFuseLibSetTimerTickHandler(_timeoutChecker);
 }
@@ -154,9 +386,23 @@ void iFuseRodsClientInit() {
  */
 void iFuseRodsClientDestroy() {
     iFuseLibUnsetTimerTickHandler(_timeoutChecker);
-    
-    pthread_rwlock_destroy(&g_RodsClientAPILock);
-    pthread_rwlockattr_destroy(&g_RodsClientAPILockAttr);
+
+    if(g_Backend != &g_RodsBackend) {
+        iFuseMockBackendDestroy();
+        g_Backend = &g_RodsBackend;
+    }
+}
+
+/*
+ * Set a handler watching results of operations (e.g., to detect outages)
+ * NULL unsets the handler
+ */
+void iFuseRodsClientSetResultHandler(iFuseRodsClientResultHandlerCB callback) {
+    g_ResultHandler = callback;
+}
+
+const char *iFuseRodsClientGetBackendName() {
+    return g_Backend->name;
 }
 
 int iFuseRodsClientReadMsgError(int status) {
@@ -166,57 +412,36 @@ int iFuseRodsClientReadMsgError(int status) {
     if (irodsErr == SYS_READ_MSG_BODY_LEN_ERR ||
             irodsErr == SYS_HEADER_READ_LEN_ERR ||
             irodsErr == SYS_HEADER_WRITE_LEN_ERR ||
-            irodsErr == SYS_PACK_INSTRUCT_FORMAT_ERR) {
+            irodsErr == SYS_PACK_INSTRUCT_FORMAT_ERR ||
+            irodsErr == SYS_SOCK_READ_TIMEDOUT) {
         return 1;
     } else {
         return 0;
     }
 }
 
-rcComm_t *iFuseRodsClientConnect(const char *rodsHost, int rodsPort, const char *userName, const char *rodsZone, int reconnFlag, rErrMsg_t *errMsg) {
-    rcComm_t *conn = NULL;
-    conn = rcConnect(rodsHost, rodsPort, userName, rodsZone, reconnFlag, errMsg);
-    if(conn != NULL) {
-        socklen_t len;
-        struct sockaddr_storage addr;
-        char ipstr[INET6_ADDRSTRLEN];
-        int port;
-        len = sizeof addr;
-
-        getsockname(conn->sock, (struct sockaddr*)&addr, &len);
-
-        // deal with both IPv4 and IPv6:
-        if (addr.ss_family == AF_INET) {
-            struct sockaddr_in *s = (struct sockaddr_in *)&addr;
-            port = ntohs(s->sin_port);
-            inet_ntop(AF_INET, &s->sin_addr, ipstr, sizeof ipstr);
-        } else { // AF_INET6
-            struct sockaddr_in6 *s = (struct sockaddr_in6 *)&addr;
-            port = ntohs(s->sin6_port);
-            inet_ntop(AF_INET6, &s->sin6_addr, ipstr, sizeof ipstr);
-        }
-
-        iFuseLibLog(LOG_DEBUG, "iFuseRodsClientConnect: Local IP address: %s:%d\n", ipstr, port);
+int iFuseRodsClientTimedOutError(int status) {
+    if (getIrodsErrno( status ) == SYS_SOCK_READ_TIMEDOUT) {
+        return 1;
+    } else {
+        return 0;
     }
+}
 
-    return conn;
+rcComm_t *iFuseRodsClientConnect(const char *rodsHost, int rodsPort, const char *userName, const char *rodsZone, int reconnFlag, rErrMsg_t *errMsg) {
+    return g_Backend->connect(rodsHost, rodsPort, userName, rodsZone, reconnFlag, errMsg);
 }
 
 int iFuseRodsClientLogin(rcComm_t *conn) {
-    iFuseRodsClientOperation_t *oper = _startOperationTimeout(conn);
+    int oper = _startOperationTimeout(conn, IFUSE_RODSCLIENTAPI_CLASS_METADATA);
     int status;
     
-    if(oper == NULL) {
-        return SYS_MALLOC_ERR;
-    }
-    
-    status = clientLogin(conn);
-    _endOperationTimeout(oper);
-    return status;
+    status = g_Backend->login(conn);
+    return _endOperationTimeout(oper, status);
 }
 
 int iFuseRodsClientDisconnect(rcComm_t *conn) {
-    return rcDisconnect(conn);
+    return g_Backend->disconnect(conn);
 }
 
 int iFuseRodsClientMakeRodsPath(const char *path, char *iRodsPath) {
@@ -224,213 +449,157 @@ int iFuseRodsClientMakeRodsPath(const char *path, char *iRodsPath) {
 }
 
 int iFuseRodsClientSetSessionTicket(rcComm_t *conn, ticketAdminInp_t *ticketAdminInp) {
-    iFuseRodsClientOperation_t *oper = _startOperationTimeout(conn);
+    int oper = _startOperationTimeout(conn, IFUSE_RODSCLIENTAPI_CLASS_METADATA);
     int status;
     
-    if(oper == NULL) {
-        return SYS_MALLOC_ERR;
-    }
-
-    status = rcTicketAdmin(conn, ticketAdminInp);
-    _endOperationTimeout(oper);
-    return status;
+    status = g_Backend->ticketAdmin(conn, ticketAdminInp);
+    return _endOperationTimeout(oper, status);
 }
 
 int iFuseRodsClientDataObjOpen(rcComm_t *conn, dataObjInp_t *dataObjInp) {
-    iFuseRodsClientOperation_t *oper = _startOperationTimeout(conn);
+    int oper = _startOperationTimeout(conn, IFUSE_RODSCLIENTAPI_CLASS_SMALL_IO);
     int status;
     
-    if(oper == NULL) {
-        return SYS_MALLOC_ERR;
-    }
-    
-    status = rcDataObjOpen(conn, dataObjInp);
-    _endOperationTimeout(oper);
-    return status;
+    status = g_Backend->dataObjOpen(conn, dataObjInp);
+    return _endOperationTimeout(oper, status);
 }
 
 int iFuseRodsClientDataObjClose(rcComm_t *conn, openedDataObjInp_t *dataObjCloseInp) {
-    iFuseRodsClientOperation_t *oper = _startOperationTimeout(conn);
+    int oper = _startOperationTimeout(conn, IFUSE_RODSCLIENTAPI_CLASS_SMALL_IO);
     int status;
     
-    if(oper == NULL) {
-        return SYS_MALLOC_ERR;
-    }
-    
-    status = rcDataObjClose(conn, dataObjCloseInp);
-    _endOperationTimeout(oper);
-    return status;
+    status = g_Backend->dataObjClose(conn, dataObjCloseInp);
+    return _endOperationTimeout(oper, status);
 }
 
 int iFuseRodsClientOpenCollection(rcComm_t *conn, char *collection, int flag, collHandle_t *collHandle) {
-    iFuseRodsClientOperation_t *oper = _startOperationTimeout(conn);
+    int oper = _startOperationTimeout(conn, IFUSE_RODSCLIENTAPI_CLASS_METADATA);
     int status;
     
-    if(oper == NULL) {
-        return SYS_MALLOC_ERR;
-    }
-    
-    status = rclOpenCollection(conn, collection, flag, collHandle);
-    _endOperationTimeout(oper);
-    return status;
+    status = g_Backend->openCollection(conn, collection, flag, collHandle);
+    return _endOperationTimeout(oper, status);
 }
 
 int iFuseRodsClientCloseCollection(collHandle_t *collHandle) {
-    return rclCloseCollection(collHandle);
+    return g_Backend->closeCollection(collHandle);
 }
 
-int iFuseRodsClientObjStat(rcComm_t *conn, dataObjInp_t *dataObjInp, rodsObjStat_t **rodsObjStatOut) {
-    iFuseRodsClientOperation_t *oper = _startOperationTimeout(conn);
+int iFuseRodsClientGetHostForGet(rcComm_t *conn, dataObjInp_t *dataObjInp, char **outHost) {
+    int oper = _startOperationTimeout(conn, IFUSE_RODSCLIENTAPI_CLASS_METADATA);
     int status;
     
-    if(oper == NULL) {
-        return SYS_MALLOC_ERR;
-    }
+    status = g_Backend->getHostForGet(conn, dataObjInp, outHost);
+    return _endOperationTimeout(oper, status);
+}
+
+int iFuseRodsClientGetHostForPut(rcComm_t *conn, dataObjInp_t *dataObjInp, char **outHost) {
+    int oper = _startOperationTimeout(conn, IFUSE_RODSCLIENTAPI_CLASS_METADATA);
+    int status;
     
-    status = rcObjStat(conn, dataObjInp, rodsObjStatOut);
-    _endOperationTimeout(oper);
-    return status;
+    status = g_Backend->getHostForPut(conn, dataObjInp, outHost);
+    return _endOperationTimeout(oper, status);
 }
 
-int iFuseRodsClientDataObjLseek(rcComm_t *conn, openedDataObjInp_t *dataObjLseekInp, fileLseekOut_t **dataObjLseekOut) {
-    iFuseRodsClientOperation_t *oper = _startOperationTimeout(conn);
+int iFuseRodsClientGetMiscSvrInfo(rcComm_t *conn, miscSvrInfo_t **miscSvrInfoOut) {
+    int oper = _startOperationTimeout(conn, IFUSE_RODSCLIENTAPI_CLASS_METADATA);
     int status;
     
-    if(oper == NULL) {
-        return SYS_MALLOC_ERR;
-    }
+    status = g_Backend->getMiscSvrInfo(conn, miscSvrInfoOut);
+    return _endOperationTimeout(oper, status);
+}
+
+int iFuseRodsClientObjStat(rcComm_t *conn, dataObjInp_t *dataObjInp, rodsObjStat_t **rodsObjStatOut) {
+    int oper = _startOperationTimeout(conn, IFUSE_RODSCLIENTAPI_CLASS_METADATA);
+    int status;
     
-    status = rcDataObjLseek(conn, dataObjLseekInp, dataObjLseekOut);
-    _endOperationTimeout(oper);
-    return status;
+    status = g_Backend->objStat(conn, dataObjInp, rodsObjStatOut);
+    return _endOperationTimeout(oper, status);
 }
 
-int iFuseRodsClientDataObjRead(rcComm_t *conn, openedDataObjInp_t *dataObjReadInp, bytesBuf_t *dataObjReadOutBBuf) {
-    iFuseRodsClientOperation_t *oper = _startOperationTimeout(conn);
+int iFuseRodsClientDataObjLseek(rcComm_t *conn, openedDataObjInp_t *dataObjLseekInp, fileLseekOut_t **dataObjLseekOut) {
+    int oper = _startOperationTimeout(conn, IFUSE_RODSCLIENTAPI_CLASS_SMALL_IO);
     int status;
     
-    if(oper == NULL) {
-        return SYS_MALLOC_ERR;
-    }
+    status = g_Backend->dataObjLseek(conn, dataObjLseekInp, dataObjLseekOut);
+    return _endOperationTimeout(oper, status);
+}
+
+int iFuseRodsClientDataObjRead(rcComm_t *conn, openedDataObjInp_t *dataObjReadInp, bytesBuf_t *dataObjReadOutBBuf) {
+    int oper = _startOperationTimeout(conn, _getIOClass(dataObjReadInp));
+    int status;
     
-    status = rcDataObjRead(conn, dataObjReadInp, dataObjReadOutBBuf);
-    _endOperationTimeout(oper);
-    return status;
+    status = g_Backend->dataObjRead(conn, dataObjReadInp, dataObjReadOutBBuf);
+    return _endOperationTimeout(oper, status);
 }
 
 int iFuseRodsClientDataObjWrite(rcComm_t *conn, openedDataObjInp_t *dataObjWriteInp, bytesBuf_t *dataObjWriteInpBBuf) {
-    iFuseRodsClientOperation_t *oper = _startOperationTimeout(conn);
+    int oper = _startOperationTimeout(conn, _getIOClass(dataObjWriteInp));
     int status;
     
-    if(oper == NULL) {
-        return SYS_MALLOC_ERR;
-    }
-    
-    status = rcDataObjWrite(conn, dataObjWriteInp, dataObjWriteInpBBuf);
-    _endOperationTimeout(oper);
-    return status;
+    status = g_Backend->dataObjWrite(conn, dataObjWriteInp, dataObjWriteInpBBuf);
+    return _endOperationTimeout(oper, status);
 }
 
 int iFuseRodsClientDataObjCreate(rcComm_t *conn, dataObjInp_t *dataObjInp) {
-    iFuseRodsClientOperation_t *oper = _startOperationTimeout(conn);
+    int oper = _startOperationTimeout(conn, IFUSE_RODSCLIENTAPI_CLASS_METADATA);
     int status;
     
-    if(oper == NULL) {
-        return SYS_MALLOC_ERR;
-    }
-    
-    status = rcDataObjCreate(conn, dataObjInp);
-    _endOperationTimeout(oper);
-    return status;
+    status = g_Backend->dataObjCreate(conn, dataObjInp);
+    return _endOperationTimeout(oper, status);
 }
 
 int iFuseRodsClientDataObjUnlink(rcComm_t *conn, dataObjInp_t *dataObjUnlinkInp) {
-    iFuseRodsClientOperation_t *oper = _startOperationTimeout(conn);
+    int oper = _startOperationTimeout(conn, IFUSE_RODSCLIENTAPI_CLASS_METADATA);
     int status;
     
-    if(oper == NULL) {
-        return SYS_MALLOC_ERR;
-    }
-    
-    status = rcDataObjUnlink(conn, dataObjUnlinkInp);
-    _endOperationTimeout(oper);
-    return status;
+    status = g_Backend->dataObjUnlink(conn, dataObjUnlinkInp);
+    return _endOperationTimeout(oper, status);
 }
 
 int iFuseRodsClientReadCollection(rcComm_t *conn, collHandle_t *collHandle, collEnt_t *collEnt) {
-    iFuseRodsClientOperation_t *oper = _startOperationTimeout(conn);
+    int oper = _startOperationTimeout(conn, IFUSE_RODSCLIENTAPI_CLASS_METADATA);
     int status;
     
-    if(oper == NULL) {
-        return SYS_MALLOC_ERR;
-    }
-    
-    status = rclReadCollection(conn, collHandle, collEnt);
-    _endOperationTimeout(oper);
-    return status;
+    status = g_Backend->readCollection(conn, collHandle, collEnt);
+    return _endOperationTimeout(oper, status);
 }
 
 int iFuseRodsClientCollCreate(rcComm_t *conn, collInp_t *collCreateInp) {
-    iFuseRodsClientOperation_t *oper = _startOperationTimeout(conn);
+    int oper = _startOperationTimeout(conn, IFUSE_RODSCLIENTAPI_CLASS_METADATA);
     int status;
     
-    if(oper == NULL) {
-        return SYS_MALLOC_ERR;
-    }
-    
-    status = rcCollCreate(conn, collCreateInp);
-    _endOperationTimeout(oper);
-    return status;
+    status = g_Backend->collCreate(conn, collCreateInp);
+    return _endOperationTimeout(oper, status);
 }
 
 int iFuseRodsClientRmColl(rcComm_t *conn, collInp_t *rmCollInp, int vFlag) {
-    iFuseRodsClientOperation_t *oper = _startOperationTimeout(conn);
+    int oper = _startOperationTimeout(conn, IFUSE_RODSCLIENTAPI_CLASS_METADATA);
     int status;
     
-    if(oper == NULL) {
-        return SYS_MALLOC_ERR;
-    }
-    
-    status = rcRmColl(conn, rmCollInp, vFlag);
-    _endOperationTimeout(oper);
-    return status;
+    status = g_Backend->rmColl(conn, rmCollInp, vFlag);
+    return _endOperationTimeout(oper, status);
 }
 
 int iFuseRodsClientDataObjRename(rcComm_t *conn, dataObjCopyInp_t *dataObjRenameInp) {
-    iFuseRodsClientOperation_t *oper = _startOperationTimeout(conn);
+    int oper = _startOperationTimeout(conn, IFUSE_RODSCLIENTAPI_CLASS_METADATA);
     int status;
     
-    if(oper == NULL) {
-        return SYS_MALLOC_ERR;
-    }
-    
-    status = rcDataObjRename(conn, dataObjRenameInp);
-    _endOperationTimeout(oper);
-    return status;
+    status = g_Backend->dataObjRename(conn, dataObjRenameInp);
+    return _endOperationTimeout(oper, status);
 }
 
 int iFuseRodsClientDataObjTruncate(rcComm_t *conn, dataObjInp_t *dataObjInp) {
-    iFuseRodsClientOperation_t *oper = _startOperationTimeout(conn);
+    int oper = _startOperationTimeout(conn, IFUSE_RODSCLIENTAPI_CLASS_METADATA);
     int status;
     
-    if(oper == NULL) {
-        return SYS_MALLOC_ERR;
-    }
-    
-    status = rcDataObjTruncate(conn, dataObjInp);
-    _endOperationTimeout(oper);
-    return status;
+    status = g_Backend->dataObjTruncate(conn, dataObjInp);
+    return _endOperationTimeout(oper, status);
 }
 
 int iFuseRodsClientModDataObjMeta(rcComm_t *conn, modDataObjMeta_t *modDataObjMetaInp) {
-    iFuseRodsClientOperation_t *oper = _startOperationTimeout(conn);
+    int oper = _startOperationTimeout(conn, IFUSE_RODSCLIENTAPI_CLASS_METADATA);
     int status;
     
-    if(oper == NULL) {
-        return SYS_MALLOC_ERR;
-    }
-    
-    status = rcModDataObjMeta(conn, modDataObjMetaInp);
-    _endOperationTimeout(oper);
-    return status;
+    status = g_Backend->modDataObjMeta(conn, modDataObjMetaInp);
+    return _endOperationTimeout(oper, status);
 }
@@ -59,6 +59,34 @@ double iFuseLibDiffTimeSec(time_t end, time_t beginning) {
     return difftime(end, beginning);
 }
 
+/*
+ * Milliseconds from an arbitrary point, only useful to measure elapsed time
+ */
+unsigned long long iFuseLibGetMonotonicTimeMSec() {
+    struct timespec ts;
+    clock_gettime(CLOCK_MONOTONIC, &ts);
+    return ((unsigned long long)ts.tv_sec * 1000) + (ts.tv_nsec / 1000000);
+}
+
+unsigned long long iFuseLibGetMonotonicTimeUSec() {
+    struct timespec ts;
+    clock_gettime(CLOCK_MONOTONIC, &ts);
+    return ((unsigned long long)ts.tv_sec * 1000000) + (ts.tv_nsec / 1000);
+}
+
+/*
+ * Absolute time after given milliseconds, for pthread_cond_timedwait
+ */
+void iFuseLibGetTimespecAfterMSec(struct timespec *ts, int msec) {
+    clock_gettime(CLOCK_REALTIME, ts);
+    ts->tv_sec += msec / 1000;
+    ts->tv_nsec += (long)(msec % 1000) * 1000000;
+    if(ts->tv_nsec >= 1000000000) {
+        ts->tv_sec++;
+        ts->tv_nsec -= 1000000000;
+    }
+}
+
 int iFuseLibSplitPath(const char *srcPath, char *dir, unsigned int maxDirLen, char *file, unsigned int maxFileLen) {
     const std::string srcPathString(srcPath);
     if(srcPathString.size() == 0) {
@@ -12,7 +12,9 @@
 #include <unistd.h>
 #include "iFuse.Lib.hpp"
 #include "iFuse.Lib.RodsClientAPI.hpp"
+#include "iFuse.Lib.Admission.hpp"
 #include "iFuse.Lib.Conn.hpp"
+#include "iFuse.Lib.Engine.hpp"
 #include "iFuse.Lib.Fd.hpp"
 #include "iFuse.Lib.MetadataCache.hpp"
 #include "iFuse.Lib.Util.hpp"
@@ -84,6 +86,9 @@ void iFuseLibInit() {
     
     iFuseUtilInit();
     
+    iFuseAdmissionInit();
+    iFuseEngineInit();
+    
     iFuseRodsClientInit();
     iFuseConnInit();
     
@@ -100,6 +105,9 @@ void iFuseLibDestroy() {
     iFuseConnDestroy();
     iFuseRodsClientDestroy();
     
+    iFuseEngineDestroy();
+    iFuseAdmissionDestroy();
+    
     iFuseUtilDestroy();
     
     pthread_rwlock_destroy(&g_TimerHandlerLock);
@@ -13,6 +13,7 @@
 #include "iFuse.FS.hpp"
 #include "iFuse.Lib.hpp"
 #include "iFuse.Lib.Fd.hpp"
+#include "iFuse.Lib.Engine.hpp"
 #include "iFuse.Preload.hpp"
 #include "iFuse.BufferedFS.hpp"
 #include "iFuse.Lib.Util.hpp"
@@ -25,6 +26,8 @@ static pthread_rwlock_t g_PreloadLock;
 static std::map<unsigned long, iFusePreload_t*> g_PreloadMap;
 
 static int g_preloadNumBlocks = IFUSE_PRELOAD_PBLOCK_NUM;
+static int g_preloadStripeNum = IFUSE_PRELOAD_STRIPE_NUM;
+static off_t g_preloadStripeMinSize = (off_t)IFUSE_PRELOAD_STRIPE_MIN_SIZE_MB * 1024 * 1024;
 
 static int _newPreloadPBlock(const char *iRodsPath, iFusePreloadPBlock_t **iFusePreloadPBlock) {
     iFusePreloadPBlock_t *tmpIFusePreloadPBlock = NULL;
@@ -74,20 +77,47 @@ static int _newPreload(iFusePreload_t **iFusePreload) {
     return 0;
 }
 
+/*
+ * Take a preload task out of the engine queue if it has not started yet
+ */
+static void _cancelPreloadTask(iFusePreloadPBlock_t *iFusePreloadPBlock) {
+    assert(iFusePreloadPBlock != NULL);
+
+    if(iFusePreloadPBlock->request == NULL || iFusePreloadPBlock->taskJoined) {
+        return;
+    }
+
+    if(!iFuseEngineCancel(iFusePreloadPBlock->request)) {
+        return;
+    }
+
+    iFuseLibLog(LOG_DEBUG, "_cancelPreloadTask: canceled a preload task of blockID: %u", iFusePreloadPBlock->blockID);
+
+    // the task param is not freed by the task
+    free(iFusePreloadPBlock->request->param);
+
+    pthread_rwlock_wrlock(&iFusePreloadPBlock->lock);
+    iFusePreloadPBlock->status = IFUSE_PRELOAD_PBLOCK_STATUS_TASK_FAILED;
+    iFusePreloadPBlock->taskJoined = true;
+    pthread_rwlock_unlock(&iFusePreloadPBlock->lock);
+}
+
 static int _freePreloadPBlock(iFusePreloadPBlock_t *iFusePreloadPBlock) {
     assert(iFusePreloadPBlock != NULL);
 
+    _cancelPreloadTask(iFusePreloadPBlock);
+
     if(iFusePreloadPBlock->status == IFUSE_PRELOAD_PBLOCK_STATUS_RUNNING ||
             iFusePreloadPBlock->status == IFUSE_PRELOAD_PBLOCK_STATUS_INIT ||
             iFusePreloadPBlock->status == IFUSE_PRELOAD_PBLOCK_STATUS_COMPLETED ||
             iFusePreloadPBlock->status == IFUSE_PRELOAD_PBLOCK_STATUS_TASK_FAILED) {
-        if(!iFusePreloadPBlock->threadJoined) {
-            pthread_join(iFusePreloadPBlock->thread, NULL);
+        if(!iFusePreloadPBlock->taskJoined) {
+            iFuseEngineWait(iFusePreloadPBlock->request);
 
             pthread_rwlock_wrlock(&iFusePreloadPBlock->lock);
 
             // set to joined
-            iFusePreloadPBlock->threadJoined = true;
+            iFusePreloadPBlock->taskJoined = true;
 
             pthread_rwlock_unlock(&iFusePreloadPBlock->lock);
         }
@@ -95,6 +125,11 @@ static int _freePreloadPBlock(iFusePreloadPBlock_t *iFusePreloadPBlock) {
 
     pthread_rwlock_wrlock(&iFusePreloadPBlock->lock);
 
+    if(iFusePreloadPBlock->request != NULL) {
+        iFuseEngineRelease(iFusePreloadPBlock->request);
+        iFusePreloadPBlock->request = NULL;
+    }
+
     if(iFusePreloadPBlock->fd != NULL) {
         iFuseBufferedFsClose(iFusePreloadPBlock->fd);
         iFusePreloadPBlock->fd = NULL;
@@ -160,28 +195,18 @@ static int _releaseAllPreload() {
     return 0;
 }
 
-static void* _preloadTask(void* param) {
+static int _preloadTask(void* param) {
     int status = 0;
-    iFusePreloadThreadParam_t *iFusePreloadThreadParam;
+    iFusePreloadTaskParam_t *iFusePreloadTaskParam;
     iFusePreload_t *iFusePreload;
     iFusePreloadPBlock_t *iFusePreloadPBlock;
     iFuseFd_t *iFuseFd;
-    char *blockBuffer = (char*)calloc(1, getBufferCacheBlockSize());
 
     assert(param != NULL);
 
-    iFusePreloadThreadParam = (iFusePreloadThreadParam_t*)param;
-    iFusePreload = iFusePreloadThreadParam->preload;
-    iFusePreloadPBlock = iFusePreloadThreadParam->pblock;
-
-    if(blockBuffer == NULL) {
-        free(iFusePreloadThreadParam);
-
-        pthread_rwlock_wrlock(&iFusePreloadPBlock->lock);
-        iFusePreloadPBlock->status = IFUSE_PRELOAD_PBLOCK_STATUS_TASK_FAILED;
-        pthread_rwlock_unlock(&iFusePreloadPBlock->lock);
-        return NULL;
-    }
+    iFusePreloadTaskParam = (iFusePreloadTaskParam_t*)param;
+    iFusePreload = iFusePreloadTaskParam->preload;
+    iFusePreloadPBlock = iFusePreloadTaskParam->pblock;
 
     iFuseLibLog(LOG_DEBUG, "_preloadTask: preloading %s, blockID: %u", iFusePreload->iRodsPath, iFusePreloadPBlock->blockID);
 
@@ -190,13 +215,12 @@ static void* _preloadTask(void* param) {
         if (status < 0) {
             iFuseLibLogError(LOG_ERROR, status, "_preloadTask: iFuseBufferedFsOpen of %s error, status = %d",
                     iFusePreload->iRodsPath, status);
-            free(blockBuffer);
-            free(iFusePreloadThreadParam);
+            free(iFusePreloadTaskParam);
 
             pthread_rwlock_wrlock(&iFusePreloadPBlock->lock);
             iFusePreloadPBlock->status = IFUSE_PRELOAD_PBLOCK_STATUS_TASK_FAILED;
             pthread_rwlock_unlock(&iFusePreloadPBlock->lock);
-            return NULL;
+            return status;
         }
 
         pthread_rwlock_wrlock(&iFusePreloadPBlock->lock);
@@ -204,33 +228,42 @@ static void* _preloadTask(void* param) {
         pthread_rwlock_unlock(&iFusePreloadPBlock->lock);
     }
 
-    status = iFuseBufferedFsReadBlock(iFusePreloadPBlock->fd, blockBuffer, iFusePreloadPBlock->blockID);
+    // only load the block into the buffer cache of the fd
+    status = iFuseBufferedFsReadBlock(iFusePreloadPBlock->fd, NULL, iFusePreloadPBlock->blockID, 0, 0);
     if (status < 0) {
         iFuseLibLogError(LOG_ERROR, status, "_preloadTask: iFuseBufferedFsReadBlock of %s error, status = %d",
                 iFusePreloadPBlock->fd->iRodsPath, status);
-        free(blockBuffer);
-        free(iFusePreloadThreadParam);
+        free(iFusePreloadTaskParam);
 
         pthread_rwlock_wrlock(&iFusePreloadPBlock->lock);
         iFusePreloadPBlock->status = IFUSE_PRELOAD_PBLOCK_STATUS_TASK_FAILED;
         pthread_rwlock_unlock(&iFusePreloadPBlock->lock);
-        return NULL;
+        return status;
     }
 
-    free(blockBuffer);
-
     pthread_rwlock_wrlock(&iFusePreloadPBlock->lock);
     iFusePreloadPBlock->status = IFUSE_PRELOAD_PBLOCK_STATUS_COMPLETED;
     pthread_rwlock_unlock(&iFusePreloadPBlock->lock);
 
-    free(iFusePreloadThreadParam);
+    free(iFusePreloadTaskParam);
 
-    return NULL;
+    return 0;
+}
+
+static bool _isPastEOF(iFusePreload_t *iFusePreload, unsigned int blockID) {
+    assert(iFusePreload != NULL);
+
+    // size is unknown for files opened for write
+    if(iFusePreload->size < 0) {
+        return false;
+    }
+
+    return getBlockStartOffset(blockID) >= iFusePreload->size;
 }
 
 int _startPreload(iFusePreload_t *iFusePreload, unsigned int blockID, iFuseFd_t *iFuseFd) {
     int status = 0;
-    iFusePreloadThreadParam_t *iFusePreloadThreadParam;
+    iFusePreloadTaskParam_t *iFusePreloadTaskParam;
     iFusePreloadPBlock_t *iFusePreloadPBlock;
 
     assert(iFusePreload != NULL);
@@ -246,21 +279,28 @@ int _startPreload(iFusePreload_t *iFusePreload, unsigned int blockID, iFuseFd_t
     iFusePreloadPBlock->blockID = blockID;
     iFusePreloadPBlock->status = IFUSE_PRELOAD_PBLOCK_STATUS_RUNNING;
 
-    iFusePreloadThreadParam = (iFusePreloadThreadParam_t*) calloc(1, sizeof(iFusePreloadThreadParam_t));
-    if(iFusePreloadThreadParam == NULL) {
+    iFusePreloadTaskParam = (iFusePreloadTaskParam_t*) calloc(1, sizeof(iFusePreloadTaskParam_t));
+    if(iFusePreloadTaskParam == NULL) {
         return SYS_MALLOC_ERR;
     }
 
-    iFusePreloadThreadParam->preload = iFusePreload;
-    iFusePreloadThreadParam->pblock = iFusePreloadPBlock;
+    iFusePreloadTaskParam->preload = iFusePreload;
+    iFusePreloadTaskParam->pblock = iFusePreloadPBlock;
 
-    status = pthread_create(&iFusePreloadPBlock->thread, NULL, _preloadTask, (void*)iFusePreloadThreadParam);
-    if(status != 0) {
-        iFuseLibLogError(LOG_ERROR, status, "_startPreload: failed to create a thread for %s of block id %u, status = %d",
+    status = iFuseEngineSubmitBackground(_preloadTask, (void*)iFusePreloadTaskParam, getBufferCacheBlockSize(), &iFusePreloadPBlock->request);
+    if(status == -EBUSY) {
+        // shed by admission control, the block is read when requested
+        iFuseLibLog(LOG_DEBUG, "_startPreload: preload of %s of block id %u is shed", iFusePreload->iRodsPath, blockID);
+        iFusePreloadPBlock->status = IFUSE_PRELOAD_PBLOCK_STATUS_CREATION_FAILED;
+        _freePreloadPBlock(iFusePreloadPBlock);
+        free(iFusePreloadTaskParam);
+        return status;
+    } else if(status < 0) {
+        iFuseLibLogError(LOG_ERROR, status, "_startPreload: failed to submit a task for %s of block id %u, status = %d",
                 iFusePreload->iRodsPath, blockID, status);
         iFusePreloadPBlock->status = IFUSE_PRELOAD_PBLOCK_STATUS_CREATION_FAILED;
         _freePreloadPBlock(iFusePreloadPBlock);
-        free(iFusePreloadThreadParam);
+        free(iFusePreloadTaskParam);
         return -1;
     }
 
@@ -272,7 +312,7 @@ int _startPreload(iFusePreload_t *iFusePreload, unsigned int blockID, iFuseFd_t
     return status;
 }
 
-int _readPreload(iFusePreload_t *iFusePreload, char *buf, unsigned int blockID) {
+int _readPreload(iFusePreload_t *iFusePreload, char *buf, unsigned int blockID, off_t inBlockOffset, size_t size) {
     size_t readSize = 0;
     std::list<iFusePreloadPBlock_t*> removeList;
     std::list<iFusePreloadPBlock_t*> recycleList;
@@ -280,7 +320,7 @@ int _readPreload(iFusePreload_t *iFusePreload, char *buf, unsigned int blockID)
     iFusePreloadPBlock_t *iFusePreloadPBlock = NULL;
     iFuseFd_t *iFuseFd = NULL;
     bool hasBlock = false;
-    bool *pblockExistance = (bool*)calloc(g_preloadNumBlocks, sizeof(bool));
+    bool *pblockExistance = (bool*)calloc(iFusePreload->numBlocks, sizeof(bool));
     int i;
 
     assert(iFusePreload != NULL);
@@ -290,7 +330,7 @@ int _readPreload(iFusePreload_t *iFusePreload, char *buf, unsigned int blockID)
         return SYS_MALLOC_ERR;
     }
 
-    bzero(pblockExistance, g_preloadNumBlocks * sizeof(bool));
+    bzero(pblockExistance, iFusePreload->numBlocks * sizeof(bool));
 
     pthread_rwlock_wrlock(&iFusePreload->lock);
 
@@ -302,7 +342,7 @@ int _readPreload(iFusePreload_t *iFusePreload, char *buf, unsigned int blockID)
             // has block
             hasBlock = true;
         } else if(blockID > iFusePreloadPBlock->blockID ||
-                blockID + g_preloadNumBlocks < iFusePreloadPBlock->blockID) {
+                blockID + iFusePreload->numBlocks < iFusePreloadPBlock->blockID) {
             // remove old blocks
             // if block id is less than current block id
             // or block id is far larger than current block id (for backward read)
@@ -311,7 +351,7 @@ int _readPreload(iFusePreload_t *iFusePreload, char *buf, unsigned int blockID)
             removeList.push_back(iFusePreloadPBlock);
         } else {
             // preloaded blocks
-            if(iFusePreloadPBlock->blockID - blockID - 1 < (unsigned int)g_preloadNumBlocks) {
+            if(iFusePreloadPBlock->blockID - blockID - 1 < (unsigned int)iFusePreload->numBlocks) {
                 pblockExistance[iFusePreloadPBlock->blockID - blockID - 1] = true;
             }
         }
@@ -321,19 +361,22 @@ int _readPreload(iFusePreload_t *iFusePreload, char *buf, unsigned int blockID)
     for(it_preloadpblock=removeList.begin();it_preloadpblock!=removeList.end();it_preloadpblock++) {
         iFusePreloadPBlock = *it_preloadpblock;
 
+        // blocks not started yet are dropped without reading
+        _cancelPreloadTask(iFusePreloadPBlock);
+
         if(iFusePreloadPBlock->status == IFUSE_PRELOAD_PBLOCK_STATUS_RUNNING ||
                 iFusePreloadPBlock->status == IFUSE_PRELOAD_PBLOCK_STATUS_INIT ||
                 iFusePreloadPBlock->status == IFUSE_PRELOAD_PBLOCK_STATUS_COMPLETED ||
                 iFusePreloadPBlock->status == IFUSE_PRELOAD_PBLOCK_STATUS_TASK_FAILED) {
-            if(!iFusePreloadPBlock->threadJoined) {
-                iFuseLibLog(LOG_DEBUG, "_readPreload: waiting for a preload thread of %s, blockID: %u", iFusePreload->iRodsPath, iFusePreloadPBlock->blockID);
+            if(!iFusePreloadPBlock->taskJoined) {
+                iFuseLibLog(LOG_DEBUG, "_readPreload: waiting for a preload task of %s, blockID: %u", iFusePreload->iRodsPath, iFusePreloadPBlock->blockID);
 
-                pthread_join(iFusePreloadPBlock->thread, NULL);
+                iFuseEngineWait(iFusePreloadPBlock->request);
 
                 pthread_rwlock_wrlock(&iFusePreloadPBlock->lock);
 
                 // set to joined
-                iFusePreloadPBlock->threadJoined = true;
+                iFusePreloadPBlock->taskJoined = true;
 
                 pthread_rwlock_unlock(&iFusePreloadPBlock->lock);
             }
@@ -351,7 +394,7 @@ int _readPreload(iFusePreload_t *iFusePreload, char *buf, unsigned int blockID)
         iFusePreload->pblocks->remove(iFusePreloadPBlock);
         if(iFusePreloadPBlock->fd != NULL &&
                 iFusePreloadPBlock->status == IFUSE_PRELOAD_PBLOCK_STATUS_COMPLETED &&
-                iFusePreloadPBlock->threadJoined) {
+                iFusePreloadPBlock->taskJoined) {
             // reusable
             recycleList.push_back(iFusePreloadPBlock);
         } else {
@@ -388,27 +431,27 @@ int _readPreload(iFusePreload_t *iFusePreload, char *buf, unsigned int blockID)
                     iFusePreloadPBlock->status == IFUSE_PRELOAD_PBLOCK_STATUS_RUNNING ||
                     iFusePreloadPBlock->status == IFUSE_PRELOAD_PBLOCK_STATUS_COMPLETED ||
                     iFusePreloadPBlock->status == IFUSE_PRELOAD_PBLOCK_STATUS_TASK_FAILED) {
-                if(!iFusePreloadPBlock->threadJoined) {
-                    iFuseLibLog(LOG_DEBUG, "_readPreload: waiting for a preload thread of %s, blockID: %u", iFusePreload->iRodsPath, blockID);
+                if(!iFusePreloadPBlock->taskJoined) {
+                    iFuseLibLog(LOG_DEBUG, "_readPreload: waiting for a preload task of %s, blockID: %u", iFusePreload->iRodsPath, blockID);
 
-                    pthread_join(iFusePreloadPBlock->thread, NULL);
+                    iFuseEngineWait(iFusePreloadPBlock->request);
 
                     pthread_rwlock_wrlock(&iFusePreloadPBlock->lock);
 
                     // set to joined
-                    iFusePreloadPBlock->threadJoined = true;
+                    iFusePreloadPBlock->taskJoined = true;
 
                     pthread_rwlock_unlock(&iFusePreloadPBlock->lock);
                 }
             }
 
             if(iFusePreloadPBlock->status == IFUSE_PRELOAD_PBLOCK_STATUS_COMPLETED &&
-                    iFusePreloadPBlock->threadJoined) {
+                    iFusePreloadPBlock->taskJoined) {
                 pthread_rwlock_rdlock(&iFusePreloadPBlock->lock);
 
                 if(iFusePreloadPBlock->fd != NULL) {
                     iFuseLibLog(LOG_DEBUG, "_readPreload: reading a block from preloaded data of %s, blockID: %u", iFusePreload->iRodsPath, blockID);
-                    readSize = iFuseBufferedFsReadBlock(iFusePreloadPBlock->fd, buf, blockID);
+                    readSize = iFuseBufferedFsReadBlock(iFusePreloadPBlock->fd, buf, blockID, inBlockOffset, size);
                 } else {
                     readSize = -1;
                 }
@@ -422,8 +465,8 @@ int _readPreload(iFusePreload_t *iFusePreload, char *buf, unsigned int blockID)
     
     pthread_rwlock_unlock(&iFusePreload->lock);
 
-    for(i=0;i<g_preloadNumBlocks;i++) {
-        if(!pblockExistance[i]) {
+    for(i=0;i<iFusePreload->numBlocks;i++) {
+        if(!pblockExistance[i] && !_isPastEOF(iFusePreload, i + blockID + 1)) {
             // start preload
             iFuseFd = NULL;
             if(!recycleList.empty()) {
@@ -444,7 +487,7 @@ int _readPreload(iFusePreload_t *iFusePreload, char *buf, unsigned int blockID)
     // release entries in recycleList that will not be used
     while(!recycleList.empty()) {
         iFusePreloadPBlock = recycleList.front();
-        removeList.pop_front();
+        recycleList.pop_front();
         _freePreloadPBlock(iFusePreloadPBlock);
     }
 
@@ -463,6 +506,13 @@ void iFusePreloadInit() {
             g_preloadNumBlocks = IFUSE_PRELOAD_MAX_PBLOCK_NUM;
         }
     }
+
+    g_preloadStripeNum = iFuseLibGetOption()->preloadStripeNum;
+    if(g_preloadStripeNum > IFUSE_PRELOAD_MAX_PBLOCK_NUM) {
+        g_preloadStripeNum = IFUSE_PRELOAD_MAX_PBLOCK_NUM;
+    }
+
+    g_preloadStripeMinSize = (off_t)iFuseLibGetOption()->preloadStripeMinSizeMB * 1024 * 1024;
     
     pthread_rwlockattr_init(&g_PreloadLockAttr);
     pthread_rwlock_init(&g_PreloadLock, &g_PreloadLockAttr);
@@ -485,6 +535,7 @@ int iFusePreloadOpen(const char *iRodsPath, iFuseFd_t **iFuseFd, int openFlag) {
     int status = 0;
     std::map<unsigned long, iFusePreload_t*>::iterator it_preloadmap;
     iFusePreload_t *iFusePreload = NULL;
+    struct stat stbuf;
     int i;
 
     assert(iRodsPath != NULL);
@@ -503,10 +554,30 @@ int iFusePreloadOpen(const char *iRodsPath, iFuseFd_t **iFuseFd, int openFlag) {
     if (status == 0) {
         iFusePreload->fdId = (*iFuseFd)->fdId;
         iFusePreload->iRodsPath = strdup(iRodsPath);
+        iFusePreload->size = -1;
+        iFusePreload->numBlocks = g_preloadNumBlocks;
+
+        // size of a read-only file does not change under us
+        if((openFlag & O_ACCMODE) == O_RDONLY) {
+            if(iFuseFsGetAttr(iRodsPath, &stbuf) == 0) {
+                iFusePreload->size = stbuf.st_size;
+
+                // fetch more blocks in parallel for a large file
+                // each preload block is read over its own connection
+                if(g_preloadStripeNum > iFusePreload->numBlocks &&
+                        stbuf.st_size >= g_preloadStripeMinSize) {
+                    iFuseLibLog(LOG_DEBUG, "iFusePreloadOpen: reading %s in %d stripes", iRodsPath, g_preloadStripeNum);
+                    iFusePreload->numBlocks = g_preloadStripeNum;
+                }
+            }
+        }
 
         // start preload thread - only when the file is opened for read
         if((openFlag & O_ACCMODE) == O_RDONLY || (openFlag & O_ACCMODE) == O_RDWR) {
-            for(i=0;i<g_preloadNumBlocks;i++) {
+            for(i=0;i<iFusePreload->numBlocks;i++) {
+                if(_isPastEOF(iFusePreload, i)) {
+                    break;
+                }
                 _startPreload(iFusePreload, i, NULL);
             }
         }
@@ -542,8 +613,8 @@ int iFusePreloadClose(iFuseFd_t *iFuseFd) {
     if (status < 0) {
         iFuseLibLogError(LOG_ERROR, status, "iFusePreloadClose: iFuseBufferedFsClose of %s error, status = %d",
                 iRodsPath, status);
-        free(iRodsPath);
-        return -ENOENT;
+        // the descriptor is closed anyway, release the preload too
+        status = -ENOENT;
     }
 
     free(iRodsPath);
@@ -574,7 +645,6 @@ int iFusePreloadRead(iFuseFd_t *iFuseFd, char *buf, off_t off, size_t size) {
     size_t readSize = 0;
     size_t remain = 0;
     off_t curOffset = 0;
-    char *blockBuffer = (char*)calloc(1, getBufferCacheBlockSize());
     std::map<unsigned long, iFusePreload_t*>::iterator it_preloadmap;
     iFusePreload_t *iFusePreload = NULL;
 
@@ -599,7 +669,7 @@ int iFusePreloadRead(iFuseFd_t *iFuseFd, char *buf, off_t off, size_t size) {
             size_t curSize = inBlockAvail > remain ? remain : inBlockAvail;
             size_t blockSize = 0;
 
-            status = _readPreload(iFusePreload, blockBuffer, getBlockID(curOffset));
+            status = _readPreload(iFusePreload, buf + readSize, getBlockID(curOffset), inBlockOffset, curSize);
             if(status < 0) {
                 iFuseLibLogError(LOG_ERROR, status, "iFusePreloadRead: _readPreload of %s error, status = %d",
                         iFuseFd->iRodsPath, status);
@@ -609,12 +679,10 @@ int iFusePreloadRead(iFuseFd_t *iFuseFd, char *buf, off_t off, size_t size) {
                     iFuseLibLogError(LOG_ERROR, status, "iFusePreloadRead: iFuseBufferedFsRead of %s error, status = %d",
                             iFuseFd->iRodsPath, status);
                     pthread_rwlock_unlock(&g_PreloadLock);
-                    free(blockBuffer);
                     return -ENOENT;
                 }
 
                 pthread_rwlock_unlock(&g_PreloadLock);
-                free(blockBuffer);
                 return status;
             } else if(status == 0) {
                 // eof
@@ -623,17 +691,14 @@ int iFusePreloadRead(iFuseFd_t *iFuseFd, char *buf, off_t off, size_t size) {
 
             blockSize = (size_t)status;
 
-            if(inBlockOffset + curSize > blockSize) {
-                curSize = blockSize - inBlockOffset;
-            }
-
-            if(curSize == 0) {
+            if((size_t)inBlockOffset >= blockSize) {
                 // eof
                 break;
             }
 
-            // copy
-            memcpy(buf + readSize, blockBuffer + inBlockOffset, curSize);
+            if(inBlockOffset + curSize > blockSize) {
+                curSize = blockSize - inBlockOffset;
+            }
 
             readSize += curSize;
             remain -= curSize;
@@ -646,15 +711,12 @@ int iFusePreloadRead(iFuseFd_t *iFuseFd, char *buf, off_t off, size_t size) {
         }
 
         pthread_rwlock_unlock(&g_PreloadLock);
-        free(blockBuffer);
         return readSize;
     }
 
     // no preloaded data
     pthread_rwlock_unlock(&g_PreloadLock);
 
-    free(blockBuffer);
-
     status = iFuseBufferedFsRead(iFuseFd, buf, off, size);
     if (status < 0) {
         iFuseLibLogError(LOG_ERROR, status, "iFusePreloadRead: iFuseBufferedFsRead of %s error, status = %d",
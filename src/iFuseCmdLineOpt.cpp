@@ -12,7 +12,11 @@
 #include <unistd.h>
 #include "iFuseCmdLineOpt.hpp"
 #include "iFuse.FS.hpp"
+#include "iFuse.Lib.Admission.hpp"
+#include "iFuse.Lib.BufferPool.hpp"
 #include "iFuse.Lib.Conn.hpp"
+#include "iFuse.Lib.Engine.hpp"
+#include "iFuse.Lib.Fd.hpp"
 #include "iFuse.Lib.MetadataCache.hpp"
 #include "iFuse.Lib.RodsClientAPI.hpp"
 #include "iFuse.Lib.Util.hpp"
@@ -38,19 +42,47 @@ void iFuseCmdOptsInit() {
     g_Opt.directio = true;
     g_Opt.bufferedFS = true;
     g_Opt.preload = true;
+    g_Opt.writeBehind = true;
     g_Opt.cacheMetadata = true;
     g_Opt.maxConn = IFUSE_MAX_NUM_CONN;
+    g_Opt.minConn = IFUSE_MIN_NUM_CONN;
+    g_Opt.connWaitTargetMSec = IFUSE_CONN_WAIT_TARGET_MSEC;
+    g_Opt.maxShortopConn = IFUSE_MAX_NUM_SHORTOP_CONN;
+    g_Opt.maxBackgroundConn = IFUSE_MAX_NUM_BACKGROUND_CONN;
     g_Opt.blocksize = IFUSE_BUFFER_CACHE_BLOCK_SIZE;
+    g_Opt.cacheMB = IFUSE_BUFFER_CACHE_MB;
+    g_Opt.dirtyMB = IFUSE_BUFFER_DIRTY_MB;
+    g_Opt.maxDirtyMB = IFUSE_BUFFER_MAX_DIRTY_MB;
+    g_Opt.bufferPoolMB = IFUSE_BUFFER_POOL_MAX_MB;
+    g_Opt.hugepage = false;
+    g_Opt.writeStripeNum = IFUSE_WRITE_STRIPE_NUM;
+    g_Opt.hedgeReadPercentile = IFUSE_HEDGE_READ_PERCENTILE;
+    g_Opt.workerNum = IFUSE_ENGINE_WORKER_NUM;
+    g_Opt.maxRPCNum = IFUSE_ADMISSION_MAX_RPC_NUM;
+    g_Opt.maxConnectingNum = IFUSE_ADMISSION_MAX_CONNECTING_NUM;
+    g_Opt.maxBackgroundMB = IFUSE_ADMISSION_MAX_BACKGROUND_MB;
+    g_Opt.admissionWaitMSec = IFUSE_ADMISSION_WAIT_MSEC;
 #ifdef USE_CONNREUSE
     g_Opt.connReuse = true;
 #else
     g_Opt.connReuse = false;
 #endif
+    g_Opt.connWaitTimeoutMSec = IFUSE_CONN_WAIT_TIMEOUT_MSEC;
+    g_Opt.connBreakerFailNum = IFUSE_CONN_BREAKER_FAIL_NUM;
+    g_Opt.connBreakerCoolDownSec = IFUSE_CONN_BREAKER_COOLDOWN_SEC;
+    g_Opt.connWarmUpNum = IFUSE_CONN_WARMUP_NUM;
+    g_Opt.directData = false;
+    g_Opt.readStreams = IFUSE_FD_STREAM_NUM;
     g_Opt.connTimeoutSec = IFUSE_FREE_CONN_TIMEOUT_SEC;
     g_Opt.connKeepAliveSec = IFUSE_FREE_CONN_KEEPALIVE_SEC;
     g_Opt.connCheckIntervalSec = IFUSE_FREE_CONN_CHECK_INTERVAL_SEC;
     g_Opt.rodsapiTimeoutSec = IFUSE_RODSCLIENTAPI_TIMEOUT_SEC;
+    g_Opt.rodsapiMetadataTimeoutSec = IFUSE_RODSCLIENTAPI_METADATA_TIMEOUT_SEC;
+    g_Opt.rodsapiSmallIOTimeoutSec = IFUSE_RODSCLIENTAPI_SMALL_IO_TIMEOUT_SEC;
+    g_Opt.rodsapiBulkIOTimeoutSec = IFUSE_RODSCLIENTAPI_BULK_IO_TIMEOUT_SEC;
     g_Opt.preloadNumBlocks = IFUSE_PRELOAD_PBLOCK_NUM;
+    g_Opt.preloadStripeNum = IFUSE_PRELOAD_STRIPE_NUM;
+    g_Opt.preloadStripeMinSizeMB = IFUSE_PRELOAD_STRIPE_MIN_SIZE_MB;
     g_Opt.metadataCacheTimeoutSec = IFUSE_METADATA_CACHE_TIMEOUT_SEC;
 
     // check environmental variables
@@ -66,6 +98,11 @@ void iFuseCmdOptsInit() {
         g_Opt.preload = false;
     }
 
+    value = getenv("IRODSFS_NOWRITEBEHIND"); // true/false
+    if(_atob(value)) {
+        g_Opt.writeBehind = false;
+    }
+
     value = getenv("IRODSFS_NOCACHEMETADATA"); // true/false
     if(_atob(value)) {
         g_Opt.cacheMetadata = false;
@@ -76,11 +113,91 @@ void iFuseCmdOptsInit() {
         g_Opt.maxConn = atoi(value);
     }
 
+    value = getenv("IRODSFS_MINCONN"); // number
+    if(value != NULL) {
+        g_Opt.minConn = atoi(value);
+    }
+
+    value = getenv("IRODSFS_CONNWAITTARGET"); // number
+    if(value != NULL) {
+        g_Opt.connWaitTargetMSec = atoi(value);
+    }
+
+    value = getenv("IRODSFS_MAXSHORTOPCONN"); // number
+    if(value != NULL) {
+        g_Opt.maxShortopConn = atoi(value);
+    }
+
+    value = getenv("IRODSFS_MAXBGCONN"); // number
+    if(value != NULL) {
+        g_Opt.maxBackgroundConn = atoi(value);
+    }
+
     value = getenv("IRODSFS_BLOCKSIZE"); // number
     if(value != NULL) {
         g_Opt.blocksize = atoi(value);
     }
 
+    value = getenv("IRODSFS_CACHEMB"); // number
+    if(value != NULL) {
+        g_Opt.cacheMB = atoi(value);
+    }
+
+    value = getenv("IRODSFS_DIRTYMB"); // number
+    if(value != NULL) {
+        g_Opt.dirtyMB = atoi(value);
+    }
+
+    value = getenv("IRODSFS_MAXDIRTYMB"); // number
+    if(value != NULL) {
+        g_Opt.maxDirtyMB = atoi(value);
+    }
+
+    value = getenv("IRODSFS_POOLMB"); // number
+    if(value != NULL) {
+        g_Opt.bufferPoolMB = atoi(value);
+    }
+
+    value = getenv("IRODSFS_HUGEPAGES"); // true/false
+    if(_atob(value)) {
+        g_Opt.hugepage = true;
+    }
+
+    value = getenv("IRODSFS_WRITESTRIPES"); // number
+    if(value != NULL) {
+        g_Opt.writeStripeNum = atoi(value);
+    }
+
+    value = getenv("IRODSFS_HEDGEPERCENTILE"); // number
+    if(value != NULL) {
+        g_Opt.hedgeReadPercentile = atoi(value);
+    }
+
+    value = getenv("IRODSFS_WORKERS"); // number
+    if(value != NULL) {
+        g_Opt.workerNum = atoi(value);
+    }
+
+    value = getenv("IRODSFS_MAXRPCS"); // number
+    if(value != NULL) {
+        g_Opt.maxRPCNum = atoi(value);
+    }
+
+    value = getenv("IRODSFS_MAXCONNECTING"); // number
+    if(value != NULL) {
+        g_Opt.maxConnectingNum = atoi(value);
+    }
+
+    value = getenv("IRODSFS_MAXBGMB"); // number
+    if(value != NULL) {
+        g_Opt.maxBackgroundMB = atoi(value);
+    }
+
+    value = getenv("IRODSFS_ADMISSIONWAIT"); // number
+    if(value != NULL) {
+        g_Opt.admissionWaitMSec = atoi(value);
+    }
+
     value = getenv("IRODSFS_CONNREUSE"); // true/false
     if(_atob(value)) {
         g_Opt.connReuse = true;
@@ -91,6 +208,41 @@ void iFuseCmdOptsInit() {
         g_Opt.connReuse = false;
     }
 
+    value = getenv("IRODSFS_CONNWARMUP"); // number
+    if(value != NULL) {
+        g_Opt.connWarmUpNum = atoi(value);
+    }
+
+    value = getenv("IRODSFS_DIRECTDATA"); // true/false
+    if(_atob(value)) {
+        g_Opt.directData = true;
+    }
+
+    value = getenv("IRODSFS_READSTREAMS"); // number
+    if(value != NULL) {
+        g_Opt.readStreams = atoi(value);
+    }
+
+    value = getenv("IRODSFS_HOSTS"); // host[:port],host[:port],...
+    if(value != NULL && strlen(value) > 0) {
+        g_Opt.hosts = strdup(value);
+    }
+
+    value = getenv("IRODSFS_CONNWAITTIMEOUT"); // number
+    if(value != NULL) {
+        g_Opt.connWaitTimeoutMSec = atoi(value);
+    }
+
+    value = getenv("IRODSFS_BREAKERFAILURES"); // number
+    if(value != NULL) {
+        g_Opt.connBreakerFailNum = atoi(value);
+    }
+
+    value = getenv("IRODSFS_BREAKERCOOLDOWN"); // number
+    if(value != NULL) {
+        g_Opt.connBreakerCoolDownSec = atoi(value);
+    }
+
     value = getenv("IRODSFS_CONNTIMEOUT"); // number
     if(value != NULL) {
         g_Opt.connTimeoutSec = atoi(value);
@@ -111,11 +263,51 @@ void iFuseCmdOptsInit() {
         g_Opt.rodsapiTimeoutSec = atoi(value);
     }
 
+    value = getenv("IRODSFS_METADATATIMEOUT"); // number
+    if(value != NULL) {
+        g_Opt.rodsapiMetadataTimeoutSec = atoi(value);
+    }
+
+    value = getenv("IRODSFS_IOTIMEOUT"); // number
+    if(value != NULL) {
+        g_Opt.rodsapiSmallIOTimeoutSec = atoi(value);
+    }
+
+    value = getenv("IRODSFS_BULKIOTIMEOUT"); // number
+    if(value != NULL) {
+        g_Opt.rodsapiBulkIOTimeoutSec = atoi(value);
+    }
+
+    value = getenv("IRODSFS_MOCKBACKEND"); // local directory
+    if(value != NULL && strlen(value) > 0) {
+        g_Opt.mockBackend = strdup(value);
+    }
+
+    value = getenv("IRODSFS_MOCKLATENCY"); // number
+    if(value != NULL) {
+        g_Opt.mockLatencyUSec = atoi(value);
+    }
+
+    value = getenv("IRODSFS_MOCKBANDWIDTH"); // number
+    if(value != NULL) {
+        g_Opt.mockBandwidthKBps = atoi(value);
+    }
+
     value = getenv("IRODSFS_PRELOADBLOCKS"); // number
     if(value != NULL) {
         g_Opt.preloadNumBlocks = atoi(value);
     }
 
+    value = getenv("IRODSFS_STRIPES"); // number
+    if(value != NULL) {
+        g_Opt.preloadStripeNum = atoi(value);
+    }
+
+    value = getenv("IRODSFS_STRIPEMINSIZE"); // number
+    if(value != NULL) {
+        g_Opt.preloadStripeMinSizeMB = atoi(value);
+    }
+
     value = getenv("IRODSFS_METADATACACHETIMEOUT"); // number
     if(value != NULL) {
         g_Opt.metadataCacheTimeoutSec = atoi(value);
@@ -145,6 +337,16 @@ void iFuseCmdOptsDestroy() {
         g_Opt.ticket = NULL;
     }
 
+    if(g_Opt.hosts != NULL) {
+        free(g_Opt.hosts);
+        g_Opt.hosts = NULL;
+    }
+
+    if(g_Opt.mockBackend != NULL) {
+        free(g_Opt.mockBackend);
+        g_Opt.mockBackend = NULL;
+    }
+
     peopt = g_Opt.extendedOpts;
     while(peopt != NULL) {
         iFuseExtendedOpt_t *next = peopt->next;
@@ -215,7 +417,7 @@ static int _parseFuseCommandArg(char **argv, int argc, int index, iFuseCmdArg_t
                 // if there's no command found
                 continue;
             }
-            strncpy(option->value, argv[i], IFUSE_CMD_ARG_MAX_TOKEN_LEN);
+            strncpy(option->value, argv[i], IFUSE_CMD_ARG_MAX_VALUE_LEN - 1);
             option->end = i + 1;
             tokens++;
             break;
@@ -255,6 +457,9 @@ int iFuseCmdOptsParse(int argc, char **argv) {
             } else if(strcmp(cmd.command, "nopreload") == 0) {
                 g_Opt.preload = false;
                 processed = true;
+            } else if(strcmp(cmd.command, "nowritebehind") == 0) {
+                g_Opt.writeBehind = false;
+                processed = true;
             } else if(strcmp(cmd.command, "nocachemetadata") == 0) {
                 g_Opt.cacheMetadata = false;
                 processed = true;
@@ -263,17 +468,131 @@ int iFuseCmdOptsParse(int argc, char **argv) {
                     g_Opt.maxConn = atoi(cmd.value);
                 }
                 processed = true;
+            } else if(strcmp(cmd.command, "minconn") == 0) {
+                if(strlen(cmd.value) > 0) {
+                    g_Opt.minConn = atoi(cmd.value);
+                }
+                processed = true;
+            } else if(strcmp(cmd.command, "connwaittarget") == 0) {
+                if(strlen(cmd.value) > 0) {
+                    g_Opt.connWaitTargetMSec = atoi(cmd.value);
+                }
+                processed = true;
+            } else if(strcmp(cmd.command, "maxshortopconn") == 0) {
+                if(strlen(cmd.value) > 0) {
+                    g_Opt.maxShortopConn = atoi(cmd.value);
+                }
+                processed = true;
+            } else if(strcmp(cmd.command, "maxbgconn") == 0) {
+                if(strlen(cmd.value) > 0) {
+                    g_Opt.maxBackgroundConn = atoi(cmd.value);
+                }
+                processed = true;
             } else if(strcmp(cmd.command, "blocksize") == 0) {
                 if(strlen(cmd.value) > 0) {
                     g_Opt.blocksize = atoi(cmd.value);
                 }
                 processed = true;
+            } else if(strcmp(cmd.command, "cachemb") == 0) {
+                if(strlen(cmd.value) > 0) {
+                    g_Opt.cacheMB = atoi(cmd.value);
+                }
+                processed = true;
+            } else if(strcmp(cmd.command, "dirtymb") == 0) {
+                if(strlen(cmd.value) > 0) {
+                    g_Opt.dirtyMB = atoi(cmd.value);
+                }
+                processed = true;
+            } else if(strcmp(cmd.command, "maxdirtymb") == 0) {
+                if(strlen(cmd.value) > 0) {
+                    g_Opt.maxDirtyMB = atoi(cmd.value);
+                }
+                processed = true;
+            } else if(strcmp(cmd.command, "poolmb") == 0) {
+                if(strlen(cmd.value) > 0) {
+                    g_Opt.bufferPoolMB = atoi(cmd.value);
+                }
+                processed = true;
+            } else if(strcmp(cmd.command, "hugepages") == 0) {
+                g_Opt.hugepage = true;
+                processed = true;
+            } else if(strcmp(cmd.command, "writestripes") == 0) {
+                if(strlen(cmd.value) > 0) {
+                    g_Opt.writeStripeNum = atoi(cmd.value);
+                }
+                processed = true;
+            } else if(strcmp(cmd.command, "hedgepercentile") == 0) {
+                if(strlen(cmd.value) > 0) {
+                    g_Opt.hedgeReadPercentile = atoi(cmd.value);
+                }
+                processed = true;
+            } else if(strcmp(cmd.command, "workers") == 0) {
+                if(strlen(cmd.value) > 0) {
+                    g_Opt.workerNum = atoi(cmd.value);
+                }
+                processed = true;
+            } else if(strcmp(cmd.command, "maxrpcs") == 0) {
+                if(strlen(cmd.value) > 0) {
+                    g_Opt.maxRPCNum = atoi(cmd.value);
+                }
+                processed = true;
+            } else if(strcmp(cmd.command, "maxconnecting") == 0) {
+                if(strlen(cmd.value) > 0) {
+                    g_Opt.maxConnectingNum = atoi(cmd.value);
+                }
+                processed = true;
+            } else if(strcmp(cmd.command, "maxbgmb") == 0) {
+                if(strlen(cmd.value) > 0) {
+                    g_Opt.maxBackgroundMB = atoi(cmd.value);
+                }
+                processed = true;
+            } else if(strcmp(cmd.command, "admissionwait") == 0) {
+                if(strlen(cmd.value) > 0) {
+                    g_Opt.admissionWaitMSec = atoi(cmd.value);
+                }
+                processed = true;
             } else if(strcmp(cmd.command, "connreuse") == 0) {
                 g_Opt.connReuse = true;
                 processed = true;
             } else if(strcmp(cmd.command, "noconnreuse") == 0) {
                 g_Opt.connReuse = false;
                 processed = true;
+            } else if(strcmp(cmd.command, "connwarmup") == 0) {
+                if(strlen(cmd.value) > 0) {
+                    g_Opt.connWarmUpNum = atoi(cmd.value);
+                }
+                processed = true;
+            } else if(strcmp(cmd.command, "directdata") == 0) {
+                g_Opt.directData = true;
+                processed = true;
+            } else if(strcmp(cmd.command, "readstreams") == 0) {
+                if(strlen(cmd.value) > 0) {
+                    g_Opt.readStreams = atoi(cmd.value);
+                }
+                processed = true;
+            } else if(strcmp(cmd.command, "hosts") == 0) {
+                if(strlen(cmd.value) > 0) {
+                    if(g_Opt.hosts != NULL) {
+                        free(g_Opt.hosts);
+                    }
+                    g_Opt.hosts = strdup(cmd.value);
+                }
+                processed = true;
+            } else if(strcmp(cmd.command, "connwaittimeout") == 0) {
+                if(strlen(cmd.value) > 0) {
+                    g_Opt.connWaitTimeoutMSec = atoi(cmd.value);
+                }
+                processed = true;
+            } else if(strcmp(cmd.command, "breakerfailures") == 0) {
+                if(strlen(cmd.value) > 0) {
+                    g_Opt.connBreakerFailNum = atoi(cmd.value);
+                }
+                processed = true;
+            } else if(strcmp(cmd.command, "breakercooldown") == 0) {
+                if(strlen(cmd.value) > 0) {
+                    g_Opt.connBreakerCoolDownSec = atoi(cmd.value);
+                }
+                processed = true;
             } else if(strcmp(cmd.command, "conntimeout") == 0) {
                 if(strlen(cmd.value) > 0) {
                     g_Opt.connTimeoutSec = atoi(cmd.value);
@@ -294,11 +613,54 @@ int iFuseCmdOptsParse(int argc, char **argv) {
                     g_Opt.rodsapiTimeoutSec = atoi(cmd.value);
                 }
                 processed = true;
+            } else if(strcmp(cmd.command, "metadatatimeout") == 0) {
+                if(strlen(cmd.value) > 0) {
+                    g_Opt.rodsapiMetadataTimeoutSec = atoi(cmd.value);
+                }
+                processed = true;
+            } else if(strcmp(cmd.command, "iotimeout") == 0) {
+                if(strlen(cmd.value) > 0) {
+                    g_Opt.rodsapiSmallIOTimeoutSec = atoi(cmd.value);
+                }
+                processed = true;
+            } else if(strcmp(cmd.command, "bulkiotimeout") == 0) {
+                if(strlen(cmd.value) > 0) {
+                    g_Opt.rodsapiBulkIOTimeoutSec = atoi(cmd.value);
+                }
+                processed = true;
+            } else if(strcmp(cmd.command, "mockbackend") == 0) {
+                if(strlen(cmd.value) > 0) {
+                    if(g_Opt.mockBackend != NULL) {
+                        free(g_Opt.mockBackend);
+                    }
+                    g_Opt.mockBackend = strdup(cmd.value);
+                }
+                processed = true;
+            } else if(strcmp(cmd.command, "mocklatency") == 0) {
+                if(strlen(cmd.value) > 0) {
+                    g_Opt.mockLatencyUSec = atoi(cmd.value);
+                }
+                processed = true;
+            } else if(strcmp(cmd.command, "mockbandwidth") == 0) {
+                if(strlen(cmd.value) > 0) {
+                    g_Opt.mockBandwidthKBps = atoi(cmd.value);
+                }
+                processed = true;
             } else if(strcmp(cmd.command, "preloadblocks") == 0) {
                 if(strlen(cmd.value) > 0) {
                     g_Opt.preloadNumBlocks = atoi(cmd.value);
                 }
                 processed = true;
+            } else if(strcmp(cmd.command, "stripes") == 0) {
+                if(strlen(cmd.value) > 0) {
+                    g_Opt.preloadStripeNum = atoi(cmd.value);
+                }
+                processed = true;
+            } else if(strcmp(cmd.command, "stripeminsize") == 0) {
+                if(strlen(cmd.value) > 0) {
+                    g_Opt.preloadStripeMinSizeMB = atoi(cmd.value);
+                }
+                processed = true;
             } else if(strcmp(cmd.command, "metadatacachetimeout") == 0) {
                 if(strlen(cmd.value) > 0) {
                     g_Opt.metadataCacheTimeoutSec = atoi(cmd.value);
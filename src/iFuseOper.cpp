@@ -14,10 +14,30 @@
 #include "iFuse.Lib.hpp"
 #include "iFuse.Lib.Fd.hpp"
 #include "iFuse.Lib.Conn.hpp"
+#include "iFuse.Lib.Engine.hpp"
 #include "iFuse.Lib.Util.hpp"
 #include "iFuse.Lib.RodsClientAPI.hpp"
 #include "sockComm.h"
 
+/*
+ * Arguments of a FUSE callback run by an engine worker
+ */
+typedef struct IFuseOperRequest {
+    const char *path;
+    const char *path2;
+    struct stat *stbuf;
+    struct fuse_file_info *fi;
+    char *buf;
+    const char *constBuf;
+    void *dirBuf;
+    fuse_fill_dir_t filler;
+    size_t size;
+    off_t offset;
+    mode_t mode;
+    dev_t rdev;
+    int isdatasync;
+} iFuseOperRequest_t;
+
 void *iFuseInit(struct fuse_conn_info *conn) {
     if (conn->capable & FUSE_CAP_BIG_WRITES) {
         conn->want |= FUSE_CAP_BIG_WRITES;
@@ -30,6 +50,12 @@ void *iFuseInit(struct fuse_conn_info *conn) {
 #endif
 
     iFuseLibInitTimerThread();
+
+    // workers running FUSE and background requests
+    iFuseEngineStart();
+
+    // establish connections in background
+    iFuseConnWarmUp();
     
     int status = 0;
     char iRodsPath[MAX_NAME_LEN];
@@ -52,9 +78,11 @@ void iFuseDestroy(void *data) {
     UNUSED(data);
     
     iFuseLibTerminateTimerThread();
+
+    iFuseEngineStop();
 }
 
-int iFuseGetAttr(const char *path, struct stat *stbuf) {
+static int _getAttr(const char *path, struct stat *stbuf) {
     int status = 0;
     char iRodsPath[MAX_NAME_LEN];
     
@@ -84,7 +112,23 @@ int iFuseGetAttr(const char *path, struct stat *stbuf) {
     return status;
 }
 
-int iFuseOpen(const char *path, struct fuse_file_info *fi) {
+static int _getAttrTask(void *param) {
+    iFuseOperRequest_t *iFuseOperRequest = (iFuseOperRequest_t*)param;
+
+    return _getAttr(iFuseOperRequest->path, iFuseOperRequest->stbuf);
+}
+
+int iFuseGetAttr(const char *path, struct stat *stbuf) {
+    iFuseOperRequest_t iFuseOperRequest;
+
+    bzero(&iFuseOperRequest, sizeof(iFuseOperRequest_t));
+    iFuseOperRequest.path = path;
+    iFuseOperRequest.stbuf = stbuf;
+
+    return iFuseEngineRun(_getAttrTask, (void*)&iFuseOperRequest);
+}
+
+static int _open(const char *path, struct fuse_file_info *fi) {
     int status = 0;
     char iRodsPath[MAX_NAME_LEN];
     iFuseFd_t *iFuseFd = NULL;
@@ -128,7 +172,23 @@ int iFuseOpen(const char *path, struct fuse_file_info *fi) {
     return 0;
 }
 
-int iFuseClose(const char *path, struct fuse_file_info *fi) {
+static int _openTask(void *param) {
+    iFuseOperRequest_t *iFuseOperRequest = (iFuseOperRequest_t*)param;
+
+    return _open(iFuseOperRequest->path, iFuseOperRequest->fi);
+}
+
+int iFuseOpen(const char *path, struct fuse_file_info *fi) {
+    iFuseOperRequest_t iFuseOperRequest;
+
+    bzero(&iFuseOperRequest, sizeof(iFuseOperRequest_t));
+    iFuseOperRequest.path = path;
+    iFuseOperRequest.fi = fi;
+
+    return iFuseEngineRun(_openTask, (void*)&iFuseOperRequest);
+}
+
+static int _close(const char *path, struct fuse_file_info *fi) {
     int status = 0;
     char iRodsPath[MAX_NAME_LEN];
     iFuseFd_t *iFuseFd = NULL;
@@ -176,7 +236,23 @@ int iFuseClose(const char *path, struct fuse_file_info *fi) {
     return 0;
 }
 
-int iFuseFlush(const char *path, struct fuse_file_info *fi) {
+static int _closeTask(void *param) {
+    iFuseOperRequest_t *iFuseOperRequest = (iFuseOperRequest_t*)param;
+
+    return _close(iFuseOperRequest->path, iFuseOperRequest->fi);
+}
+
+int iFuseClose(const char *path, struct fuse_file_info *fi) {
+    iFuseOperRequest_t iFuseOperRequest;
+
+    bzero(&iFuseOperRequest, sizeof(iFuseOperRequest_t));
+    iFuseOperRequest.path = path;
+    iFuseOperRequest.fi = fi;
+
+    return iFuseEngineRun(_closeTask, (void*)&iFuseOperRequest);
+}
+
+static int _flush(const char *path, struct fuse_file_info *fi) {
     int status = 0;
     char iRodsPath[MAX_NAME_LEN];
     iFuseFd_t *iFuseFd = NULL;
@@ -215,7 +291,23 @@ int iFuseFlush(const char *path, struct fuse_file_info *fi) {
     return status;
 }
 
-int iFuseFsync(const char *path, int isdatasync, struct fuse_file_info *fi) {
+static int _flushTask(void *param) {
+    iFuseOperRequest_t *iFuseOperRequest = (iFuseOperRequest_t*)param;
+
+    return _flush(iFuseOperRequest->path, iFuseOperRequest->fi);
+}
+
+int iFuseFlush(const char *path, struct fuse_file_info *fi) {
+    iFuseOperRequest_t iFuseOperRequest;
+
+    bzero(&iFuseOperRequest, sizeof(iFuseOperRequest_t));
+    iFuseOperRequest.path = path;
+    iFuseOperRequest.fi = fi;
+
+    return iFuseEngineRun(_flushTask, (void*)&iFuseOperRequest);
+}
+
+static int _fsync(const char *path, int isdatasync, struct fuse_file_info *fi) {
     int status = 0;
     char iRodsPath[MAX_NAME_LEN];
     iFuseFd_t *iFuseFd = NULL;
@@ -255,7 +347,24 @@ int iFuseFsync(const char *path, int isdatasync, struct fuse_file_info *fi) {
     return status;
 }
 
-int iFuseRead(const char *path, char *buf, size_t size, off_t offset, struct fuse_file_info *fi) {
+static int _fsyncTask(void *param) {
+    iFuseOperRequest_t *iFuseOperRequest = (iFuseOperRequest_t*)param;
+
+    return _fsync(iFuseOperRequest->path, iFuseOperRequest->isdatasync, iFuseOperRequest->fi);
+}
+
+int iFuseFsync(const char *path, int isdatasync, struct fuse_file_info *fi) {
+    iFuseOperRequest_t iFuseOperRequest;
+
+    bzero(&iFuseOperRequest, sizeof(iFuseOperRequest_t));
+    iFuseOperRequest.path = path;
+    iFuseOperRequest.isdatasync = isdatasync;
+    iFuseOperRequest.fi = fi;
+
+    return iFuseEngineRun(_fsyncTask, (void*)&iFuseOperRequest);
+}
+
+static int _read(const char *path, char *buf, size_t size, off_t offset, struct fuse_file_info *fi) {
     int status = 0;
     char iRodsPath[MAX_NAME_LEN];
     iFuseFd_t *iFuseFd = NULL;
@@ -301,12 +410,34 @@ int iFuseRead(const char *path, char *buf, size_t size, off_t offset, struct fus
                     "iFuseRead: cannot read file content for %s error", iRodsPath);
             return -ENOENT;
         }
+
+        iFuseFsCountReadDirect(status);
     }
     
+    iFuseFsCountReadDelivery(status);
     return status;
 }
 
-int iFuseWrite(const char *path, const char *buf, size_t size, off_t offset, struct fuse_file_info *fi) {
+static int _readTask(void *param) {
+    iFuseOperRequest_t *iFuseOperRequest = (iFuseOperRequest_t*)param;
+
+    return _read(iFuseOperRequest->path, iFuseOperRequest->buf, iFuseOperRequest->size, iFuseOperRequest->offset, iFuseOperRequest->fi);
+}
+
+int iFuseRead(const char *path, char *buf, size_t size, off_t offset, struct fuse_file_info *fi) {
+    iFuseOperRequest_t iFuseOperRequest;
+
+    bzero(&iFuseOperRequest, sizeof(iFuseOperRequest_t));
+    iFuseOperRequest.path = path;
+    iFuseOperRequest.buf = buf;
+    iFuseOperRequest.size = size;
+    iFuseOperRequest.offset = offset;
+    iFuseOperRequest.fi = fi;
+
+    return iFuseEngineRun(_readTask, (void*)&iFuseOperRequest);
+}
+
+static int _write(const char *path, const char *buf, size_t size, off_t offset, struct fuse_file_info *fi) {
     int status = 0;
     char iRodsPath[MAX_NAME_LEN];
     iFuseFd_t *iFuseFd = NULL;
@@ -343,7 +474,26 @@ int iFuseWrite(const char *path, const char *buf, size_t size, off_t offset, str
     return status;
 }
 
-int iFuseCreate(const char *path, mode_t mode, dev_t) {
+static int _writeTask(void *param) {
+    iFuseOperRequest_t *iFuseOperRequest = (iFuseOperRequest_t*)param;
+
+    return _write(iFuseOperRequest->path, iFuseOperRequest->constBuf, iFuseOperRequest->size, iFuseOperRequest->offset, iFuseOperRequest->fi);
+}
+
+int iFuseWrite(const char *path, const char *buf, size_t size, off_t offset, struct fuse_file_info *fi) {
+    iFuseOperRequest_t iFuseOperRequest;
+
+    bzero(&iFuseOperRequest, sizeof(iFuseOperRequest_t));
+    iFuseOperRequest.path = path;
+    iFuseOperRequest.constBuf = buf;
+    iFuseOperRequest.size = size;
+    iFuseOperRequest.offset = offset;
+    iFuseOperRequest.fi = fi;
+
+    return iFuseEngineRun(_writeTask, (void*)&iFuseOperRequest);
+}
+
+static int _create(const char *path, mode_t mode, dev_t) {
     int status = 0;
     char iRodsPath[MAX_NAME_LEN];
     
@@ -366,7 +516,24 @@ int iFuseCreate(const char *path, mode_t mode, dev_t) {
     return 0;
 }
 
-int iFuseUnlink(const char *path) {
+static int _createTask(void *param) {
+    iFuseOperRequest_t *iFuseOperRequest = (iFuseOperRequest_t*)param;
+
+    return _create(iFuseOperRequest->path, iFuseOperRequest->mode, iFuseOperRequest->rdev);
+}
+
+int iFuseCreate(const char *path, mode_t mode, dev_t rdev) {
+    iFuseOperRequest_t iFuseOperRequest;
+
+    bzero(&iFuseOperRequest, sizeof(iFuseOperRequest_t));
+    iFuseOperRequest.path = path;
+    iFuseOperRequest.mode = mode;
+    iFuseOperRequest.rdev = rdev;
+
+    return iFuseEngineRun(_createTask, (void*)&iFuseOperRequest);
+}
+
+static int _unlink(const char *path) {
     int status = 0;
     char iRodsPath[MAX_NAME_LEN];
     
@@ -379,7 +546,12 @@ int iFuseUnlink(const char *path) {
         return -ENOTDIR;
     }
     
-    status = iFuseFsUnlink(iRodsPath);
+    if(iFuseLibGetOption()->bufferedFS) {
+        status = iFuseBufferedFsUnlink(iRodsPath);
+    } else {
+        status = iFuseFsUnlink(iRodsPath);
+    }
+
     if (status < 0) {
         iFuseLibLogError(LOG_ERROR, status, 
                 "iFuseUnlink: cannot delete a file for %s error", iRodsPath);
@@ -389,6 +561,21 @@ int iFuseUnlink(const char *path) {
     return 0;
 }
 
+static int _unlinkTask(void *param) {
+    iFuseOperRequest_t *iFuseOperRequest = (iFuseOperRequest_t*)param;
+
+    return _unlink(iFuseOperRequest->path);
+}
+
+int iFuseUnlink(const char *path) {
+    iFuseOperRequest_t iFuseOperRequest;
+
+    bzero(&iFuseOperRequest, sizeof(iFuseOperRequest_t));
+    iFuseOperRequest.path = path;
+
+    return iFuseEngineRun(_unlinkTask, (void*)&iFuseOperRequest);
+}
+
 int iFuseLink(const char *from, const char *to) {
     UNUSED(from);
     UNUSED(to);
@@ -421,7 +608,7 @@ int iFuseStatfs(const char *path, struct statvfs *stbuf) {
     return 0;
 }
 
-int iFuseOpenDir(const char *path, struct fuse_file_info *fi) {
+static int _openDir(const char *path, struct fuse_file_info *fi) {
     int status = 0;
     char iRodsPath[MAX_NAME_LEN];
     iFuseDir_t *iFuseDir = NULL;
@@ -446,7 +633,23 @@ int iFuseOpenDir(const char *path, struct fuse_file_info *fi) {
     return 0;
 }
 
-int iFuseCloseDir(const char *path, struct fuse_file_info *fi) {
+static int _openDirTask(void *param) {
+    iFuseOperRequest_t *iFuseOperRequest = (iFuseOperRequest_t*)param;
+
+    return _openDir(iFuseOperRequest->path, iFuseOperRequest->fi);
+}
+
+int iFuseOpenDir(const char *path, struct fuse_file_info *fi) {
+    iFuseOperRequest_t iFuseOperRequest;
+
+    bzero(&iFuseOperRequest, sizeof(iFuseOperRequest_t));
+    iFuseOperRequest.path = path;
+    iFuseOperRequest.fi = fi;
+
+    return iFuseEngineRun(_openDirTask, (void*)&iFuseOperRequest);
+}
+
+static int _closeDir(const char *path, struct fuse_file_info *fi) {
     int status = 0;
     char iRodsPath[MAX_NAME_LEN];
     iFuseDir_t *iFuseDir = NULL;
@@ -474,7 +677,23 @@ int iFuseCloseDir(const char *path, struct fuse_file_info *fi) {
     return 0;
 }
 
-int iFuseReadDir(const char *path, void *buf, fuse_fill_dir_t filler, off_t offset, struct fuse_file_info *fi) {
+static int _closeDirTask(void *param) {
+    iFuseOperRequest_t *iFuseOperRequest = (iFuseOperRequest_t*)param;
+
+    return _closeDir(iFuseOperRequest->path, iFuseOperRequest->fi);
+}
+
+int iFuseCloseDir(const char *path, struct fuse_file_info *fi) {
+    iFuseOperRequest_t iFuseOperRequest;
+
+    bzero(&iFuseOperRequest, sizeof(iFuseOperRequest_t));
+    iFuseOperRequest.path = path;
+    iFuseOperRequest.fi = fi;
+
+    return iFuseEngineRun(_closeDirTask, (void*)&iFuseOperRequest);
+}
+
+static int _readDir(const char *path, void *buf, fuse_fill_dir_t filler, off_t offset, struct fuse_file_info *fi) {
     int status = 0;
     char iRodsPath[MAX_NAME_LEN];
     iFuseDir_t *iFuseDir = NULL;
@@ -506,7 +725,26 @@ int iFuseReadDir(const char *path, void *buf, fuse_fill_dir_t filler, off_t offs
     return 0;
 }
 
-int iFuseMakeDir(const char *path, mode_t mode) {
+static int _readDirTask(void *param) {
+    iFuseOperRequest_t *iFuseOperRequest = (iFuseOperRequest_t*)param;
+
+    return _readDir(iFuseOperRequest->path, iFuseOperRequest->dirBuf, iFuseOperRequest->filler, iFuseOperRequest->offset, iFuseOperRequest->fi);
+}
+
+int iFuseReadDir(const char *path, void *buf, fuse_fill_dir_t filler, off_t offset, struct fuse_file_info *fi) {
+    iFuseOperRequest_t iFuseOperRequest;
+
+    bzero(&iFuseOperRequest, sizeof(iFuseOperRequest_t));
+    iFuseOperRequest.path = path;
+    iFuseOperRequest.dirBuf = buf;
+    iFuseOperRequest.filler = filler;
+    iFuseOperRequest.offset = offset;
+    iFuseOperRequest.fi = fi;
+
+    return iFuseEngineRun(_readDirTask, (void*)&iFuseOperRequest);
+}
+
+static int _makeDir(const char *path, mode_t mode) {
     int status = 0;
     char iRodsPath[MAX_NAME_LEN];
     struct stat stbuf;
@@ -536,7 +774,23 @@ int iFuseMakeDir(const char *path, mode_t mode) {
     return 0;
 }
 
-int iFuseRemoveDir(const char *path) {
+static int _makeDirTask(void *param) {
+    iFuseOperRequest_t *iFuseOperRequest = (iFuseOperRequest_t*)param;
+
+    return _makeDir(iFuseOperRequest->path, iFuseOperRequest->mode);
+}
+
+int iFuseMakeDir(const char *path, mode_t mode) {
+    iFuseOperRequest_t iFuseOperRequest;
+
+    bzero(&iFuseOperRequest, sizeof(iFuseOperRequest_t));
+    iFuseOperRequest.path = path;
+    iFuseOperRequest.mode = mode;
+
+    return iFuseEngineRun(_makeDirTask, (void*)&iFuseOperRequest);
+}
+
+static int _removeDir(const char *path) {
     int status = 0;
     char iRodsPath[MAX_NAME_LEN];
     
@@ -559,7 +813,22 @@ int iFuseRemoveDir(const char *path) {
     return 0;
 }
 
-int iFuseRename(const char *from, const char *to) {
+static int _removeDirTask(void *param) {
+    iFuseOperRequest_t *iFuseOperRequest = (iFuseOperRequest_t*)param;
+
+    return _removeDir(iFuseOperRequest->path);
+}
+
+int iFuseRemoveDir(const char *path) {
+    iFuseOperRequest_t iFuseOperRequest;
+
+    bzero(&iFuseOperRequest, sizeof(iFuseOperRequest_t));
+    iFuseOperRequest.path = path;
+
+    return iFuseEngineRun(_removeDirTask, (void*)&iFuseOperRequest);
+}
+
+static int _rename(const char *from, const char *to) {
     int status = 0;
     char iRodsFromPath[MAX_NAME_LEN];
     char iRodsToPath[MAX_NAME_LEN];
@@ -594,7 +863,12 @@ int iFuseRename(const char *from, const char *to) {
         }
     }
     
-    status = iFuseFsRename(iRodsFromPath, iRodsToPath);
+    if(iFuseLibGetOption()->bufferedFS) {
+        status = iFuseBufferedFsRename(iRodsFromPath, iRodsToPath);
+    } else {
+        status = iFuseFsRename(iRodsFromPath, iRodsToPath);
+    }
+
     if (status < 0) {
         iFuseLibLogError(LOG_ERROR, status, 
                 "iFuseFsRename: cannot rename a file or a directory for %s to %s error", iRodsFromPath, iRodsToPath);
@@ -604,7 +878,23 @@ int iFuseRename(const char *from, const char *to) {
     return 0;
 }
 
-int iFuseTruncate(const char *path, off_t size) {
+static int _renameTask(void *param) {
+    iFuseOperRequest_t *iFuseOperRequest = (iFuseOperRequest_t*)param;
+
+    return _rename(iFuseOperRequest->path, iFuseOperRequest->path2);
+}
+
+int iFuseRename(const char *from, const char *to) {
+    iFuseOperRequest_t iFuseOperRequest;
+
+    bzero(&iFuseOperRequest, sizeof(iFuseOperRequest_t));
+    iFuseOperRequest.path = from;
+    iFuseOperRequest.path2 = to;
+
+    return iFuseEngineRun(_renameTask, (void*)&iFuseOperRequest);
+}
+
+static int _truncate(const char *path, off_t size) {
     int status = 0;
     char iRodsPath[MAX_NAME_LEN];
     
@@ -617,7 +907,12 @@ int iFuseTruncate(const char *path, off_t size) {
         return -ENOTDIR;
     }
     
-    status = iFuseFsTruncate(iRodsPath, size);
+    if(iFuseLibGetOption()->bufferedFS) {
+        status = iFuseBufferedFsTruncate(iRodsPath, size);
+    } else {
+        status = iFuseFsTruncate(iRodsPath, size);
+    }
+
     if (status < 0) {
         iFuseLibLogError(LOG_ERROR, status, 
                 "iFuseTruncate: cannot truncate a file for %s error", iRodsPath);
@@ -627,7 +922,23 @@ int iFuseTruncate(const char *path, off_t size) {
     return 0;
 }
 
-int iFuseSymlink(const char *to, const char *from) {
+static int _truncateTask(void *param) {
+    iFuseOperRequest_t *iFuseOperRequest = (iFuseOperRequest_t*)param;
+
+    return _truncate(iFuseOperRequest->path, iFuseOperRequest->offset);
+}
+
+int iFuseTruncate(const char *path, off_t size) {
+    iFuseOperRequest_t iFuseOperRequest;
+
+    bzero(&iFuseOperRequest, sizeof(iFuseOperRequest_t));
+    iFuseOperRequest.path = path;
+    iFuseOperRequest.offset = size;
+
+    return iFuseEngineRun(_truncateTask, (void*)&iFuseOperRequest);
+}
+
+static int _symlink(const char *to, const char *from) {
     int status = 0;
     char iRodsFromPath[MAX_NAME_LEN];
     char iRodsToPath[MAX_NAME_LEN];
@@ -695,7 +1006,23 @@ int iFuseSymlink(const char *to, const char *from) {
     return 0;
 }
 
-int iFuseReadLink(const char *path, char *buf, size_t size) {
+static int _symlinkTask(void *param) {
+    iFuseOperRequest_t *iFuseOperRequest = (iFuseOperRequest_t*)param;
+
+    return _symlink(iFuseOperRequest->path, iFuseOperRequest->path2);
+}
+
+int iFuseSymlink(const char *to, const char *from) {
+    iFuseOperRequest_t iFuseOperRequest;
+
+    bzero(&iFuseOperRequest, sizeof(iFuseOperRequest_t));
+    iFuseOperRequest.path = to;
+    iFuseOperRequest.path2 = from;
+
+    return iFuseEngineRun(_symlinkTask, (void*)&iFuseOperRequest);
+}
+
+static int _readLink(const char *path, char *buf, size_t size) {
     int status = 0;
     char iRodsPath[MAX_NAME_LEN];
     iFuseFd_t *iFuseFd = NULL;
@@ -736,7 +1063,24 @@ int iFuseReadLink(const char *path, char *buf, size_t size) {
     return 0;
 }
 
-int iFuseChmod(const char *path, mode_t mode) {
+static int _readLinkTask(void *param) {
+    iFuseOperRequest_t *iFuseOperRequest = (iFuseOperRequest_t*)param;
+
+    return _readLink(iFuseOperRequest->path, iFuseOperRequest->buf, iFuseOperRequest->size);
+}
+
+int iFuseReadLink(const char *path, char *buf, size_t size) {
+    iFuseOperRequest_t iFuseOperRequest;
+
+    bzero(&iFuseOperRequest, sizeof(iFuseOperRequest_t));
+    iFuseOperRequest.path = path;
+    iFuseOperRequest.buf = buf;
+    iFuseOperRequest.size = size;
+
+    return iFuseEngineRun(_readLinkTask, (void*)&iFuseOperRequest);
+}
+
+static int _chmod(const char *path, mode_t mode) {
     int status = 0;
     char iRodsPath[MAX_NAME_LEN];
     
@@ -759,6 +1103,22 @@ int iFuseChmod(const char *path, mode_t mode) {
     return 0;
 }
 
+static int _chmodTask(void *param) {
+    iFuseOperRequest_t *iFuseOperRequest = (iFuseOperRequest_t*)param;
+
+    return _chmod(iFuseOperRequest->path, iFuseOperRequest->mode);
+}
+
+int iFuseChmod(const char *path, mode_t mode) {
+    iFuseOperRequest_t iFuseOperRequest;
+
+    bzero(&iFuseOperRequest, sizeof(iFuseOperRequest_t));
+    iFuseOperRequest.path = path;
+    iFuseOperRequest.mode = mode;
+
+    return iFuseEngineRun(_chmodTask, (void*)&iFuseOperRequest);
+}
+
 int iFuseChown(const char *path, uid_t uid, gid_t gid) {
     UNUSED(path);
     UNUSED(uid);
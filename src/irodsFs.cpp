@@ -29,9 +29,11 @@ static struct fuse_operations irodsOper;
 static void usage();
 static int checkMountPoint(char *mountPoint, bool nonempty);
 static void registerClientProgram(char *prog);
+static void fillMockRodsEnv(rodsEnv *pEnv);
 
 int main(int argc, char **argv) {
     int status;
+    int rodsEnvStatus;
     rodsEnv myRodsEnv;
     int fuse_argc;
     char **fuse_argv;
@@ -65,11 +67,10 @@ int main(int argc, char **argv) {
     irodsOper.fsync = iFuseFsync;
     irodsOper.ioctl = iFuseIoctl;
 
-    status = getRodsEnv(&myRodsEnv);
-    if (status < 0) {
-        fprintf(stderr, "iRods Fuse abort: getRodsEnv error with status %d\n", status);
-        return 1;
-    }
+    // rods environment is not required by the mock backend
+    // check after parsing options
+    bzero(&myRodsEnv, sizeof ( rodsEnv));
+    rodsEnvStatus = getRodsEnv(&myRodsEnv);
 
     iFuseCmdOptsInit();
 
@@ -91,6 +92,14 @@ int main(int argc, char **argv) {
         return 0;
     }
 
+    if (myiFuseOpt.mockBackend != NULL) {
+        fillMockRodsEnv(&myRodsEnv);
+    } else if (rodsEnvStatus < 0) {
+        fprintf(stderr, "iRods Fuse abort: getRodsEnv error with status %d\n", rodsEnvStatus);
+        iFuseCmdOptsDestroy();
+        return 1;
+    }
+
     // check mount point
     status = checkMountPoint(myiFuseOpt.mountpoint, myiFuseOpt.nonempty);
     if(status != 0) {
@@ -166,16 +175,48 @@ static void usage() {
         " -w, --workdir <irods_dir>        Use given irods dir as a work dir",
         " --nocache                        Disable all caching features (Buffered IO, Preload, Metadata Cache)",
         " --nopreload                      Disable Preload feature that pre-fetches file blocks in advance",
+        " --nowritebehind                  Disable Write-behind feature that uploads buffered blocks in the background while the application keeps writing",
         " --nocachemetadata                Disable metadata caching feature",
         " --connreuse                      Set to reuse network connections for performance. This may provide inconsistent metadata with mysql-backed iCAT. By default, connections are not reused",
         " --maxconn <num_conn>             Set max number of network connection to be established at the same time. By default, this is set to 10",
+        " --minconn <num_conn>             Set min number of network connections kept when the pool is sized adaptively. By default, this is set to 2",
+        " --connwaittarget <wait>          Set target wait time in milliseconds for a connection. When set, the connection pool grows up to maxconn while callers wait longer than the target on average, and shrinks down to minconn when connections are idle. By default, this is set to 0(fixed pool of maxconn)",
+        " --maxshortopconn <num_conn>      Set max number of network connections used for metadata operations (stat, create, rename, etc.) at the same time. By default, this is set to 3",
+        " --maxbgconn <num_conn>           Set max number of network connections background requests (preload, write-behind, hedged reads) take at the same time. Foreground accesses are served first when connections are released. By default, this is set to 0(half of maxconn)",
         " --blocksize <block_size>         Set block size at data transfer. All transfer is made in a block-level for performance. By default, this is set to 1048576(1MB)",
+        " --cachemb <size_in_mb>           Set max size of file blocks cached in memory. Cached blocks are shared by all descriptors of a file and dropped on local truncate, unlink and rename, or when the file has changed on reopen. By default, this is set to 64",
+        " --dirtymb <size_in_mb>           Set max size of data written to a file buffered in memory. Writes to any offset are absorbed in place and written back in offset order at flush, close or when over the limit. By default, this is set to 16",
+        " --maxdirtymb <size_in_mb>        Set max size of data written to all files buffered in memory, including blocks being uploaded in the background. Writers over the limit write back their own data and wait for uploads. By default, this is set to 128(at most half of poolmb)",
+        " --poolmb <size_in_mb>            Set max size of block buffers allocated for reads, writes and the block cache. At the limit, cached blocks are dropped, then accesses wait for a buffer to be released. By default, this is set to 256(0 for unlimited)",
+        " --hugepages                      Allocate block buffers from memory backed by transparent huge pages. Memory is kept until unmount. By default, this is disabled",
+        " --writestripes <num_stripes>     Set the number of extra descriptors, each on its own connection, uploading blocks written back in parallel, like iput -N. Write errors are reported at flush/close at the latest. By default, this is set to 0(write-behind through the file's own descriptor)",
+        " --hedgepercentile <percentile>   Set the percentile of recent block read latency after which a block read is sent again on another connection. The first response is used. By default, this is set to 0(disabled)",
+        " --workers <num_workers>          Set number of worker threads making iRODS calls. FUSE requests are queued to the workers and taken before background requests (preload, write-behind, hedged reads, keep-alive, warm-up), which use at most 3/4 of the workers. By default, this is set to 16",
+        " --maxrpcs <num_rpcs>             Set max number of iRODS requests in flight. Requests over the limit wait in a queue for others, up to admissionwait. By default, this is set to 64(0 for unlimited)",
+        " --maxconnecting <num_conn>       Set max number of network connections being established at the same time. Connections over the limit wait in a queue, up to admissionwait. By default, this is set to 8(0 for unlimited)",
+        " --maxbgmb <size_in_mb>           Set max size of data in flight for background requests (preload, write-behind, hedged reads). New background requests are dropped over the limit or while foreground requests wait. By default, this is set to 64(0 for unlimited)",
+        " --admissionwait <wait>           Set max wait time in milliseconds of a request held by maxrpcs or maxconnecting. After the wait, the request fails with EAGAIN. By default, this is set to 1000",
+        " --connwarmup <num_conn>          Set number of connections established in parallel right after mount, to avoid connection setup delay at the first burst of file accesses. Short-op connections are also filled up. File-io connections are warmed up only with --connreuse. By default, this is set to 0(no warm-up)",
+        " --directdata                     Set to read and write file data through connections to the resource server holding the replica, instead of relaying through the iRODS host. Falls back to the iRODS host when the resource server is not reachable. By default, this is disabled",
+        " --readstreams <num_streams>      Set max number of server-side descriptors opened for a read-only file. Readers interleaving on different regions of the file get their own descriptors, so reads do not need a seek request. By default, this is set to 1",
+        " --hosts <host[:port],...>        Set iRODS hosts serving the zone. New connections are spread over the hosts weighted by observed latency, and a host failing to connect is not used for 60 seconds. By default, irodsHost in the iRODS environment is used",
+        " --connwaittimeout <timeout>      Set timeout in milliseconds to wait for a connection released by others when all connections are in use. Metadata operations, then foreground reads and writes, then background requests are served, in order within each. After the timeout, a busy connection is shared. By default, this is set to 0(share without waiting)",
+        " --breakerfailures <num_failures> Set number of network failures in a row after which requests fail fast (EIO) without talking to the server for breakercooldown. A single request probes the server after the cool-down. By default, this is set to 0(disabled)",
+        " --breakercooldown <cooldown>     Set cool-down in seconds of breakerfailures. By default, this is set to 10",
         " --conntimeout <timeout>          Set timeout of a network connection. After the timeout, idle connections will be automatically closed. By default, this is set to 300(5 minutes)",
         " --connkeepalive <interval>       Set interval of keepalive requests. For every keepalive interval, keepalive message is sent to iCAT to keep network connections live. By default, this is set to 180(3 minutes)",
         " --conncheckinterval <interval>   Set intervals of connection timeout check. For every check intervals, all connections established are checked to figure out if they are timed-out. By default, this is set to 10(10 seconds)",
         " --apitimeout <timeout>           Set timeout of iRODS client API calls. If an API call does not respond before the timeout, the API call and the network connection associated with are killed. By default, this is set to 90(90 seconds)",
+        " --metadatatimeout <timeout>      Set timeout of metadata API calls (stat, list, create, rename, etc.). A timed-out stat, replica lookup or listing is retried on another pooled connection right away. By default, this is set to 30(30 seconds)",
+        " --iotimeout <timeout>            Set timeout of open, close, seek and reads/writes up to 64KB. A timed-out open, seek or read of a file opened for read is retried on another pooled connection right away, also for bulk reads. By default, this follows --apitimeout",
+        " --bulkiotimeout <timeout>        Set timeout of reads/writes larger than 64KB. By default, this follows --apitimeout",
         " --preloadblocks <num_blocks>     Set the number of blocks pre-fetched. By default, this is set to 3 (next 3 blocks in advance)",
+        " --stripes <num_stripes>          Set the number of blocks of a large file fetched in parallel over separate connections, like iget -N. By default, this is set to 0(off)",
+        " --stripeminsize <size_in_MB>     Set min size of a file read in stripes. By default, this is set to 32(32MB)",
         " --metadatacachetimeout <timeout> Set timeout of a metadata cache. Metadata caches are invalidated after the timeout. By default, this is set to 180(3 minutes)",
+        " --mockbackend <local_dir>        Serve files from a local directory through a mock iRODS backend instead of iRODS servers, for testing and benchmarking without a zone",
+        " --mocklatency <latency>          Set latency in microseconds added to every call to the mock backend. By default, this is set to 0",
+        " --mockbandwidth <bandwidth>      Set bandwidth in KB/s of reads/writes through the mock backend. By default, this is set to 0(unlimited)",
         ""
     };
     int i;
@@ -289,3 +330,27 @@ static void registerClientProgram(char *prog) {
         mySetenvStr(SP_OPTION, filename);
     }
 }
+
+/*
+ * Fill missing rods environment for the mock backend
+ */
+static void fillMockRodsEnv(rodsEnv *pEnv) {
+    if(strlen(pEnv->rodsHost) == 0) {
+        rstrcpy(pEnv->rodsHost, "localhost", NAME_LEN);
+    }
+    if(pEnv->rodsPort <= 0) {
+        pEnv->rodsPort = 1247;
+    }
+    if(strlen(pEnv->rodsUserName) == 0) {
+        rstrcpy(pEnv->rodsUserName, "rods", NAME_LEN);
+    }
+    if(strlen(pEnv->rodsZone) == 0) {
+        rstrcpy(pEnv->rodsZone, "tempZone", NAME_LEN);
+    }
+    if(strlen(pEnv->rodsHome) == 0) {
+        snprintf(pEnv->rodsHome, MAX_NAME_LEN, "/%s/home/%s", pEnv->rodsZone, pEnv->rodsUserName);
+    }
+    if(strlen(pEnv->rodsCwd) == 0) {
+        rstrcpy(pEnv->rodsCwd, pEnv->rodsHome, MAX_NAME_LEN);
+    }
+}
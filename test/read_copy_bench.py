@@ -0,0 +1,43 @@
+#!/usr/bin/python
+# Reads a file on an irodsFs mount and reports bytes copied per byte delivered
+# usage: read_copy_bench.py <mounted_file> [read_size]
+# e.g. with a mock backend: irodsFs --mockbackend /tmp/mock /tmp/mnt
+import os
+import sys
+import time
+
+sys.path.append(os.path.join(os.path.dirname(os.path.abspath(__file__)), '../bin'))
+import irodsFsCtl
+
+fn = sys.argv[1]
+read_size = 128 * 1024
+if len(sys.argv) > 2:
+    read_size = int(sys.argv[2])
+
+mount_path = os.path.dirname(os.path.abspath(fn))
+
+before = irodsFsCtl.get_read_copies(mount_path)
+assert before is not None
+
+start = time.time()
+total = 0
+fd = os.open(fn, os.O_RDONLY)
+while True:
+    data = os.read(fd, read_size)
+    if len(data) == 0:
+        break
+    total += len(data)
+os.close(fd)
+elapsed = time.time() - start
+
+after = irodsFsCtl.get_read_copies(mount_path)
+assert after is not None
+
+delivered = after[0] - before[0]
+direct = after[1] - before[1]
+copied = after[2] - before[2]
+
+print "read %d bytes in %.2f sec (%.1f MB/s)" % (total, elapsed, total / elapsed / 1024 / 1024)
+print "delivered: %d KB, received into FUSE buffer: %d KB, copied: %d KB" % (delivered, direct, copied)
+if delivered > 0:
+    print "copies per delivered byte: %.2f" % (float(copied) / delivered)
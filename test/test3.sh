@@ -0,0 +1,42 @@
+# write-behind against the mock backend
+# - blocks overwritten out of order in one open reach the backend in order
+# - an upload failing in background fails the write or close
+#   (the mock backend is a 2MB tmpfs, needs root to mount)
+dir=/tmp/fmnt
+dir2=/tmp/local2
+mock=/tmp/mock
+
+./clear_dir.sh $dir2
+./clear_dir.sh $mock
+mount -t tmpfs -o size=2m tmpfs $mock || exit -1
+
+# slow backend keeps uploads in flight
+export IRODSFS_MOCKBACKEND=$mock
+export IRODSFS_MOCKLATENCY=2000
+
+./start_fuse.sh $dir
+
+./write_ops.py $dir/100.bin $dir2/100.bin w:0:1048576:97 w:458752:65536:98 w:65536:65536:99 w:458752:1000:100 w:0:65536:101 w:983040:65536:102 w:65536:10:103 || exit -1
+
+# read back from the backend, not from the cache
+./end_fuse.sh $dir
+./start_fuse.sh $dir
+
+if ! cmp $dir/100.bin $dir2/100.bin
+then
+	echo [error] $dir/100.bin is not written in order
+	exit -1
+fi
+echo [success] $dir/100.bin is written in order
+
+dd if=/dev/zero of=$dir2/200.bin bs=1M count=4 2>/dev/null
+if cp $dir2/200.bin $dir/200.bin
+then
+	echo [error] copying $dir/200.bin over the backend capacity succeeded
+	exit -1
+fi
+echo [success] copying $dir/200.bin over the backend capacity failed
+
+rm -f $dir/100.bin $dir/200.bin
+./end_fuse.sh $dir
+umount $mock
@@ -0,0 +1,34 @@
+# dirty extents against the mock backend
+# overlapping and disjoint writes in a block are merged, and a truncate
+# in the middle of dirty data drops the part beyond the new size
+dir=/tmp/fmnt
+dir2=/tmp/local2
+mock=/tmp/mock
+
+./clear_dir.sh $dir2
+./clear_dir.sh $mock
+
+export IRODSFS_MOCKBACKEND=$mock
+
+./clear_fuse.sh $dir
+./start_fuse.sh $dir
+
+# disjoint and overlapping extents in the first block
+./write_ops.py $dir/100.bin $dir2/100.bin w:0:131072:97 w:100:10:98 w:4096:4096:99 w:105:4000:100 w:200000:100:101 || exit -1
+# truncate in the middle of dirty data, then extend with a hole
+./write_ops.py $dir/100.bin $dir2/100.bin w:1000:8192:102 t:5000 w:70000:10:103 || exit -1
+# truncate to zero and write past the old end
+./write_ops.py $dir/100.bin $dir2/100.bin w:0:100:104 t:0 w:300000:100:105 || exit -1
+
+./end_fuse.sh $dir
+./start_fuse.sh $dir
+
+if ! cmp $dir/100.bin $dir2/100.bin
+then
+	echo [error] $dir/100.bin differs after remount
+	exit -1
+fi
+echo [success] $dir/100.bin is same after remount
+
+rm -f $dir/100.bin
+./end_fuse.sh $dir
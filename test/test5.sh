@@ -0,0 +1,35 @@
+# cache invalidation against the mock backend
+# cached blocks and stats follow renames and unlinks of files
+dir=/tmp/fmnt
+mock=/tmp/mock
+
+./clear_dir.sh $mock
+
+export IRODSFS_MOCKBACKEND=$mock
+
+./clear_fuse.sh $dir
+./start_fuse.sh $dir
+
+echo abc > $dir/100.txt
+./file_exist.sh $dir/100.txt abc || exit -1
+
+# rename, then reuse the old name
+mv $dir/100.txt $dir/200.txt
+./file_not_exist.sh $dir/100.txt || exit -1
+./file_exist.sh $dir/200.txt abc || exit -1
+echo defgh > $dir/100.txt
+./file_exist.sh $dir/100.txt defgh || exit -1
+
+# unlink, then reuse the name
+rm $dir/200.txt
+./file_not_exist.sh $dir/200.txt || exit -1
+echo xy > $dir/200.txt
+./file_exist.sh $dir/200.txt xy || exit -1
+
+# rename over a cached file
+mv $dir/200.txt $dir/100.txt
+./file_not_exist.sh $dir/200.txt || exit -1
+./file_exist.sh $dir/100.txt xy || exit -1
+
+rm $dir/100.txt
+./end_fuse.sh $dir
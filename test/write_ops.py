@@ -0,0 +1,46 @@
+#!/usr/bin/python
+# Applies the same writes and truncates to a file on a mount and a local reference
+# file in one open each, then compares them after the file on the mount is closed
+# usage: write_ops.py <mounted_file> <local_file> <op> [<op> ...]
+#   w:<offset>:<length>:<byte>  write length bytes of the byte value at offset
+#   t:<size>                    truncate to size
+# e.g. write_ops.py /tmp/fmnt/1.bin /tmp/local2/1.bin w:0:131072:97 w:100:10:98 t:70000
+import os
+import sys
+
+
+def apply_ops(path, ops):
+    fd = os.open(path, os.O_RDWR | os.O_CREAT, 0o644)
+    try:
+        for op in ops:
+            fields = op.split(':')
+            if fields[0] == 'w':
+                offset = int(fields[1])
+                data = bytearray([int(fields[3])] * int(fields[2]))
+                os.lseek(fd, offset, os.SEEK_SET)
+                os.write(fd, bytes(data))
+            elif fields[0] == 't':
+                os.ftruncate(fd, int(fields[1]))
+            else:
+                raise ValueError('unknown op ' + op)
+    finally:
+        # errors of writes done in background are returned here
+        os.close(fd)
+
+
+def read_all(path):
+    with open(path, 'rb') as f:
+        return f.read()
+
+
+mounted = sys.argv[1]
+local = sys.argv[2]
+ops = sys.argv[3:]
+
+apply_ops(local, ops)
+apply_ops(mounted, ops)
+
+if read_all(mounted) != read_all(local):
+    sys.stdout.write('[error] %s differs from %s\n' % (mounted, local))
+    sys.exit(1)
+sys.stdout.write('[success] %s = %s\n' % (mounted, local))